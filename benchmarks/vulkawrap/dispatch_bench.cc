@@ -0,0 +1,102 @@
+//---- benchmarks/vulkawrap/dispatch_bench.cc -------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  dispatch_bench.cc
+/// \brief Measures the cost of recording a draw through a device dispatch
+///        table, against calling it through a loader trampoline. The ICD is
+///        mocked, and the trampoline does what the loader's does: it gets
+///        the loader's dispatch table from the first word of the dispatchable
+///        handle, and then calls into the ICD through it.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/loader/dispatch.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#if defined(_MSC_VER)
+  #define VWRAP_NOINLINE __declspec(noinline)
+#else
+  #define VWRAP_NOINLINE __attribute__((noinline))
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// The number of draws which are recorded by each benchmark.
+static constexpr size_t DrawsCx = 100000000;
+
+/// A dispatchable object, as the loader lays it out: the first word is the
+/// loader's dispatch table for the object.
+struct MockDispatchable {
+  const vwrap::loader::DeviceDispatch* loaderTable;  //!< Loader's table.
+  uint64_t                             vertexCount;  //!< Recorded vertices.
+};
+
+/// The mock ICD's draw, which only records the vertex count.
+VWRAP_NOINLINE void VKAPI_PTR mockCmdDraw(VkCommandBuffer commandBuffer,
+    uint32_t vertexCount, uint32_t, uint32_t, uint32_t) {
+  reinterpret_cast<MockDispatchable*>(commandBuffer)->vertexCount +=
+    vertexCount;
+}
+
+/// The loader's trampoline for vkCmdDraw, which is what an application which
+/// links the loader calls.
+VWRAP_NOINLINE void VKAPI_PTR trampolineCmdDraw(VkCommandBuffer commandBuffer,
+    uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex,
+    uint32_t firstInstance) {
+  const auto* table =
+    *reinterpret_cast<const vwrap::loader::DeviceDispatch* const*>(
+      commandBuffer);
+  table->vkCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex,
+                   firstInstance);
+}
+
+/// Times the recording of draws, and prints the time per draw.
+///
+/// \param name     The name of the benchmark.
+/// \param draw     The function which records a draw.
+/// \tparam Draw    The type of the function.
+template <typename Draw>
+void time(const std::string& name, Draw&& draw) {
+  const auto start = Clock::now();
+  for (size_t drawIdx = 0; drawIdx < DrawsCx; ++drawIdx) draw();
+  const auto seconds =
+    std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << std::left  << std::setw(30) << name << std::right
+            << std::fixed << std::setprecision(3) << std::setw(10)
+            << seconds * 1e9 / DrawsCx << " ns/draw\n";
+}
+
+} // annonymous namespace
+
+int main() {
+  vwrap::loader::DeviceDispatch dispatch;
+  dispatch.vkCmdDraw = mockCmdDraw;
+
+  MockDispatchable commandBuffer = { &dispatch, 0 };
+  auto* const vkCommandBuffer    =
+    reinterpret_cast<VkCommandBuffer>(&commandBuffer);
+
+  // The table's entry is copied to a volatile, as the table of a device is
+  // loaded at run time, so that the call can't be resolved at compile time.
+  volatile PFN_vkCmdDraw trampoline = trampolineCmdDraw;
+  time("Loader trampoline", [&] {
+    trampoline(vkCommandBuffer, 3, 1, 0, 0);
+  });
+  time("Device dispatch table", [&] {
+    dispatch.vkCmdDraw(vkCommandBuffer, 3, 1, 0, 0);
+  });
+  return commandBuffer.vertexCount == 2 * 3 * DrawsCx ? 0 : 1;
+}
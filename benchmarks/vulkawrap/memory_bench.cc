@@ -0,0 +1,288 @@
+//---- benchmarks/vulkawrap/memory_bench.cc ---------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  memory_bench.cc
+/// \brief Measures the allocation rate of the memory sub allocators, and of
+///        the device memory allocator compared to calling vkAllocateMemory
+///        for every resource. The comparison is made against a mock driver,
+///        which counts the driver allocations, and against a Vulkan device
+///        if one is available.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/memory/allocator.h"
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// The number of allocations which are made for each benchmark.
+static constexpr size_t AllocationCountCx = 1000000;
+
+/// The number of live allocations which each benchmark keeps.
+static constexpr size_t LiveAllocationsCx = 1024;
+
+/// Prints the rate of a benchmark.
+///
+/// \param name        The name of the benchmark.
+/// \param allocations The number of allocations which were made.
+/// \param start       The time the benchmark started.
+void report(const char* name, size_t allocations, Clock::time_point start) {
+  const auto seconds = std::chrono::duration<double>(
+                         Clock::now() - start).count();
+  std::cout << std::left  << std::setw(40) << name << std::right
+            << std::fixed << std::setprecision(2) << std::setw(12)
+            << allocations / seconds / 1e6 << " M allocations/s\n";
+}
+
+/// Benchmarks the TLSF allocator, with random sizes and alignments, freeing
+/// a random live allocation for each new allocation.
+void benchmarkTlsf() {
+  vwrap::TlsfAllocator                allocator(256ull << 20);
+  std::vector<vwrap::SubAllocation>   live(LiveAllocationsCx);
+  std::mt19937                        generator(42);
+  std::vector<VkDeviceSize>           sizes(AllocationCountCx);
+  for (auto& size : sizes) size = 256 + generator() % (64 << 10);
+
+  const auto start = Clock::now();
+  for (size_t allocationIdx = 0; allocationIdx < AllocationCountCx;
+       ++allocationIdx) {
+    auto& slot = live[allocationIdx % LiveAllocationsCx];
+    allocator.free(slot.handle);
+    slot = allocator.allocate(sizes[allocationIdx], 256);
+  }
+  report("TlsfAllocator", AllocationCountCx, start);
+}
+
+/// Benchmarks the linear allocator, from multiple threads.
+///
+/// \param threadCount The number of threads to allocate from.
+void benchmarkLinear(unsigned threadCount) {
+  vwrap::LinearAllocator allocator(~VkDeviceSize(0) >> 1);
+  const auto perThread = AllocationCountCx / threadCount;
+
+  const auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned threadIdx = 0; threadIdx < threadCount; ++threadIdx) {
+    threads.emplace_back([&allocator, perThread] {
+      for (size_t allocationIdx = 0; allocationIdx < perThread;
+           ++allocationIdx) {
+        allocator.allocate(1024, 256);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  const std::string name = "LinearAllocator (" + 
+                           std::to_string(threadCount) + " threads)";
+  report(name.c_str(), perThread * threadCount, start);
+}
+
+/// Benchmarks the pool allocator, from multiple threads.
+///
+/// \param threadCount The number of threads to allocate from.
+void benchmarkPool(unsigned threadCount) {
+  vwrap::PoolAllocator allocator(1024, 4096);
+  const auto perThread = AllocationCountCx / threadCount;
+
+  const auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned threadIdx = 0; threadIdx < threadCount; ++threadIdx) {
+    threads.emplace_back([&allocator, perThread] {
+      for (size_t allocationIdx = 0; allocationIdx < perThread;
+           ++allocationIdx) {
+        allocator.free(allocator.allocate().handle);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  const std::string name = "PoolAllocator (" + 
+                           std::to_string(threadCount) + " threads)";
+  report(name.c_str(), perThread * threadCount, start);
+}
+
+//---- Mock driver ----------------------------------------------------------//
+
+/// The number of memory allocations which the mock driver has made.
+size_t mockAllocations = 0;
+
+/// Makes a fake handle, which is only compared and never used.
+template <typename VkT>
+VkT fakeHandle(uintptr_t value) {
+  return reinterpret_cast<VkT>(value);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mockCreateDevice(VkPhysicalDevice,
+    const VkDeviceCreateInfo*, const VkAllocationCallbacks*,
+    VkDevice* device) {
+  *device = fakeHandle<VkDevice>(1);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mockDestroyDevice(VkDevice,
+    const VkAllocationCallbacks*) {}
+
+VKAPI_ATTR void VKAPI_CALL mockGetDeviceQueue(VkDevice, uint32_t, uint32_t,
+    VkQueue* queue) {
+  *queue = fakeHandle<VkQueue>(1);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mockAllocateMemory(VkDevice,
+    const VkMemoryAllocateInfo*, const VkAllocationCallbacks*,
+    VkDeviceMemory* memory) {
+  *memory = fakeHandle<VkDeviceMemory>(++mockAllocations);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mockFreeMemory(VkDevice, VkDeviceMemory,
+    const VkAllocationCallbacks*) {}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL mockGetDeviceProcAddr(VkDevice,
+    const char* name) {
+  if (!std::strcmp(name, "vkDestroyDevice"))
+    return reinterpret_cast<PFN_vkVoidFunction>(mockDestroyDevice);
+  if (!std::strcmp(name, "vkGetDeviceQueue"))
+    return reinterpret_cast<PFN_vkVoidFunction>(mockGetDeviceQueue);
+  if (!std::strcmp(name, "vkAllocateMemory"))
+    return reinterpret_cast<PFN_vkVoidFunction>(mockAllocateMemory);
+  if (!std::strcmp(name, "vkFreeMemory"))
+    return reinterpret_cast<PFN_vkVoidFunction>(mockFreeMemory);
+  return nullptr;
+}
+
+//---- Device benchmarks ----------------------------------------------------//
+
+/// Benchmarks the device memory allocator against vkAllocateMemory, and
+/// prints how many driver allocations each of them made.
+///
+/// \param device The device to allocate from.
+/// \param name   The name of the device, for the report.
+void benchmarkAllocator(const vwrap::Device& device, const std::string& name) {
+  vwrap::MemoryAllocator allocator(device);
+  const auto& dispatch = device.getDispatch();
+
+  VkMemoryRequirements requirements = {};
+  requirements.size           = 4096;
+  requirements.alignment      = 256;
+  requirements.memoryTypeBits = ~0u;
+  const auto memoryType = allocator.findMemoryType(requirements.memoryTypeBits,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  // Drivers limit the number of live allocations, so the raw benchmark keeps
+  // fewer of them alive.
+  const size_t rawCount = 10000;
+  std::vector<VkDeviceMemory> rawLive(64, VK_NULL_HANDLE);
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize       = requirements.size;
+  allocateInfo.memoryTypeIndex      = memoryType;
+
+  auto driverAllocations = mockAllocations;
+  auto start             = Clock::now();
+  for (size_t allocationIdx = 0; allocationIdx < rawCount; ++allocationIdx) {
+    auto& slot = rawLive[allocationIdx % rawLive.size()];
+    if (slot != VK_NULL_HANDLE)
+      dispatch.vkFreeMemory(device.getVkDevice(), slot, nullptr);
+    dispatch.vkAllocateMemory(device.getVkDevice(), &allocateInfo, nullptr,
+      &slot);
+  }
+  report(("vkAllocateMemory (" + name + ")").c_str(), rawCount, start);
+  if (mockAllocations != driverAllocations)
+    std::cout << "  driver allocations: "
+              << mockAllocations - driverAllocations << "\n";
+  for (auto memory : rawLive)
+    if (memory != VK_NULL_HANDLE)
+      dispatch.vkFreeMemory(device.getVkDevice(), memory, nullptr);
+
+  std::vector<vwrap::MemoryAllocation> live(LiveAllocationsCx);
+  driverAllocations = mockAllocations;
+  start             = Clock::now();
+  for (size_t allocationIdx = 0; allocationIdx < AllocationCountCx;
+       ++allocationIdx) {
+    auto& slot = live[allocationIdx % LiveAllocationsCx];
+    allocator.free(slot);
+    slot = allocator.allocate(requirements, 
+             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+  report(("MemoryAllocator (" + name + ")").c_str(), AllocationCountCx,
+         start);
+  if (mockAllocations != driverAllocations)
+    std::cout << "  driver allocations: "
+              << mockAllocations - driverAllocations << "\n";
+  for (const auto& allocation : live)
+    allocator.free(allocation);
+}
+
+/// Benchmarks the device memory allocator against vkAllocateMemory, with a
+/// mock driver, so that only the cost of the allocator is measured, and the
+/// number of driver allocations can be counted.
+void benchmarkMockDevice() {
+  vwrap::loader::InstanceDispatch instanceDispatch;
+  instanceDispatch.vkCreateDevice      = mockCreateDevice;
+  instanceDispatch.vkGetDeviceProcAddr = mockGetDeviceProcAddr;
+
+  vwrap::DeviceCapabilities capabilities;
+  capabilities.device = fakeHandle<VkPhysicalDevice>(1);
+  capabilities.properties.limits.bufferImageGranularity = 1024;
+  capabilities.queueFamilies.resize(1);
+  capabilities.queueFamilies[0].queueFlags = VK_QUEUE_GRAPHICS_BIT |
+    VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+  capabilities.queueFamilies[0].queueCount = 3;
+
+  auto& memory                             = capabilities.memoryProperties;
+  memory.memoryTypeCount                   = 1;
+  memory.memoryTypes[0].propertyFlags      = 
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  memory.memoryTypes[0].heapIndex          = 0;
+  memory.memoryHeapCount                   = 1;
+  memory.memoryHeaps[0].size               = 8ull << 30;
+
+  vwrap::Device device(instanceDispatch, vwrap::PhysicalDevice(capabilities));
+  benchmarkAllocator(device, "mock driver");
+}
+
+/// Benchmarks the device memory allocator against vkAllocateMemory, if there
+/// is a Vulkan device available.
+void benchmarkDevice() {
+  vwrap::detail::Instance instance("MemoryBench");
+  if (instance.vkInstance == VK_NULL_HANDLE ||
+      instance.deviceCapabilities().empty()) {
+    std::cout << "No Vulkan device, skipping the device benchmarks.\n";
+    return;
+  }
+
+  vwrap::PhysicalDevice physicalDevice(instance.deviceCapabilities()[0]);
+  vwrap::Device         device(instance, physicalDevice);
+  benchmarkAllocator(device, "device");
+}
+
+} // annonymous namespace
+
+int main() {
+  const unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  benchmarkTlsf();
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    benchmarkLinear(threads);
+    benchmarkPool(threads);
+  }
+  benchmarkMockDevice();
+  benchmarkDevice();
+}
@@ -0,0 +1,191 @@
+//---- benchmarks/vulkawrap/parallel_recording_bench.cc ---- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  parallel_recording_bench.cc
+/// \brief Measures how the job system, and recording with the parallel
+///        recorder, scale from one thread to all the hardware threads. The
+///        recording benchmark needs a Vulkan device, for which a software
+///        driver such as lavapipe or SwiftShader works.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/parallel_recorder.h"
+#include "vulkawrap/memory/allocator.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// The number of commands which are recorded each frame.
+static constexpr size_t CommandCountCx = 50000;
+
+/// The number of frames which are recorded for each thread count.
+static constexpr size_t FrameCountCx = 20;
+
+/// The number of times each item of the job system benchmark is hashed, to
+/// stand in for the cost of recording a draw.
+static constexpr uint32_t HashRoundsCx = 200;
+
+/// Gets the thread counts to benchmark, which are the powers of two up to
+/// the number of hardware threads, and the number of hardware threads.
+std::vector<uint32_t> getThreadCounts() {
+  const auto maxThreads = vwrap::util::JobSystem::defaultThreadCount();
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+    threadCounts.push_back(threads);
+  threadCounts.push_back(maxThreads);
+  return threadCounts;
+}
+
+/// Prints the time per frame of a benchmark, and its speedup over the single
+/// threaded run.
+///
+/// \param name        The name of the benchmark.
+/// \param threadCount The number of threads.
+/// \param seconds     The time per frame.
+/// \param baseline    The time per frame with one thread.
+void report(const std::string& name, uint32_t threadCount, double seconds,
+            double baseline) {
+  const auto label = name + " (" + std::to_string(threadCount) + " threads)";
+  std::cout << std::left  << std::setw(40) << label << std::right
+            << std::fixed << std::setprecision(3) << std::setw(10)
+            << seconds * 1e3 << " ms/frame" << std::setprecision(2)
+            << std::setw(8) << baseline / seconds << "x\n";
+}
+
+/// Benchmarks the job system alone, with work which is similar in cost to
+/// recording a draw.
+void benchmarkJobSystem() {
+  std::vector<uint64_t> results(CommandCountCx);
+  double baseline = 0.0;
+  for (const auto threadCount : getThreadCounts()) {
+    vwrap::util::JobSystem jobs(threadCount);
+    const auto chunkSize  = CommandCountCx / (threadCount * 4) + 1;
+    const auto chunkCount = (CommandCountCx + chunkSize - 1) / chunkSize;
+
+    const auto start = Clock::now();
+    for (size_t frameIdx = 0; frameIdx < FrameCountCx; ++frameIdx) {
+      jobs.parallelFor(chunkCount, [&] (size_t chunkIdx) {
+        const auto end = std::min((chunkIdx + 1) * chunkSize, CommandCountCx);
+        for (auto itemIdx = chunkIdx * chunkSize; itemIdx < end; ++itemIdx) {
+          uint64_t hash = itemIdx + frameIdx;
+          for (uint32_t round = 0; round < HashRoundsCx; ++round)
+            hash = hash * 6364136223846793005ull + 1442695040888963407ull;
+          results[itemIdx] = hash;
+        }
+      });
+    }
+    const auto seconds = std::chrono::duration<double>(
+                           Clock::now() - start).count() / FrameCountCx;
+    if (threadCount == 1) baseline = seconds;
+    report("JobSystem", threadCount, seconds, baseline);
+  }
+}
+
+/// Creates a small transfer buffer, with device local memory.
+///
+/// \param device    The device to create the buffer for.
+/// \param allocator The allocator for the memory of the buffer.
+/// \param memory    The memory of the buffer, to free.
+VkBuffer createBuffer(const vwrap::Device&       device   ,
+                      vwrap::MemoryAllocator&    allocator,
+                      vwrap::MemoryAllocation&   memory   ) {
+  VkBufferCreateInfo bufferInfo = {};
+  bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size               = 4096;
+  bufferInfo.usage              = VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkBuffer buffer = VK_NULL_HANDLE;
+  device.getDispatch().vkCreateBuffer(device.getVkDevice(), &bufferInfo,
+    nullptr, &buffer);
+  memory = allocator.allocateForBuffer(buffer, 0,
+             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  return buffer;
+}
+
+/// Benchmarks recording commands into secondaries with the parallel
+/// recorder, if there is a Vulkan device available. Small buffer copies are
+/// recorded, since they are valid without a render pass or pipeline, and
+/// cost the driver about as much as a draw to record.
+void benchmarkRecording() {
+  vwrap::detail::Instance instance("ParallelRecordingBench");
+  if (instance.vkInstance == VK_NULL_HANDLE ||
+      instance.deviceCapabilities().empty()) {
+    std::cout << "No Vulkan device, skipping the recording benchmarks.\n";
+    return;
+  }
+
+  vwrap::PhysicalDevice  physicalDevice(instance.deviceCapabilities()[0]);
+  vwrap::Device          device(instance, physicalDevice);
+  vwrap::MemoryAllocator allocator(device);
+  const auto& dispatch = device.getDispatch();
+  const auto  family   =
+    device.getQueueFamily(vwrap::QueueType::VW_GRAPHICS_QUEUE);
+
+  vwrap::MemoryAllocation srcMemory, dstMemory;
+  const auto src = createBuffer(device, allocator, srcMemory);
+  const auto dst = createBuffer(device, allocator, dstMemory);
+
+  VkCommandBufferInheritanceInfo inheritance = {};
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  double baseline = 0.0;
+  for (const auto threadCount : getThreadCounts()) {
+    vwrap::util::JobSystem        jobs(threadCount);
+    vwrap::CommandPoolManager     commandPools(device);
+    vwrap::ParallelRecorder       recorder(device, commandPools, jobs);
+
+    const auto start = Clock::now();
+    for (size_t frameIdx = 0; frameIdx < FrameCountCx; ++frameIdx) {
+      commandPools.beginFrame();
+      auto primary = commandPools.allocate(family);
+      dispatch.vkBeginCommandBuffer(primary, &beginInfo);
+      recorder.record(primary, family, inheritance, CommandCountCx,
+        [&] (VkCommandBuffer secondary, size_t begin, size_t end) {
+          for (auto commandIdx = begin; commandIdx < end; ++commandIdx) {
+            VkBufferCopy region = {};
+            region.srcOffset    = (commandIdx % 1024) * 4;
+            region.dstOffset    = region.srcOffset;
+            region.size         = 4;
+            dispatch.vkCmdCopyBuffer(secondary, src, dst, 1, &region);
+          }
+        });
+      dispatch.vkEndCommandBuffer(primary);
+    }
+    const auto seconds = std::chrono::duration<double>(
+                           Clock::now() - start).count() / FrameCountCx;
+    if (threadCount == 1) baseline = seconds;
+    report("ParallelRecorder", threadCount, seconds, baseline);
+  }
+
+  dispatch.vkDestroyBuffer(device.getVkDevice(), src, nullptr);
+  dispatch.vkDestroyBuffer(device.getVkDevice(), dst, nullptr);
+  allocator.free(srcMemory);
+  allocator.free(dstMemory);
+}
+
+} // annonymous namespace
+
+int main() {
+  benchmarkJobSystem();
+  benchmarkRecording();
+}
@@ -0,0 +1,93 @@
+//---- benchmarks/vulkawrap/result_bench.cc ---------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  result_bench.cc
+/// \brief Measures the cost of checking a successful VkResult, with a bare
+///        comparison, with AssertSuccess and CheckResult, and with a check
+///        which takes std::string arguments, as AssertSuccess used to.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/util/assert.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// The number of results which are checked by each benchmark.
+static constexpr size_t ChecksCx = 50000000;
+
+/// The result which is checked, which is volatile so that the checks can't
+/// be folded away.
+volatile VkResult successResult = VK_SUCCESS;
+
+/// The number of failures which were seen, so that the bare comparison
+/// isn't removed.
+size_t failures = 0;
+
+/// A check which takes std::string arguments, as AssertSuccess used to, so
+/// that a string is built for each argument on every call.
+///
+/// \param result  The result to check.
+/// \param message The message to print on failure.
+/// \param file    The file of the check.
+/// \param line    The line of the check.
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void stringCheck(VkResult result, const std::string& message,
+                 const std::string file, int line) {
+  if (result != VK_SUCCESS) {
+    std::cerr << file << " : " << line << " : " << message << "\n";
+    ++failures;
+  }
+}
+
+/// Times a check, and prints the time per check.
+///
+/// \param name     The name of the check.
+/// \param check    The check to run.
+/// \tparam Check   The type of the check.
+template <typename Check>
+void time(const std::string& name, Check&& check) {
+  const auto start = Clock::now();
+  for (size_t checkIdx = 0; checkIdx < ChecksCx; ++checkIdx) check();
+  const auto seconds =
+    std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << std::left  << std::setw(30) << name << std::right
+            << std::fixed << std::setprecision(3) << std::setw(10)
+            << seconds * 1e9 / ChecksCx << " ns/check\n";
+}
+
+} // annonymous namespace
+
+int main() {
+  time("Bare comparison", [] {
+    if (successResult != VK_SUCCESS) ++failures;
+  });
+  time("AssertSuccess", [] {
+    vwrap::util::AssertSuccess(successResult, "Failed to submit.\n");
+  });
+  time("CheckResult", [] {
+    if (!vwrap::util::CheckResult(successResult, "Failed to submit.\n"))
+      ++failures;
+  });
+  time("std::string arguments", [] {
+    stringCheck(successResult, "Failed to submit.\n", __FILE__, __LINE__);
+  });
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+//---- benchmarks/vulkawrap/shared_instance_bench.cc ------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  shared_instance_bench.cc
+/// \brief Measures the cost of copying and destroying shared instances from
+///        multiple threads, compared to std::shared_ptr.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/instance/instance.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// The number of copies each thread makes and destroys.
+static constexpr size_t CopiesPerThreadCx = 1000000;
+
+/// Prevents the compiler from removing the copies which are benchmarked.
+volatile uintptr_t Sink = 0;
+
+/// Copies and destroys a shared object, many times.
+///
+/// \param  shared The shared object to copy.
+/// \tparam Shared The type of the shared object.
+template <typename Shared>
+void copyAndDestroy(const Shared& shared) {
+  uintptr_t sink = 0;
+  for (size_t copyIdx = 0; copyIdx < CopiesPerThreadCx; ++copyIdx) {
+    Shared copy(shared);
+    sink += static_cast<bool>(copy);
+  }
+  Sink += sink;
+}
+
+/// Runs copyAndDestroy from a number of threads, which all share the same
+/// object, and prints the average time of each copy and destroy.
+///
+/// \param  name        The name of the benchmark.
+/// \param  shared      The shared object to copy.
+/// \param  threadCount The number of threads to copy from.
+/// \tparam Shared      The type of the shared object.
+template <typename Shared>
+void run(const char* name, const Shared& shared, unsigned threadCount) {
+  using Clock = std::chrono::steady_clock;
+
+  const auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+    threads.emplace_back([&shared] { copyAndDestroy(shared); });
+  for (auto& thread : threads)
+    thread.join();
+  const auto elapsed = std::chrono::duration<double, std::nano>(
+                         Clock::now() - start).count();
+
+  std::cout << std::left  << std::setw(32) << name 
+            << std::right << std::setw(4)  << threadCount << " threads: "
+            << std::fixed << std::setprecision(2) << std::setw(8)
+            << elapsed / CopiesPerThreadCx << " ns/copy\n";
+}
+
+} // annonymous namespace
+
+int main(int argc, char** argv) {
+  using namespace vwrap;
+
+  const unsigned maxThreads = argc > 1 
+    ? static_cast<unsigned>(std::atoi(argv[1]))
+    : std::max(1u, std::thread::hardware_concurrency());
+
+  ConcurrentSharedInstance    concurrentInstance;
+  NonConcurrentSharedInstance nonConcurrentInstance;
+  auto sharedPtr = std::make_shared<VkInstance>(VkInstance{});
+
+  // The non concurrent counter is not thread safe, so it is only run from a
+  // single thread, as the baseline of an uncontended count.
+  run("NonConcurrentSharedInstance", nonConcurrentInstance, 1);
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    run("ConcurrentSharedInstance", concurrentInstance, threads);
+    run("std::shared_ptr"         , sharedPtr         , threads);
+  }
+}
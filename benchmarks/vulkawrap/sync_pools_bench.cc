@@ -0,0 +1,150 @@
+//---- benchmarks/vulkawrap/sync_pools_bench.cc ------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  sync_pools_bench.cc
+/// \brief Measures the cost of creating and destroying a fence for every
+///        submission, against acquiring and releasing one from a fence pool,
+///        from one thread to all the hardware threads. The driver is mocked,
+///        with a heap allocation and a lock for each object, as drivers
+///        usually have, so that the benchmark runs without a device.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/sync_pools.h"
+#include "vulkawrap/util/job_system.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// The number of fences which each thread uses.
+static constexpr size_t FencesPerThreadCx = 200000;
+
+/// The number of fences which are in flight at once on each thread.
+static constexpr size_t FencesInFlightCx = 3;
+
+/// The lock which the mock driver takes for each object, as a driver's
+/// object allocator would.
+std::mutex driverMutex;
+
+/// The state of a mock fence.
+struct MockFence {
+  bool signalled;  //!< If the fence is signalled.
+};
+
+VkResult VKAPI_PTR mockCreateFence(VkDevice, const VkFenceCreateInfo*,
+    const VkAllocationCallbacks*, VkFence* fence) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  *fence = reinterpret_cast<VkFence>(new MockFence{ false });
+  return VK_SUCCESS;
+}
+
+void VKAPI_PTR mockDestroyFence(VkDevice, VkFence fence,
+    const VkAllocationCallbacks*) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  delete reinterpret_cast<MockFence*>(fence);
+}
+
+VkResult VKAPI_PTR mockResetFences(VkDevice, uint32_t count,
+    const VkFence* fences) {
+  for (uint32_t fenceIdx = 0; fenceIdx < count; ++fenceIdx)
+    reinterpret_cast<MockFence*>(fences[fenceIdx])->signalled = false;
+  return VK_SUCCESS;
+}
+
+/// Stands in for a submission which signals a fence.
+///
+/// \param fence The fence to signal.
+void submit(VkFence fence) {
+  reinterpret_cast<MockFence*>(fence)->signalled = true;
+}
+
+/// Runs a function on a number of threads, and gets the time it took.
+///
+/// \param threadCount The number of threads.
+/// \param function    The function to run on each thread.
+/// \tparam Function   The type of the function.
+template <typename Function>
+double timeThreads(uint32_t threadCount, Function&& function) {
+  std::vector<std::thread> threads;
+  const auto start = Clock::now();
+  for (uint32_t threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+    threads.emplace_back(function);
+  for (auto& thread : threads) thread.join();
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Prints the time per fence of a benchmark.
+///
+/// \param name        The name of the benchmark.
+/// \param threadCount The number of threads.
+/// \param seconds     The total time.
+void report(const std::string& name, uint32_t threadCount, double seconds) {
+  const auto label = name + " (" + std::to_string(threadCount) + " threads)";
+  const auto fences = FencesPerThreadCx * threadCount;
+  std::cout << std::left  << std::setw(40) << label << std::right
+            << std::fixed << std::setprecision(1) << std::setw(10)
+            << seconds * 1e9 / fences << " ns/fence\n";
+}
+
+} // annonymous namespace
+
+int main() {
+  vwrap::loader::DeviceDispatch dispatch;
+  dispatch.vkCreateFence  = mockCreateFence;
+  dispatch.vkDestroyFence = mockDestroyFence;
+  dispatch.vkResetFences  = mockResetFences;
+
+  const auto maxThreads = vwrap::util::JobSystem::defaultThreadCount();
+  for (uint32_t threadCount = 1; ; threadCount *= 2) {
+    threadCount = std::min(threadCount, maxThreads);
+
+    // Every submission creates a fence, and destroys it once it signals.
+    const auto rawSeconds = timeThreads(threadCount, [&dispatch] {
+      VkFenceCreateInfo fenceInfo = {};
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      VkFence inFlight[FencesInFlightCx] = {};
+      for (size_t useIdx = 0; useIdx < FencesPerThreadCx; ++useIdx) {
+        auto& fence = inFlight[useIdx % FencesInFlightCx];
+        if (fence != VK_NULL_HANDLE)
+          dispatch.vkDestroyFence(dispatch.device, fence, nullptr);
+        dispatch.vkCreateFence(dispatch.device, &fenceInfo, nullptr, &fence);
+        submit(fence);
+      }
+      for (auto fence : inFlight)
+        dispatch.vkDestroyFence(dispatch.device, fence, nullptr);
+    });
+    report("Create/destroy", threadCount, rawSeconds);
+
+    // Every submission acquires a fence, and releases it once it signals.
+    vwrap::FencePool fences(dispatch);
+    const auto poolSeconds = timeThreads(threadCount, [&fences] {
+      VkFence inFlight[FencesInFlightCx] = {};
+      for (size_t useIdx = 0; useIdx < FencesPerThreadCx; ++useIdx) {
+        auto& fence = inFlight[useIdx % FencesInFlightCx];
+        fences.release(fence);
+        fence = fences.acquire();
+        submit(fence);
+      }
+      for (auto fence : inFlight) fences.release(fence);
+    });
+    report("FencePool", threadCount, poolSeconds);
+
+    if (threadCount == maxThreads) break;
+  }
+}
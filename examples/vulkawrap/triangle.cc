@@ -14,30 +14,44 @@
 //
 //---------------------------------------------------------------------------//
 
-#include <vulkawrap/device/filter.h>
+#include <vulkawrap/device/device.h>
 #include <iostream>
 
 int main() {
   using namespace vwrap;
 
-  UniqueInstance instance = makeUniqueInstance();
-  NonConcurrentSharedInstance  ncSharedInstance;
-  ConcurrentSharedInstance     cSharedInstance;
-
+  // Concurrent shared instances with the same parameters share a single
+  // Vulkan instance, so every module which creates one uses the same one.
+  ConcurrentSharedInstance instance;
 
   // Define the DeviceSpecifier for any device and ay queue,
   // and another which must have a graphics queue. By default
   // all the requested queues must be found, but by passing 
   // false as the second parameter, a device will be created 
-  // if any of the specified queues are found.
-  DeviceSpecifier anyDevice(DeviceType::VW_ANY, QueueType::VW_ANY);
+  // if any of the specified queues are found. Specifiers can
+  // be constants, since the filter only reads them.
+  constexpr DeviceSpecifier anyDevice(DeviceType::VW_ANY, QueueType::VW_ANY);
   DeviceSpecifier graphicsDevice(DeviceType::VW_ANY, 
                                  QueueType::VW_GRAPHICS_QUEUE);
+
+  // Rank the graphics devices so that the fastest device is chosen when
+  // there are multiple GPUs.
+  graphicsDevice.rankBy(ScoringPolicy::throughput());
  
-  // Create a device filter -- moves ownershp of the instance to the filter.
-  DeviceFilter deviceFilter(std::move(instance), anyDevice, graphicsDevice);
+  // Create a device filter -- the filter keeps a reference to the instance.
+  // The devices are grouped by specifier, so the graphics devices are first.
+  DeviceFilter deviceFilter(instance, graphicsDevice, anyDevice);
 
   // Check if a graphics device is found, otherwise we can't draw!
-  if (!graphicsDevice.valid)
+  if (!deviceFilter.hasMatch(0))
     std::cerr << "Can't present without graphics device!\n";
+
+  if (deviceFilter.getPhysicalDeviceCount() == 0)
+    return 1;
+
+  // Create a logical device on the first matching physical device. The
+  // graphics, compute and transfer queues are placed on separate queue 
+  // families (or separate queues) wherever the device allows it.
+  Device device(deviceFilter.getInstance(), 
+                deviceFilter.getVwPhysicalDevice(0));
 }
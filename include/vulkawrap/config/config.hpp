@@ -34,6 +34,11 @@ static constexpr uint8_t AssertHandlingCx = TestingCx;
 ///   TestingCx  - Enables testing specializations of classes and functions.
 static constexpr uint8_t ErrorHandlingCx = TestingCx;
 
+/// Allows or removes the tracing of Vulkan calls, it can be:
+///   EnabledCx  - Counts and times every call through the dispatch tables.
+///   DisabledCx - Calls through plain function pointers, with no tracing.
+static constexpr uint8_t TracingCx = DisabledCx;
+
 }  // namespace config
 }  // namespace vwrap
 
@@ -0,0 +1,149 @@
+//---- include/vulkawrap/device/command_pools.h ------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  command_pools.h
+/// \brief Defines the command pool manager, which gives each recording thread
+///        its own command pools, and recycles them a frame at a time.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_COMMAND_POOLS_H
+#define VULKAWRAP_DEVICE_COMMAND_POOLS_H
+
+#include "device.h"
+#include "vulkawrap/util/thread_cache.h"
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <vector>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The default number of frames which can be in flight at once.
+static constexpr uint32_t DefaultFramesInFlightCx = 2;
+
+/// The number of command buffers which are allocated from the driver at a
+/// time, when a pool runs out.
+static constexpr uint32_t CommandBufferBatchSizeCx = 8;
+
+//---- Implementations ------------------------------------------------------//
+
+/// Manages the command pools of a device. Command pools are externally
+/// synchronized, so each thread which records commands is given its own pool
+/// for each queue family and frame in flight, which is created the first time
+/// the thread allocates from it. Allocation only touches the pools of the
+/// calling thread, so it never locks, and only calls the driver when a pool
+/// needs more command buffers.
+///
+/// Command buffers are never freed individually. When a frame slot comes
+/// around again, beginFrame waits for the fence which was given to endFrame
+/// the last time the slot was used, and then resets every pool of the slot,
+/// so that all of the command buffers which were allocated from them are
+/// reused.
+///
+/// beginFrame must not be called while other threads are allocating, which
+/// is the case at a frame boundary.
+///
+/// Example usage:
+/// \code
+/// CommandPoolManager commandPools(device);
+///
+/// while (running) {
+///   commandPools.beginFrame();
+///
+///   // On any thread:
+///   auto commandBuffer = commandPools.allocate(QueueType::VW_GRAPHICS_QUEUE);
+///   ...
+///
+///   commandPools.endFrame(frameFence);
+/// }
+/// \endcode
+class CommandPoolManager {
+ public:
+  /// Constructor which sets up the frame slots. No pools are created until a
+  /// thread allocates from them.
+  ///
+  /// \param device         The device to create the pools for, which must
+  ///        outlive the manager.
+  /// \param framesInFlight The number of frames which can be in flight.
+  CommandPoolManager(const Device& device                             ,
+                     uint32_t      framesInFlight = DefaultFramesInFlightCx);
+
+  /// Destructor which destroys all the pools. None of the command buffers may
+  /// still be executing.
+  ~CommandPoolManager();
+
+  CommandPoolManager(const CommandPoolManager&)            = delete;
+  CommandPoolManager& operator=(const CommandPoolManager&) = delete;
+
+  /// Allocates a command buffer for the current frame, from the calling
+  /// thread's pool for a queue family. Returns VK_NULL_HANDLE if the family
+  /// is not a family of the device.
+  ///
+  /// \param familyIndex The index of the queue family.
+  /// \param level       The level of the command buffer.
+  VkCommandBuffer allocate(
+    uint32_t             familyIndex                             ,
+    VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY );
+
+  /// Allocates a command buffer for the current frame, for the queue which
+  /// the device allocated for a type of work.
+  ///
+  /// \param queueType The type of work the command buffer is for.
+  /// \param level     The level of the command buffer.
+  VkCommandBuffer allocate(
+    QueueType            queueType                               ,
+    VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY ) {
+    return allocate(Owner.getQueueFamily(queueType), level);
+  }
+
+  /// Moves to the next frame slot. Waits for the fence of the last frame
+  /// which used the slot, and then resets all the pools of the slot. Returns
+  /// the index of the slot.
+  uint32_t beginFrame();
+
+  /// Sets the fence which signals when the command buffers of the current
+  /// frame have finished executing. The fence is not owned by the manager.
+  ///
+  /// \param fence The fence of the current frame.
+  void endFrame(VkFence fence);
+
+  /// Gets the index of the current frame slot.
+  uint32_t getFrameIndex() const {
+    return FrameIdx.load(std::memory_order_acquire);
+  }
+
+  /// Gets the number of frames which can be in flight.
+  uint32_t getFramesInFlight() const {
+    return FrameCount;
+  }
+
+ private:
+  /// The pools of a single thread, which are defined in the implementation.
+  struct ThreadPools;
+
+  const Device&                     Owner;        //!< The device.
+  uint32_t                          FrameCount;   //!< Frame slots.
+  uint32_t                          FamilyCount;  //!< Queue families.
+  std::atomic<uint32_t>             FrameIdx;     //!< Current slot.
+  std::vector<VkFence>              FrameFences;  //!< The fence of each slot.
+  util::ThreadCache<ThreadPools>    Threads;      //!< The pools of each
+                                                  //!< thread.
+
+  /// Gets the pools of the calling thread, creating them the first time the
+  /// thread uses the manager.
+  ThreadPools& getThreadPools();
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_COMMAND_POOLS_H
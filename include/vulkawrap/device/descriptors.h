@@ -0,0 +1,320 @@
+//---- include/vulkawrap/device/descriptors.h -------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  descriptors.h
+/// \brief Defines the descriptor allocator, which allocates descriptor sets
+///        from per thread pools for each set layout, recycles them a frame at
+///        a time, and caches sets which never change.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_DESCRIPTORS_H
+#define VULKAWRAP_DEVICE_DESCRIPTORS_H
+
+#include "vulkawrap/loader/dispatch.h"
+#include "vulkawrap/util/hash.hpp"
+#include "vulkawrap/util/thread_cache.h"
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vwrap {
+
+class ObjectInterner;
+
+//---- Constants ------------------------------------------------------------//
+
+/// The number of sets which each descriptor pool is sized for.
+static constexpr uint32_t DescriptorSetsPerPoolCx = 64;
+
+//---- Implementations ------------------------------------------------------//
+
+/// A descriptor to write to a set, for a single element of a binding. Only
+/// the info which matches the type of the descriptor is used.
+struct DescriptorWrite {
+  uint32_t               binding;       //!< The binding to write.
+  uint32_t               arrayElement;  //!< The element of the binding.
+  VkDescriptorType       type;          //!< The type of the descriptor.
+  VkDescriptorBufferInfo bufferInfo;    //!< For buffer descriptors.
+  VkDescriptorImageInfo  imageInfo;     //!< For image and sampler
+                                        //!< descriptors.
+  VkBufferView           texelView;     //!< For texel buffer descriptors.
+
+  /// Makes a write of a buffer descriptor.
+  ///
+  /// \param binding The binding to write.
+  /// \param type    The type of the descriptor.
+  /// \param buffer  The buffer.
+  /// \param offset  The offset of the descriptor in the buffer.
+  /// \param range   The size of the descriptor.
+  static DescriptorWrite buffer(uint32_t         binding,
+                                VkDescriptorType type   ,
+                                VkBuffer         buffer ,
+                                VkDeviceSize     offset ,
+                                VkDeviceSize     range  ) {
+    DescriptorWrite write = {};
+    write.binding           = binding;
+    write.type              = type;
+    write.bufferInfo.buffer = buffer;
+    write.bufferInfo.offset = offset;
+    write.bufferInfo.range  = range;
+    return write;
+  }
+
+  /// Makes a write of an image or sampler descriptor.
+  ///
+  /// \param binding The binding to write.
+  /// \param type    The type of the descriptor.
+  /// \param sampler The sampler, if the type uses one.
+  /// \param view    The image view, if the type uses one.
+  /// \param layout  The layout of the image when it is accessed.
+  static DescriptorWrite image(uint32_t         binding,
+                               VkDescriptorType type   ,
+                               VkSampler        sampler,
+                               VkImageView      view   ,
+                               VkImageLayout    layout ) {
+    DescriptorWrite write = {};
+    write.binding               = binding;
+    write.type                  = type;
+    write.imageInfo.sampler     = sampler;
+    write.imageInfo.imageView   = view;
+    write.imageInfo.imageLayout = layout;
+    return write;
+  }
+};
+
+using DescriptorWriteVec = std::vector<DescriptorWrite>;
+using LayoutBindingVec   = std::vector<VkDescriptorSetLayoutBinding>;
+
+/// A descriptor set layout of the allocator. Every set of the layout is
+/// allocated from pools which only hold sets of the layout, and are sized for
+/// exactly DescriptorSetsPerPoolCx of them, so allocation from a pool never
+/// fails because of fragmentation or the wrong mix of descriptors.
+struct DescriptorLayout {
+  VkDescriptorSetLayout             layout;     //!< The interned layout.
+  uint32_t                          index;      //!< The index of the layout
+                                                //!< in the allocator.
+  std::vector<VkDescriptorPoolSize> poolSizes;  //!< The sizes of a pool.
+};
+
+namespace detail {
+
+/// The words which identify a layout or a set.
+using DescriptorSignature     = util::Signature;
+
+/// Hashes a descriptor signature.
+using DescriptorSignatureHash = util::SignatureHash;
+
+/// Map of descriptor signatures to values.
+/// \tparam Value The type of the values.
+template <typename Value>
+using DescriptorSignatureMap =
+  std::unordered_map<DescriptorSignature, Value, DescriptorSignatureHash>;
+
+/// Appends the signature of the bindings of a set layout.
+///
+/// \param bindings  The bindings of the layout.
+/// \param signature The signature to append to.
+void appendSignature(const LayoutBindingVec& bindings ,
+                     DescriptorSignature&    signature);
+
+/// Appends the signature of the writes of a set.
+///
+/// \param layoutIndex The index of the layout of the set.
+/// \param writes      The writes of the set.
+/// \param signature   The signature to append to.
+void appendSignature(uint32_t                  layoutIndex,
+                     const DescriptorWriteVec& writes     ,
+                     DescriptorSignature&      signature  );
+
+} // namespace detail
+
+/// Allocates the descriptor sets of a device. Each thread has its own
+/// descriptor pools for each layout and frame in flight, so allocation only
+/// touches the calling thread's pools, never locks, and only calls the driver
+/// for the set itself, or to create a pool when the thread's pools for the
+/// layout are full.
+///
+/// Sets are never freed individually. When a frame slot comes around again,
+/// beginFrame waits for the fence which was given to endFrame the last time
+/// the slot was used, and then resets every pool of the slot which was used,
+/// which returns all of its sets at once.
+///
+/// Sets whose descriptors never change, such as those for materials, can be
+/// cached instead. A cached set is allocated and written the first time its
+/// descriptors are seen, and then the same set is returned for the same
+/// layout and descriptors, without writing it again. Each thread keeps the
+/// cached sets it has used, so only the first lookup of a set on a thread
+/// locks. Cached sets stay valid until clearCachedSets is called.
+///
+/// beginFrame and clearCachedSets must not be called while other threads are
+/// allocating, which is the case at a frame boundary.
+///
+/// Example usage:
+/// \code
+/// ObjectInterner      interner(device.getDispatch());
+/// DescriptorAllocator descriptors(interner,
+///                                 commandPools.getFramesInFlight());
+/// auto layout = descriptors.getLayout(bindings);
+///
+/// while (running) {
+///   descriptors.beginFrame();
+///
+///   // On any thread:
+///   auto perDraw  = descriptors.allocate(*layout, {
+///     DescriptorWrite::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+///                             uniforms, offset, sizeof(DrawUniforms)) });
+///   auto material = descriptors.getCachedSet(*materialLayout, textures);
+///   ...
+///
+///   descriptors.endFrame(frameFence);
+/// }
+/// \endcode
+class DescriptorAllocator {
+ public:
+  /// Constructor which sets up the frame slots. No pools are created until a
+  /// thread allocates from them.
+  ///
+  /// \param interner       The interner of the device, which creates the
+  ///        set layouts, and must outlive the allocator.
+  /// \param framesInFlight The number of frames which can be in flight,
+  ///        which is normally the same as for the command pool manager.
+  DescriptorAllocator(ObjectInterner& interner      ,
+                      uint32_t        framesInFlight);
+
+  /// Destructor which destroys all of the pools. None of the sets may still
+  /// be in use by the device.
+  ~DescriptorAllocator();
+
+  DescriptorAllocator(const DescriptorAllocator&)            = delete;
+  DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+  /// Gets the layout for a list of bindings, so that identical layouts share
+  /// their pools. The Vulkan layout is interned, so it is the same handle as
+  /// the interner returns for the bindings, in any order. Returns nullptr if
+  /// the layout could not be created. The layout is owned by the allocator.
+  ///
+  /// \param bindings The bindings of the layout, in any order.
+  const DescriptorLayout* getLayout(const LayoutBindingVec& bindings);
+
+  /// Allocates a set for the current frame, from the calling thread's pools
+  /// for its layout, and writes descriptors to it. Returns VK_NULL_HANDLE if
+  /// the set could not be allocated.
+  ///
+  /// \param layout The layout of the set.
+  /// \param writes The descriptors to write, if any.
+  VkDescriptorSet allocate(
+    const DescriptorLayout&   layout                       ,
+    const DescriptorWriteVec& writes = DescriptorWriteVec());
+
+  /// Gets the cached set for a layout and its descriptors, allocating and
+  /// writing it if it is not cached yet. Returns VK_NULL_HANDLE if the set
+  /// could not be allocated.
+  ///
+  /// \param layout The layout of the set.
+  /// \param writes The descriptors of the set.
+  VkDescriptorSet getCachedSet(const DescriptorLayout&   layout,
+                               const DescriptorWriteVec& writes);
+
+  /// Frees all of the cached sets, which must no longer be in use by the
+  /// device. This should be done when any of the resources which they
+  /// reference are destroyed.
+  void clearCachedSets();
+
+  /// Moves to the next frame slot. Waits for the fence of the last frame
+  /// which used the slot, and then resets all the pools of the slot. Returns
+  /// the index of the slot.
+  uint32_t beginFrame();
+
+  /// Sets the fence which signals when the work of the current frame has
+  /// finished executing. The fence is not owned by the allocator.
+  ///
+  /// \param fence The fence of the current frame.
+  void endFrame(VkFence fence);
+
+  /// Gets the number of sets which are cached.
+  size_t getCachedSetCount();
+
+  /// Gets the index of the current frame slot.
+  uint32_t getFrameIndex() const {
+    return FrameIdx.load(std::memory_order_acquire);
+  }
+
+  /// Gets the number of frames which can be in flight.
+  uint32_t getFramesInFlight() const {
+    return FrameCount;
+  }
+
+ private:
+  /// The pools of a single layout, which are defined in the implementation.
+  struct LayoutPools;
+  /// The pools and cached sets of a single thread, which are defined in the
+  /// implementation.
+  struct ThreadDescriptors;
+
+  /// Map of interned Vulkan layouts to layouts.
+  using LayoutMap =
+    std::unordered_map<VkDescriptorSetLayout,
+                       std::unique_ptr<DescriptorLayout>>;
+  /// Map of set signatures to cached sets.
+  using SetMap    = detail::DescriptorSignatureMap<VkDescriptorSet>;
+  /// List of the pools of each layout.
+  using PoolsVec  = std::vector<std::unique_ptr<LayoutPools>>;
+
+  ObjectInterner&               Interner;     //!< Interns the layouts.
+  const loader::DeviceDispatch& Dispatch;     //!< The device.
+  uint32_t                      FrameCount;   //!< Frame slots.
+  std::atomic<uint32_t>         FrameIdx;     //!< Current slot.
+  std::atomic<uint64_t>         CacheEpoch;   //!< Changes when the cached
+                                              //!< sets are cleared.
+  std::vector<VkFence>          FrameFences;  //!< The fence of each slot.
+  util::ThreadCache<ThreadDescriptors>
+                                Threads;      //!< The state of each thread.
+  std::mutex                    Mutex;        //!< Protects the state below.
+  LayoutMap                     Layouts;      //!< The layouts.
+  SetMap                        CachedSets;   //!< The cached sets.
+  PoolsVec                      CachedPools;  //!< The pools of the cached
+                                              //!< sets, for each layout.
+
+  /// Gets the state of the calling thread, creating it the first time the
+  /// thread uses the allocator.
+  ThreadDescriptors& getThreadDescriptors();
+
+  /// Allocates a set from a list of pools for a layout, creating a pool if
+  /// they are all full.
+  ///
+  /// \param pools  The pools to allocate from.
+  /// \param layout The layout of the set.
+  VkDescriptorSet allocateFrom(LayoutPools&            pools ,
+                               const DescriptorLayout& layout);
+
+  /// Writes descriptors to a set.
+  ///
+  /// \param set     The set to write to.
+  /// \param writes  The descriptors to write.
+  /// \param scratch The write infos to fill, which are kept between calls so
+  ///        they are not reallocated.
+  void write(VkDescriptorSet                    set    ,
+             const DescriptorWriteVec&          writes ,
+             std::vector<VkWriteDescriptorSet>& scratch);
+
+  /// Resets all of the pools of a list which have been used.
+  ///
+  /// \param pools The pools to reset.
+  void reset(LayoutPools& pools);
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_DESCRIPTORS_H
@@ -0,0 +1,169 @@
+//---- include/vulkawrap/device/device.h ------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  device.h
+/// \brief Defines a wrapper around a Vulkan logical device, which creates
+///        the device and its queues from a filtered physical device.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_DEVICE_H
+#define VULKAWRAP_DEVICE_DEVICE_H
+
+#include "filter.h"
+#include "queue.h"
+#include "vulkawrap/loader/dispatch.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+namespace vwrap {
+
+/// Wrapper around a Vulkan logical device. The device owns its device level
+/// dispatch table, and the queues which were allocated for it.
+///
+/// Example usage:
+/// \code
+/// DeviceFilter deviceFilter(std::move(instance), graphicsDevice);
+///
+/// // Graphics, async compute and transfer work each get their own queue
+/// // where the device allows it.
+/// Device device(deviceFilter.getInstance(), 
+///               deviceFilter.getVwPhysicalDevice(0));
+///
+/// VkQueue transferQueue = device.getQueue(QueueType::VW_TRANSFER_QUEUE);
+/// \endcode
+class Device {
+ public:
+  /// Constructor to create a logical device.
+  ///
+  /// \param instance       The instance which the physical device is from.
+  /// \param physicalDevice The physical device to create the device for.
+  /// \param queueRequests  The queues to create for the device. By default a 
+  ///        graphics, compute and a transfer queue are requested.
+  /// \param extensions     The device extensions to enable.
+  /// \param features       The device features to enable, or nullptr.
+  /// \param next           A structure chain to pass to the device create 
+  ///        info, to enable extension features.
+  Device(
+    const detail::Instance&         instance                                ,
+    const PhysicalDevice&           physicalDevice                          ,
+    const QueueRequestVec&          queueRequests = defaultQueueRequests()  ,
+    const std::vector<const char*>& extensions    = std::vector<const char*>{},
+    const VkPhysicalDeviceFeatures* features      = nullptr                 ,
+    const void*                     next          = nullptr
+  );
+
+  /// Constructor to create a logical device through an instance dispatch
+  /// table, rather than an instance, so that the driver can be replaced.
+  ///
+  /// \param dispatch       The dispatch table of the instance which the
+  ///        physical device is from.
+  /// \param physicalDevice The physical device to create the device for.
+  /// \param queueRequests  The queues to create for the device.
+  /// \param extensions     The device extensions to enable.
+  /// \param features       The device features to enable, or nullptr.
+  /// \param next           A structure chain to pass to the device create
+  ///        info, to enable extension features.
+  Device(
+    const loader::InstanceDispatch& dispatch                                ,
+    const PhysicalDevice&           physicalDevice                          ,
+    const QueueRequestVec&          queueRequests = defaultQueueRequests()  ,
+    const std::vector<const char*>& extensions    = std::vector<const char*>{},
+    const VkPhysicalDeviceFeatures* features      = nullptr                 ,
+    const void*                     next          = nullptr
+  );
+
+  /// Destructor which destroys the device.
+  ~Device();
+
+  Device(const Device&)            = delete;
+  Device& operator=(const Device&) = delete;
+
+  /// Gets the graphics, compute and transfer queue requests, each with full
+  /// priority.
+  static QueueRequestVec defaultQueueRequests() {
+    return QueueRequestVec{ QueueRequest(QueueType::VW_GRAPHICS_QUEUE),
+                            QueueRequest(QueueType::VW_COMPUTE_QUEUE ),
+                            QueueRequest(QueueType::VW_TRANSFER_QUEUE) };
+  }
+
+  /// Gets the Vulkan device.
+  VkDevice getVkDevice() const {
+    return VulkanDevice;
+  }
+
+  /// Gets the device level dispatch table.
+  const loader::DeviceDispatch& getDispatch() const {
+    return Dispatch;
+  }
+
+  /// Gets the physical device which the device was created from.
+  const PhysicalDevice& getPhysicalDevice() const {
+    return Physical;
+  }
+
+  /// Gets the properties (and so the limits) of the physical device.
+  const VkPhysicalDeviceProperties& getProperties() const {
+    return Properties;
+  }
+
+  /// Gets the memory types and heaps of the physical device.
+  const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const {
+    return MemoryProperties;
+  }
+
+  /// Gets the properties of the queue families of the physical device.
+  const QueueFamilyPropVec& getQueueFamilyProperties() const {
+    return QueueFamilies;
+  }
+
+  /// Gets the allocations of the queues, in the order they were requested.
+  const QueueAllocationVec& getQueueAllocations() const {
+    return Allocations;
+  }
+
+  /// Gets the queue for a request. Returns VK_NULL_HANDLE if there is no
+  /// such request, or the device failed to be created.
+  ///
+  /// \param requestIdx The index of the request to get the queue for.
+  VkQueue getQueue(size_t requestIdx) const {
+    return requestIdx < Queues.size() ? Queues[requestIdx] : VK_NULL_HANDLE;
+  }
+
+  /// Gets the queue for the first request of a type of work. Returns
+  /// VK_NULL_HANDLE if no queue of the type was requested or allocated.
+  ///
+  /// \param queueType The type of work to get the queue for.
+  VkQueue getQueue(QueueType queueType) const;
+
+  /// Gets the queue family index of the first request for a type of work.
+  /// Returns VK_QUEUE_FAMILY_IGNORED if no queue of the type was allocated.
+  ///
+  /// \param queueType The type of work to get the queue family for.
+  uint32_t getQueueFamily(QueueType queueType) const;
+
+ private:
+  loader::DeviceDispatch            Dispatch;          //!< The device level
+                                                       //!< functions.
+  VkDevice                          VulkanDevice;      //!< The device.
+  PhysicalDevice                    Physical;          //!< The physical device.
+  VkPhysicalDeviceProperties        Properties;        //!< Device limits.
+  VkPhysicalDeviceMemoryProperties  MemoryProperties;  //!< Memory types.
+  QueueFamilyPropVec                QueueFamilies;     //!< The queue families.
+  QueueAllocationVec                Allocations;       //!< Where each queue
+                                                       //!< was allocated.
+  std::vector<VkQueue>              Queues;            //!< The queue for each
+                                                       //!< allocation.
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_DEVICE_H
@@ -19,8 +19,11 @@
 #define VULKAWRAP_DEVICE_FILTER_H
 
 #include "queue.h"
+#include "../instance/capabilities.h"
 #include "../instance/instance.h"
 #include <vulkan/vulkan.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 
 namespace vwrap {
@@ -30,6 +33,7 @@ namespace vwrap {
 struct      DeviceSpecifier;
 struct      DeviceView;
 struct      PhysicalDevice;
+struct      ScoringPolicy;
 enum class  DeviceType : uint8_t;
 
 //---- Aliases --------------------------------------------------------------//
@@ -61,66 +65,151 @@ enum class DeviceType : uint8_t {
 /// Wrapper for a Vulkan Physical Device to include the queues assosciated
 /// with the specific physical device.
 struct PhysicalDevice {
-  VkPhysicalDevice    device;       //!< The acrual physical device.
-  QueueTypeVec        queueTypes;   //!< The types of queues for the device.
-  QueueIdVec          queueIds;     //!< The id's of the queues for the device.
-
-  /// Default constructor -- sets the vectors to empty.
-  PhysicalDevice() : queueTypes(0), queueIds(0) {};
+  VkPhysicalDevice          device;        //!< The acrual physical device.
+  QueueTypeMask             queueTypes;    //!< The requested types of 
+                                           //!< queues which the device 
+                                           //!< supports.
+  QueueFamilyMask           queueFamilies; //!< The families which support
+                                           //!< any of the requested types.
+  const DeviceCapabilities* capabilities;  //!< The capability snapshot of
+                                           //!< the device, owned by the 
+                                           //!< instance.
+  float                     score;         //!< The score of the device, 
+                                           //!< from the specifier it 
+                                           //!< matched.
+  uint32_t                  specifier;     //!< The index of the specifier
+                                           //!< which the device matched.
+
+  /// Default constructor -- sets the queue sets to empty.
+  PhysicalDevice() 
+  : queueTypes(0), queueFamilies(0), capabilities(nullptr), score(0.0f),
+    specifier(0) {};
 
   /// Constructor which takes a vulkan physical device.
   ///
   /// \param vkPhysicalDevice The vulkan physical device.
   PhysicalDevice(const VkPhysicalDevice& vkPhysicalDevice) 
-  : device(vkPhysicalDevice), queueTypes(0), queueIds(0) {}
+  : device(vkPhysicalDevice), queueTypes(0), queueFamilies(0), 
+    capabilities(nullptr), score(0.0f), specifier(0) {}
+
+  /// Constructor which takes the capability snapshot of a physical device.
+  ///
+  /// \param deviceCapabilities The capabilities of the physical device.
+  PhysicalDevice(const DeviceCapabilities& deviceCapabilities)
+  : device(deviceCapabilities.device), queueTypes(0), queueFamilies(0),
+    capabilities(&deviceCapabilities), score(0.0f), specifier(0) {}
 
-  /// Constructor which takes a Vulkan Physical Device, the queue types and 
-  /// indexes of those queues.
+  /// Constructor which takes a Vulkan Physical Device, the queue types it
+  /// supports and the families which support them.
   ///
   /// \param vkPhysicalDevice The vulkan physical device.
   /// \param qTypes           The types of queus which are supported.
-  /// \param qIds             The indexes of each queue type.
+  /// \param qFamilies        The families which support the types.
   PhysicalDevice(const VkPhysicalDevice vkPhysicalDevice, 
-    const QueueTypeVec& qTypes, const QueueIdVec qIds) 
-  : device(vkPhysicalDevice), queueTypes(qTypes), queueIds(qIds) {}
+    QueueTypeMask qTypes, QueueFamilyMask qFamilies) 
+  : device(vkPhysicalDevice), queueTypes(qTypes), queueFamilies(qFamilies), 
+    capabilities(nullptr), score(0.0f), specifier(0) {}
 
-  /// Checks for the requested queues, and adds those which are a match.
+  /// Checks for the requested queues, and adds those which are a match. Only
+  /// the first QueueFamilyMaskBitsCx families are checked.
   ///
+  /// \param families            The queue families of the device, from the
+  ///        device's capability snapshot.
   /// \param requestedQueueTypes The type of queues that the device must
   ///        support.
-  void addSupportedQueues(const QueueTypeVec& requestedQueueTypes) {
-    uint32_t queueCount, queueId = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueCount, nullptr);
+  void addSupportedQueues(const QueueFamilyPropVec& families           ,
+                          QueueTypeMask             requestedQueueTypes) {
+    const auto familyCount = std::min(QueueFamilyMaskBitsCx,
+      static_cast<uint32_t>(families.size()));
+    for (uint32_t familyIdx = 0; familyIdx < familyCount; ++familyIdx) {
+      const auto matches = 
+        queueFamilyTypes(families[familyIdx].queueFlags) & requestedQueueTypes;
+      if (!matches) continue;
+
+      queueTypes    |= static_cast<QueueTypeMask>(matches);
+      queueFamilies |= QueueFamilyMask(1) << familyIdx;
+    }
+  }
+};
 
-    if (queueCount < 1) return;
+/// Weights which are used to score the devices which match a specifier, so 
+/// that the filter can rank the devices. Each specifier's devices are only
+/// ranked against each other, since the scores of different policies are on
+/// different scales. A default constructed policy scores every device as
+/// zero, which leaves the devices in the order in which they were
+/// enumerated.
+struct ScoringPolicy {
+  float deviceLocalMemory;  //!< Score per GiB of the largest device local
+                            //!< memory heap.
+  float computeLimits;      //!< Score per 1024 compute invocations in a work
+                            //!< group, and per 32KiB of shared memory.
+  float discreteGpu;        //!< Score for a discrete GPU.
+  float integratedGpu;      //!< Score for an integrated GPU.
+  float dedicatedTransfer;  //!< Score for a transfer only queue family.
+  float asyncCompute;       //!< Score for a compute family without graphics.
+
+  /// Constructor to create a policy -- by default everything scores zero.
+  ///
+  /// \param memoryWeight     The score per GiB of device local memory.
+  /// \param computeWeight    The score per unit of compute limits.
+  /// \param discreteWeight   The score for a discrete GPU.
+  /// \param integratedWeight The score for an integrated GPU.
+  /// \param transferWeight   The score for a dedicated transfer family.
+  /// \param asyncWeight      The score for an async compute family.
+  constexpr ScoringPolicy(float memoryWeight     = 0.0f, 
+                          float computeWeight    = 0.0f,
+                          float discreteWeight   = 0.0f,
+                          float integratedWeight = 0.0f,
+                          float transferWeight   = 0.0f,
+                          float asyncWeight      = 0.0f)
+  : deviceLocalMemory(memoryWeight), computeLimits(computeWeight),
+    discreteGpu(discreteWeight), integratedGpu(integratedWeight),
+    dedicatedTransfer(transferWeight), asyncCompute(asyncWeight) {}
+
+  /// Gets a policy which favours the device with the highest throughput: 
+  /// discrete GPUs first, then the most device memory and compute, with
+  /// dedicated transfer and async compute families breaking ties.
+  static constexpr ScoringPolicy throughput() {
+    return ScoringPolicy(1.0f, 1.0f, 1000.0f, 100.0f, 10.0f, 10.0f);
+  }
 
-    QueueFamilyPropVec queueProperties;
-    queueProperties.resize(queueCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueCount, 
-      queueProperties.data());
-    
-    for (; queueId < queueCount; ++queueId) {
-      for (const auto& queueType : requestedQueueTypes) {
-        if ((!(static_cast<uint8_t>(queueProperties[queueId].queueFlags)  & 
-               static_cast<uint8_t>(queueType))                         ) &&
-            (queueType != QueueType::VW_ANY                            )) {
-          continue;
-        }
-
-        queueIds.push_back(queueId);
-        queueTypes.push_back(queueType);
-      }
-    }
+  /// Returns true if the policy gives any device a non-zero score.
+  constexpr bool ranks() const {
+    return deviceLocalMemory != 0.0f || computeLimits     != 0.0f ||
+           discreteGpu       != 0.0f || integratedGpu     != 0.0f ||
+           dedicatedTransfer != 0.0f || asyncCompute      != 0.0f;
   }
 };
 
+/// Scores a device with a scoring policy -- a higher score is better.
+///
+/// \param capabilities The capabilities of the device to score.
+/// \param policy       The policy to score the device with.
+float scoreDevice(const DeviceCapabilities& capabilities, 
+                  const ScoringPolicy&      policy      );
+
+/// Ranks physical devices which have been matched and scored. The devices
+/// are grouped by the specifier which they matched, in the order of the
+/// specifiers, and each group is sorted by score, with the highest first.
+/// The sort is stable, so devices with the same score stay in the order in
+/// which they were enumerated.
+///
+/// \param physicalDevices The devices to rank.
+void rankPhysicalDevices(PhysicalDeviceVec& physicalDevices);
+
 /// Struct for specifying a type of physical device and the type of queues 
-/// which it needs to support.
+/// which it needs to support. The specifier is a literal type, so it can be
+/// made and checked at compile time:
+///
+/// \code
+/// constexpr DeviceSpecifier computeDevice(DeviceType::VW_DISCRETE_GPU,
+///   QueueType::VW_COMPUTE_QUEUE, QueueType::VW_TRANSFER_QUEUE);
+/// static_assert(computeDevice.needsQueue(QueueType::VW_COMPUTE_QUEUE), "");
+/// \endcode
 struct DeviceSpecifier {
-  QueueTypeVec  queueTypes; //!< The types of queues the device must support.
+  QueueTypeMask queueTypes; //!< The types of queues the device must support.
   DeviceType    deviceType; //!< The type of device to look for.
-  bool          valid;      //!< If the device specifier is valid -- a device
-                            //!< matching the specifiers was found.
+  ScoringPolicy scoring;    //!< How to rank the devices which match.
   bool          mustSupportAllQueues;  //!< If the physical device must 
                                        //!< support all queues.
 
@@ -129,8 +218,8 @@ struct DeviceSpecifier {
   ///
   /// \note While only the first template parameter is checked for equivalence 
   /// wih a QueueType, if any of the parameter pack is not QueueType then
-  /// construction of the vector will fail since the vector cannot be filled
-  /// with differing types, which is what we want.
+  /// building the mask will fail since queueTypeMask only takes QueueTypes,
+  /// which is what we want.
   ///
   /// \param  deviceType The type of device to look for.
   /// \param  qType      The type of the first queue which must be supported 
@@ -143,9 +232,9 @@ struct DeviceSpecifier {
   ///         be of type QuueType.
   template <typename QType, typename... QTypes, typename = 
     std::enable_if_t<std::is_same<QueueType, QType>::value>>
-  DeviceSpecifier(DeviceType device, QType qType, QTypes... qTypes)
-  : queueTypes{qType, qTypes...}, deviceType(device), valid(false),
-    mustSupportAllQueues(true) {}
+  constexpr DeviceSpecifier(DeviceType device, QType qType, QTypes... qTypes)
+  : queueTypes(queueTypeMask(qType, qTypes...)), deviceType(device), 
+    scoring(), mustSupportAllQueues(true) {}
   
   /// Constructor which allows for the specificatio of allowing the device to
   /// be found if only some of the queues are found.
@@ -160,10 +249,35 @@ struct DeviceSpecifier {
   ///         be of type QuueType.
   template <typename QType, typename... QTypes, typename = 
     std::enable_if_t<std::is_same<QueueType, QType>::value>>
-  DeviceSpecifier(DeviceType device, bool supportAllQueues,
+  constexpr DeviceSpecifier(DeviceType device, bool supportAllQueues,
     QType qType, QTypes... qTypes)
-  : queueTypes{qType, qTypes...}, deviceType(device), valid(false),
-    mustSupportAllQueues(supportAllQueues) {}
+  : queueTypes(queueTypeMask(qType, qTypes...)), deviceType(device), 
+    scoring(), mustSupportAllQueues(supportAllQueues) {}
+
+  /// Returns true if the specifier requires a type of queue.
+  ///
+  /// \param queueType The type of queue to check for.
+  constexpr bool needsQueue(QueueType queueType) const {
+    return (queueTypes & static_cast<QueueTypeMask>(queueType)) != 0;
+  }
+
+  /// Returns true if a device which supports a set of the requested queue
+  /// types meets the requirements of the specifier.
+  ///
+  /// \param supportedTypes The requested types which the device supports.
+  constexpr bool isSatisfiedBy(QueueTypeMask supportedTypes) const {
+    return !mustSupportAllQueues || 
+           (supportedTypes & queueTypes) == queueTypes;
+  }
+
+  /// Sets the policy to rank the devices which match the specifier with, and
+  /// returns the specifier.
+  ///
+  /// \param policy The policy to score the matching devices with.
+  constexpr DeviceSpecifier& rankBy(const ScoringPolicy& policy) {
+    scoring = policy;
+    return *this;
+  }
 };
 
 /// Class which allows vulkan physical devices to be filtered based on their
@@ -173,21 +287,28 @@ struct DeviceSpecifier {
 /// Example usage:
 /// \code 
 /// DeviceFilter deviceFilter(
-///   instance         , // A UniqueInstance with application state
+///   instance         , // A shared or unique instance
 ///   graphicsDevice   , // First queus
 ///   cpuComputeDevice   // Rest of the device specifiers ...
 /// );
 ///
-/// // The constructor changes the validity of the specifier if a device
-/// // meeting the specifiers requirements is found ...
-/// if (!graphicsQueue.valid)
+/// // The specifiers are only read, so they can be constants. The filter
+/// // records which of them a device meeting the requirements was found
+/// // for ...
+/// if (!deviceFilter.hasMatch(0))
 ///   // exit ...
 ///
+/// // The devices are grouped by the specifier which they matched, in the
+/// // order of the specifiers. If the specifiers have a scoring policy, each
+/// // group is ranked, so the first device is the best match for the first
+/// // specifier ...
+/// auto bestDevice = deviceFilter.getVwPhysicalDevice(0);
 /// /endcode
 class DeviceFilter {
  public:
   /// Constructor which takes a single device specifier for the type of
-  /// physical device which is wanted.
+  /// physical device which is wanted. The filter keeps a reference to the
+  /// instance, so a UniqueInstance can be moved into it.
   ///
   /// \param  instance             The instance for vulkan state.
   /// \param  mustSUpportAllQueues If all the specifier queus must be found for
@@ -201,21 +322,41 @@ class DeviceFilter {
   template <typename SpecifierType, typename... SpecifierTypes, typename = 
     std::enable_if_t<std::is_same<DeviceSpecifier, SpecifierType>::value>>
   DeviceFilter(
-    UniqueInstance     instance        ,
-    SpecifierType&     deviceSpecifier , 
-    SpecifierTypes&... deviceSpecifiers
+    std::shared_ptr<const detail::Instance> instance        ,
+    const SpecifierType&                    deviceSpecifier ,
+    const SpecifierTypes&...                deviceSpecifiers
   );
 
+  /// Constructor which takes the device specifiers for the types of physical
+  /// device which are wanted, and shares an instance, so that the filter
+  /// uses the same instance as the rest of the application.
+  ///
+  /// \param  instance         The shared instance for vulkan state.
+  /// \param  deviceSpecifier  The first device specifier.
+  /// \param  deviceSpecifiers The rest of the device specifiers.
+  /// \tparam SpecifierType    The type of the first specifier -- must be 
+  ///         of type DeviceSpecifier.
+  /// \tparam SpecifierTypes   The types of the rest of the specifiers --
+  ///         be of types DeviceSpecifier.
+  template <typename SpecifierType, typename... SpecifierTypes, typename = 
+    std::enable_if_t<std::is_same<DeviceSpecifier, SpecifierType>::value>>
+  DeviceFilter(
+    const ConcurrentSharedInstance& instance        ,
+    const SpecifierType&            deviceSpecifier ,
+    const SpecifierTypes&...        deviceSpecifiers
+  )
+  : DeviceFilter(instance.getSharedPtr(), deviceSpecifier,
+                 deviceSpecifiers...) {}
+
   /// Adds a vulkan physical device to the vector of physical devices, if the
   /// device has the requested queues, and returns true, otherwise returns
   /// false.
   ///
-  /// \param physicalDevice       The physical device to add.
-  /// \param queueTypes           The types of queues the device must support.
-  /// \param mustSupportAllQueues If the device must find all the queus to be
-  ///        added.
-  bool addIfQueuesAreSupported(const VkPhysicalDevice& physicalDevice, 
-    const QueueTypeVec& queueTypes, bool mustSupportAllQueues);
+  /// \param capabilities The capabilities of the physical device to add.
+  /// \param specifier    The specifier with the queues the device must
+  ///        support.
+  bool addIfQueuesAreSupported(const DeviceCapabilities& capabilities, 
+    const DeviceSpecifier& specifier);
 
   /// Gets a vulkan physical device from the available physical devices.
   ///
@@ -231,14 +372,38 @@ class DeviceFilter {
     return PhysicalDevices[deviceIdx];
   }
 
+  /// Gets the number of physical devices which matched the specifiers.
+  size_t getPhysicalDeviceCount() const {
+    return PhysicalDevices.size();
+  }
+
+  /// Returns true if a physical device matched a specifier.
+  ///
+  /// \param specifierIdx The index of the specifier, in the order they were
+  ///        given to the constructor.
+  bool hasMatch(size_t specifierIdx) const {
+    return std::any_of(PhysicalDevices.begin(), PhysicalDevices.end(),
+      [specifierIdx] (const PhysicalDevice& device) {
+        return device.specifier == specifierIdx;
+      });
+  }
+
+  /// Gets the instance which the filter references, so that logical devices
+  /// can be created from the filtered physical devices.
+  const detail::Instance& getInstance() const {
+    return *Instance;
+  }
+
  protected:
-  UniqueInstance     Instance;         //!< Stores per-application state.
-  PhysicalDeviceVec  PhysicalDevices;  //!< CPUs | GPUs for vulkan.
+  std::shared_ptr<const detail::Instance> Instance;         //!< App state.
+  PhysicalDeviceVec                       PhysicalDevices;  //!< CPUs | GPUs.
     
  private:
-  /// Gets all the physical devices available, and returns a vector of the
-  /// devices.
-  std::vector<VkPhysicalDevice> getPhysicalDevices() const;
+  /// Gets the capabilities of all the physical devices available. These are
+  /// captured once by the instance, and shared by every filter.
+  const DeviceCapabilitiesVec& getPhysicalDevices() const {
+    return Instance->deviceCapabilities();
+  }
 };
 
 namespace {
@@ -247,15 +412,12 @@ namespace {
 /// Returns true if the physical device meets the type requirements of the 
 /// specifier.
 ///
-/// \param vkPhysicalDevice The vulkan physical device to check.
-/// \param deviceSpecifier  The specifier to try and find a match with.
-bool physicalDeviceTypeIsCorrect(const VkPhysicalDevice& vkPhysicalDevice, 
-                                 const DeviceSpecifier&  deviceSpecifier) {
-  VkPhysicalDeviceProperties physicalDeviceProperties = {};
-  vkGetPhysicalDeviceProperties(vkPhysicalDevice, &physicalDeviceProperties);
-
-  if (static_cast<uint8_t>(physicalDeviceProperties.deviceType) ==
-      static_cast<uint8_t>(deviceSpecifier.deviceType)          ) {
+/// \param capabilities    The capabilities of the physical device to check.
+/// \param deviceSpecifier The specifier to try and find a match with.
+bool physicalDeviceTypeIsCorrect(const DeviceCapabilities& capabilities   , 
+                                 const DeviceSpecifier&    deviceSpecifier) {
+  if (static_cast<uint8_t>(capabilities.properties.deviceType) ==
+      static_cast<uint8_t>(deviceSpecifier.deviceType)        ) {
     return true;
   }
   if (deviceSpecifier.deviceType == DeviceType::VW_ANY)
@@ -269,29 +431,33 @@ bool physicalDeviceTypeIsCorrect(const VkPhysicalDevice& vkPhysicalDevice,
 //---- Template Implementations ---------------------------------------------//
 
 template <typename SpecifierType, typename... SpecifierTypes, typename>
-DeviceFilter::DeviceFilter(UniqueInstance instance,
-    SpecifierType& deviceSpecifier, SpecifierTypes&... deviceSpecifiers)
+DeviceFilter::DeviceFilter(std::shared_ptr<const detail::Instance> instance,
+    const SpecifierType& deviceSpecifier,
+    const SpecifierTypes&... deviceSpecifiers)
 :   Instance(std::move(instance)), PhysicalDevices(0) { 
-  auto physicalDevices = getPhysicalDevices();
+  const auto& physicalDevices = getPhysicalDevices();
   
-  // Make a vector of the specifiers.
-  auto specifierVec = 
-    std::vector<SpecifierType>{deviceSpecifier, deviceSpecifiers...};
+  // Make an array of the specifiers, so that they can be indexed. Its size
+  // is known from the pack, so it doesn't allocate.
+  std::array<const SpecifierType*, 1 + sizeof...(SpecifierTypes)>
+    specifiers = {{ &deviceSpecifier, &deviceSpecifiers... }};
 
   // Go through the physical devices and add those which match the specifier
-  for (auto& physicalDevice : physicalDevices) {
-    for (auto& specifier : specifierVec) {
-      if (!physicalDeviceTypeIsCorrect(physicalDevice, specifier))
+  for (const auto& physicalDevice : physicalDevices) {
+    for (uint32_t specifierIdx = 0; specifierIdx < specifiers.size();
+         ++specifierIdx) {
+      const auto* specifier = specifiers[specifierIdx];
+      if (!physicalDeviceTypeIsCorrect(physicalDevice, *specifier))
         continue;  // Go to next iteration if the device type is incorrect.
 
-      if (addIfQueuesAreSupported(physicalDevice, specifier.queueTypes, 
-            specifier.mustSupportAllQueues)) {
-        specifier.valid = true;
-      } else {
-        specifier.valid = false;
-      }
+      if (addIfQueuesAreSupported(physicalDevice, *specifier)) {
+        PhysicalDevices.back().score     = 
+          scoreDevice(physicalDevice, specifier->scoring);
+        PhysicalDevices.back().specifier = specifierIdx;
+      } 
     }
   }
+  rankPhysicalDevices(PhysicalDevices);
 }
 
 } // namespace vwrap
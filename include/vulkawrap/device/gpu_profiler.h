@@ -0,0 +1,279 @@
+//---- include/vulkawrap/device/gpu_profiler.h ------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  gpu_profiler.h
+/// \brief Defines the GPU profiler, which times regions of command buffers
+///        with timestamp queries, and exports the timings as Chrome traces.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_GPU_PROFILER_H
+#define VULKAWRAP_DEVICE_GPU_PROFILER_H
+
+#include "queue.h"
+#include "vulkawrap/loader/dispatch.h"
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+namespace vwrap {
+
+class Device;
+
+//---- Constants ------------------------------------------------------------//
+
+/// The default number of frames the profiler keeps queries for, which is how
+/// many frames later the results are read back.
+static constexpr uint32_t DefaultProfilerFramesCx = 4;
+
+/// The default number of timestamp queries for each frame. Each scope uses
+/// two.
+static constexpr uint32_t DefaultProfilerQueriesCx = 512;
+
+/// The number of resolved frames which are kept until they are taken.
+static constexpr size_t ProfilerHistoryCx = 120;
+
+/// The id of a scope which isn't being timed.
+static constexpr uint32_t InvalidScopeCx = ~0u;
+
+//---- Implementations ------------------------------------------------------//
+
+/// The time a scope took on the GPU.
+struct GpuScopeTiming {
+  std::string name;        //!< The name of the scope.
+  uint32_t    parent;      //!< The index of the enclosing scope, or
+                           //!< InvalidScopeCx for the frame.
+  uint32_t    depth;       //!< The depth of the scope, 0 for the frame.
+  double      beginNs;     //!< When the scope began, in nanoseconds since
+                           //!< the first profiled frame began.
+  double      durationNs;  //!< How long the scope took, in nanoseconds.
+};
+
+/// The timings of the scopes of a frame. The first scope is the whole
+/// frame, and every scope comes after its parent.
+struct GpuFrameTimings {
+  uint64_t                    frame;   //!< The index of the frame.
+  std::vector<GpuScopeTiming> scopes;  //!< The timings of the scopes.
+};
+
+/// Profiles GPU work with timestamp queries. Each frame has its own query
+/// pool, and the pools are used in turn, so the results of a frame are read
+/// back several frames later, once the GPU has finished with them. Results
+/// are only read if they are all available, so the profiler never waits on
+/// the GPU -- a frame whose results still aren't ready when its pool is
+/// needed again is dropped.
+///
+/// Timestamps are converted to nanoseconds with the timestampPeriod of the
+/// device. The timings are available through takeFrames, and as Chrome trace
+/// JSON, which can be loaded by chrome://tracing or Perfetto.
+///
+/// The profiler is not thread safe, so scopes must be recorded by one thread
+/// at a time, in the order the command buffers are submitted.
+///
+/// Example usage:
+/// \code
+/// GpuProfiler profiler(device);
+///
+/// profiler.beginFrame(commandBuffer);
+/// {
+///   GpuScope scope(profiler, commandBuffer, "Shadows");
+///   ...
+/// }
+/// profiler.endFrame(commandBuffer);
+///
+/// const auto frames = profiler.takeFrames();
+/// GpuProfiler::writeChromeTrace("gpu.json", frames);
+/// \endcode
+class GpuProfiler {
+ public:
+  /// Constructor which creates the query pools.
+  ///
+  /// \param dispatch        The dispatch table of the device, which must
+  ///        outlive the profiler.
+  /// \param timestampPeriod The nanoseconds per timestamp tick.
+  /// \param validBits       The number of valid bits in the timestamps.
+  /// \param frameCount      The number of frames to keep queries for.
+  /// \param queryCount      The number of queries for each frame.
+  GpuProfiler(const loader::DeviceDispatch& dispatch                       ,
+              float                         timestampPeriod                ,
+              uint32_t validBits  = 64                                     ,
+              uint32_t frameCount = DefaultProfilerFramesCx                ,
+              uint32_t queryCount = DefaultProfilerQueriesCx               );
+
+  /// Constructor which creates the query pools for a device, with the
+  /// timestamp period of the device, and the valid timestamp bits of the
+  /// queue family which the profiled work is submitted to.
+  ///
+  /// \param device     The device, which must outlive the profiler.
+  /// \param frameCount The number of frames to keep queries for.
+  /// \param queryCount The number of queries for each frame.
+  /// \param queueType  The type of work which is profiled.
+  explicit GpuProfiler(const Device& device                               ,
+                       uint32_t      frameCount = DefaultProfilerFramesCx ,
+                       uint32_t      queryCount = DefaultProfilerQueriesCx,
+                       QueueType     queueType  = QueueType::VW_GRAPHICS_QUEUE);
+
+  /// Destructor which destroys the query pools.
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler&)            = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+  /// Begins profiling a frame. This reads back the frames which are ready,
+  /// and resets the queries of the frame, so it must be recorded outside of
+  /// a render pass, before any other scopes of the frame.
+  ///
+  /// \param commandBuffer The first command buffer of the frame.
+  void beginFrame(VkCommandBuffer commandBuffer);
+
+  /// Ends profiling a frame. All the scopes of the frame must have ended.
+  ///
+  /// \param commandBuffer The last command buffer of the frame.
+  void endFrame(VkCommandBuffer commandBuffer);
+
+  /// Begins a scope, which is nested in the scopes which are open. Returns
+  /// the id of the scope, or InvalidScopeCx if the frame has run out of
+  /// queries, in which case the scope isn't timed.
+  ///
+  /// \param commandBuffer The command buffer to time.
+  /// \param name          The name of the scope.
+  /// \param stage         The stage to write the timestamp after.
+  uint32_t beginScope(
+    VkCommandBuffer         commandBuffer                                ,
+    const std::string&      name                                         ,
+    VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT    );
+
+  /// Ends a scope, which must be the innermost open scope.
+  ///
+  /// \param commandBuffer The command buffer to time.
+  /// \param scope         The id of the scope.
+  /// \param stage         The stage to write the timestamp after.
+  void endScope(
+    VkCommandBuffer         commandBuffer                                ,
+    uint32_t                scope                                        ,
+    VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT );
+
+  /// Reads back the results of the frames which the GPU has finished,
+  /// without waiting for the others.
+  void resolve();
+
+  /// Takes the timings of the frames which have been read back since the
+  /// last call, oldest first.
+  std::vector<GpuFrameTimings> takeFrames();
+
+  /// Gets the number of frames whose results were dropped, because they
+  /// weren't ready when their queries were needed again.
+  uint64_t getDroppedFrameCount() const {
+    return DroppedFrames;
+  }
+
+  /// Converts frame timings to Chrome trace JSON. Scopes are complete events
+  /// on a single track, so they nest as they did in the frame.
+  ///
+  /// \param frames The timings of the frames.
+  static std::string
+  toChromeTrace(const std::vector<GpuFrameTimings>& frames);
+
+  /// Writes frame timings to a Chrome trace file. Returns true if the file
+  /// was written.
+  ///
+  /// \param path   The path of the file.
+  /// \param frames The timings of the frames.
+  static bool writeChromeTrace(const std::string&                  path  ,
+                               const std::vector<GpuFrameTimings>& frames);
+
+ private:
+  /// A scope which has been recorded, but not read back.
+  struct PendingScope {
+    std::string name;        //!< The name of the scope.
+    uint32_t    parent;      //!< The index of the enclosing scope.
+    uint32_t    depth;       //!< The depth of the scope.
+    uint32_t    beginQuery;  //!< The query of the start timestamp.
+    uint32_t    endQuery;    //!< The query of the end timestamp.
+  };
+
+  /// The queries and scopes of a frame.
+  struct FrameSlot {
+    VkQueryPool               pool;        //!< The queries of the frame.
+    uint64_t                  frame;       //!< The frame which used it.
+    bool                      pending;     //!< If it is waiting to be read.
+    uint32_t                  usedCount;   //!< The number of queries used.
+    std::vector<PendingScope> scopes;      //!< The scopes of the frame.
+  };
+
+  const loader::DeviceDispatch& Dispatch;       //!< The device.
+  double                        Period;         //!< Nanoseconds per tick.
+  uint64_t                      TickMask;       //!< The valid tick bits.
+  uint32_t                      QueryCount;     //!< Queries per frame.
+  std::vector<FrameSlot>        Slots;          //!< The slot of each frame.
+  uint64_t                      FrameIndex;     //!< The current frame.
+  std::vector<uint32_t>         OpenScopes;     //!< The open scopes.
+  bool                          HasEpoch;       //!< If the epoch is set.
+  uint64_t                      Epoch;          //!< The first tick.
+  std::vector<uint64_t>         Results;        //!< Result scratch.
+  std::vector<GpuFrameTimings>  Resolved;       //!< Frames read back.
+  uint64_t                      DroppedFrames;  //!< Frames not read back.
+
+  /// Gets the slot of the current frame.
+  FrameSlot& currentSlot() {
+    return Slots[FrameIndex % Slots.size()];
+  }
+
+  /// Creates the query pools.
+  ///
+  /// \param frameCount The number of frames to keep queries for.
+  void createPools(uint32_t frameCount);
+
+  /// Reads back the results of a slot, if they are all available. Returns
+  /// true if they were read.
+  ///
+  /// \param slot The slot to read back.
+  bool resolve(FrameSlot& slot);
+};
+
+/// Times the commands which are recorded while it is alive.
+///
+/// Example usage:
+/// \code
+/// {
+///   GpuScope scope(profiler, commandBuffer, "Lighting");
+///   vkCmdDraw(...);
+/// }
+/// \endcode
+class GpuScope {
+ public:
+  /// Constructor which begins the scope.
+  ///
+  /// \param profiler      The profiler to time the scope with.
+  /// \param commandBuffer The command buffer to time.
+  /// \param name          The name of the scope.
+  GpuScope(GpuProfiler& profiler, VkCommandBuffer commandBuffer,
+           const std::string& name)
+  : Profiler(profiler), CommandBuffer(commandBuffer),
+    Scope(profiler.beginScope(commandBuffer, name)) {}
+
+  /// Destructor which ends the scope.
+  ~GpuScope() {
+    Profiler.endScope(CommandBuffer, Scope);
+  }
+
+  GpuScope(const GpuScope&)            = delete;
+  GpuScope& operator=(const GpuScope&) = delete;
+
+ private:
+  GpuProfiler&    Profiler;       //!< The profiler.
+  VkCommandBuffer CommandBuffer;  //!< The command buffer.
+  uint32_t        Scope;          //!< The id of the scope.
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_GPU_PROFILER_H
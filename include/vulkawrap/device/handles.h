@@ -0,0 +1,105 @@
+//---- include/vulkawrap/device/handles.h ------------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  handles.h
+/// \brief Defines the deleters, and unique and shared handle types, for the
+///        Vulkan objects which are created from a logical device.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_HANDLES_H
+#define VULKAWRAP_DEVICE_HANDLES_H
+
+#include "vulkawrap/loader/dispatch.h"
+#include "vulkawrap/util/handle.hpp"
+
+namespace vwrap {
+
+//---- Handle List ----------------------------------------------------------//
+
+/// The objects which are created from a device, and the functions which
+/// destroy them. Objects which are allocated from a pool (command buffers
+/// and descriptor sets) are not listed, since they are freed with the pool.
+#define VWRAP_DEVICE_HANDLES(VW_HANDLE)                                       \
+  VW_HANDLE(DeviceMemory       , vkFreeMemory                )               \
+  VW_HANDLE(Fence              , vkDestroyFence              )               \
+  VW_HANDLE(Semaphore          , vkDestroySemaphore          )               \
+  VW_HANDLE(Event              , vkDestroyEvent              )               \
+  VW_HANDLE(QueryPool          , vkDestroyQueryPool          )               \
+  VW_HANDLE(Buffer             , vkDestroyBuffer             )               \
+  VW_HANDLE(BufferView         , vkDestroyBufferView         )               \
+  VW_HANDLE(Image              , vkDestroyImage              )               \
+  VW_HANDLE(ImageView          , vkDestroyImageView          )               \
+  VW_HANDLE(ShaderModule       , vkDestroyShaderModule       )               \
+  VW_HANDLE(PipelineCache      , vkDestroyPipelineCache      )               \
+  VW_HANDLE(Pipeline           , vkDestroyPipeline           )               \
+  VW_HANDLE(PipelineLayout     , vkDestroyPipelineLayout     )               \
+  VW_HANDLE(Sampler            , vkDestroySampler            )               \
+  VW_HANDLE(DescriptorSetLayout, vkDestroyDescriptorSetLayout)               \
+  VW_HANDLE(DescriptorPool     , vkDestroyDescriptorPool     )               \
+  VW_HANDLE(Framebuffer        , vkDestroyFramebuffer        )               \
+  VW_HANDLE(RenderPass         , vkDestroyRenderPass         )               \
+  VW_HANDLE(CommandPool        , vkDestroyCommandPool        )
+
+//---- Deleters -------------------------------------------------------------//
+
+/// Deleter for a logical device. This stores the dispatch table of the
+/// device, which must outlive the handle.
+struct DeviceDeleter {
+  const loader::DeviceDispatch* dispatch = nullptr;  //!< The device's table.
+
+  /// Destroys the device.
+  ///
+  /// \param device The device to destroy.
+  void operator()(VkDevice device) const {
+    dispatch->vkDestroyDevice(device, nullptr);
+  }
+};
+
+/// Defines the deleter for an object which is created from a device. Each
+/// deleter stores only a pointer to the dispatch table of the device, which
+/// holds both the device handle and the destroy function.
+#define VWRAP_DEFINE_DELETER(type, destroy)                                   \
+  struct type##Deleter {                                                      \
+    const loader::DeviceDispatch* dispatch = nullptr;                         \
+                                                                              \
+    void operator()(Vk##type handle) const {                                  \
+      dispatch->destroy(dispatch->device, handle, nullptr);                   \
+    }                                                                         \
+  };
+
+VWRAP_DEVICE_HANDLES(VWRAP_DEFINE_DELETER)
+
+#undef VWRAP_DEFINE_DELETER
+
+//---- Aliases --------------------------------------------------------------//
+
+/// Alias for a uniquely owned device.
+using UniqueDevice = UniqueHandle<VkDevice, DeviceDeleter>;
+
+/// Alias for a device which is shared between threads.
+using SharedDevice = 
+  SharedHandle<VkDevice, DeviceDeleter, ConcurrentReferenceCounter>;
+
+/// Defines the unique and shared handle aliases for an object which is
+/// created from a device -- for example UniqueBuffer and SharedBuffer.
+#define VWRAP_DEFINE_HANDLE_ALIASES(type, destroy)                            \
+  using Unique##type = UniqueHandle<Vk##type, type##Deleter>;                 \
+  using Shared##type =                                                        \
+    SharedHandle<Vk##type, type##Deleter, ConcurrentReferenceCounter>;
+
+VWRAP_DEVICE_HANDLES(VWRAP_DEFINE_HANDLE_ALIASES)
+
+#undef VWRAP_DEFINE_HANDLE_ALIASES
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_HANDLES_H
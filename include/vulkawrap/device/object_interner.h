@@ -0,0 +1,159 @@
+//---- include/vulkawrap/device/object_interner.h ---------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  object_interner.h
+/// \brief Defines the object interner, which returns the same handle for
+///        every request for an identical immutable object.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_OBJECT_INTERNER_H
+#define VULKAWRAP_DEVICE_OBJECT_INTERNER_H
+
+#include "descriptors.h"
+#include "vulkawrap/loader/dispatch.h"
+#include "vulkawrap/util/hash.hpp"
+#include "vulkawrap/util/sharded_map.hpp"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+namespace vwrap {
+
+//---- Implementations ------------------------------------------------------//
+
+using SetLayoutVec         = std::vector<VkDescriptorSetLayout>;
+using PushConstantRangeVec = std::vector<VkPushConstantRange>;
+
+namespace detail {
+
+/// Appends the canonical signature of a sampler create info. Samplers which
+/// are created with an extension structure are not interned.
+///
+/// \param createInfo The create info of the sampler.
+/// \param signature  The signature to append to.
+void appendSignature(const VkSamplerCreateInfo& createInfo,
+                     util::Signature&           signature );
+
+/// Appends the canonical signature of a pipeline layout. The push constant
+/// ranges are sorted first, so that their order doesn't matter.
+///
+/// \param setLayouts The set layouts of the pipeline layout.
+/// \param ranges     The push constant ranges of the pipeline layout.
+/// \param signature  The signature to append to.
+void appendSignature(const SetLayoutVec&         setLayouts,
+                     const PushConstantRangeVec& ranges    ,
+                     util::Signature&            signature );
+
+} // namespace detail
+
+/// Interns the immutable objects of a device -- samplers, descriptor set
+/// layouts and pipeline layouts. Requesting an object with the same
+/// description as an earlier request returns the same handle, so handles can
+/// be compared to compare the objects, and the device only ever has one of
+/// each distinct object, which matters for samplers, whose number is limited
+/// by maxSamplerAllocationCount.
+///
+/// Descriptions are canonicalized before they are hashed, so bindings and
+/// push constant ranges which are given in a different order are the same
+/// object. The objects are kept in sharded maps, so requests from different
+/// threads rarely contend, and each object is only created once. Interned
+/// objects live as long as the interner. The descriptor allocator gets its
+/// set layouts from the interner, so there is only one layout for each list
+/// of bindings.
+///
+/// Example usage:
+/// \code
+/// ObjectInterner interner(device.getDispatch());
+///
+/// auto setLayout      = interner.getSetLayout(materialBindings);
+/// auto pipelineLayout = interner.getPipelineLayout({ frameLayout,
+///                                                    setLayout });
+///
+/// // Materials with equal layouts can share pipelines.
+/// if (pipelineLayout == other.pipelineLayout) ...
+/// \endcode
+class ObjectInterner {
+ public:
+  /// Constructor which creates an empty interner.
+  ///
+  /// \param dispatch The dispatch table of the device, which must outlive
+  ///        the interner.
+  explicit ObjectInterner(const loader::DeviceDispatch& dispatch)
+  : Dispatch(dispatch) {}
+
+  /// Destructor which destroys all the interned objects.
+  ~ObjectInterner();
+
+  ObjectInterner(const ObjectInterner&)            = delete;
+  ObjectInterner& operator=(const ObjectInterner&) = delete;
+
+  /// Gets the sampler for a create info, creating it the first time the
+  /// create info is seen. Samplers with an extension structure in the create
+  /// info are not interned, so VK_NULL_HANDLE is returned for them, as it is
+  /// when the sampler could not be created.
+  ///
+  /// \param createInfo The create info of the sampler.
+  VkSampler getSampler(const VkSamplerCreateInfo& createInfo);
+
+  /// Gets the descriptor set layout for a list of bindings, creating it the
+  /// first time the bindings are seen. Returns VK_NULL_HANDLE if the layout
+  /// could not be created.
+  ///
+  /// \param bindings The bindings of the layout, in any order.
+  VkDescriptorSetLayout getSetLayout(const LayoutBindingVec& bindings);
+
+  /// Gets the pipeline layout for a list of set layouts and push constant
+  /// ranges, creating it the first time they are seen. Returns
+  /// VK_NULL_HANDLE if the layout could not be created.
+  ///
+  /// \param setLayouts The set layouts, in set order.
+  /// \param ranges     The push constant ranges, in any order.
+  VkPipelineLayout getPipelineLayout(
+    const SetLayoutVec&         setLayouts                     ,
+    const PushConstantRangeVec& ranges = PushConstantRangeVec());
+
+  /// Gets the dispatch table of the device.
+  const loader::DeviceDispatch& getDispatch() const {
+    return Dispatch;
+  }
+
+  /// Gets the number of interned samplers.
+  size_t getSamplerCount() const {
+    return Samplers.size();
+  }
+
+  /// Gets the number of interned descriptor set layouts.
+  size_t getSetLayoutCount() const {
+    return SetLayouts.size();
+  }
+
+  /// Gets the number of interned pipeline layouts.
+  size_t getPipelineLayoutCount() const {
+    return PipelineLayouts.size();
+  }
+
+ private:
+  /// Map of canonical signatures to interned objects.
+  /// \tparam Handle The type of the objects.
+  template <typename Handle>
+  using InternMap = util::ShardedMap<util::Signature, Handle,
+                                     util::SignatureHash>;
+
+  const loader::DeviceDispatch&     Dispatch;         //!< The device.
+  InternMap<VkSampler>              Samplers;         //!< The samplers.
+  InternMap<VkDescriptorSetLayout>  SetLayouts;       //!< The set layouts.
+  InternMap<VkPipelineLayout>       PipelineLayouts;  //!< The pipeline
+                                                      //!< layouts.
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_OBJECT_INTERNER_H
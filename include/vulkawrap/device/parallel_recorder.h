@@ -0,0 +1,151 @@
+//---- include/vulkawrap/device/parallel_recorder.h -------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  parallel_recorder.h
+/// \brief Defines the parallel recorder, which records a list of commands
+///        into secondary command buffers on the threads of a job system.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_PARALLEL_RECORDER_H
+#define VULKAWRAP_DEVICE_PARALLEL_RECORDER_H
+
+#include "command_pools.h"
+#include "vulkawrap/util/job_system.h"
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <vector>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The number of chunks which each thread gets, when the chunk size is
+/// chosen automatically, so that threads which finish early can steal.
+static constexpr size_t ChunksPerThreadCx = 4;
+
+/// The smallest number of commands in a chunk, when the chunk size is chosen
+/// automatically, below which a secondary command buffer costs more than it
+/// saves.
+static constexpr size_t MinChunkSizeCx = 64;
+
+//---- Implementations ------------------------------------------------------//
+
+/// Records a list of commands (draws or dispatches) in parallel. The list is
+/// split into chunks, each chunk is recorded into its own secondary command
+/// buffer by whichever thread of the job system runs it, and the secondary
+/// command buffers are then executed by the primary command buffer in the
+/// order of the chunks, so the result doesn't depend on the scheduling.
+///
+/// The secondary command buffers are allocated from the recording thread's
+/// own pools of the command pool manager, so recording never locks, and they
+/// are recycled with the rest of the frame.
+///
+/// Example usage:
+/// \code
+/// ParallelRecorder recorder(device, commandPools, jobs);
+///
+/// // The primary is in the render pass, with secondary contents.
+/// recorder.record(primary, graphicsFamily, inheritance, draws.size(),
+///   [&] (VkCommandBuffer secondary, size_t begin, size_t end) {
+///     for (auto drawIdx = begin; drawIdx < end; ++drawIdx)
+///       recordDraw(secondary, draws[drawIdx]);
+///   });
+/// \endcode
+class ParallelRecorder {
+ public:
+  /// Constructor which sets the objects the recorder uses, which must all
+  /// outlive it.
+  ///
+  /// \param device       The device to record for.
+  /// \param commandPools The pools to allocate the secondaries from.
+  /// \param jobs         The job system to record on.
+  ParallelRecorder(const Device&       device      ,
+                   CommandPoolManager& commandPools,
+                   util::JobSystem&    jobs        )
+  : Owner(device), CommandPools(commandPools), Jobs(jobs) {}
+
+  /// Records commands into secondary command buffers in parallel, and
+  /// executes them from a primary command buffer. If the inheritance info has
+  /// a render pass, the secondaries continue it, and the primary must be in
+  /// that render pass, with secondary contents. Returns false if any chunk
+  /// could not be recorded, in which case none of the secondaries are
+  /// executed, so the primary never runs only part of the commands.
+  ///
+  /// \param primary        The primary command buffer, which is recording.
+  /// \param familyIndex    The queue family of the primary command buffer.
+  /// \param inheritance    The state which the secondaries inherit.
+  /// \param commandCount   The number of commands to record.
+  /// \param recordFunction The function which records the commands in
+  ///        [begin, end) into a secondary command buffer.
+  /// \param chunkSize      The number of commands in each secondary, or zero
+  ///        to choose it from the number of threads.
+  /// \tparam RecordFunction The type of the record function.
+  template <typename RecordFunction>
+  bool record(VkCommandBuffer                       primary       ,
+              uint32_t                              familyIndex   ,
+              const VkCommandBufferInheritanceInfo& inheritance   ,
+              size_t                                commandCount  ,
+              RecordFunction&&                      recordFunction,
+              size_t                                chunkSize = 0 ) {
+    if (commandCount == 0) return true;
+    if (chunkSize == 0) chunkSize = getChunkSize(commandCount);
+
+    const auto chunkCount = (commandCount + chunkSize - 1) / chunkSize;
+    Secondaries.assign(chunkCount, VK_NULL_HANDLE);
+    Jobs.parallelFor(chunkCount, [&] (size_t chunkIdx) {
+      const auto begin = chunkIdx * chunkSize;
+      const auto end   = std::min(begin + chunkSize, commandCount);
+
+      auto secondary = beginSecondary(familyIndex, inheritance);
+      if (secondary == VK_NULL_HANDLE) return;
+      recordFunction(secondary, begin, end);
+      if (Owner.getDispatch().vkEndCommandBuffer(secondary) == VK_SUCCESS)
+        Secondaries[chunkIdx] = secondary;
+    });
+    return executeSecondaries(primary);
+  }
+
+  /// Gets the chunk size which is used for a number of commands, when it is
+  /// chosen automatically.
+  ///
+  /// \param commandCount The number of commands.
+  size_t getChunkSize(size_t commandCount) const {
+    const auto chunks = Jobs.getThreadCount() * ChunksPerThreadCx;
+    return std::max((commandCount + chunks - 1) / chunks, MinChunkSizeCx);
+  }
+
+ private:
+  const Device&                 Owner;         //!< The device.
+  CommandPoolManager&           CommandPools;  //!< Allocates secondaries.
+  util::JobSystem&              Jobs;          //!< Runs the recording.
+  std::vector<VkCommandBuffer>  Secondaries;   //!< The secondary of each
+                                               //!< chunk.
+
+  /// Allocates a secondary command buffer from the calling thread's pool,
+  /// and begins it. Returns VK_NULL_HANDLE if it could not be allocated.
+  ///
+  /// \param familyIndex The queue family of the primary.
+  /// \param inheritance The state which the secondary inherits.
+  VkCommandBuffer beginSecondary(
+    uint32_t                              familyIndex,
+    const VkCommandBufferInheritanceInfo& inheritance);
+
+  /// Executes the recorded secondaries from the primary, in chunk order.
+  /// Returns false, and executes nothing, if any chunk failed to record.
+  ///
+  /// \param primary The primary command buffer.
+  bool executeSecondaries(VkCommandBuffer primary);
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_PARALLEL_RECORDER_H
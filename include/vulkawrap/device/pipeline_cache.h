@@ -0,0 +1,165 @@
+//---- include/vulkawrap/device/pipeline_cache.h ----------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  pipeline_cache.h
+/// \brief Defines the pipeline cache, which keeps a Vulkan pipeline cache on
+///        disk between runs, and gives each compiling thread its own cache.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_PIPELINE_CACHE_H
+#define VULKAWRAP_DEVICE_PIPELINE_CACHE_H
+
+#include "vulkawrap/util/thread_cache.h"
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+namespace vwrap {
+
+class Device;
+
+//---- Constants ------------------------------------------------------------//
+
+/// The version of the pipeline cache file format. Files with another version
+/// are ignored and rewritten.
+static constexpr uint32_t PipelineCacheVersionCx = 1;
+
+namespace detail {
+
+/// Header at the start of a pipeline cache file, before the data from the
+/// driver.
+struct PipelineCacheFileHeader {
+  char      magic[4];                        //!< Identifies the file --
+                                             //!< "VWPC".
+  uint32_t  version;                         //!< The file format version.
+  uint32_t  vendorID;                        //!< The vendor of the device.
+  uint32_t  deviceID;                        //!< The device.
+  uint32_t  driverVersion;                   //!< The version of the driver.
+  uint8_t   pipelineCacheUUID[VK_UUID_SIZE]; //!< The cache UUID of the
+                                             //!< device.
+  uint64_t  dataSize;                        //!< The size of the data.
+  uint64_t  checksum;                        //!< FNV-1a hash of the data.
+};
+
+} // namespace detail
+
+//---- Implementations ------------------------------------------------------//
+
+/// Wrapper for a Vulkan pipeline cache, which is loaded from a file when it
+/// is created and written back to the file by save, so that pipelines which
+/// were compiled on an earlier run are not compiled again. The file is only
+/// loaded if it was written for the same device, driver version and pipeline
+/// cache UUID, and its contents are intact, otherwise the cache starts empty.
+///
+/// Drivers lock a pipeline cache while a pipeline is created with it, so each
+/// thread which compiles pipelines gets its own cache, which starts with the
+/// contents of the file, and these are merged into the main cache before it
+/// is saved.
+///
+/// Example usage:
+/// \code
+/// PipelineCache pipelineCache(device, "pipelines.bin");
+///
+/// // On any thread:
+/// vkCreateGraphicsPipelines(device, pipelineCache.getThreadCache(), ...);
+///
+/// // At shutdown, or after loading a level:
+/// pipelineCache.save();
+/// \endcode
+class PipelineCache {
+ public:
+  /// Constructor which creates the cache, with the contents of the file at a
+  /// path if the file is valid for the device.
+  ///
+  /// \param device The device to create the cache for, which must outlive
+  ///        the cache.
+  /// \param path   The path of the cache file.
+  PipelineCache(const Device& device, const std::string& path);
+
+  /// Destructor which destroys the caches. The cache is not saved.
+  ~PipelineCache();
+
+  PipelineCache(const PipelineCache&)            = delete;
+  PipelineCache& operator=(const PipelineCache&) = delete;
+
+  /// Returns true if the cache was loaded from the file.
+  bool isLoaded() const {
+    return Loaded;
+  }
+
+  /// Gets the main Vulkan pipeline cache.
+  VkPipelineCache getVkPipelineCache() const {
+    return Cache;
+  }
+
+  /// Gets the pipeline cache of the calling thread, creating it from the
+  /// contents of the file the first time the thread uses it. Returns the main
+  /// cache if a cache could not be created for the thread.
+  VkPipelineCache getThreadCache();
+
+  /// Merges the caches of all the threads into the main cache. This must not
+  /// be called while pipelines are being created with the main cache.
+  void mergeThreadCaches();
+
+  /// Merges the thread caches into the main cache, and then writes the main
+  /// cache to the file. Returns true if the file was written.
+  bool save();
+
+  /// Loads the data of a pipeline cache file. Returns no data if the file
+  /// doesn't exist, or is not valid for a device.
+  ///
+  /// \param path       The path to the cache file.
+  /// \param properties The properties of the device.
+  static std::vector<char> load(const std::string&                path      ,
+                                const VkPhysicalDeviceProperties& properties);
+
+  /// Writes the data of a pipeline cache to a file. The file is written to a
+  /// temporary file which is then renamed, so that a process which is reading
+  /// the cache never sees a partially written file. Returns true if the file
+  /// was written.
+  ///
+  /// \param path       The path to the cache file.
+  /// \param properties The properties of the device the data is from.
+  /// \param data       The data of the pipeline cache.
+  static bool store(const std::string&                path      ,
+                    const VkPhysicalDeviceProperties& properties,
+                    const std::vector<char>&          data      );
+
+  /// Returns true if pipeline cache data from the driver has a header which
+  /// matches a device.
+  ///
+  /// \param data       The data of the cache.
+  /// \param size       The size of the data.
+  /// \param properties The properties of the device.
+  static bool isValidData(const void*                       data      ,
+                          size_t                            size      ,
+                          const VkPhysicalDeviceProperties& properties);
+
+ private:
+  const Device&                Owner;         //!< The device.
+  std::string                  Path;          //!< The cache file.
+  VkPipelineCache              Cache;         //!< The main cache.
+  bool                         Loaded;        //!< If the file was loaded.
+  std::vector<char>            InitialData;   //!< The data from the file.
+  util::ThreadCache<VkPipelineCache>
+                               ThreadCaches;  //!< The cache of each thread.
+
+  /// Creates a pipeline cache with initial data. Returns VK_NULL_HANDLE if
+  /// the cache could not be created.
+  ///
+  /// \param data The initial data of the cache.
+  VkPipelineCache create(const std::vector<char>& data) const;
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_PIPELINE_CACHE_H
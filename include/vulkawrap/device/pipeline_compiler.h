@@ -0,0 +1,133 @@
+//---- include/vulkawrap/device/pipeline_compiler.h -------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  pipeline_compiler.h
+/// \brief Defines the pipeline compiler, which creates pipelines on a pool of
+///        background threads, so that compiling them doesn't stall the
+///        threads which need them.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_PIPELINE_COMPILER_H
+#define VULKAWRAP_DEVICE_PIPELINE_COMPILER_H
+
+#include "device.h"
+#include "pipeline_cache.h"
+#include "vulkawrap/util/job_system.h"
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vwrap {
+
+/// Creates pipelines on background threads. Each request returns a future
+/// for the pipeline, which is VK_NULL_HANDLE if it could not be created.
+/// Every thread creates its pipelines with its own cache from the pipeline
+/// cache, so pipelines which were compiled on an earlier run are found in the
+/// cache instead of being compiled again, and threads never contend for a
+/// cache.
+///
+/// The create infos are copied, but the state which they point to (shader
+/// stages, fixed function state and so on) is not, so it must stay valid
+/// until the future of the pipeline is ready.
+///
+/// Example usage:
+/// \code
+/// PipelineCache    pipelineCache(device, "pipelines.bin");
+/// PipelineCompiler compiler(device, pipelineCache);
+///
+/// std::vector<std::future<VkPipeline>> pipelines;
+/// for (const auto& createInfo : materialPipelines)
+///   pipelines.push_back(compiler.compile(createInfo));
+///
+/// // Later, when the pipeline is needed:
+/// auto pipeline = pipelines[materialIdx].get();
+/// \endcode
+class PipelineCompiler {
+ public:
+  /// Constructor which starts the compilation threads.
+  ///
+  /// \param device        The device to create the pipelines for, which must
+  ///        outlive the compiler.
+  /// \param pipelineCache The cache to create the pipelines with, which must
+  ///        outlive the compiler.
+  /// \param threadCount   The number of compilation threads.
+  PipelineCompiler(
+    const Device&  device                                            ,
+    PipelineCache& pipelineCache                                     ,
+    uint32_t       threadCount = util::JobSystem::defaultThreadCount());
+
+  /// Destructor which finishes the pipelines which have been requested, and
+  /// then stops the threads.
+  ~PipelineCompiler();
+
+  PipelineCompiler(const PipelineCompiler&)            = delete;
+  PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+  /// Requests a graphics pipeline.
+  ///
+  /// \param createInfo The create info of the pipeline.
+  std::future<VkPipeline> compile(
+    const VkGraphicsPipelineCreateInfo& createInfo);
+
+  /// Requests a compute pipeline.
+  ///
+  /// \param createInfo The create info of the pipeline.
+  std::future<VkPipeline> compile(
+    const VkComputePipelineCreateInfo& createInfo);
+
+  /// Requests a pipeline which is created by a function, which is given the
+  /// pipeline cache of the thread which runs it, and must return the
+  /// pipeline.
+  ///
+  /// \param createFunction The function which creates the pipeline.
+  /// \tparam CreateFunction The type of the create function.
+  template <typename CreateFunction>
+  std::future<VkPipeline> submit(CreateFunction&& createFunction) {
+    Task task(std::forward<CreateFunction>(createFunction));
+    auto pipeline = task.get_future();
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Tasks.push_back(std::move(task));
+    }
+    WorkReady.notify_one();
+    return pipeline;
+  }
+
+  /// Gets the number of compilation threads.
+  uint32_t getThreadCount() const {
+    return static_cast<uint32_t>(Workers.size());
+  }
+
+ private:
+  /// A request for a pipeline, which is run with the pipeline cache of the
+  /// thread which runs it.
+  using Task = std::packaged_task<VkPipeline(VkPipelineCache)>;
+
+  const Device&            Owner;      //!< The device.
+  PipelineCache&           Cache;      //!< The pipeline cache.
+  std::mutex               Mutex;      //!< Protects the tasks.
+  std::condition_variable  WorkReady;  //!< Signals new tasks.
+  std::deque<Task>         Tasks;      //!< The requested pipelines.
+  bool                     Stopping;   //!< If the threads must stop.
+  std::vector<std::thread> Workers;    //!< The compilation threads.
+
+  /// Runs requests until the compiler stops.
+  void run();
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_PIPELINE_COMPILER_H
@@ -18,7 +18,10 @@
 #ifndef VULKAWRAP_DEVICE_QUEUE_H
 #define VULKAWRAP_DEVICE_QUEUE_H
 
+#include "../instance/capabilities.h"
 #include <vulkan/vulkan.h>
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 namespace vwrap {
@@ -34,11 +37,345 @@ enum class QueueType : uint8_t {
   VW_ANY                  = 0x10
 };
 
+static_assert(static_cast<uint8_t>(QueueType::VW_GRAPHICS_QUEUE) ==
+                VK_QUEUE_GRAPHICS_BIT                             &&
+              static_cast<uint8_t>(QueueType::VW_COMPUTE_QUEUE)  ==
+                VK_QUEUE_COMPUTE_BIT                              &&
+              static_cast<uint8_t>(QueueType::VW_TRANSFER_QUEUE) ==
+                VK_QUEUE_TRANSFER_BIT                             &&
+              static_cast<uint8_t>(QueueType::VW_SPARSE_BINDING_QUEUE) ==
+                VK_QUEUE_SPARSE_BINDING_BIT,
+              "Queue types must have the same bits as the Vulkan flags.");
+
+//---- Forward Declarations -------------------------------------------------//
+
+class  Device;
+struct QueueRequest;
+struct QueueAllocation;
+
 //---- Aliases --------------------------------------------------------------//
 
+/// Alias for a set of queue types, with a bit for each QueueType.
+using QueueTypeMask       = uint8_t;
+
+/// Alias for a set of queue families, with a bit for each family index.
+using QueueFamilyMask     = uint32_t;
+
 using QueueTypeVec        = std::vector<QueueType>;
 using QueueIdVec          = std::vector<uint32_t>;
-using QueueFamilyPropVec  = std::vector<VkQueueFamilyProperties>;
+using QueueRequestVec     = std::vector<QueueRequest>;
+using QueueAllocationVec  = std::vector<QueueAllocation>;
+
+//---- Constants ------------------------------------------------------------//
+
+/// The number of queue families which a QueueFamilyMask can hold.
+static constexpr uint32_t QueueFamilyMaskBitsCx = 32;
+
+//---- Implementations ------------------------------------------------------//
+
+/// Gets the empty set of queue types, which ends the variadic overload.
+constexpr QueueTypeMask queueTypeMask() {
+  return 0;
+}
+
+/// Gets the set of queue types for one or more types, at compile time if the
+/// types are constants.
+///
+/// \param  queueType  The first type in the set.
+/// \param  queueTypes The rest of the types in the set.
+/// \tparam QueueTypes The types of the rest of the types, which must all be
+///         QueueType.
+template <typename... QueueTypes>
+constexpr QueueTypeMask queueTypeMask(QueueType queueType, 
+                                      QueueTypes... queueTypes) {
+  return static_cast<QueueTypeMask>(static_cast<QueueTypeMask>(queueType) |
+                                    queueTypeMask(queueTypes...));
+}
+
+/// Gets the set of queue types which a queue family with the given flags
+/// matches. Every family matches VW_ANY, so the types which a family can run
+/// from a set of requested types is the AND of the two sets.
+///
+/// \param flags The flags of the queue family.
+constexpr QueueTypeMask queueFamilyTypes(VkQueueFlags flags) {
+  return static_cast<QueueTypeMask>(
+    (flags & queueTypeMask(QueueType::VW_GRAPHICS_QUEUE      ,
+                           QueueType::VW_COMPUTE_QUEUE       ,
+                           QueueType::VW_TRANSFER_QUEUE      ,
+                           QueueType::VW_SPARSE_BINDING_QUEUE)) |
+    static_cast<QueueTypeMask>(QueueType::VW_ANY));
+}
+
+/// A request for a queue for a specific type of work.
+struct QueueRequest {
+  QueueType type;      //!< The type of work the queue is for.
+  float     priority;  //!< The priority of the queue, in [0, 1].
+
+  /// Constructor to create a queue request.
+  ///
+  /// \param queueType     The type of work the queue is for.
+  /// \param queuePriority The priority of the queue.
+  QueueRequest(QueueType queueType, float queuePriority = 1.0f) 
+  : type(queueType), priority(queuePriority) {}
+};
+
+/// The queue which was allocated for a QueueRequest.
+struct QueueAllocation {
+  QueueType type;         //!< The type of work the queue is for.
+  uint32_t  familyIndex;  //!< The index of the queue family.
+  uint32_t  queueIndex;   //!< The index of the queue in the family.
+  float     priority;     //!< The priority of the queue.
+  bool      shared;       //!< If the queue was already allocated to another
+                          //!< request, because the family had no free queues.
+};
+
+/// Returns true if a queue family can execute a type of work. Any family
+/// which supports graphics or compute work also supports transfers.
+///
+/// \param family    The properties of the queue family.
+/// \param queueType The type of work.
+bool queueFamilySupports(const VkQueueFamilyProperties& family, 
+                         QueueType                      queueType);
+
+/// Allocates queues for the requests so that different types of work run on
+/// queues which can overlap on the GPU. Each request is placed on the most 
+/// dedicated family which supports it (a transfer only family for transfers,
+/// a compute family without graphics for async compute), on a family which
+/// no other type of work is using if possible, and on a queue index which is
+/// not yet used if the family has one free. Requests which are supported by
+/// the fewest families are placed first. The allocations are returned in the
+/// same order as the requests, and a request which no family supports is
+/// given a family index of VK_QUEUE_FAMILY_IGNORED.
+///
+/// \param families The queue families of the physical device.
+/// \param requests The queues which are requested.
+QueueAllocationVec allocateQueues(const QueueFamilyPropVec& families,
+                                  const QueueRequestVec&    requests);
+
+/// A semaphore which a submission waits on before some of its stages run.
+struct SemaphoreWait {
+  VkSemaphore           semaphore;  //!< The semaphore to wait on.
+  uint64_t              value;      //!< The value to wait for, which is
+                                    //!< ignored for binary semaphores.
+  VkPipelineStageFlags  stage;      //!< The stages which wait.
+};
+
+namespace detail {
+
+/// Accumulates submissions, and coalesces them into as few VkSubmitInfo
+/// structures as possible. A submission is appended to the previous one
+/// unless it waits on a semaphore, or the previous one signals a binary
+/// semaphore, since those have to happen between the command buffers. Each
+/// submit info signals the timeline semaphore of the queue with the value of
+/// its last submission. This is not thread safe.
+class SubmitBatch {
+ public:
+  /// Adds a submission to the batch.
+  ///
+  /// \param commandBuffers     The command buffers to submit.
+  /// \param commandBufferCount The number of command buffers.
+  /// \param waits              The semaphores to wait on first.
+  /// \param waitCount          The number of semaphores to wait on.
+  /// \param signal             A binary semaphore to signal when the
+  ///        submission completes, or VK_NULL_HANDLE.
+  /// \param value              The timeline value of the submission.
+  void add(const VkCommandBuffer* commandBuffers    ,
+           uint32_t               commandBufferCount,
+           const SemaphoreWait*   waits             ,
+           uint32_t               waitCount         ,
+           VkSemaphore            signal            ,
+           uint64_t               value             );
+
+  /// Builds the submit infos for all the submissions in the batch. The infos
+  /// point into the batch, so they are valid until it is changed.
+  ///
+  /// \param timeline The timeline semaphore to signal.
+  const std::vector<VkSubmitInfo>& build(VkSemaphore timeline);
+
+  /// Removes all the submissions.
+  void clear();
+
+  /// Returns true if there are no submissions.
+  bool empty() const {
+    return Entries.empty();
+  }
+
+ private:
+  /// The submissions which are coalesced into a single submit info.
+  struct Entry {
+    uint32_t    waitBegin;     //!< The index of the first wait.
+    uint32_t    waitCount;     //!< The number of waits.
+    uint32_t    commandBegin;  //!< The index of the first command buffer.
+    uint32_t    commandCount;  //!< The number of command buffers.
+    VkSemaphore signal;        //!< The binary semaphore to signal.
+    uint64_t    value;         //!< The timeline value to signal.
+  };
+
+  using TimelineInfoVec = std::vector<VkTimelineSemaphoreSubmitInfoKHR>;
+
+  std::vector<Entry>                Entries;           //!< The submit infos.
+  std::vector<VkSemaphore>          WaitSemaphores;    //!< All waits.
+  std::vector<uint64_t>             WaitValues;        //!< Value of each wait.
+  std::vector<VkPipelineStageFlags> WaitStages;        //!< Stage of each wait.
+  std::vector<VkCommandBuffer>      CommandBuffers;    //!< All the commands.
+  std::vector<VkSemaphore>          SignalSemaphores;  //!< Built signals.
+  std::vector<uint64_t>             SignalValues;      //!< Built values.
+  TimelineInfoVec                   TimelineInfos;     //!< Built values info.
+  std::vector<VkSubmitInfo>         SubmitInfos;       //!< Built infos.
+};
+
+} // namespace detail
+
+/// Wrapper around a Vulkan queue, which batches submissions and tracks their
+/// completion with a timeline semaphore. Submissions are only recorded until
+/// the queue is flushed, which submits all of them with a single call to
+/// vkQueueSubmit. Every submission is given a value on the timeline of the
+/// queue, which increases monotonically, and the submission has completed
+/// once the timeline reaches that value. Other queues wait for a submission
+/// by waiting for its value on the timeline, rather than through chains of
+/// binary semaphores.
+///
+/// The device must be created with VK_KHR_timeline_semaphore enabled, and
+/// with the timelineSemaphore feature. Only one Queue may be created for
+/// each VkQueue, since submissions to a VkQueue must be synchronized, so a
+/// Queue can't be created for a request which shares the queue of an earlier
+/// request -- the QueueScheduler routes the work of such requests to the
+/// Queue of the request which owns the queue. The queue is thread safe.
+///
+/// Example usage:
+/// \code
+/// Queue graphics(device, QueueType::VW_GRAPHICS_QUEUE);
+/// Queue transfer(device, QueueType::VW_TRANSFER_QUEUE);
+///
+/// const auto uploaded = transfer.submit(uploadCommands);
+/// transfer.flush();
+///
+/// const auto wait = transfer.waitPoint(uploaded,
+///                     VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+/// const auto drawn = graphics.submit(&drawCommands, 1, &wait, 1);
+/// graphics.flush();
+/// ...
+/// graphics.wait(drawn);
+/// \endcode
+class Queue {
+ public:
+  /// Constructor which wraps the queue which was allocated for a request of
+  /// a device, and creates the timeline semaphore. The queue is not wrapped
+  /// if the allocation of the request is shared.
+  ///
+  /// \param device     The device, which must outlive the queue.
+  /// \param requestIdx The index of the request of the queue.
+  Queue(const Device& device, size_t requestIdx);
+
+  /// Constructor which wraps the queue which was allocated for the first
+  /// request for a type of work.
+  ///
+  /// \param device    The device, which must outlive the queue.
+  /// \param queueType The type of work.
+  Queue(const Device& device, QueueType queueType);
+
+  /// Destructor which flushes the queue, waits for all the submissions to
+  /// complete, and destroys the timeline semaphore.
+  ~Queue();
+
+  Queue(const Queue&)            = delete;
+  Queue& operator=(const Queue&) = delete;
+
+  /// Adds a submission to the next flush, and returns the timeline value
+  /// which it signals, or 0 if the queue has no timeline.
+  ///
+  /// \param commandBuffers     The command buffers to submit.
+  /// \param commandBufferCount The number of command buffers.
+  /// \param waits              Semaphores to wait on before the submission.
+  /// \param waitCount          The number of semaphores to wait on.
+  /// \param signal             A binary semaphore to signal when the
+  ///        submission completes, such as for a present.
+  uint64_t submit(const VkCommandBuffer* commandBuffers                  ,
+                  uint32_t               commandBufferCount              ,
+                  const SemaphoreWait*   waits     = nullptr             ,
+                  uint32_t               waitCount = 0                   ,
+                  VkSemaphore            signal    = VK_NULL_HANDLE      );
+
+  /// Adds a single command buffer to the next flush, and returns the
+  /// timeline value which it signals, or 0 if the queue has no timeline.
+  ///
+  /// \param commandBuffer The command buffer to submit.
+  uint64_t submit(VkCommandBuffer commandBuffer) {
+    return submit(&commandBuffer, 1);
+  }
+
+  /// Submits all the pending submissions with a single vkQueueSubmit, and
+  /// returns the timeline value of the last of them. If the submit fails,
+  /// or the queue has no timeline, 0 is returned and the submissions are
+  /// kept for the next flush.
+  ///
+  /// \param fence A fence to signal once the submissions complete, or
+  ///        VK_NULL_HANDLE.
+  uint64_t flush(VkFence fence = VK_NULL_HANDLE);
+
+  /// Gets a wait for a value of this queue's timeline, which another queue
+  /// can submit with.
+  ///
+  /// \param value The timeline value to wait for.
+  /// \param stage The stages of the waiting submission which wait.
+  SemaphoreWait waitPoint(uint64_t value, VkPipelineStageFlags stage) const {
+    return SemaphoreWait{ Timeline, value, stage };
+  }
+
+  /// Gets the value which the timeline has reached, from the driver. All
+  /// submissions with values up to this have completed.
+  uint64_t getCompletedValue() const;
+
+  /// Returns true if a submission has completed. This only asks the driver
+  /// if the last known completed value is lower than the value.
+  ///
+  /// \param value The timeline value of the submission.
+  bool isComplete(uint64_t value) const;
+
+  /// Waits until a submission has completed, and returns true if it did.
+  /// Returns false if the submission wasn't flushed, or the wait failed,
+  /// such as when the device is lost.
+  ///
+  /// \param value The timeline value of the submission.
+  bool wait(uint64_t value) const;
+
+  /// Gets the timeline value of the last submission which was flushed.
+  uint64_t getSubmittedValue() const {
+    return SubmittedValue.load(std::memory_order_acquire);
+  }
+
+  /// Gets the Vulkan queue.
+  VkQueue getVkQueue() const {
+    return VulkanQueue;
+  }
+
+  /// Gets the index of the queue family of the queue.
+  uint32_t getFamilyIndex() const {
+    return FamilyIndex;
+  }
+
+  /// Gets the timeline semaphore of the queue.
+  VkSemaphore getTimeline() const {
+    return Timeline;
+  }
+
+ private:
+  const Device&                 Owner;           //!< The device.
+  VkQueue                       VulkanQueue;     //!< The queue.
+  uint32_t                      FamilyIndex;     //!< The queue family.
+  VkSemaphore                   Timeline;        //!< Signalled with the
+                                                 //!< value of each submit.
+  std::mutex                    Mutex;           //!< Protects the batch.
+  detail::SubmitBatch           Batch;           //!< Pending submissions.
+  uint64_t                      NextValue;       //!< Value of the next
+                                                 //!< submission.
+  std::atomic<uint64_t>         SubmittedValue;  //!< Last flushed value.
+  mutable std::atomic<uint64_t> CompletedValue;  //!< Last known completed
+                                                 //!< value.
+
+  /// Creates the timeline semaphore.
+  void createTimeline();
+};
 
 } // namespace vwrap 
 
@@ -0,0 +1,334 @@
+//---- include/vulkawrap/device/queue_scheduler.h ---------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  queue_scheduler.h
+/// \brief Defines the queue scheduler, which runs compute and transfer work
+///        on their own queue families when the device has them, so that it
+///        overlaps with graphics work.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_QUEUE_SCHEDULER_H
+#define VULKAWRAP_DEVICE_QUEUE_SCHEDULER_H
+
+#include "queue.h"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The number of types of work which the scheduler routes -- graphics,
+/// compute and transfer.
+static constexpr size_t ScheduledQueueCountCx = 3;
+
+/// The number of times per frame an image must move between queue families
+/// before it is cheaper to share it concurrently than to transfer its
+/// ownership. Concurrent images may lose framebuffer compression, so images
+/// are only shared when they change hands often.
+static constexpr uint32_t ConcurrentImageHandoffsCx = 4;
+
+//---- Implementations ------------------------------------------------------//
+
+/// Description of the hand over of a resource from one type of work to
+/// another, for example from a compute pass which writes an image to the
+/// graphics pass which samples it.
+struct QueueHandoff {
+  QueueType            srcType;      //!< The work which used the resource.
+  QueueType            dstType;      //!< The work which uses it next.
+  VkPipelineStageFlags srcStages;    //!< The stages which used it.
+  VkAccessFlags        srcAccess;    //!< The accesses which used it.
+  VkPipelineStageFlags dstStages;    //!< The stages which use it next.
+  VkAccessFlags        dstAccess;    //!< The accesses which use it next.
+  VkImageLayout        oldLayout;    //!< The layout of an image before.
+  VkImageLayout        newLayout;    //!< The layout of an image after.
+  VkSharingMode        sharingMode;  //!< The sharing mode of the resource.
+
+  /// Default constructor, which creates a handoff from graphics to graphics
+  /// of an exclusive resource, without any stages.
+  QueueHandoff()
+  : srcType(QueueType::VW_GRAPHICS_QUEUE),
+    dstType(QueueType::VW_GRAPHICS_QUEUE), srcStages(0), srcAccess(0),
+    dstStages(0), dstAccess(0), oldLayout(VK_IMAGE_LAYOUT_UNDEFINED),
+    newLayout(VK_IMAGE_LAYOUT_UNDEFINED),
+    sharingMode(VK_SHARING_MODE_EXCLUSIVE) {}
+};
+
+/// One side of a handoff -- the barrier which the queue which gives up the
+/// resource, or the queue which takes it, records.
+struct HandoffBarrier {
+  bool                 record;     //!< If the barrier needs to be recorded.
+  VkPipelineStageFlags srcStages;  //!< The source stages of the barrier.
+  VkPipelineStageFlags dstStages;  //!< The destination stages.
+  VkAccessFlags        srcAccess;  //!< The source accesses.
+  VkAccessFlags        dstAccess;  //!< The destination accesses.
+  uint32_t             srcFamily;  //!< The family which releases ownership,
+                                   //!< or VK_QUEUE_FAMILY_IGNORED.
+  uint32_t             dstFamily;  //!< The family which acquires ownership,
+                                   //!< or VK_QUEUE_FAMILY_IGNORED.
+};
+
+namespace detail {
+
+/// The index of each type of work in the routes.
+///
+/// \param queueType The type of work, which must be graphics, compute or
+///        transfer.
+size_t routeIndex(QueueType queueType);
+
+/// Chooses the queue request which each type of work runs on. Graphics runs
+/// on the first graphics allocation, and compute and transfer work run on
+/// their own allocations when there are any. Compute work falls back to the
+/// graphics queue, and transfers to the compute queue, which may itself be
+/// the graphics queue. Returns the index of the allocation for each type, in
+/// route order, which is the number of allocations if there is no queue.
+///
+/// \param allocations The allocations of the queues of the device.
+std::array<size_t, ScheduledQueueCountCx> routeQueues(
+  const QueueAllocationVec& allocations);
+
+/// Chooses the sharing mode for a resource which is used by several queue
+/// families. Buffers are always shared concurrently, since that costs them
+/// nothing on common hardware, and saves the ownership barriers. Images are
+/// exclusive, and have their ownership transferred, unless they change hands
+/// at least ConcurrentImageHandoffsCx times a frame.
+///
+/// \param isImage          If the resource is an image.
+/// \param familyCount      The number of families which use the resource.
+/// \param handoffsPerFrame The number of times each frame the resource
+///        moves between families.
+VkSharingMode chooseSharingMode(bool     isImage         ,
+                                uint32_t familyCount     ,
+                                uint32_t handoffsPerFrame);
+
+/// Works out the barriers for a handoff. When the work runs on different
+/// families and the resource is exclusive, the source queue releases
+/// ownership and the destination queue acquires it. Otherwise only the
+/// destination records a barrier -- a full barrier if both types of work
+/// run on the same queue, or just the layout transition if they run on
+/// different queues, where the semaphore wait already orders them.
+///
+/// \param handoff   The handoff.
+/// \param srcFamily The family of the source queue.
+/// \param dstFamily The family of the destination queue.
+/// \param sameQueue If both types of work run on the same queue.
+/// \param release   Set to the barrier of the source queue.
+/// \param acquire   Set to the barrier of the destination queue.
+void planHandoff(const QueueHandoff& handoff  ,
+                 uint32_t            srcFamily,
+                 uint32_t            dstFamily,
+                 bool                sameQueue,
+                 HandoffBarrier&     release  ,
+                 HandoffBarrier&     acquire  );
+
+} // namespace detail
+
+/// Schedules graphics, compute and transfer work onto the queues of a device.
+/// Compute and transfer work run on dedicated queue families when the device
+/// has them, so that post processing and streaming overlap with rendering,
+/// and run on the graphics queue when it doesn't, without the caller doing
+/// anything differently.
+///
+/// Work which uses the results of another type of work is submitted with
+/// submitAfter, which waits on the other queue's timeline only if the work
+/// runs on another queue. Resources are handed between the types of work
+/// with the release and acquire functions, which record queue family
+/// ownership transfers only when they are needed.
+///
+/// Example usage:
+/// \code
+/// QueueScheduler scheduler(device);
+///
+/// // Compute writes the image, then graphics samples it.
+/// QueueHandoff handoff;
+/// handoff.srcType   = QueueType::VW_COMPUTE_QUEUE;
+/// handoff.srcStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+/// handoff.srcAccess = VK_ACCESS_SHADER_WRITE_BIT;
+/// handoff.dstStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+/// handoff.dstAccess = VK_ACCESS_SHADER_READ_BIT;
+/// handoff.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+/// handoff.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+///
+/// scheduler.releaseImage(computeCommands, handoff, bloom, aspects);
+/// const auto bloomed = scheduler.submit(QueueType::VW_COMPUTE_QUEUE,
+///                                       computeCommands);
+///
+/// scheduler.acquireImage(graphicsCommands, handoff, bloom, aspects);
+/// scheduler.submitAfter(QueueType::VW_GRAPHICS_QUEUE, graphicsCommands,
+///   QueueType::VW_COMPUTE_QUEUE, bloomed,
+///   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+/// scheduler.flush();
+/// \endcode
+class QueueScheduler {
+ public:
+  /// Constructor which creates a queue for each distinct queue which the
+  /// work is routed to. If the device has no queues the scheduler has none
+  /// either, and no work may be submitted through it.
+  ///
+  /// \param device The device, which must outlive the scheduler.
+  explicit QueueScheduler(const Device& device);
+
+  QueueScheduler(const QueueScheduler&)            = delete;
+  QueueScheduler& operator=(const QueueScheduler&) = delete;
+
+  /// Gets the queue which a type of work runs on.
+  ///
+  /// \param queueType The type of work.
+  Queue& getQueue(QueueType queueType) const {
+    return *Routes[detail::routeIndex(queueType)];
+  }
+
+  /// Returns true if a type of work runs on a different queue family to the
+  /// graphics work, and so can overlap with it.
+  ///
+  /// \param queueType The type of work.
+  bool isAsync(QueueType queueType) const {
+    return getQueue(queueType).getFamilyIndex() !=
+           getQueue(QueueType::VW_GRAPHICS_QUEUE).getFamilyIndex();
+  }
+
+  /// Gets the distinct queue families which the work runs on, which are the
+  /// families to create concurrently shared resources with.
+  const QueueIdVec& getFamilies() const {
+    return Families;
+  }
+
+  /// Gets the sharing mode for a resource which is used by all the types of
+  /// work.
+  ///
+  /// \param isImage          If the resource is an image.
+  /// \param handoffsPerFrame The number of times each frame the resource
+  ///        moves between types of work.
+  VkSharingMode getSharingMode(bool isImage, uint32_t handoffsPerFrame) const {
+    return detail::chooseSharingMode(isImage,
+      static_cast<uint32_t>(Families.size()), handoffsPerFrame);
+  }
+
+  /// Adds a command buffer to the next flush of the queue for a type of
+  /// work. Returns the timeline value of the submission.
+  ///
+  /// \param queueType     The type of work.
+  /// \param commandBuffer The command buffer to submit.
+  uint64_t submit(QueueType queueType, VkCommandBuffer commandBuffer) {
+    return getQueue(queueType).submit(commandBuffer);
+  }
+
+  /// Adds a command buffer which waits for a submission of another type of
+  /// work to the next flush. The wait is left out if both types of work run
+  /// on the same queue, where the barriers in the command buffers order
+  /// them. Returns the timeline value of the submission.
+  ///
+  /// \param queueType     The type of work.
+  /// \param commandBuffer The command buffer to submit.
+  /// \param waitType      The type of work to wait for.
+  /// \param waitValue     The timeline value of the submission to wait for.
+  /// \param waitStages    The stages which wait.
+  uint64_t submitAfter(QueueType            queueType    ,
+                       VkCommandBuffer      commandBuffer,
+                       QueueType            waitType     ,
+                       uint64_t             waitValue    ,
+                       VkPipelineStageFlags waitStages   );
+
+  /// Flushes all the queues -- transfer and compute first, so that their
+  /// work starts before the graphics work which waits on it.
+  void flush();
+
+  /// Records the release of an image by the source work of a handoff, if it
+  /// needs one.
+  ///
+  /// \param commandBuffer The command buffer of the source work.
+  /// \param handoff       The handoff.
+  /// \param image         The image.
+  /// \param aspects       The aspects of the image.
+  void releaseImage(VkCommandBuffer     commandBuffer,
+                    const QueueHandoff& handoff      ,
+                    VkImage             image        ,
+                    VkImageAspectFlags  aspects      ) const;
+
+  /// Records the acquire of an image by the destination work of a handoff,
+  /// if it needs one.
+  ///
+  /// \param commandBuffer The command buffer of the destination work.
+  /// \param handoff       The handoff.
+  /// \param image         The image.
+  /// \param aspects       The aspects of the image.
+  void acquireImage(VkCommandBuffer     commandBuffer,
+                    const QueueHandoff& handoff      ,
+                    VkImage             image        ,
+                    VkImageAspectFlags  aspects      ) const;
+
+  /// Records the release of a buffer by the source work of a handoff, if it
+  /// needs one.
+  ///
+  /// \param commandBuffer The command buffer of the source work.
+  /// \param handoff       The handoff.
+  /// \param buffer        The buffer.
+  void releaseBuffer(VkCommandBuffer     commandBuffer,
+                     const QueueHandoff& handoff      ,
+                     VkBuffer            buffer       ) const;
+
+  /// Records the acquire of a buffer by the destination work of a handoff,
+  /// if it needs one.
+  ///
+  /// \param commandBuffer The command buffer of the destination work.
+  /// \param handoff       The handoff.
+  /// \param buffer        The buffer.
+  void acquireBuffer(VkCommandBuffer     commandBuffer,
+                     const QueueHandoff& handoff      ,
+                     VkBuffer            buffer       ) const;
+
+ private:
+  /// The queue each type of work runs on, in route order.
+  using RouteArray = std::array<Queue*, ScheduledQueueCountCx>;
+
+  const Device&                       Owner;     //!< The device.
+  std::vector<std::unique_ptr<Queue>> Queues;    //!< The distinct queues.
+  RouteArray                          Routes;    //!< The queue of each type.
+  QueueIdVec                          Families;  //!< The distinct families.
+
+  /// Works out the barriers for a handoff.
+  ///
+  /// \param handoff The handoff.
+  /// \param release Set to the barrier of the source queue.
+  /// \param acquire Set to the barrier of the destination queue.
+  void plan(const QueueHandoff& handoff,
+            HandoffBarrier&     release,
+            HandoffBarrier&     acquire) const;
+
+  /// Records the barrier for one side of an image handoff.
+  ///
+  /// \param commandBuffer The command buffer to record into.
+  /// \param handoff       The handoff.
+  /// \param barrier       The side of the handoff.
+  /// \param image         The image.
+  /// \param aspects       The aspects of the image.
+  void recordImage(VkCommandBuffer       commandBuffer,
+                   const QueueHandoff&   handoff      ,
+                   const HandoffBarrier& barrier      ,
+                   VkImage               image        ,
+                   VkImageAspectFlags    aspects      ) const;
+
+  /// Records the barrier for one side of a buffer handoff.
+  ///
+  /// \param commandBuffer The command buffer to record into.
+  /// \param barrier       The side of the handoff.
+  /// \param buffer        The buffer.
+  void recordBuffer(VkCommandBuffer       commandBuffer,
+                    const HandoffBarrier& barrier      ,
+                    VkBuffer              buffer       ) const;
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_QUEUE_SCHEDULER_H
@@ -0,0 +1,204 @@
+//---- include/vulkawrap/device/render_pass_cache.h -------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  render_pass_cache.h
+/// \brief Defines the render pass cache, which creates each distinct render
+///        pass and framebuffer once, and finds them by their description.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_RENDER_PASS_CACHE_H
+#define VULKAWRAP_DEVICE_RENDER_PASS_CACHE_H
+
+#include "vulkawrap/loader/dispatch.h"
+#include "vulkawrap/util/hash.hpp"
+#include "vulkawrap/util/thread_cache.h"
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vwrap {
+
+//---- Implementations ------------------------------------------------------//
+
+/// Description of a subpass, which owns its attachment references.
+struct SubpassDescription {
+  std::vector<VkAttachmentReference> inputs;        //!< Input attachments.
+  std::vector<VkAttachmentReference> colors;        //!< Color attachments.
+  std::vector<VkAttachmentReference> resolves;      //!< Resolve attachments,
+                                                    //!< which are empty or
+                                                    //!< one per color.
+  VkAttachmentReference              depthStencil;  //!< The depth stencil
+                                                    //!< attachment.
+  std::vector<uint32_t>              preserves;     //!< Preserved attachments.
+
+  /// Default constructor, which creates a subpass without a depth stencil
+  /// attachment.
+  SubpassDescription()
+  : depthStencil{ VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED } {}
+};
+
+/// Description of a render pass.
+struct RenderPassDescription {
+  std::vector<VkAttachmentDescription> attachments;   //!< The attachments.
+  std::vector<SubpassDescription>      subpasses;     //!< The subpasses.
+  std::vector<VkSubpassDependency>     dependencies;  //!< The dependencies
+                                                      //!< between subpasses.
+};
+
+/// Description of a framebuffer.
+struct FramebufferDescription {
+  VkRenderPass             renderPass;   //!< The render pass.
+  std::vector<VkImageView> attachments;  //!< The view of each attachment.
+  uint32_t                 width;        //!< The width of the framebuffer.
+  uint32_t                 height;       //!< The height of the framebuffer.
+  uint32_t                 layers;       //!< The number of layers.
+
+  /// Default constructor, which creates a description of a single layer.
+  FramebufferDescription()
+  : renderPass(VK_NULL_HANDLE), width(0), height(0), layers(1) {}
+};
+
+namespace detail {
+
+/// Appends the signature of a render pass description.
+///
+/// \param description The description of the render pass.
+/// \param signature   The signature to append to.
+void appendSignature(const RenderPassDescription& description,
+                     util::Signature&             signature  );
+
+/// Appends the signature of a framebuffer description.
+///
+/// \param description The description of the framebuffer.
+/// \param signature   The signature to append to.
+void appendSignature(const FramebufferDescription& description,
+                     util::Signature&              signature  );
+
+} // namespace detail
+
+/// Cache of the render passes and framebuffers of a device. A render pass or
+/// framebuffer is created the first time its description is seen, and the
+/// same object is returned for every identical description after that, so
+/// that resizing a render target or reconfiguring a pass only creates the
+/// objects which are actually new.
+///
+/// Each thread keeps the objects it has looked up, so once a thread has seen
+/// an object it is found without locking. Only a thread's first lookup of an
+/// object takes a lock, and only creating an object calls the driver.
+///
+/// Render passes live as long as the cache. Framebuffers are destroyed when
+/// one of their image views is evicted, which must be done before the view
+/// is destroyed, and once no work which uses the framebuffers is executing.
+/// Evicting must not be done while other threads are using the cache.
+///
+/// Example usage:
+/// \code
+/// RenderPassCache renderPasses(device.getDispatch());
+///
+/// auto renderPass = renderPasses.getRenderPass(gBufferDescription);
+///
+/// FramebufferDescription framebuffer;
+/// framebuffer.renderPass  = renderPass;
+/// framebuffer.attachments = { albedoView, normalView, depthView };
+/// framebuffer.width       = extent.width;
+/// framebuffer.height      = extent.height;
+/// auto vkFramebuffer = renderPasses.getFramebuffer(framebuffer);
+///
+/// // When the render target is resized:
+/// renderPasses.evictImageView(albedoView);
+/// \endcode
+class RenderPassCache {
+ public:
+  /// Constructor which creates an empty cache.
+  ///
+  /// \param dispatch The dispatch table of the device, which must outlive
+  ///        the cache.
+  explicit RenderPassCache(const loader::DeviceDispatch& dispatch);
+
+  /// Destructor which destroys all the render passes and framebuffers.
+  ~RenderPassCache();
+
+  RenderPassCache(const RenderPassCache&)            = delete;
+  RenderPassCache& operator=(const RenderPassCache&) = delete;
+
+  /// Gets the render pass for a description, creating it if it is not in the
+  /// cache. Returns VK_NULL_HANDLE if the render pass could not be created.
+  ///
+  /// \param description The description of the render pass.
+  VkRenderPass getRenderPass(const RenderPassDescription& description);
+
+  /// Gets the framebuffer for a description, creating it if it is not in the
+  /// cache. Returns VK_NULL_HANDLE if the framebuffer could not be created.
+  ///
+  /// \param description The description of the framebuffer.
+  VkFramebuffer getFramebuffer(const FramebufferDescription& description);
+
+  /// Destroys all the framebuffers which use an image view.
+  ///
+  /// \param imageView The image view which is being destroyed.
+  void evictImageView(VkImageView imageView);
+
+  /// Gets the number of render passes in the cache.
+  size_t getRenderPassCount();
+
+  /// Gets the number of framebuffers in the cache.
+  size_t getFramebufferCount();
+
+ private:
+  /// The objects which a single thread has looked up, which are defined in
+  /// the implementation.
+  struct ThreadObjects;
+
+  /// A cached framebuffer, and the image views which it uses.
+  struct FramebufferEntry {
+    VkFramebuffer            framebuffer;  //!< The framebuffer.
+    std::vector<VkImageView> views;        //!< The views of the framebuffer.
+  };
+
+  /// Map of signatures to render passes.
+  using RenderPassMap  =
+    std::unordered_map<util::Signature, VkRenderPass, util::SignatureHash>;
+  /// Map of signatures to framebuffers.
+  using FramebufferMap =
+    std::unordered_map<util::Signature, FramebufferEntry, util::SignatureHash>;
+
+  const loader::DeviceDispatch& Dispatch;      //!< The device.
+  std::atomic<uint64_t>         Epoch;         //!< Changes when framebuffers
+                                               //!< are evicted.
+  util::ThreadCache<ThreadObjects>
+                                Threads;       //!< The objects of each
+                                               //!< thread.
+  std::mutex                    Mutex;         //!< Protects the state below.
+  RenderPassMap                 RenderPasses;  //!< The render passes.
+  FramebufferMap                Framebuffers;  //!< The framebuffers.
+
+  /// Gets the objects of the calling thread, creating them the first time
+  /// the thread uses the cache.
+  ThreadObjects& getThreadObjects();
+
+  /// Creates a render pass.
+  ///
+  /// \param description The description of the render pass.
+  VkRenderPass create(const RenderPassDescription& description) const;
+
+  /// Creates a framebuffer.
+  ///
+  /// \param description The description of the framebuffer.
+  VkFramebuffer create(const FramebufferDescription& description) const;
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_RENDER_PASS_CACHE_H
@@ -0,0 +1,272 @@
+//---- include/vulkawrap/device/sync_pools.h --------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  sync_pools.h
+/// \brief Defines pools which recycle fences, semaphores and events, rather
+///        than creating and destroying them for every use.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_DEVICE_SYNC_POOLS_H
+#define VULKAWRAP_DEVICE_SYNC_POOLS_H
+
+#include "vulkawrap/loader/dispatch.h"
+#include "vulkawrap/util/thread_cache.h"
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The default number of returned objects which each thread keeps, before it
+/// gives half of them back to the shared pool.
+static constexpr uint32_t DefaultSyncCacheSizeCx = 64;
+
+//---- Implementations ------------------------------------------------------//
+
+namespace detail {
+
+/// Creates, resets and destroys fences for a SyncPool. Fences are reset
+/// with a single call for the whole batch.
+struct FenceTraits {
+  using Handle = VkFence;
+
+  /// Creates an unsignalled fence.
+  ///
+  /// \param dispatch The dispatch table of the device.
+  static VkFence create(const loader::DeviceDispatch& dispatch);
+
+  /// Resets a batch of fences to unsignalled.
+  ///
+  /// \param dispatch The dispatch table of the device.
+  /// \param fences   The fences to reset.
+  /// \param count    The number of fences.
+  static void reset(const loader::DeviceDispatch& dispatch,
+                    const VkFence* fences, uint32_t count);
+
+  /// Destroys a fence.
+  ///
+  /// \param dispatch The dispatch table of the device.
+  /// \param fence    The fence to destroy.
+  static void destroy(const loader::DeviceDispatch& dispatch, VkFence fence);
+};
+
+/// Creates and destroys binary semaphores for a SyncPool. A semaphore is
+/// unsignalled again once its wait has executed, so it needs no reset.
+struct SemaphoreTraits {
+  using Handle = VkSemaphore;
+
+  /// Creates a binary semaphore.
+  ///
+  /// \param dispatch The dispatch table of the device.
+  static VkSemaphore create(const loader::DeviceDispatch& dispatch);
+
+  /// Does nothing, since semaphores unsignal when they are waited on.
+  static void reset(const loader::DeviceDispatch&, const VkSemaphore*,
+                    uint32_t) {}
+
+  /// Destroys a semaphore.
+  ///
+  /// \param dispatch  The dispatch table of the device.
+  /// \param semaphore The semaphore to destroy.
+  static void destroy(const loader::DeviceDispatch& dispatch,
+                      VkSemaphore                   semaphore);
+};
+
+/// Creates, resets and destroys events for a SyncPool. There is no batched
+/// reset for events, so they are reset one at a time, but still only when
+/// they are about to be reused.
+struct EventTraits {
+  using Handle = VkEvent;
+
+  /// Creates an unsignalled event.
+  ///
+  /// \param dispatch The dispatch table of the device.
+  static VkEvent create(const loader::DeviceDispatch& dispatch);
+
+  /// Resets a batch of events to unsignalled.
+  ///
+  /// \param dispatch The dispatch table of the device.
+  /// \param events   The events to reset.
+  /// \param count    The number of events.
+  static void reset(const loader::DeviceDispatch& dispatch,
+                    const VkEvent* events, uint32_t count);
+
+  /// Destroys an event.
+  ///
+  /// \param dispatch The dispatch table of the device.
+  /// \param event    The event to destroy.
+  static void destroy(const loader::DeviceDispatch& dispatch, VkEvent event);
+};
+
+} // namespace detail
+
+/// Pool of synchronization objects of one type, for a device. Each thread
+/// which uses the pool has its own cache of ready and returned objects, so
+/// acquiring and releasing normally touch no locks and make no driver calls.
+/// Returned objects are only reset when the thread runs out of ready ones,
+/// and then all of them are reset together, which for fences is a single
+/// call to vkResetFences. A thread which returns more objects than its cache
+/// holds gives half of them to a shared list, which other threads take from
+/// before creating new objects.
+///
+/// An object must only be released once the device is done with it -- a
+/// fence once it has signalled (or was never submitted), a semaphore once its
+/// wait has executed, and an event once no commands which use it are pending.
+/// All objects must be released before the pool is destroyed, and the pool
+/// must not be used while it is being destroyed.
+///
+/// Example usage:
+/// \code
+/// FencePool fences(device.getDispatch());
+///
+/// auto fence = fences.acquire();
+/// vkQueueSubmit(queue, 1, &submitInfo, fence);
+/// ...
+/// vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+/// fences.release(fence);
+/// \endcode
+///
+/// \tparam Traits The traits which create, reset and destroy the objects.
+template <typename Traits>
+class SyncPool {
+ public:
+  using Handle = typename Traits::Handle;
+
+  /// Constructor which sets up an empty pool. Objects are only created when
+  /// they are first acquired.
+  ///
+  /// \param dispatch  The dispatch table of the device, which must outlive the
+  ///        pool.
+  /// \param cacheSize The number of returned objects each thread keeps.
+  explicit SyncPool(const loader::DeviceDispatch& dispatch,
+                    uint32_t cacheSize = DefaultSyncCacheSizeCx)
+  : Dispatch(dispatch), CacheSize(std::max(cacheSize, 2u)), CreatedCount(0) {}
+
+  /// Destructor which destroys all of the objects in the pool.
+  ~SyncPool() {
+    Caches.forEach([this] (const ThreadObjects& cache) {
+      for (auto handle : cache.ready)    Traits::destroy(Dispatch, handle);
+      for (auto handle : cache.returned) Traits::destroy(Dispatch, handle);
+    });
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (auto handle : Shared) Traits::destroy(Dispatch, handle);
+  }
+
+  SyncPool(const SyncPool&)            = delete;
+  SyncPool& operator=(const SyncPool&) = delete;
+
+  /// Acquires an object which is reset and ready to use. Returns
+  /// VK_NULL_HANDLE if a new object was needed and could not be created.
+  Handle acquire() {
+    auto& cache = getThreadCache();
+    if (cache.ready.empty() && !refill(cache)) return Handle{};
+
+    const auto handle = cache.ready.back();
+    cache.ready.pop_back();
+    return handle;
+  }
+
+  /// Returns an object to the pool.
+  ///
+  /// \param handle The object to return.
+  void release(Handle handle) {
+    if (handle == Handle{}) return;
+    auto& cache = getThreadCache();
+    cache.returned.push_back(handle);
+    if (cache.returned.size() <= CacheSize) return;
+
+    const auto keep = cache.returned.size() / 2;
+    std::lock_guard<std::mutex> lock(Mutex);
+    Shared.insert(Shared.end(), cache.returned.begin() + keep,
+                  cache.returned.end());
+    cache.returned.resize(keep);
+  }
+
+  /// Gets the number of objects which the pool has created.
+  size_t getCreatedCount() const {
+    return CreatedCount.load(std::memory_order_relaxed);
+  }
+
+ private:
+  /// The objects which a thread holds.
+  struct ThreadObjects {
+    std::vector<Handle> ready;     //!< Objects which are ready to use.
+    std::vector<Handle> returned;  //!< Objects which need a reset.
+  };
+
+  const loader::DeviceDispatch&    Dispatch;      //!< The device.
+  size_t                           CacheSize;     //!< Returned objects each
+                                                  //!< thread keeps.
+  std::atomic<size_t>              CreatedCount;  //!< Objects made.
+  util::ThreadCache<ThreadObjects> Caches;        //!< The cache of each
+                                                  //!< thread.
+  std::mutex                       Mutex;         //!< Protects the state
+                                                  //!< below.
+  std::vector<Handle>              Shared;        //!< Objects given back by
+                                                  //!< threads.
+
+  /// Gets the cache of the calling thread, creating it the first time the
+  /// thread uses the pool.
+  ThreadObjects& getThreadCache() {
+    return Caches.get([] (ThreadObjects&) {});
+  }
+
+  /// Fills the ready objects of a thread. The thread's returned objects are
+  /// reset first, then objects from the shared list, and only if there are
+  /// none of those is a new object created. Returns false if no object could
+  /// be made ready.
+  ///
+  /// \param cache The cache of the calling thread.
+  bool refill(ThreadObjects& cache) {
+    if (cache.returned.empty()) {
+      std::lock_guard<std::mutex> lock(Mutex);
+      const auto take = std::min(Shared.size(), CacheSize / 2);
+      cache.returned.insert(cache.returned.end(), Shared.end() - take,
+                            Shared.end());
+      Shared.resize(Shared.size() - take);
+    }
+
+    if (!cache.returned.empty()) {
+      Traits::reset(Dispatch, cache.returned.data(),
+                    static_cast<uint32_t>(cache.returned.size()));
+      cache.ready.swap(cache.returned);
+      return true;
+    }
+
+    const auto handle = Traits::create(Dispatch);
+    if (handle == Handle{}) return false;
+    CreatedCount.fetch_add(1, std::memory_order_relaxed);
+    cache.ready.push_back(handle);
+    return true;
+  }
+};
+
+//---- Aliases --------------------------------------------------------------//
+
+/// Pool of fences, which are handed out unsignalled.
+using FencePool     = SyncPool<detail::FenceTraits>;
+
+/// Pool of binary semaphores.
+using SemaphorePool = SyncPool<detail::SemaphoreTraits>;
+
+/// Pool of events, which are handed out unsignalled.
+using EventPool     = SyncPool<detail::EventTraits>;
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_DEVICE_SYNC_POOLS_H
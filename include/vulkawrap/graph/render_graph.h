@@ -0,0 +1,350 @@
+//---- include/vulkawrap/graph/render_graph.h -------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  render_graph.h
+/// \brief Defines the render graph, which orders the passes of a frame, works
+///        out the barriers between them, and aliases the memory of transient
+///        resources.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_GRAPH_RENDER_GRAPH_H
+#define VULKAWRAP_GRAPH_RENDER_GRAPH_H
+
+#include "vulkawrap/loader/dispatch.h"
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The id of a resource or pass which doesn't exist.
+static constexpr uint32_t InvalidGraphIdCx = ~0u;
+
+//---- Implementations ------------------------------------------------------//
+
+/// The barriers which are needed before a pass. All the barriers of a pass
+/// are recorded with a single vkCmdPipelineBarrier call.
+struct BarrierBatch {
+  /// A layout transition of an image, which also makes the image's earlier
+  /// writes available.
+  struct ImageTransition {
+    uint32_t      resource;   //!< The image.
+    VkAccessFlags srcAccess;  //!< Writes which must be made available.
+    VkAccessFlags dstAccess;  //!< Accesses which the writes must be visible
+                              //!< to.
+    VkImageLayout oldLayout;  //!< The layout the image is in.
+    VkImageLayout newLayout;  //!< The layout the image is needed in.
+  };
+
+  VkPipelineStageFlags         srcStages;  //!< Stages which must complete.
+  VkPipelineStageFlags         dstStages;  //!< Stages which wait.
+  VkAccessFlags                srcAccess;  //!< Writes for the memory barrier.
+  VkAccessFlags                dstAccess;  //!< Accesses for the memory
+                                           //!< barrier.
+  std::vector<ImageTransition> images;     //!< The layout transitions.
+
+  /// Default constructor, which creates an empty batch.
+  BarrierBatch() : srcStages(0), dstStages(0), srcAccess(0), dstAccess(0) {}
+
+  /// Returns true if the batch has no barriers.
+  bool empty() const {
+    return srcStages == 0 && dstStages == 0 && images.empty();
+  }
+};
+
+/// Where a transient resource is placed in the transient memory, and the
+/// passes it is used in. Resources which are never used at the same time can
+/// be placed in the same memory.
+struct ResourcePlacement {
+  VkDeviceSize offset;     //!< The offset of the resource in the memory.
+  uint32_t     firstPass;  //!< The first pass, in execution order, which
+                           //!< uses the resource.
+  uint32_t     lastPass;   //!< The last pass which uses the resource.
+
+  /// Default constructor, which creates the placement of an unused resource.
+  ResourcePlacement()
+  : offset(0), firstPass(InvalidGraphIdCx), lastPass(InvalidGraphIdCx) {}
+
+  /// Returns true if the resource is used by any pass.
+  bool used() const {
+    return firstPass != InvalidGraphIdCx;
+  }
+};
+
+/// The result of compiling a render graph, which is everything that is
+/// needed to record the frame.
+struct RenderGraphPlan {
+  std::vector<uint32_t>          order;         //!< The passes which are
+                                                //!< executed, in order.
+  std::vector<BarrierBatch>      barriers;      //!< The barriers before each
+                                                //!< pass in the order.
+  BarrierBatch                   finalBarriers; //!< Transitions imported
+                                                //!< images to their final
+                                                //!< layouts.
+  std::vector<ResourcePlacement> placements;    //!< The placement of each
+                                                //!< resource.
+  VkDeviceSize                   transientSize; //!< The size of the memory
+                                                //!< for transient resources.
+
+  /// Default constructor, which creates an empty plan.
+  RenderGraphPlan() : transientSize(0) {}
+};
+
+/// Graph of the passes of a frame, and the resources which they use. Passes
+/// declare what they read and write, and compiling the graph:
+///
+///   - Removes passes whose results are never used. A pass is needed if it
+///     writes an imported resource, or writes something a needed pass reads.
+///   - Orders the passes, starting each pass as long after the passes it
+///     depends on as possible, so that the GPU has other work to do while it
+///     waits for them.
+///   - Works out the barriers before each pass, only synchronising the
+///     stages and accesses which actually conflict, and only transitioning
+///     images whose layout changes. The barriers before a pass are batched
+///     into a single vkCmdPipelineBarrier call.
+///   - Places transient resources in a single block of memory, so that
+///     resources which are never used at the same time share memory.
+///
+/// Compiling doesn't use the device, so the plan can be inspected in tests.
+/// Recording the graph needs the images, and the transient resources must be
+/// bound to the transient memory at their placement offsets.
+///
+/// Example usage:
+/// \code
+/// RenderGraph graph;
+/// auto gBuffer   = graph.createImage("gbuffer", VK_IMAGE_ASPECT_COLOR_BIT,
+///                                    gBufferSize, gBufferAlignment);
+/// auto swapchain = graph.importImage("swapchain", VK_IMAGE_ASPECT_COLOR_BIT,
+///                    VK_IMAGE_LAYOUT_UNDEFINED,
+///                    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+///
+/// auto geometry = graph.addPass("geometry", recordGeometry);
+/// graph.write(geometry, gBuffer,
+///   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+///   VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+///   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+///
+/// auto lighting = graph.addPass("lighting", recordLighting);
+/// graph.read(lighting, gBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+///   VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+/// graph.write(lighting, swapchain, ...);
+///
+/// graph.compile();
+/// // Allocate graph.getPlan().transientSize bytes, and bind the images.
+/// graph.setImage(gBuffer  , gBufferImage  );
+/// graph.setImage(swapchain, swapchainImage);
+/// graph.record(device.getDispatch(), commandBuffer);
+/// \endcode
+class RenderGraph {
+ public:
+  /// The function which records the commands of a pass.
+  using PassFunction = std::function<void(VkCommandBuffer)>;
+
+  /// Adds a transient image, which only lives for the frame, and whose
+  /// contents are undefined when it is first used. Returns the id of the
+  /// image.
+  ///
+  /// \param name      The name of the image.
+  /// \param aspects   The aspects of the image.
+  /// \param size      The size of the memory the image needs.
+  /// \param alignment The alignment of the memory the image needs.
+  uint32_t createImage(const std::string& name     ,
+                       VkImageAspectFlags aspects  ,
+                       VkDeviceSize       size     ,
+                       VkDeviceSize       alignment);
+
+  /// Adds a transient buffer. Returns the id of the buffer.
+  ///
+  /// \param name      The name of the buffer.
+  /// \param size      The size of the memory the buffer needs.
+  /// \param alignment The alignment of the memory the buffer needs.
+  uint32_t createBuffer(const std::string& name     ,
+                        VkDeviceSize       size     ,
+                        VkDeviceSize       alignment);
+
+  /// Adds an image which is owned outside of the graph, such as a swapchain
+  /// image. Returns the id of the image.
+  ///
+  /// \param name          The name of the image.
+  /// \param aspects       The aspects of the image.
+  /// \param initialLayout The layout the image is in before the frame.
+  /// \param finalLayout   The layout the image must be in after the frame.
+  uint32_t importImage(const std::string& name         ,
+                       VkImageAspectFlags aspects      ,
+                       VkImageLayout      initialLayout,
+                       VkImageLayout      finalLayout  );
+
+  /// Adds a buffer which is owned outside of the graph. Returns the id of the
+  /// buffer.
+  ///
+  /// \param name The name of the buffer.
+  uint32_t importBuffer(const std::string& name);
+
+  /// Adds a pass. Passes which are added later may only read what earlier
+  /// passes write. Returns the id of the pass.
+  ///
+  /// \param name     The name of the pass.
+  /// \param function The function which records the pass.
+  uint32_t addPass(const std::string& name                     ,
+                   PassFunction       function = PassFunction());
+
+  /// Declares that a pass reads a resource.
+  ///
+  /// \param pass     The pass which reads the resource.
+  /// \param resource The resource which is read.
+  /// \param stages   The stages which read the resource.
+  /// \param access   The types of the reads.
+  /// \param layout   The layout an image is read in.
+  void read(uint32_t             pass                               ,
+            uint32_t             resource                           ,
+            VkPipelineStageFlags stages                             ,
+            VkAccessFlags        access                             ,
+            VkImageLayout        layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+  /// Declares that a pass writes a resource. A pass which also needs the
+  /// contents of the resource must read it too.
+  ///
+  /// \param pass     The pass which writes the resource.
+  /// \param resource The resource which is written.
+  /// \param stages   The stages which write the resource.
+  /// \param access   The types of the writes.
+  /// \param layout   The layout an image is written in.
+  void write(uint32_t             pass                               ,
+             uint32_t             resource                           ,
+             VkPipelineStageFlags stages                             ,
+             VkAccessFlags        access                             ,
+             VkImageLayout        layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+  /// Compiles the graph into a plan. This must be done again after passes or
+  /// resources are added.
+  void compile();
+
+  /// Gets the plan from the last compile.
+  const RenderGraphPlan& getPlan() const {
+    return Plan;
+  }
+
+  /// Gets the name of a pass.
+  ///
+  /// \param pass The id of the pass.
+  const std::string& getPassName(uint32_t pass) const {
+    return Passes[pass].name;
+  }
+
+  /// Gets the name of a resource.
+  ///
+  /// \param resource The id of the resource.
+  const std::string& getResourceName(uint32_t resource) const {
+    return Resources[resource].name;
+  }
+
+  /// Sets the Vulkan image of an image resource, which the barriers use.
+  ///
+  /// \param resource The id of the image.
+  /// \param image    The Vulkan image.
+  void setImage(uint32_t resource, VkImage image) {
+    Resources[resource].image = image;
+  }
+
+  /// Records the compiled graph into a command buffer -- the barriers before
+  /// each pass, the pass, and then the final transitions.
+  ///
+  /// \param dispatch      The dispatch table of the device.
+  /// \param commandBuffer The command buffer to record into.
+  void record(const loader::DeviceDispatch& dispatch     ,
+              VkCommandBuffer               commandBuffer) const;
+
+ private:
+  /// A use of a resource by a pass.
+  struct ResourceUse {
+    uint32_t             resource;  //!< The resource.
+    VkPipelineStageFlags stages;    //!< The stages which use it.
+    VkAccessFlags        access;    //!< The types of access.
+    VkImageLayout        layout;    //!< The layout of an image.
+    bool                 reads;     //!< If the resource is read.
+    bool                 writes;    //!< If the resource is written.
+  };
+
+  /// A resource of the graph.
+  struct Resource {
+    std::string        name;           //!< The name of the resource.
+    bool               isImage;        //!< If the resource is an image.
+    bool               imported;       //!< If the resource is imported.
+    VkImageAspectFlags aspects;        //!< The aspects of an image.
+    VkImageLayout      initialLayout;  //!< The layout before the frame.
+    VkImageLayout      finalLayout;    //!< The layout after the frame.
+    VkDeviceSize       size;           //!< The size of a transient resource.
+    VkDeviceSize       alignment;      //!< The alignment of a transient
+                                       //!< resource.
+    VkImage            image;          //!< The Vulkan image.
+  };
+
+  /// A pass of the graph.
+  struct Pass {
+    std::string              name;      //!< The name of the pass.
+    PassFunction             function;  //!< Records the pass.
+    std::vector<ResourceUse> uses;      //!< The resources the pass uses.
+  };
+
+  std::vector<Resource> Resources;  //!< The resources.
+  std::vector<Pass>     Passes;     //!< The passes.
+  RenderGraphPlan       Plan;       //!< The plan from the last compile.
+
+  /// Adds a resource. Returns its id.
+  ///
+  /// \param resource The resource to add.
+  uint32_t addResource(Resource&& resource);
+
+  /// Adds a use of a resource to a pass, merging it with an earlier use of
+  /// the same resource by the pass.
+  ///
+  /// \param pass The pass which uses the resource.
+  /// \param use  The use of the resource.
+  void addUse(uint32_t pass, const ResourceUse& use);
+
+  /// Finds the passes which each pass depends on, and removes the passes
+  /// which aren't needed. Returns the dependencies of each needed pass, and
+  /// an empty list for the others.
+  ///
+  /// \param needed Set to whether each pass is needed.
+  std::vector<std::vector<uint32_t>> findDependencies(
+    std::vector<bool>& needed) const;
+
+  /// Orders the needed passes.
+  ///
+  /// \param dependencies The dependencies of each pass.
+  /// \param needed       Whether each pass is needed.
+  void orderPasses(const std::vector<std::vector<uint32_t>>& dependencies,
+                   const std::vector<bool>&                  needed      );
+
+  /// Places the transient resources in memory, from their lifetimes.
+  void placeResources();
+
+  /// Works out the barriers before each pass in the order.
+  void buildBarriers();
+
+  /// Records a batch of barriers.
+  ///
+  /// \param dispatch      The dispatch table of the device.
+  /// \param commandBuffer The command buffer to record into.
+  /// \param batch         The barriers to record.
+  void recordBarriers(const loader::DeviceDispatch& dispatch     ,
+                      VkCommandBuffer               commandBuffer,
+                      const BarrierBatch&           batch        ) const;
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_GRAPH_RENDER_GRAPH_H
@@ -0,0 +1,129 @@
+//---- include/vulkawrap/instance/capabilities.h ------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  capabilities.h
+/// \brief Defines a snapshot of the capabilities of a physical device, which
+///        is captured once and then queried in memory.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_INSTANCE_CAPABILITIES_H
+#define VULKAWRAP_INSTANCE_CAPABILITIES_H
+
+#include "vulkawrap/loader/dispatch.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+namespace vwrap {
+
+//---- Forward declarations -------------------------------------------------//
+
+struct DeviceCapabilities;
+
+//---- Aliases --------------------------------------------------------------//
+
+/// Alias for a vector of device capabilities.
+using DeviceCapabilitiesVec = std::vector<DeviceCapabilities>;
+
+/// Alias for a vector of queue family properties.
+using QueueFamilyPropVec = std::vector<VkQueueFamilyProperties>;
+
+/// Alias for a vector of format properties.
+using FormatPropVec = std::vector<VkFormatProperties>;
+
+//---- Constants ------------------------------------------------------------//
+
+/// The number of core Vulkan formats, for which the format properties are
+/// captured in the snapshot.
+static constexpr uint32_t CoreFormatCountCx =
+  static_cast<uint32_t>(VK_FORMAT_ASTC_12x12_SRGB_BLOCK) + 1;
+
+//---- Implementations ------------------------------------------------------//
+
+/// Immutable snapshot of the capabilities of a physical device. All the
+/// device queries are made when the snapshot is created, so that anything
+/// which needs to inspect the device afterwards does not need to call into
+/// the driver.
+struct DeviceCapabilities {
+  VkPhysicalDevice                 device;            //!< The device.
+  VkPhysicalDeviceProperties       properties;        //!< Device properties.
+  VkPhysicalDeviceFeatures         features;          //!< Device features.
+  VkPhysicalDeviceMemoryProperties memoryProperties;  //!< Memory types/heaps.
+  QueueFamilyPropVec               queueFamilies;     //!< Queue families.
+  FormatPropVec                    formats;           //!< Properties of each
+                                                      //!< core format.
+
+  /// Default constructor -- creates an empty snapshot.
+  DeviceCapabilities()
+  : device(VK_NULL_HANDLE), properties{}, features{}, memoryProperties{} {}
+
+  /// Constructor which queries all the capabilities of a physical device.
+  ///
+  /// \param dispatch         The dispatch table of the instance which the
+  ///        device belongs to.
+  /// \param vkPhysicalDevice The physical device to capture.
+  DeviceCapabilities(const loader::InstanceDispatch& dispatch,
+                     VkPhysicalDevice                vkPhysicalDevice);
+
+  /// Gets the properties of a format. Formats which are not core formats
+  /// were not captured, and report no supported features.
+  ///
+  /// \param format The format to get the properties of.
+  const VkFormatProperties& formatProperties(VkFormat format) const {
+    static const VkFormatProperties unsupported = {};
+    const auto formatIdx = static_cast<uint32_t>(format);
+    return formatIdx < formats.size() ? formats[formatIdx] : unsupported;
+  }
+
+  /// Returns true if the format supports all the features for the tiling.
+  ///
+  /// \param format           The format to check.
+  /// \param tiling           The tiling the format is used with.
+  /// \param requiredFeatures The features which must be supported.
+  bool supportsFormat(VkFormat format, VkImageTiling tiling,
+                      VkFormatFeatureFlags requiredFeatures) const {
+    const auto& props    = formatProperties(format);
+    const auto supported = tiling == VK_IMAGE_TILING_LINEAR
+                         ? props.linearTilingFeatures
+                         : props.optimalTilingFeatures;
+    return (supported & requiredFeatures) == requiredFeatures;
+  }
+};
+
+/// Enumerates the physical devices of an instance.
+///
+/// \param dispatch The dispatch table of the instance.
+/// \param instance The instance to enumerate the devices of.
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(
+  const loader::InstanceDispatch& dispatch, VkInstance instance);
+
+/// Captures the capabilities of physical devices. Each device is queried
+/// on its own thread, since the queries for a device are independent of the
+/// others, so the time is close to that of the slowest device rather than
+/// the sum. The capabilities are in the same order as the devices.
+///
+/// \param dispatch        The dispatch table of the instance.
+/// \param physicalDevices The devices to capture.
+DeviceCapabilitiesVec captureDeviceCapabilities(
+  const loader::InstanceDispatch&      dispatch       ,
+  const std::vector<VkPhysicalDevice>& physicalDevices);
+
+/// Captures the capabilities of all the physical devices of an instance,
+/// in parallel, in the order in which the instance enumerates them.
+///
+/// \param dispatch The dispatch table of the instance.
+/// \param instance The instance to capture the devices of.
+DeviceCapabilitiesVec captureDeviceCapabilities(
+  const loader::InstanceDispatch& dispatch, VkInstance instance);
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_INSTANCE_CAPABILITIES_H
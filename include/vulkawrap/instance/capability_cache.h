@@ -0,0 +1,139 @@
+//---- include/vulkawrap/instance/capability_cache.h -------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  capability_cache.h
+/// \brief Defines a persistent, memory mapped cache of physical device
+///        capabilities, so that a process can skip querying the driver for
+///        devices which it has already seen.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_INSTANCE_CAPABILITY_CACHE_H
+#define VULKAWRAP_INSTANCE_CAPABILITY_CACHE_H
+
+#include "capabilities.h"
+#include <cstddef>
+#include <string>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The version of the cache file format. Files with another version are
+/// ignored and rewritten.
+static constexpr uint32_t CapabilityCacheVersionCx = 1;
+
+/// The maximum number of queue families which are stored for a device.
+/// Devices with more families are not cached.
+static constexpr uint32_t MaxCachedQueueFamiliesCx = 16;
+
+namespace detail {
+
+/// Header at the start of a capability cache file.
+struct CapabilityCacheHeader {
+  char      magic[4];     //!< Identifies the file -- "VWDC".
+  uint32_t  version;      //!< The version of the file format.
+  uint32_t  recordSize;   //!< The size of each record, which changes if the
+                          //!< Vulkan structures which are stored change.
+  uint32_t  recordCount;  //!< The number of device records.
+  uint64_t  checksum;     //!< FNV-1a hash of all the records.
+};
+
+/// The capabilities of a single device, as they are stored in the file.
+struct CapabilityCacheRecord {
+  VkPhysicalDeviceProperties        properties;
+  VkPhysicalDeviceFeatures          features;
+  VkPhysicalDeviceMemoryProperties  memoryProperties;
+  uint32_t                          queueFamilyCount;
+  VkQueueFamilyProperties           queueFamilies[MaxCachedQueueFamiliesCx];
+  VkFormatProperties                formats[CoreFormatCountCx];
+};
+
+} // namespace detail
+
+/// A read only view of a capability cache file. The file is memory mapped,
+/// and is only used if its header, version, record size and checksum are
+/// all correct, otherwise the cache is not valid and the devices must be
+/// queried from the driver.
+///
+/// Records are keyed by the vendor id, device id, driver version and
+/// pipeline cache UUID of the device, so any driver update invalidates the
+/// records of the devices which it affects.
+class CapabilityCache {
+ public:
+  /// Constructor which maps the cache file, if it exists.
+  ///
+  /// \param path The path to the cache file.
+  explicit CapabilityCache(const std::string& path);
+
+  /// Destructor which unmaps the file.
+  ~CapabilityCache();
+
+  CapabilityCache(const CapabilityCache&)            = delete;
+  CapabilityCache& operator=(const CapabilityCache&) = delete;
+
+  /// Returns true if the file was mapped, and all of its contents are valid.
+  bool valid() const {
+    return Records != nullptr;
+  }
+
+  /// Finds the record for a device. Returns nullptr if there is no record for
+  /// the device, or the record is for another driver version.
+  ///
+  /// \param properties The live properties of the device.
+  const detail::CapabilityCacheRecord* find(
+    const VkPhysicalDeviceProperties& properties) const;
+
+  /// Makes a capability snapshot from a cache record.
+  ///
+  /// \param record           The record to make the snapshot from.
+  /// \param vkPhysicalDevice The device which the record is for.
+  static DeviceCapabilities toCapabilities(
+    const detail::CapabilityCacheRecord& record,
+    VkPhysicalDevice                     vkPhysicalDevice);
+
+  /// Writes the capabilities of devices to a cache file. The records which
+  /// the file already has for other devices are kept, while the records for
+  /// these devices replace any which the file has for them. The file is
+  /// written to a temporary file which is then renamed, so that a process
+  /// which is reading the cache never sees a partially written file. Returns
+  /// true if the file was written.
+  ///
+  /// \param path         The path to the cache file.
+  /// \param capabilities The capabilities to write.
+  static bool store(const std::string&           path        ,
+                    const DeviceCapabilitiesVec& capabilities);
+
+ private:
+  void*                                 Mapping;      //!< The mapped file.
+  size_t                                MappingSize;  //!< Size of the file.
+  uint32_t                              RecordCount;  //!< Number of records.
+  const detail::CapabilityCacheRecord*  Records;      //!< The records, or
+                                                      //!< nullptr if invalid.
+};
+
+/// Captures the capabilities of all the physical devices of an instance,
+/// using a cache file for devices which it has a record for. Each device
+/// is validated against the cache with a single properties query, and only
+/// devices which are missing from the cache (or whose driver has changed)
+/// are fully queried, after which the cache file is rewritten.
+///
+/// \param dispatch  The dispatch table of the instance.
+/// \param instance  The instance to capture the devices of.
+/// \param cachePath The path to the cache file.
+DeviceCapabilitiesVec captureDeviceCapabilities(
+  const loader::InstanceDispatch& dispatch ,
+  VkInstance                      instance ,
+  const std::string&              cachePath);
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_INSTANCE_CAPABILITY_CACHE_H
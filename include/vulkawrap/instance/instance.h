@@ -18,19 +18,23 @@
 #ifndef VULKAWRAP_INSTANCE_INSTANCE_H
 #define VULKAWRAP_INSTANCE_INSTANCE_H
 
+#include "capability_cache.h"
+#include "vulkawrap/loader/dispatch.h"
 #include "vulkawrap/util/assert.hpp"
+#include "vulkawrap/util/handle.hpp"
+#include "vulkawrap/util/reference_counter.hpp"
 #include <vulkan/vulkan.h>
-#include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace vwrap  {
 
 //---- Forward Declataions --------------------------------------------------//
 
-class ConcurrentReferenceCounter;
-class NonConcurrentReferenceCounter;
-
 template <typename ReferenceCounterType>
 class SharedInstance;
 
@@ -54,64 +58,6 @@ using UniqueInstance = std::unique_ptr<detail::Instance>;
 
 //---- Implementations ------------------------------------------------------//
 
-/// Reference counting class. This implementation is thread safe and can
-/// be used concurrently, but incurrs the overhead that the cuncurrent 
-/// incrementation and decrementation brings.
-class ConcurrentReferenceCounter {
- public:
-  /// Initializes the count.
-  void initialize() {
-    Count.store(1);
-  }
-
-  /// Increments the reference count.
-  void increment() { 
-    ++Count;
-  }
-
-  /// Decrements the reference count.
-  void decrement() {
-    --Count;
-  }
-
-  /// Gets the reference count.
-  uint32_t count() const {
-    return Count.load();
-  }
-
- private:
-  std::atomic<uint32_t> Count;  //!< The number of references.
-};
-
-/// Reference counting class. This implementation is not thread safe, and is
-/// provided for the case that thread safety is not required and the additional
-/// performance gained by removing the thread-safe functionality is justified.
-class NonConcurrentReferenceCounter {
- public:
-  /// Initializes the count.
-  void initialize() {
-    Count = 1;
-  }
-
-  /// Increments the reference count.
-  void increment() { 
-    ++Count;
-  }
-
-  /// Decrements the reference count.
-  void decrement() {
-    --Count;
-  }
-
-  /// Gets the reference count.
-  uint32_t count() const {
-    return Count;
-  }
-
- private:
-  uint32_t Count;  //!< The number of references.
-};
-
 namespace detail {
 
 /// Wrapper around a Vulkan Instance with a cleaner interface, and automatic
@@ -119,7 +65,10 @@ namespace detail {
 /// detail class which should be further wrapped by an instance couning
 /// classes, to provide shared and unique instance functionality.
 struct Instance {
-  VkInstance vkInstance;  //!< The vulkan instance which is being wrapped.
+  VkInstance                vkInstance;  //!< The vulkan instance which is 
+                                         //!< being wrapped.
+  loader::InstanceDispatch  dispatch;    //!< The instance level functions,
+                                         //!< loaded for this instance.
 
   /// Constructor to create an Instance.
   ///
@@ -128,46 +77,188 @@ struct Instance {
   /// \param extensions The vulkan extensions to use.
   /// \param layers     The layers which must be enabled.
   /// \param apiVersion The version of the vulkan API to use.
+  /// \param cachePath  The path of a file to use as a persistent cache of
+  ///        the device capabilities, so that the devices do not need to be
+  ///        fully queried by every process, or empty for no cache.
   Instance(
     const char* appName                        = ""                        , 
     const char* engineName                     = ""                        ,
     const std::vector<const char*>& extensions = std::vector<const char*>{},
     const std::vector<const char*>& layers     = std::vector<const char*>{},
-    uint32_t apiVersion                        = VK_MAKE_VERSION(1, 0, 2)
+    uint32_t apiVersion                        = VK_MAKE_VERSION(1, 0, 2)  ,
+    const std::string& cachePath               = std::string()
   );
 
   // Destructor to destroy the instance when it goes out of scope.     
   ~Instance() {
-     vkDestroyInstance(vkInstance, nullptr);
+     if (vkInstance != VK_NULL_HANDLE && dispatch.vkDestroyInstance)
+       dispatch.vkDestroyInstance(vkInstance, nullptr);
    } 
+
+  /// Gets the capabilities of all the physical devices of the instance. The
+  /// devices are only queried the first time this is called (which is thread
+  /// safe), and every later call returns the same snapshot. An instance which
+  /// failed to be created has no devices.
+  const DeviceCapabilitiesVec& deviceCapabilities() const {
+    std::call_once(CapabilitiesCaptured, [this] {
+      if (vkInstance == VK_NULL_HANDLE) return;
+      Capabilities = CapabilityCachePath.empty()
+        ? captureDeviceCapabilities(dispatch, vkInstance)
+        : captureDeviceCapabilities(dispatch, vkInstance, CapabilityCachePath);
+    });
+    return Capabilities;
+  }
+
+ private:
+  const std::string             CapabilityCachePath;  //!< Path of the cache,
+                                                      //!< or empty if none.
+  mutable std::once_flag        CapabilitiesCaptured; //!< If the devices have
+                                                      //!< been captured.
+  mutable DeviceCapabilitiesVec Capabilities;         //!< Device snapshots.
 };
 
 } // namespace detail 
 
+namespace detail {
+
+/// Builds the key which identifies the parameters of an instance, so that
+/// instances with the same parameters can be shared. The order of the
+/// extensions does not affect the key, but the order of the layers does,
+/// since it is the order in which the layers are called.
+///
+/// \param appName    The name of the application for the instance.
+/// \param engineName The name of the engine for the application.
+/// \param extensions The vulkan extensions to use.
+/// \param layers     The layers which must be enabled.
+/// \param apiVersion The version of the vulkan API to use.
+/// \param cachePath  The path of the capability cache, or empty for none.
+std::string instanceKey(const char*                     appName   ,
+                        const char*                     engineName,
+                        const std::vector<const char*>& extensions,
+                        const std::vector<const char*>& layers    ,
+                        uint32_t                        apiVersion,
+                        const std::string&              cachePath );
+
+/// The control block of a shared instance, which stores the reference count
+/// together with the instance so that sharing needs a single allocation.
+///
+/// \tparam RefCounter The type of the reference counter.
+template <typename RefCounter>
+struct SharedInstanceBlock {
+  RefCounter  counter;   //!< The number of shared instances referencing this.
+  Instance    instance;  //!< The instance being shared.
+  std::string key;       //!< The key of the instance in the registry.
+
+  /// Constructor which creates the instance, with a single reference.
+  ///
+  /// \param  key  The key of the instance in the registry.
+  /// \param  args The arguments to create the instance with.
+  /// \tparam Args The types of the arguments.
+  template <typename... Args>
+  SharedInstanceBlock(std::string key, Args&&... args) 
+  : instance(std::forward<Args>(args)...), key(std::move(key)) {
+    counter.initialize();
+  }
+};
+
+/// Process wide registry of the live shared instances, by the key of their
+/// parameters, so that shared instances which are created with the same
+/// parameters, even by unrelated modules, share a single Vulkan instance.
+/// The registry doesn't reference the instances, so an instance is still
+/// destroyed when its last shared instance is.
+///
+/// \tparam Block The type of the control blocks, which must have a
+///         concurrent reference counter, since the instances are shared
+///         between threads.
+template <typename Block>
+class InstanceRegistry {
+ public:
+  /// Alias for the type of the control blocks.
+  using Block_t = Block;
+
+  /// Gets the registry. It is never destroyed, so that shared instances
+  /// which are destroyed during static destruction can still release.
+  static InstanceRegistry& get() {
+    static auto* registry = new InstanceRegistry();
+    return *registry;
+  }
+
+  /// Gets a reference to the live instance with a key, or creates the
+  /// instance if there is none. Creation happens under the lock, so that
+  /// concurrent requests for the same parameters create a single instance.
+  ///
+  /// \param  key  The key of the instance's parameters.
+  /// \param  args The arguments to create the instance with.
+  /// \tparam Args The types of the arguments.
+  template <typename... Args>
+  Block_t* acquire(std::string key, Args&&... args) {
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    // An instance whose last reference is being released can't be shared,
+    // so it is replaced, and removes only itself when it is released.
+    auto found = Blocks.find(key);
+    if (found != Blocks.end() && found->second->counter.tryIncrement())
+      return found->second;
+
+    auto* block = new Block_t(key, std::forward<Args>(args)...);
+    if (block->instance.vkInstance != VK_NULL_HANDLE)
+      Blocks[std::move(key)] = block;
+    return block;
+  }
+
+  /// Removes an instance whose last reference has been released, and
+  /// destroys it.
+  ///
+  /// \param block The block of the instance.
+  void release(Block_t* block) {
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      auto found = Blocks.find(block->key);
+      if (found != Blocks.end() && found->second == block)
+        Blocks.erase(found);
+    }
+    delete block;
+  }
+
+ private:
+  std::mutex                                Mutex;   //!< Guards the blocks.
+  std::unordered_map<std::string, Block_t*> Blocks;  //!< Live instances.
+};
+
+} // namespace detail
+
 /// A shared Instance, so that a single vulkan instance can be used multiple
 /// times, and we can make sure that the instance is never cleaned if there is
-/// a pointer to it.
+/// a pointer to it. The instance is destroyed when the last shared instance
+/// which references it is destroyed.
 ///
 /// \tparam RefCounter The reference counter type -- this can be an atomic or a
 ///         non-atomic counter, deoending on what is required. 
 template <typename RefCounter>
 class SharedInstance {
  public:
-  /// Constructor to create a shared instance. This initializes
-  /// the instance count, creating a completelty new instance.
+  /// Constructor to create a shared instance. A concurrent shared instance
+  /// references the live instance with the same parameters, if there is
+  /// one, and otherwise creates a completely new instance. A non-concurrent
+  /// shared instance always creates a new instance, since its count can't
+  /// be shared with other threads.
   ///
   /// \param appName    The name of the application for this instance.
   /// \param engineName The name of the engine for this application.
   /// \param extensions The vulkan extensions to use.
   /// \param layers     The layers which must be enabled.
   /// \param apiVersion The version of the vulkan API to use.
+  /// \param cachePath  The path of the capability cache, or empty for none.
   SharedInstance(
     const char* appName                        = ""                        , 
     const char* engineName                     = ""                        ,
     const std::vector<const char*>& extensions = std::vector<const char*>{},
     const std::vector<const char*>& layers     = std::vector<const char*>{},
-    uint32_t apiVersion                        = VK_MAKE_VERSION(1, 0, 2)
-  );
+    uint32_t apiVersion                        = VK_MAKE_VERSION(1, 0, 2)  ,
+    const std::string& cachePath               = std::string()
+  ) 
+  : Block(acquire(appName, engineName, extensions, layers, apiVersion,
+                  cachePath)) {}
 
   /// Copy constructor, to create a SharedInstance from another SharedInstance.
   /// This will result in both the shared instances having the same Vulkan
@@ -175,10 +266,55 @@ class SharedInstance {
   ///
   /// \param otherInstance The other shared instance to create this shared
   /// instance from.
-  SharedInstance(const SharedInstance<RefCounter>& otherInstance)
-  :   InstanceCounter(otherInstance.InstanceCounter),
-      VulkanInstance(otherInstance.VulkanInstance) {
-    InstanceCounter->increment();
+  SharedInstance(const SharedInstance& otherInstance) noexcept
+  :   Block(otherInstance.Block) {
+    if (Block) Block->counter.increment();
+  }
+
+  /// Move constructor, which takes the reference of the other shared instance
+  /// without changing the reference count.
+  ///
+  /// \param otherInstance The other shared instance to move from.
+  SharedInstance(SharedInstance&& otherInstance) noexcept
+  :   Block(otherInstance.Block) {
+    otherInstance.Block = nullptr;
+  }
+
+  /// Destructor, which destroys the instance if this is the last reference.
+  ~SharedInstance() {
+    release();
+  }
+
+  /// Copy assignment, which releases the current instance and references the
+  /// instance of the other shared instance.
+  ///
+  /// \param otherInstance The other shared instance to copy.
+  SharedInstance& operator=(const SharedInstance& otherInstance) noexcept {
+    if (Block != otherInstance.Block) {
+      if (otherInstance.Block) otherInstance.Block->counter.increment();
+      release();
+      Block = otherInstance.Block;
+    }
+    return *this;
+  }
+
+  /// Move assignment, which releases the current instance and takes the
+  /// reference of the other shared instance without changing its count.
+  ///
+  /// \param otherInstance The other shared instance to move from.
+  SharedInstance& operator=(SharedInstance&& otherInstance) noexcept {
+    if (this != &otherInstance) {
+      release();
+      Block               = otherInstance.Block;
+      otherInstance.Block = nullptr;
+    }
+    return *this;
+  }
+
+  /// Returns true if the shared instance references an instance -- this is 
+  /// only false after the shared instance has been moved from.
+  explicit operator bool() const {
+    return Block != nullptr;
   }
 
   /// Gets the vulkan instance. This is designed as an accessor, so that the
@@ -188,59 +324,94 @@ class SharedInstance {
   /// since when the copy is made for the raw Vulkan instance, no counting
   /// functionality is invoked.
   VkInstance getVkInstance() const {
-    return VulkanInstance;
+    return Block->instance.vkInstance;
+  }
+
+  /// Gets the instance level dispatch table of the shared instance.
+  const loader::InstanceDispatch& getDispatch() const {
+    return Block->instance.dispatch;
+  }
+
+  /// Gets the capabilities of the physical devices of the shared instance,
+  /// which are shared by all copies of the instance.
+  const DeviceCapabilitiesVec& getDeviceCapabilities() const {
+    return Block->instance.deviceCapabilities();
+  }
+
+  /// Gets a std::shared_ptr to the instance, which holds a reference to it
+  /// for as long as any copy of the pointer is alive, so that the instance
+  /// can be given to classes which don't know the type of the counter. For
+  /// a non-concurrent shared instance the copies must stay on one thread.
+  std::shared_ptr<const detail::Instance> getSharedPtr() const {
+    auto owner = std::make_shared<SharedInstance>(*this);
+    return std::shared_ptr<const detail::Instance>(owner, &Block->instance);
+  }
+
+  /// Gets the number of shared instances which reference the instance.
+  uint32_t useCount() const {
+    return Block ? Block->counter.count() : 0;
   }
  
  private:
-  RefCounter*     InstanceCounter;    //!< The counter for the instances.
-  VkInstance      VulkanInstance;     //!< The vulkan instance being shared.
-};
+  /// Alias for the type of the control block.
+  using Block_t = detail::SharedInstanceBlock<RefCounter>;
 
-//---- Implementation -------------------------------------------------------//
+  Block_t* Block;  //!< The instance and its reference count.
 
-template <typename RefCounter>
-SharedInstance<RefCounter>::SharedInstance(
-    const char* appName                                                   , 
-    const char* engineName                                                ,
-    const std::vector<const char*>& extensions                            ,
-    const std::vector<const char*>& layers                                ,
-    uint32_t apiVersion                                                   ) 
-:   InstanceCounter(new RefCounter()) {
-  InstanceCounter->initialize();
-
-   // Set the application properties.
-  VkApplicationInfo appInfo = {};
-  appInfo.sType             = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-  appInfo.pApplicationName  = appName;
-  appInfo.pEngineName       = engineName;
-  appInfo.apiVersion        = apiVersion;
-
-  // Create a vector with the default extensions 
-  // and then add the user defined extensions.
-  std::vector<const char*> enabledExtensions = 
-    { VK_KHR_SURFACE_EXTENSION_NAME }; 
-  for (const auto& extension : extensions) 
-    enabledExtensions.push_back(extension);
-
-  // Create and set the properties for a vulkan instance.
-  VkInstanceCreateInfo instanceInfo = {};
-  instanceInfo.sType                = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-  instanceInfo.pNext                = nullptr;
-  instanceInfo.pApplicationInfo     = &appInfo;
-
-  if (enabledExtensions.size() > 0) {
-    instanceInfo.enabledExtensionCount   = 
-      static_cast<uint32_t>(enabledExtensions.size());
-    instanceInfo.ppEnabledExtensionNames = enabledExtensions.data();
+  /// Alias for the type of the registry.
+  using Registry_t = detail::InstanceRegistry<Block_t>;
+
+  /// Gets the control block of an instance with some parameters, from the
+  /// registry if the counter is concurrent.
+  ///
+  /// \param appName    The name of the application for this instance.
+  /// \param engineName The name of the engine for this application.
+  /// \param extensions The vulkan extensions to use.
+  /// \param layers     The layers which must be enabled.
+  /// \param apiVersion The version of the vulkan API to use.
+  /// \param cachePath  The path of the capability cache, or empty for none.
+  static Block_t* acquire(const char*                     appName   ,
+                          const char*                     engineName,
+                          const std::vector<const char*>& extensions,
+                          const std::vector<const char*>& layers    ,
+                          uint32_t                        apiVersion,
+                          const std::string&              cachePath ) {
+    if (!RefCounter::IsConcurrentCx) {
+      return new Block_t(std::string(), appName, engineName, extensions,
+                         layers, apiVersion, cachePath);
+    }
+    return Registry_t::get().acquire(detail::instanceKey(appName, engineName,
+      extensions, layers, apiVersion, cachePath), appName, engineName,
+      extensions, layers, apiVersion, cachePath);
   }
 
-  if (layers.size() > 0) {
-    instanceInfo.enabledLayerCount   = static_cast<uint32_t>(layers.size());
-    instanceInfo.ppEnabledLayerNames = layers.data();
+  /// Releases the reference to the instance, destroying the instance if this
+  /// was the last reference.
+  void release() {
+    if (Block && Block->counter.decrement()) {
+      if (RefCounter::IsConcurrentCx) Registry_t::get().release(Block);
+      else                            delete Block;
+    }
+    Block = nullptr;
   }
-  VkResult result = vkCreateInstance(&instanceInfo, nullptr, &VulkanInstance);
-  util::AssertSuccess(result, "Failed to create instance.\n");
-}
+};
+
+/// Deleter for a raw Vulkan instance. The destroy function is looked up from
+/// the instance when it is destroyed, so the deleter has no state and a
+/// UniqueVkInstance is the size of a VkInstance.
+struct InstanceDeleter {
+  /// Destroys the instance.
+  ///
+  /// \param instance The instance to destroy.
+  void operator()(VkInstance instance) const;
+};
+
+/// Alias for a uniquely owned raw Vulkan instance.
+using UniqueVkInstance = UniqueHandle<VkInstance, InstanceDeleter>;
+
+/// Alias for a raw Vulkan instance which is shared between threads.
+using SharedVkInstance = 
+  SharedHandle<VkInstance, InstanceDeleter, ConcurrentReferenceCounter>;
 
 /// Wrapper around make_unique specifically for instances. Returns a
 /// UniqueInstance.
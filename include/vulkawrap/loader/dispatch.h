@@ -0,0 +1,243 @@
+//---- include/vulkawrap/loader/dispatch.h ----------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  dispatch.h
+/// \brief Defines the dispatch tables through which Vulkawrap calls Vulkan,
+///        and the lazy loading of the Vulkan library which fills them.
+///
+///        The library is built with VK_NO_PROTOTYPES, so nothing links
+///        against libvulkan. The library is only opened the first time a
+///        table is loaded, and instance and device level functions are
+///        fetched for the specific instance and device, so that device calls
+///        go straight to the driver rather than through the loader
+///        trampolines.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_LOADER_DISPATCH_H
+#define VULKAWRAP_LOADER_DISPATCH_H
+
+#include "vulkawrap/loader/tracing.h"
+#include <vulkan/vulkan.h>
+
+namespace vwrap  {
+namespace loader {
+
+//---- Function Lists -------------------------------------------------------//
+
+/// Functions which do not require an instance, and are loaded with a null
+/// instance from vkGetInstanceProcAddr.
+#define VWRAP_GLOBAL_FUNCTIONS(VW_FUNCTION)                                   \
+  VW_FUNCTION(vkCreateInstance)                                               \
+  VW_FUNCTION(vkEnumerateInstanceExtensionProperties)                         \
+  VW_FUNCTION(vkEnumerateInstanceLayerProperties)
+
+/// Functions which are loaded for a specific instance.
+#define VWRAP_INSTANCE_FUNCTIONS(VW_FUNCTION)                                 \
+  VW_FUNCTION(vkDestroyInstance)                                              \
+  VW_FUNCTION(vkEnumeratePhysicalDevices)                                     \
+  VW_FUNCTION(vkGetPhysicalDeviceProperties)                                  \
+  VW_FUNCTION(vkGetPhysicalDeviceFeatures)                                    \
+  VW_FUNCTION(vkGetPhysicalDeviceMemoryProperties)                            \
+  VW_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)                       \
+  VW_FUNCTION(vkGetPhysicalDeviceFormatProperties)                            \
+  VW_FUNCTION(vkEnumerateDeviceExtensionProperties)                           \
+  VW_FUNCTION(vkEnumerateDeviceLayerProperties)                               \
+  VW_FUNCTION(vkCreateDevice)                                                 \
+  VW_FUNCTION(vkGetDeviceProcAddr)
+
+/// Functions which are loaded for a specific logical device.
+#define VWRAP_DEVICE_FUNCTIONS(VW_FUNCTION)                                   \
+  VW_FUNCTION(vkDestroyDevice)                                                \
+  VW_FUNCTION(vkGetDeviceQueue)                                               \
+  VW_FUNCTION(vkDeviceWaitIdle)                                               \
+  VW_FUNCTION(vkQueueSubmit)                                                  \
+  VW_FUNCTION(vkQueueWaitIdle)                                                \
+  VW_FUNCTION(vkAllocateMemory)                                               \
+  VW_FUNCTION(vkFreeMemory)                                                   \
+  VW_FUNCTION(vkMapMemory)                                                    \
+  VW_FUNCTION(vkUnmapMemory)                                                  \
+  VW_FUNCTION(vkFlushMappedMemoryRanges)                                      \
+  VW_FUNCTION(vkInvalidateMappedMemoryRanges)                                 \
+  VW_FUNCTION(vkBindBufferMemory)                                             \
+  VW_FUNCTION(vkBindImageMemory)                                              \
+  VW_FUNCTION(vkGetBufferMemoryRequirements)                                  \
+  VW_FUNCTION(vkGetImageMemoryRequirements)                                   \
+  VW_FUNCTION(vkCreateFence)                                                  \
+  VW_FUNCTION(vkDestroyFence)                                                 \
+  VW_FUNCTION(vkResetFences)                                                  \
+  VW_FUNCTION(vkGetFenceStatus)                                               \
+  VW_FUNCTION(vkWaitForFences)                                                \
+  VW_FUNCTION(vkCreateSemaphore)                                              \
+  VW_FUNCTION(vkDestroySemaphore)                                             \
+  VW_FUNCTION(vkCreateEvent)                                                  \
+  VW_FUNCTION(vkDestroyEvent)                                                 \
+  VW_FUNCTION(vkGetEventStatus)                                               \
+  VW_FUNCTION(vkSetEvent)                                                     \
+  VW_FUNCTION(vkResetEvent)                                                   \
+  VW_FUNCTION(vkCreateQueryPool)                                              \
+  VW_FUNCTION(vkDestroyQueryPool)                                             \
+  VW_FUNCTION(vkGetQueryPoolResults)                                          \
+  VW_FUNCTION(vkCreateBuffer)                                                 \
+  VW_FUNCTION(vkDestroyBuffer)                                                \
+  VW_FUNCTION(vkCreateBufferView)                                             \
+  VW_FUNCTION(vkDestroyBufferView)                                            \
+  VW_FUNCTION(vkCreateImage)                                                  \
+  VW_FUNCTION(vkDestroyImage)                                                 \
+  VW_FUNCTION(vkCreateImageView)                                              \
+  VW_FUNCTION(vkDestroyImageView)                                             \
+  VW_FUNCTION(vkCreateShaderModule)                                           \
+  VW_FUNCTION(vkDestroyShaderModule)                                          \
+  VW_FUNCTION(vkCreatePipelineCache)                                          \
+  VW_FUNCTION(vkDestroyPipelineCache)                                         \
+  VW_FUNCTION(vkGetPipelineCacheData)                                         \
+  VW_FUNCTION(vkMergePipelineCaches)                                          \
+  VW_FUNCTION(vkCreateGraphicsPipelines)                                      \
+  VW_FUNCTION(vkCreateComputePipelines)                                       \
+  VW_FUNCTION(vkDestroyPipeline)                                              \
+  VW_FUNCTION(vkCreatePipelineLayout)                                         \
+  VW_FUNCTION(vkDestroyPipelineLayout)                                        \
+  VW_FUNCTION(vkCreateSampler)                                                \
+  VW_FUNCTION(vkDestroySampler)                                               \
+  VW_FUNCTION(vkCreateDescriptorSetLayout)                                    \
+  VW_FUNCTION(vkDestroyDescriptorSetLayout)                                   \
+  VW_FUNCTION(vkCreateDescriptorPool)                                         \
+  VW_FUNCTION(vkDestroyDescriptorPool)                                        \
+  VW_FUNCTION(vkResetDescriptorPool)                                          \
+  VW_FUNCTION(vkAllocateDescriptorSets)                                       \
+  VW_FUNCTION(vkFreeDescriptorSets)                                           \
+  VW_FUNCTION(vkUpdateDescriptorSets)                                         \
+  VW_FUNCTION(vkCreateFramebuffer)                                            \
+  VW_FUNCTION(vkDestroyFramebuffer)                                           \
+  VW_FUNCTION(vkCreateRenderPass)                                             \
+  VW_FUNCTION(vkDestroyRenderPass)                                            \
+  VW_FUNCTION(vkCreateCommandPool)                                            \
+  VW_FUNCTION(vkDestroyCommandPool)                                           \
+  VW_FUNCTION(vkResetCommandPool)                                             \
+  VW_FUNCTION(vkAllocateCommandBuffers)                                       \
+  VW_FUNCTION(vkFreeCommandBuffers)                                           \
+  VW_FUNCTION(vkBeginCommandBuffer)                                           \
+  VW_FUNCTION(vkEndCommandBuffer)                                             \
+  VW_FUNCTION(vkResetCommandBuffer)                                           \
+  VW_FUNCTION(vkCmdBindPipeline)                                              \
+  VW_FUNCTION(vkCmdSetViewport)                                               \
+  VW_FUNCTION(vkCmdSetScissor)                                                \
+  VW_FUNCTION(vkCmdBindDescriptorSets)                                        \
+  VW_FUNCTION(vkCmdBindIndexBuffer)                                           \
+  VW_FUNCTION(vkCmdBindVertexBuffers)                                         \
+  VW_FUNCTION(vkCmdDraw)                                                      \
+  VW_FUNCTION(vkCmdDrawIndexed)                                               \
+  VW_FUNCTION(vkCmdDispatch)                                                  \
+  VW_FUNCTION(vkCmdCopyBuffer)                                                \
+  VW_FUNCTION(vkCmdCopyBufferToImage)                                         \
+  VW_FUNCTION(vkCmdSetEvent)                                                  \
+  VW_FUNCTION(vkCmdResetEvent)                                                \
+  VW_FUNCTION(vkCmdPipelineBarrier)                                           \
+  VW_FUNCTION(vkCmdResetQueryPool)                                            \
+  VW_FUNCTION(vkCmdWriteTimestamp)                                            \
+  VW_FUNCTION(vkCmdPushConstants)                                             \
+  VW_FUNCTION(vkCmdBeginRenderPass)                                           \
+  VW_FUNCTION(vkCmdNextSubpass)                                               \
+  VW_FUNCTION(vkCmdEndRenderPass)                                             \
+  VW_FUNCTION(vkCmdExecuteCommands)
+
+/// Device functions from extensions, which are null unless the extension was
+/// enabled when the device was created.
+#define VWRAP_DEVICE_EXTENSION_FUNCTIONS(VW_FUNCTION)                         \
+  VW_FUNCTION(vkGetSemaphoreCounterValueKHR)                                  \
+  VW_FUNCTION(vkWaitSemaphoresKHR)                                            \
+  VW_FUNCTION(vkSignalSemaphoreKHR)
+
+/// Lists every function in the tables, for naming them.
+#define VWRAP_ALL_FUNCTIONS(VW_FUNCTION)                                      \
+  VWRAP_GLOBAL_FUNCTIONS(VW_FUNCTION)                                         \
+  VWRAP_INSTANCE_FUNCTIONS(VW_FUNCTION)                                       \
+  VWRAP_DEVICE_FUNCTIONS(VW_FUNCTION)                                         \
+  VWRAP_DEVICE_EXTENSION_FUNCTIONS(VW_FUNCTION)
+
+/// Declares the id of a Vulkan function.
+#define VWRAP_DECLARE_FUNCTION_ID(name) name,
+
+/// Declares a member function pointer for a Vulkan function in a table, which
+/// is traced if tracing is enabled.
+#define VWRAP_DECLARE_FUNCTION(name)                                          \
+  Entry<PFN_##name, static_cast<uint32_t>(VulkanFunction::name)> name =       \
+    nullptr;
+
+//---- Implementations ------------------------------------------------------//
+
+/// The ids of the functions in the tables, which identify them in traces.
+enum class VulkanFunction : uint32_t {
+  VWRAP_ALL_FUNCTIONS(VWRAP_DECLARE_FUNCTION_ID)
+  Count
+};
+
+/// The number of functions in the tables.
+static constexpr uint32_t VulkanFunctionCountCx =
+  static_cast<uint32_t>(VulkanFunction::Count);
+
+/// Gets the name of a function in the tables.
+///
+/// \param function The id of the function.
+const char* functionName(uint32_t function);
+
+/// Gets vkGetInstanceProcAddr from the Vulkan library. The library is opened
+/// the first time that this is called (which is thread safe), so that a
+/// process which never uses Vulkan never loads it. Returns nullptr if the
+/// library could not be found.
+PFN_vkGetInstanceProcAddr getInstanceProcAddr();
+
+/// Dispatch table for the functions which are called before an instance
+/// exists.
+struct GlobalDispatch {
+  VWRAP_GLOBAL_FUNCTIONS(VWRAP_DECLARE_FUNCTION)
+
+  /// Returns true if the table was loaded -- if the Vulkan library could be
+  /// found.
+  bool valid() const {
+    return vkCreateInstance != nullptr;
+  }
+};
+
+/// Gets the global dispatch table, which is loaded on the first call.
+const GlobalDispatch& globalDispatch();
+
+/// Dispatch table for instance level functions. This is owned by an instance
+/// and is loaded for that specific instance.
+struct InstanceDispatch {
+  VWRAP_INSTANCE_FUNCTIONS(VWRAP_DECLARE_FUNCTION)
+
+  /// Loads all the instance functions for an instance.
+  ///
+  /// \param instance The instance to load the functions for.
+  void load(VkInstance instance);
+};
+
+/// Dispatch table for device level functions. This is owned by a logical
+/// device and is loaded through vkGetDeviceProcAddr, so that calls through
+/// the table go directly to the driver.
+struct DeviceDispatch {
+  VkDevice device = VK_NULL_HANDLE;  //!< The device the table is loaded for.
+  VWRAP_DEVICE_FUNCTIONS(VWRAP_DECLARE_FUNCTION)
+  VWRAP_DEVICE_EXTENSION_FUNCTIONS(VWRAP_DECLARE_FUNCTION)
+
+  /// Loads all the device functions for a logical device.
+  ///
+  /// \param instanceDispatch The dispatch table of the instance which the
+  ///        device was created from.
+  /// \param device           The device to load the functions for.
+  void load(const InstanceDispatch& instanceDispatch, VkDevice device);
+};
+
+} // namespace loader
+} // namespace vwrap
+
+#endif  // VULKAWRAP_LOADER_DISPATCH_H
@@ -0,0 +1,168 @@
+//---- include/vulkawrap/loader/tracing.h ------------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  tracing.h
+/// \brief Defines the tracing of the Vulkan calls which Vulkawrap makes
+///        through its dispatch tables.
+///
+///        When config::TracingCx is enabled, the functions in the dispatch
+///        tables are TracedEntry wrappers, which count each call and record
+///        its latency in a histogram for the calling thread. When it is
+///        disabled, the table entries are plain function pointers, so the
+///        tracing compiles away entirely.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_LOADER_TRACING_H
+#define VULKAWRAP_LOADER_TRACING_H
+
+#include "vulkawrap/config/config.hpp"
+#include <array>
+#include <chrono>
+#include <type_traits>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vwrap  {
+namespace loader {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The number of buckets in a latency histogram. Bucket i holds the calls
+/// which took less than 2^i nanoseconds (and at least 2^(i - 1)), and the
+/// last bucket also holds every longer call.
+static constexpr size_t TraceBucketCountCx = 32;
+
+//---- Implementations ------------------------------------------------------//
+
+/// The calls which have been made to a Vulkan function.
+struct FunctionTrace {
+  const char* name;     //!< The name of the function.
+  uint64_t    calls;    //!< The number of calls.
+  uint64_t    totalNs;  //!< The time spent in the calls, in nanoseconds.
+  uint64_t    maxNs;    //!< The longest call, in nanoseconds.
+  std::array<uint64_t, TraceBucketCountCx> buckets;  //!< Latency histogram.
+};
+
+/// The calls which have been made to each Vulkan function, by all threads.
+struct TraceSnapshot {
+  std::vector<FunctionTrace> functions;  //!< The functions, by id.
+
+  /// Gets the total time spent in all of the calls, in nanoseconds.
+  uint64_t totalNs() const;
+
+  /// Gets the calls which were made after an earlier snapshot, such as the
+  /// calls made in a frame. The longest calls aren't subtracted, since they
+  /// are not known for the interval.
+  ///
+  /// \param earlier The earlier snapshot.
+  TraceSnapshot since(const TraceSnapshot& earlier) const;
+};
+
+/// Function which is called after each traced call, to emit a span for it.
+/// The times are in nanoseconds, from std::chrono::steady_clock.
+using TraceSpanCallback = void (*)(const char* name   , uint64_t beginNs,
+                                   uint64_t    endNs  , void*    user   );
+
+/// Gets the calls which have been made to each function so far. This is lock
+/// free for the threads which are making calls, so the counts may be a few
+/// calls behind those threads.
+TraceSnapshot traceSnapshot();
+
+/// Sets the function which is called to emit a span for each traced call,
+/// or stops emitting spans if the callback is null. The callback and its
+/// data are published together, so a call which is made while they change
+/// never passes the data to the wrong callback.
+///
+/// \param callback The function to call for each call.
+/// \param user     The data to pass to the callback.
+void setTraceSpanCallback(TraceSpanCallback callback, void* user = nullptr);
+
+namespace detail {
+
+/// Records a call to a function, for the calling thread.
+///
+/// \param function The id of the function.
+/// \param beginNs  When the call began.
+/// \param endNs    When the call returned.
+void recordCall(uint32_t function, uint64_t beginNs, uint64_t endNs);
+
+/// Gets the current time for tracing, in nanoseconds.
+inline uint64_t traceNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace detail
+
+/// Wrapper for a Vulkan function pointer which traces each call through it.
+/// It converts to and from the function pointer, so it can be used in place
+/// of one.
+///
+/// \tparam FunctionPtr The type of the function pointer.
+/// \tparam FunctionId  The id of the function.
+template <typename FunctionPtr, uint32_t FunctionId>
+class TracedEntry;
+
+template <typename Return, typename... Args, uint32_t FunctionId>
+class TracedEntry<Return (VKAPI_PTR *)(Args...), FunctionId> {
+ public:
+  /// The type of the function pointer.
+  using FunctionPtr = Return (VKAPI_PTR *)(Args...);
+
+  /// Constructor which wraps a function pointer.
+  ///
+  /// \param function The function to wrap.
+  TracedEntry(FunctionPtr function = nullptr) : Function(function) {}
+
+  /// Gets the function which is wrapped.
+  operator FunctionPtr() const {
+    return Function;
+  }
+
+  /// Calls the function, and records the call.
+  ///
+  /// \param args The arguments to the function.
+  Return operator()(Args... args) const {
+    CallRecorder recorder;
+    return Function(args...);
+  }
+
+ private:
+  /// Records the call when the function returns, so that void functions are
+  /// handled in the same way.
+  struct CallRecorder {
+    uint64_t beginNs = detail::traceNow();  //!< When the call began.
+
+    /// Destructor which records the call.
+    ~CallRecorder() {
+      detail::recordCall(FunctionId, beginNs, detail::traceNow());
+    }
+  };
+
+  FunctionPtr Function;  //!< The function which is wrapped.
+};
+
+/// The type of the entries in the dispatch tables -- a TracedEntry when
+/// tracing is enabled, and otherwise the function pointer itself.
+///
+/// \tparam FunctionPtr The type of the function pointer.
+/// \tparam FunctionId  The id of the function.
+template <typename FunctionPtr, uint32_t FunctionId>
+using Entry = typename std::conditional<
+  config::TracingCx == config::EnabledCx,
+  TracedEntry<FunctionPtr, FunctionId>, FunctionPtr
+>::type;
+
+} // namespace loader
+} // namespace vwrap
+
+#endif  // VULKAWRAP_LOADER_TRACING_H
@@ -0,0 +1,323 @@
+//---- include/vulkawrap/memory/allocator.h ---------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  allocator.h
+/// \brief Defines the device memory allocator, which sub allocates resources
+///        from large blocks of device memory, rather than making a Vulkan
+///        allocation for every resource.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_MEMORY_ALLOCATOR_H
+#define VULKAWRAP_MEMORY_ALLOCATOR_H
+
+#include "sub_allocators.h"
+#include "vulkawrap/device/device.h"
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The default size of the blocks which are allocated from a memory heap.
+static constexpr VkDeviceSize DefaultMemoryBlockSizeCx = 256ull << 20;
+
+/// The memory type index when no memory type is suitable.
+static constexpr uint32_t InvalidMemoryTypeCx = ~0u;
+
+/// The kind of resource which memory is allocated for. Linear resources
+/// (buffers and linearly tiled images) and optimal resources (optimally
+/// tiled images) which are next to each other in memory must be separated
+/// by the bufferImageGranularity of the device.
+enum class ResourceKind : uint8_t {
+  VW_LINEAR_RESOURCE  = 0x00,
+  VW_OPTIMAL_RESOURCE = 0x01
+};
+
+//---- Forward Declarations -------------------------------------------------//
+
+namespace detail {
+ struct AllocatorBlock;
+} // namespace detail
+
+//---- Implementations ------------------------------------------------------//
+
+/// An allocation of device memory, which is a region of a larger block.
+struct MemoryAllocation {
+  VkDeviceMemory          memory;      //!< The memory of the block.
+  VkDeviceSize            offset;      //!< The offset in the memory.
+  VkDeviceSize            size;        //!< The size of the allocation.
+  void*                   mapped;      //!< The host address of the allocation
+                                       //!< if the memory is host visible,
+                                       //!< otherwise nullptr.
+  uint32_t                memoryType;  //!< The memory type of the block.
+  uint32_t                handle;      //!< The handle of the sub allocation.
+  detail::AllocatorBlock* block;       //!< The block, if it is owned by the
+                                       //!< general allocator.
+
+  /// Default constructor, which creates a failed allocation.
+  MemoryAllocation()
+  : memory(VK_NULL_HANDLE), offset(0), size(0), mapped(nullptr),
+    memoryType(InvalidMemoryTypeCx), handle(InvalidSubAllocationCx),
+    block(nullptr) {}
+
+  /// Returns true if the allocation succeeded.
+  bool valid() const {
+    return memory != VK_NULL_HANDLE;
+  }
+};
+
+namespace detail {
+
+/// A single Vulkan allocation of device memory, which is mapped for its
+/// lifetime if the memory is host visible.
+class DeviceMemoryBlock {
+ public:
+  /// Constructor which allocates the memory.
+  ///
+  /// \param device     The device to allocate the memory from.
+  /// \param memoryType The index of the memory type to allocate.
+  /// \param size       The size of the memory.
+  DeviceMemoryBlock(const Device& device, uint32_t memoryType,
+                    VkDeviceSize  size                       );
+
+  /// Destructor which unmaps and frees the memory.
+  ~DeviceMemoryBlock();
+
+  DeviceMemoryBlock(const DeviceMemoryBlock&)            = delete;
+  DeviceMemoryBlock& operator=(const DeviceMemoryBlock&) = delete;
+
+  /// Returns true if the memory was allocated.
+  bool valid() const {
+    return Memory != VK_NULL_HANDLE;
+  }
+
+  /// Gets the Vulkan memory.
+  VkDeviceMemory getMemory() const {
+    return Memory;
+  }
+
+  /// Gets the host address of an offset in the memory, or nullptr if the
+  /// memory is not host visible.
+  ///
+  /// \param offset The offset in the memory.
+  void* getMapped(VkDeviceSize offset) const {
+    return Mapped ? static_cast<char*>(Mapped) + offset : nullptr;
+  }
+
+  /// Gets the size of the memory.
+  VkDeviceSize getSize() const {
+    return Size;
+  }
+
+ private:
+  const Device&   Owner;   //!< The device the memory is from.
+  VkDeviceMemory  Memory;  //!< The Vulkan memory.
+  VkDeviceSize    Size;    //!< The size of the memory.
+  void*           Mapped;  //!< The host address of the memory, or nullptr.
+};
+
+} // namespace detail
+
+/// The general device memory allocator. Each memory type has its own list of
+/// blocks and its own lock, so threads which allocate different types of
+/// memory never contend. Within a block, resources are sub allocated with a
+/// TLSF allocator, which is constant time, so the lock is only held briefly.
+/// Requests which are larger than half a block get a dedicated block. Hot
+/// paths which can't take a lock should use a LinearMemoryBlock or a
+/// PoolMemoryBlock, which are lock free.
+///
+/// Linear and optimal resources are allocated from separate blocks when the
+/// device has a bufferImageGranularity larger than one, so that they are
+/// never next to each other and no granularity padding is required.
+///
+/// Example usage:
+/// \code
+/// MemoryAllocator allocator(device);
+///
+/// // Create the buffer, then allocate memory for it and bind it.
+/// auto allocation = allocator.allocateForBuffer(buffer,
+///                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+/// ...
+/// allocator.free(allocation);
+/// \endcode
+class MemoryAllocator {
+ public:
+  /// Constructor which creates the allocator for a device.
+  ///
+  /// \param device    The device to allocate memory from, which must outlive
+  ///        the allocator.
+  /// \param blockSize The size of the blocks to allocate. Smaller heaps use
+  ///        an eighth of the heap size, if that is smaller.
+  explicit MemoryAllocator(const Device& device,
+                           VkDeviceSize  blockSize = DefaultMemoryBlockSizeCx);
+
+  /// Destructor which frees all the blocks.
+  ~MemoryAllocator();
+
+  MemoryAllocator(const MemoryAllocator&)            = delete;
+  MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+  /// Allocates memory for a resource. The preferred properties are used if
+  /// there is a memory type which has them, otherwise only the required
+  /// properties are used. Returns a failed allocation if there is no memory.
+  ///
+  /// \param requirements The memory requirements of the resource.
+  /// \param required     The properties which the memory must have.
+  /// \param preferred    The properties which the memory should have.
+  /// \param kind         The kind of the resource.
+  MemoryAllocation allocate(
+    const VkMemoryRequirements& requirements                                ,
+    VkMemoryPropertyFlags       required                                    ,
+    VkMemoryPropertyFlags       preferred = 0                               ,
+    ResourceKind                kind      = ResourceKind::VW_LINEAR_RESOURCE);
+
+  /// Allocates memory for a buffer, and binds it to the buffer.
+  ///
+  /// \param buffer    The buffer to allocate the memory for.
+  /// \param required  The properties which the memory must have.
+  /// \param preferred The properties which the memory should have.
+  MemoryAllocation allocateForBuffer(VkBuffer              buffer       ,
+                                     VkMemoryPropertyFlags required     ,
+                                     VkMemoryPropertyFlags preferred = 0);
+
+  /// Allocates memory for an image, and binds it to the image.
+  ///
+  /// \param image     The image to allocate the memory for.
+  /// \param tiling    The tiling which the image was created with.
+  /// \param required  The properties which the memory must have.
+  /// \param preferred The properties which the memory should have.
+  MemoryAllocation allocateForImage(VkImage               image        ,
+                                    VkImageTiling         tiling       ,
+                                    VkMemoryPropertyFlags required     ,
+                                    VkMemoryPropertyFlags preferred = 0);
+
+  /// Frees an allocation. The block of the allocation is freed if it is
+  /// empty and there is another block for the memory type.
+  ///
+  /// \param allocation The allocation to free.
+  void free(const MemoryAllocation& allocation);
+
+  /// Finds the index of a memory type which is allowed by a mask and which
+  /// has some properties. Returns InvalidMemoryTypeCx if there is none.
+  ///
+  /// \param typeBits   The mask of the allowed memory types.
+  /// \param properties The properties which the type must have.
+  uint32_t findMemoryType(uint32_t              typeBits  ,
+                          VkMemoryPropertyFlags properties) const;
+
+  /// Gets the number of blocks which are allocated for a memory type.
+  ///
+  /// \param memoryType The index of the memory type.
+  size_t getBlockCount(uint32_t memoryType) const;
+
+  /// Gets the device which the memory is allocated from.
+  const Device& getDevice() const {
+    return Owner;
+  }
+
+ private:
+  /// The blocks of a single memory type.
+  struct MemoryTypePool {
+    std::mutex                                           Mutex;
+    std::vector<std::unique_ptr<detail::AllocatorBlock>> Blocks;
+  };
+
+  const Device&                     Owner;        //!< The device.
+  VkDeviceSize                      Granularity;  //!< The buffer image
+                                                  //!< granularity.
+  std::vector<VkDeviceSize>         BlockSizes;   //!< Block size, per type.
+  std::unique_ptr<MemoryTypePool[]> Pools;        //!< Blocks, per type.
+
+  /// Allocates from a specific memory type.
+  ///
+  /// \param requirements The memory requirements of the resource.
+  /// \param memoryType   The memory type to allocate from.
+  /// \param kind         The kind of the resource.
+  MemoryAllocation allocateFromType(const VkMemoryRequirements& requirements,
+                                    uint32_t                    memoryType  ,
+                                    ResourceKind                kind        );
+};
+
+/// A block of device memory which is allocated from linearly, for transient
+/// resources (such as per frame data) which are all released together with
+/// reset. Allocation is lock free. Since linear and optimal resources can be
+/// mixed in the block, every allocation is aligned to the
+/// bufferImageGranularity of the device.
+class LinearMemoryBlock {
+ public:
+  /// Constructor which allocates the block.
+  ///
+  /// \param device     The device to allocate the memory from.
+  /// \param memoryType The memory type of the block.
+  /// \param size       The size of the block.
+  LinearMemoryBlock(const Device& device, uint32_t memoryType,
+                    VkDeviceSize  size                       );
+
+  /// Allocates memory for a resource. Returns a failed allocation if the
+  /// block is full, or the resource cannot use the memory type.
+  ///
+  /// \param requirements The memory requirements of the resource.
+  MemoryAllocation allocate(const VkMemoryRequirements& requirements);
+
+  /// Releases all the allocations. This must not be called while other
+  /// threads are allocating, or while the GPU uses the resources.
+  void reset() {
+    Allocator.reset();
+  }
+
+ private:
+  detail::DeviceMemoryBlock Memory;       //!< The memory of the block.
+  LinearAllocator           Allocator;    //!< Allocates from the memory.
+  uint32_t                  MemoryType;   //!< The memory type.
+  VkDeviceSize              Granularity;  //!< Alignment of allocations.
+};
+
+/// A block of device memory which is divided into slots of a fixed size, for
+/// resources which are created and destroyed often and all have the same
+/// requirements. Allocation and freeing are lock free.
+class PoolMemoryBlock {
+ public:
+  /// Constructor which allocates the block. The slot size is rounded up to
+  /// the bufferImageGranularity of the device.
+  ///
+  /// \param device     The device to allocate the memory from.
+  /// \param memoryType The memory type of the block.
+  /// \param slotSize   The size of each slot, which must be a multiple of the
+  ///        alignment of the resources.
+  /// \param slotCount  The number of slots.
+  PoolMemoryBlock(const Device& device  , uint32_t memoryType,
+                  VkDeviceSize  slotSize, uint32_t slotCount );
+
+  /// Allocates a slot. Returns a failed allocation if all the slots are
+  /// used.
+  MemoryAllocation allocate();
+
+  /// Frees a slot which was allocated from this block.
+  ///
+  /// \param allocation The allocation to free.
+  void free(const MemoryAllocation& allocation) {
+    if (!allocation.valid()) return;
+    Allocator.free(allocation.handle);
+  }
+
+ private:
+  detail::DeviceMemoryBlock Memory;      //!< The memory of the block.
+  PoolAllocator             Allocator;   //!< Allocates from the memory.
+  uint32_t                  MemoryType;  //!< The memory type.
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_MEMORY_ALLOCATOR_H
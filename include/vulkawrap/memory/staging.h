@@ -0,0 +1,224 @@
+//---- include/vulkawrap/memory/staging.h ------------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  staging.h
+/// \brief Defines the staging ring, which uploads data to the device through
+///        a persistently mapped, host visible buffer.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_MEMORY_STAGING_H
+#define VULKAWRAP_MEMORY_STAGING_H
+
+#include "allocator.h"
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The default size of a staging ring.
+static constexpr VkDeviceSize DefaultStagingSizeCx = 64ull << 20;
+
+/// The default alignment of staging ranges, which is enough for any texel
+/// block size.
+static constexpr VkDeviceSize DefaultStagingAlignmentCx = 16;
+
+//---- Implementations ------------------------------------------------------//
+
+/// A range of the staging ring which the caller writes the data to upload
+/// into, before recording a copy from it.
+struct StagingRange {
+  void*         data;    //!< The mapped memory to write to.
+  VkDeviceSize  offset;  //!< The offset of the range in the staging buffer.
+  VkDeviceSize  size;    //!< The size of the range.
+
+  /// Default constructor, which creates a failed range.
+  StagingRange() : data(nullptr), offset(0), size(0) {}
+
+  /// Returns true if the range was reserved.
+  bool valid() const {
+    return data != nullptr;
+  }
+};
+
+/// Uploads data to the device through a single persistently mapped buffer,
+/// which is used as a ring. Callers reserve a range of the ring, write their
+/// data straight into it, and record copies from it, none of which allocate
+/// or touch the driver. A flush then records all the pending copies into one
+/// command buffer and submits it to the transfer queue of the device, and the
+/// ranges are retired once the fence of the submission signals.
+///
+/// A range is retired by the first flush which completes after a copy from it
+/// was recorded, so every copy from a range must be recorded before the next
+/// flush. Ranges which are reserved but not yet copied from are never
+/// retired, so other threads can keep flushing while a range is written.
+///
+/// The destination resources are not transitioned or transferred between
+/// queue families -- images must be in the transfer destination layout when
+/// the copies execute.
+///
+/// Example usage:
+/// \code
+/// StagingRing staging(device, allocator);
+///
+/// auto range = staging.reserve(sizeof(vertices));
+/// std::memcpy(range.data, vertices, sizeof(vertices));
+/// staging.copyToBuffer(range, vertexBuffer, 0);
+///
+/// auto flushId = staging.flush();
+/// ...
+/// staging.wait(flushId);
+/// \endcode
+class StagingRing {
+ public:
+  /// Constructor which creates the staging buffer and its command pool.
+  ///
+  /// \param device    The device to upload to, which must outlive the ring.
+  /// \param allocator The allocator to allocate the staging memory from.
+  /// \param size      The size of the ring.
+  StagingRing(const Device&    device                      ,
+              MemoryAllocator& allocator                   ,
+              VkDeviceSize     size = DefaultStagingSizeCx );
+
+  /// Destructor which waits for the uploads to finish and then destroys the
+  /// staging buffer.
+  ~StagingRing();
+
+  StagingRing(const StagingRing&)            = delete;
+  StagingRing& operator=(const StagingRing&) = delete;
+
+  /// Reserves a range of the ring. If the ring is full, completed uploads are
+  /// retired first, and if it is still full the pending copies are flushed
+  /// and the oldest upload is waited on. Returns a failed range if the size is
+  /// larger than the ring.
+  ///
+  /// \param size      The size of the range.
+  /// \param alignment The alignment of the range, which must be a power of
+  ///        two.
+  StagingRange reserve(VkDeviceSize size                               ,
+                       VkDeviceSize alignment = DefaultStagingAlignmentCx);
+
+  /// Records a copy from a range to a buffer, which is executed by the next
+  /// flush.
+  ///
+  /// \param range     The range to copy from.
+  /// \param buffer    The buffer to copy to.
+  /// \param dstOffset The offset in the buffer to copy to.
+  void copyToBuffer(const StagingRange& range, VkBuffer buffer,
+                    VkDeviceSize        dstOffset                );
+
+  /// Records a copy from a range to an image, which is executed by the next
+  /// flush. The buffer offset of the region is relative to the range.
+  ///
+  /// \param range  The range to copy from.
+  /// \param image  The image to copy to.
+  /// \param region The region of the image to copy.
+  void copyToImage(const StagingRange& range, VkImage image,
+                   VkBufferImageCopy   region                );
+
+  /// Reserves a range, copies data into it, and records a copy to a buffer.
+  /// Returns false if the data is larger than the ring.
+  ///
+  /// \param data      The data to upload.
+  /// \param size      The size of the data.
+  /// \param buffer    The buffer to copy to.
+  /// \param dstOffset The offset in the buffer to copy to.
+  bool upload(const void* data, VkDeviceSize size, VkBuffer buffer,
+              VkDeviceSize dstOffset = 0                           );
+
+  /// Submits all the pending copies in a single command buffer. Returns the
+  /// id of the flush, which can be waited on, or zero if there was nothing
+  /// to flush or the submission failed, in which case the copies are kept
+  /// for the next flush.
+  uint64_t flush();
+
+  /// Retires the ranges of all the flushes which have completed.
+  void retire();
+
+  /// Waits until a flush has completed, and retires it.
+  ///
+  /// \param flushId The id of the flush to wait for.
+  void wait(uint64_t flushId);
+
+  /// Gets the staging buffer.
+  VkBuffer getBuffer() const {
+    return Buffer;
+  }
+
+ private:
+  /// A copy which is recorded by the next flush.
+  struct PendingCopy {
+    VkBuffer          buffer;        //!< The buffer to copy to, for a buffer
+                                     //!< copy.
+    VkImage           image;         //!< The image to copy to, for an image
+                                     //!< copy.
+    VkBufferCopy      bufferRegion;  //!< The region, for a buffer copy.
+    VkBufferImageCopy imageRegion;   //!< The region, for an image copy.
+    VkDeviceSize      rangeOffset;   //!< The offset of the staging range.
+    VkDeviceSize      rangeSize;     //!< The size of the staging range.
+  };
+
+  /// A range which has been reserved, but not yet copied from.
+  struct Reservation {
+    VkDeviceSize offset;    //!< The offset of the range.
+    VkDeviceSize position;  //!< The ring position of the start of the range.
+  };
+
+  /// A submission which is still executing.
+  struct Submission {
+    uint64_t        id;             //!< The id of the flush.
+    VkCommandBuffer commandBuffer;  //!< The recorded copies.
+    VkFence         fence;          //!< Signalled when the copies finish.
+    VkDeviceSize    ringEnd;        //!< Ring position after the copies.
+  };
+
+  const Device&             Owner;          //!< The device.
+  MemoryAllocator&          Allocator;      //!< Allocates the memory.
+  std::mutex                Mutex;          //!< Protects everything below.
+  VkBuffer                  Buffer;         //!< The staging buffer.
+  MemoryAllocation          Memory;         //!< The memory of the buffer.
+  bool                      Coherent;       //!< If writes need no flush.
+  VkDeviceSize              AtomSize;       //!< Non coherent atom size.
+  RingAllocator             Ring;           //!< Allocates the ranges.
+  std::deque<Reservation>   Reserved;       //!< Ranges not yet copied from.
+  VkQueue                   Queue;          //!< The queue to submit to.
+  VkCommandPool             CommandPool;    //!< Pool for the copies.
+  std::vector<PendingCopy>  PendingCopies;  //!< Copies for the next flush.
+  std::deque<Submission>    InFlight;       //!< Executing submissions.
+  std::vector<Submission>   FreeSubmissions;//!< Reusable command buffers
+                                            //!< and fences.
+  uint64_t                  NextFlushId;    //!< The id of the next flush.
+
+  /// Implementation of flush, which expects the mutex to be locked.
+  uint64_t flushLocked();
+
+  /// Implementation of retire, which expects the mutex to be locked.
+  ///
+  /// \param waitForId Waits for the flush with this id, if it is not zero.
+  void retireLocked(uint64_t waitForId);
+
+  /// Records a copy, and marks its range as copied from.
+  ///
+  /// \param copy The copy to record.
+  void addCopy(const PendingCopy& copy);
+
+  /// Flushes the host writes to the ranges of the pending copies, if the
+  /// memory is not coherent.
+  void flushMappedRanges();
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_MEMORY_STAGING_H
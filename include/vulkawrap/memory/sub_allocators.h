@@ -0,0 +1,307 @@
+//---- include/vulkawrap/memory/sub_allocators.h ----------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  sub_allocators.h
+/// \brief Defines the strategies which divide a range of device memory into
+///        allocations. These only deal with offsets into the range, and never
+///        touch Vulkan, so that the device memory allocator can use them for
+///        any block of memory.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_MEMORY_SUB_ALLOCATORS_H
+#define VULKAWRAP_MEMORY_SUB_ALLOCATORS_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vwrap {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The handle of a sub allocation which failed.
+static constexpr uint32_t InvalidSubAllocationCx = ~0u;
+
+/// The number of second level lists for each first level of the TLSF
+/// allocator, as a power of two.
+static constexpr uint32_t TlsfSecondLevelBitsCx = 4;
+
+/// The number of second level lists for each first level.
+static constexpr uint32_t TlsfSecondLevelCountCx = 1u << TlsfSecondLevelBitsCx;
+
+/// The number of first level lists, which covers every 64 bit size.
+static constexpr uint32_t TlsfFirstLevelCountCx =
+  64 - TlsfSecondLevelBitsCx + 1;
+
+//---- Implementations ------------------------------------------------------//
+
+/// Rounds a value up to a multiple of an alignment, which must be a power of
+/// two.
+///
+/// \param value     The value to align.
+/// \param alignment The alignment to round up to.
+inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/// A region of a range which was allocated by a sub allocator.
+struct SubAllocation {
+  VkDeviceSize  offset;  //!< The offset of the region in the range.
+  VkDeviceSize  size;    //!< The size of the region.
+  uint32_t      handle;  //!< Identifies the region to the allocator, to free
+                         //!< it.
+
+  /// Default constructor, which creates a failed allocation.
+  SubAllocation() : offset(0), size(0), handle(InvalidSubAllocationCx) {}
+
+  /// Constructor which sets all the fields of the allocation.
+  ///
+  /// \param regionOffset The offset of the region.
+  /// \param regionSize   The size of the region.
+  /// \param regionHandle The handle of the region.
+  SubAllocation(VkDeviceSize regionOffset, VkDeviceSize regionSize,
+                uint32_t     regionHandle                         )
+  : offset(regionOffset), size(regionSize), handle(regionHandle) {}
+
+  /// Returns true if the allocation succeeded.
+  bool valid() const {
+    return handle != InvalidSubAllocationCx;
+  }
+};
+
+/// Two level segregated fit allocator, for general resources of any size and
+/// alignment. Free regions are kept in lists which are indexed by a two level
+/// bitmap of their sizes, so that finding a region which fits and freeing a
+/// region (which merges it with its free neighbours) are both constant time.
+/// This is not thread safe.
+class TlsfAllocator {
+ public:
+  /// Constructor which creates the allocator for a range.
+  ///
+  /// \param size The size of the range to allocate from.
+  explicit TlsfAllocator(VkDeviceSize size = 0);
+
+  /// Allocates a region from the range. Returns a failed allocation if there
+  /// is no free region which is large enough.
+  ///
+  /// \param size      The size of the region.
+  /// \param alignment The alignment of the offset of the region, which must
+  ///        be a power of two.
+  SubAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+  /// Frees a region which was allocated from this allocator.
+  ///
+  /// \param handle The handle of the region to free.
+  void free(uint32_t handle);
+
+  /// Gets the size of the range.
+  VkDeviceSize size() const {
+    return Size;
+  }
+
+  /// Gets the number of bytes which are allocated.
+  VkDeviceSize usedSize() const {
+    return UsedSize;
+  }
+
+  /// Returns true if nothing is allocated.
+  bool empty() const {
+    return UsedSize == 0;
+  }
+
+ private:
+  /// A region of the range, which is either free or allocated.
+  struct Region {
+    VkDeviceSize  offset;        //!< The offset of the region.
+    VkDeviceSize  size;          //!< The size of the region.
+    uint32_t      prevPhysical;  //!< The region before this in the range.
+    uint32_t      nextPhysical;  //!< The region after this in the range.
+    uint32_t      prevFree;      //!< The previous region in the free list.
+    uint32_t      nextFree;      //!< The next region in the free list.
+    bool          free;          //!< If the region is free.
+  };
+
+  VkDeviceSize          Size;              //!< The size of the range.
+  VkDeviceSize          UsedSize;          //!< The allocated bytes.
+  std::vector<Region>   Regions;           //!< All the regions.
+  std::vector<uint32_t> UnusedRegions;     //!< Regions which can be reused.
+  uint64_t              FirstLevelBitmap;  //!< First levels with free
+                                           //!< regions.
+  uint32_t              SecondLevelBitmaps[TlsfFirstLevelCountCx];
+                                           //!< Second levels with free
+                                           //!< regions, for each first level.
+  uint32_t              FreeLists[TlsfFirstLevelCountCx]
+                                 [TlsfSecondLevelCountCx];
+                                           //!< The first free region in each
+                                           //!< list.
+
+  /// Creates a new region, reusing an unused one if possible.
+  uint32_t makeRegion();
+
+  /// Adds a region to the free list for its size.
+  ///
+  /// \param regionIdx The index of the region.
+  void insertFree(uint32_t regionIdx);
+
+  /// Removes a region from the free list which it is in.
+  ///
+  /// \param regionIdx The index of the region.
+  void removeFree(uint32_t regionIdx);
+
+  /// Finds a free region which is at least a size, or returns
+  /// InvalidSubAllocationCx if there is none.
+  ///
+  /// \param size The size which the region must be.
+  uint32_t findFree(VkDeviceSize size) const;
+
+  /// Searches the free list which a size maps to for a region which fits an
+  /// allocation, or returns InvalidSubAllocationCx if there is none. This is
+  /// only used when findFree fails, since it is linear in the list length.
+  ///
+  /// \param size      The size of the allocation.
+  /// \param alignment The alignment of the allocation.
+  uint32_t findFreeInList(VkDeviceSize size, VkDeviceSize alignment) const;
+};
+
+/// Allocator which allocates by bumping an offset through the range, for
+/// transient resources which are all released at the same time. Allocation
+/// is lock free, and can be called from multiple threads.
+class LinearAllocator {
+ public:
+  /// Constructor which creates the allocator for a range.
+  ///
+  /// \param size The size of the range to allocate from.
+  explicit LinearAllocator(VkDeviceSize size = 0);
+
+  /// Allocates a region from the end of the allocated regions. Returns a
+  /// failed allocation if the range is full.
+  ///
+  /// \param size      The size of the region.
+  /// \param alignment The alignment of the offset of the region, which must
+  ///        be a power of two.
+  SubAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+  /// Releases all the allocations. This must not be called while other
+  /// threads are allocating.
+  void reset() {
+    Head.store(0, std::memory_order_relaxed);
+  }
+
+  /// Gets the size of the range.
+  VkDeviceSize size() const {
+    return Size;
+  }
+
+  /// Gets the number of bytes which are allocated, including padding.
+  VkDeviceSize usedSize() const {
+    return Head.load(std::memory_order_relaxed);
+  }
+
+ private:
+  VkDeviceSize              Size;  //!< The size of the range.
+  std::atomic<VkDeviceSize> Head;  //!< The end of the allocated regions.
+};
+
+/// Allocator which treats the range as a ring, for streaming data which is
+/// released in the order it was allocated. Positions are tracked as an ever
+/// increasing count of bytes, so that a position which is recorded after an
+/// allocation can later be passed to retire to release everything up to it.
+/// This is not thread safe.
+class RingAllocator {
+ public:
+  /// Constructor which creates the allocator for a range.
+  ///
+  /// \param size The size of the range to allocate from.
+  explicit RingAllocator(VkDeviceSize size = 0);
+
+  /// Allocates a contiguous region after the previous allocation, wrapping
+  /// to the start of the range if the region doesn't fit at the end. Returns
+  /// a failed allocation if the unretired regions leave no room.
+  ///
+  /// \param size      The size of the region.
+  /// \param alignment The alignment of the offset of the region, which must
+  ///        be a power of two.
+  SubAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+  /// Releases all the regions which were allocated before a position.
+  ///
+  /// \param position A position which was returned by head.
+  void retire(VkDeviceSize position) {
+    Tail = position;
+  }
+
+  /// Gets the position of the end of the last allocation.
+  VkDeviceSize head() const {
+    return Head;
+  }
+
+  /// Gets the size of the range.
+  VkDeviceSize size() const {
+    return Size;
+  }
+
+  /// Gets the number of bytes which are not retired, including padding.
+  VkDeviceSize usedSize() const {
+    return Head - Tail;
+  }
+
+ private:
+  VkDeviceSize Size;  //!< The size of the range.
+  VkDeviceSize Head;  //!< Position of the end of the last allocation.
+  VkDeviceSize Tail;  //!< Position of the oldest unretired allocation.
+};
+
+/// Allocator which divides the range into slots of a fixed size, for objects
+/// which all have the same requirements. The free slots are kept in a lock
+/// free list, so allocation and freeing can be called from multiple threads.
+class PoolAllocator {
+ public:
+  /// Constructor which creates the slots.
+  ///
+  /// \param slotSize  The size of each slot.
+  /// \param slotCount The number of slots.
+  PoolAllocator(VkDeviceSize slotSize, uint32_t slotCount);
+
+  /// Allocates a slot. Returns a failed allocation if all the slots are used.
+  SubAllocation allocate();
+
+  /// Frees a slot which was allocated from this allocator.
+  ///
+  /// \param handle The handle of the slot to free.
+  void free(uint32_t handle);
+
+  /// Gets the size of each slot.
+  VkDeviceSize slotSize() const {
+    return SlotSize;
+  }
+
+  /// Gets the number of slots.
+  uint32_t slotCount() const {
+    return SlotCount;
+  }
+
+ private:
+  VkDeviceSize                          SlotSize;   //!< The size of a slot.
+  uint32_t                              SlotCount;  //!< Number of slots.
+  std::unique_ptr<std::atomic<uint32_t>[]> Next;    //!< Next free slot, for
+                                                    //!< each free slot.
+  std::atomic<uint64_t>                 Head;       //!< The first free slot,
+                                                    //!< and a tag in the high
+                                                    //!< bits which prevents
+                                                    //!< ABA.
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_MEMORY_SUB_ALLOCATORS_H
@@ -20,9 +20,11 @@
 #define VULKAWRAP_UTIL_ASSERT_HPP
 
 #include "testing.hpp"
+#include "result.hpp"
 #include "vulkawrap/io.h"
 #include "vulkawrap/config/config.hpp"
 #include <vulkan/vulkan.h>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <type_traits>
@@ -37,9 +39,6 @@ using AssertHandlingType = uint8_t;
 
 namespace util  {
 
-void assert(bool, const std::string&, const std::string&, int);
-void assertSuccess(VkResult, const std::string&, const std::string&, int); 
-
 //---- Macros -----------------------------------------------------------------
 
 #define Assert(condition, message)                  \
@@ -50,6 +49,10 @@ void assertSuccess(VkResult, const std::string&, const std::string&, int);
   assertSuccess<vwrap::config::AssertHandlingCx>(   \
     condition, message, __FILE__, __LINE__)
 
+#define CheckResult(result, message)                \
+  checkResult<vwrap::config::AssertHandlingCx>(     \
+    result, message, __FILE__, __LINE__)
+
 //---- Implementations ------------------------------------------------------//
 
 namespace detail {
@@ -70,6 +73,40 @@ struct assert_handling_disabled {
   static constexpr bool value = HandlingType == config::DisabledCx;
 };
 
+/// Reports a failed assertation, and exits if the handling requires it.
+/// This is kept out of line, so that the checks only cost a comparison.
+///
+/// \param message The message to print.
+/// \param file    The file where the assertation is.
+/// \param line    The line in the file where the assertation is.
+/// \param exit    If the program should exit.
+VWRAP_COLD inline void reportFailure(const char* message, const char* file,
+                                     int line, bool exit) {
+  std::cerr << "Failure at         : " << file    << " : " << line << ".\n"
+            << "Additional message : " << message << ".\n\n";
+  if (exit) std::exit(EXIT_FAILURE);
+}
+
+/// Reports a failed Vulkan call, and exits if the handling requires it.
+/// This is kept out of line, so that the checks only cost a comparison.
+///
+/// \param result  The result of the call.
+/// \param message The message to print.
+/// \param file    The file where the call is checked.
+/// \param line    The line in the file where the call is checked.
+/// \param exit    If the program should exit.
+VWRAP_COLD inline void reportResultFailure(VkResult    result ,
+                                           const char* message,
+                                           const char* file   ,
+                                           int         line   ,
+                                           bool        exit   ) {
+  std::cerr << "Failure at         : " << file << " : " << line << ".\n"
+            << "Error code         : ";
+  io::printVulkanResult(result);
+  std::cerr << "Additional message : " << message << "\n";
+  if (exit) std::exit(EXIT_FAILURE);
+}
+
 } // namespace detail
 
 /// Function which asserts a condition, and takes an optinal message to 
@@ -86,13 +123,10 @@ template <AssertHandlingType AssertHandling = config::AssertHandlingCx>
 typename std::enable_if<
   detail::assert_handling_enabled<AssertHandling>::value, void
 >::type
-inline assert(bool condition, const std::string& message = "",
-    const std::string file = "", int line = 0) {
-  if (!condition) {
-    std::cerr << "Failure at         : " << file    << " : " << line << ".\n" 
-              << "Additional message : " << message << ".\n\n";
-    exit(EXIT_FAILURE);
-  }
+inline assert(bool condition, const char* message = "",
+    const char* file = "", int line = 0) {
+  if (VWRAP_UNLIKELY(!condition))
+    detail::reportFailure(message, file, line, true);
 }
 
 /// Function which asserts a condition, and takes an optional message to
@@ -111,8 +145,8 @@ template <AssertHandlingType AssertHandling = config::AssertHandlingCx>
 typename std::enable_if<
   detail::assert_handling_disabled<AssertHandling>::value, void
 >::type
-inline assert(bool condition, const std::string& message = "", 
-    const std::string& file = "", int line = 0) {
+inline assert(bool condition, const char* message = "", 
+    const char* file = "", int line = 0) {
   // Does nothing so that when this instance of the assert is called, the
   // compiler can optimize it out ...
 }
@@ -133,13 +167,11 @@ template <AssertHandlingType AssertHandling = config::AssertHandlingCx>
 typename std::enable_if<
   test::testing_enabled<AssertHandling>::value, void
 >::type
-inline assert(bool condition, const std::string& message = "", 
-    const std::string& file = "", int line = 0) {
+inline assert(bool condition, const char* message = "", 
+    const char* file = "", int line = 0) {
   // Just writes a message, but doesn't assert.
-  if (!condition) {
-    std::cerr << "Failure at         : " << file    << " : " << line << ".\n" 
-              << "Additional message : " << message << ".\n\n";
-  }
+  if (VWRAP_UNLIKELY(!condition))
+    detail::reportFailure(message, file, line, false);
 }
 
 /// Function which asserts that the result of a vulkan operation was a success,
@@ -157,15 +189,10 @@ template <AssertHandlingType AssertHandling = config::AssertHandlingCx>
 typename std::enable_if<
   detail::assert_handling_enabled<AssertHandling>::value, void
 >::type 
-inline assertSuccess(VkResult result, const std::string& message = "",
-    const std::string& file = "", int line = 0) {
-  if (result != 0) {
-    std::cerr << "Failure at         : " << file << " : " << line << ".\n"
-              << "Error code         : ";
-    io::printVulkanResult(result);
-    std::cerr << "Additional message : " << message << "\n";
-    exit(EXIT_FAILURE);
-  }
+inline assertSuccess(VkResult result, const char* message = "",
+    const char* file = "", int line = 0) {
+  if (VWRAP_UNLIKELY(result != VK_SUCCESS))
+    detail::reportResultFailure(result, message, file, line, true);
 }
 
 /// Function which asserts that the result of a vulkan operation was a success,
@@ -183,8 +210,8 @@ template <AssertHandlingType AssertHandling = config::AssertHandlingCx>
 typename std::enable_if<
   detail::assert_handling_disabled<AssertHandling>::value, void
 >::type
-inline assertSuccess(VkResult result, const std::string& message = "",
-    const std::string file = "", int line = 0) {
+inline assertSuccess(VkResult result, const char* message = "",
+    const char* file = "", int line = 0) {
   // Does nothing so that when this instance of the assert is called, the
   // compiler can optimize it out ...
 }
@@ -205,21 +232,35 @@ template <AssertHandlingType AssertHandling = config::AssertHandlingCx>
 typename std::enable_if<
   test::testing_enabled<AssertHandling>::value, void
 >::type
-inline assertSuccess(VkResult result, const std::string& message = "",
-    const std::string file = "", int line = 0) {
-  // Does nothing so that when this instance of the assert is called, the
-  // compiler can optimize it out ...
-   // Just writes a message, but doesn't assert.
-  if (result != 0) {
-    std::cerr << "Failure at         : " << file << " : " << line << ".\n"
-              << "Error code         : ";
-    io::printVulkanResult(result);
-    std::cerr << "Additional message : " << message << "\n";
-  } 
+inline assertSuccess(VkResult result, const char* message = "",
+    const char* file = "", int line = 0) {
+  // Just writes a message, but doesn't assert.
+  if (VWRAP_UNLIKELY(result != VK_SUCCESS))
+    detail::reportResultFailure(result, message, file, line, false);
+}
+
+/// Function which checks the result of a vulkan operation, and returns it
+/// for the caller to handle, rather than exiting, if it is an error which
+/// can be recovered from. Other errors are handled as by assertSuccess.
+///
+/// \param  result         The result to check.
+/// \param  message        The message to print if the result is an error
+///         which can't be recovered from.
+/// \param  file           The file where the result is checked.
+/// \param  line           The line in the file where the result is checked.
+/// \tparam AssertHandling The type of assert handling which is supported.
+template <AssertHandlingType AssertHandling = config::AssertHandlingCx>
+inline Result<void> checkResult(VkResult result, const char* message = "",
+    const char* file = "", int line = 0) {
+  if (VWRAP_UNLIKELY(result < VK_SUCCESS && !isRecoverable(result)) &&
+      !detail::assert_handling_disabled<AssertHandling>::value) {
+    detail::reportResultFailure(result, message, file, line,
+      detail::assert_handling_enabled<AssertHandling>::value);
+  }
+  return result;
 }
 
 } // namespace util
 } // namespace vwrap 
 
 #endif  // VULKAWRAP_UTIL_ASSERT_HPP
-
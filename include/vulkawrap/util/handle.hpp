@@ -0,0 +1,275 @@
+//---- include/vulkawrap/util/handle.hpp ------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  handle.hpp
+/// \brief Defines unique and shared ownership of Vulkan handles, which are
+///        parameterised on the deleter which destroys the handle, and for
+///        shared handles, the reference counting policy.
+///
+///        The deleter is a function object which is called with the handle,
+///        and which stores whatever the destroy call needs (for example the
+///        dispatch table of the parent device). Deleters are stored as a
+///        base class, so that a deleter without state adds nothing to the
+///        size of a handle.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_UTIL_HANDLE_HPP
+#define VULKAWRAP_UTIL_HANDLE_HPP
+
+#include "reference_counter.hpp"
+#include <cstdint>
+#include <utility>
+
+namespace vwrap {
+
+/// A handle which is uniquely owned, and which is destroyed with the deleter
+/// when the owner is destroyed. This is movable but not copyable.
+///
+/// \tparam VkT     The type of the Vulkan handle.
+/// \tparam Deleter The type of the function object which destroys the handle.
+template <typename VkT, typename Deleter>
+class UniqueHandle : private Deleter {
+ public:
+  /// Default constructor, which does not own a handle.
+  UniqueHandle() noexcept : Deleter(), Handle{} {}
+
+  /// Constructor which takes ownership of a handle.
+  ///
+  /// \param handle  The handle to own.
+  /// \param deleter The deleter to destroy the handle with.
+  explicit UniqueHandle(VkT handle, Deleter deleter = Deleter()) noexcept
+  :   Deleter(std::move(deleter)), Handle(handle) {}
+
+  /// Move constructor, which takes the handle of the other unique handle.
+  ///
+  /// \param other The other unique handle to move from.
+  UniqueHandle(UniqueHandle&& other) noexcept
+  :   Deleter(std::move(other.mutableDeleter())), Handle(other.release()) {}
+
+  /// Destructor, which destroys the handle if one is owned.
+  ~UniqueHandle() {
+    reset();
+  }
+
+  UniqueHandle(const UniqueHandle&)            = delete;
+  UniqueHandle& operator=(const UniqueHandle&) = delete;
+
+  /// Move assignment, which destroys the owned handle and takes the handle of
+  /// the other unique handle.
+  ///
+  /// \param other The other unique handle to move from.
+  UniqueHandle& operator=(UniqueHandle&& other) noexcept {
+    if (this != &other) {
+      reset(other.release());
+      mutableDeleter() = std::move(other.mutableDeleter());
+    }
+    return *this;
+  }
+
+  /// Gets the raw Vulkan handle, without releasing ownership.
+  VkT get() const {
+    return Handle;
+  }
+
+  /// Returns true if a handle is owned.
+  explicit operator bool() const {
+    return Handle != VkT{};
+  }
+
+  /// Gets the deleter of the handle.
+  const Deleter& getDeleter() const {
+    return *this;
+  }
+
+  /// Releases ownership of the handle, and returns it, without destroying it.
+  VkT release() {
+    VkT handle = Handle;
+    Handle     = VkT{};
+    return handle;
+  }
+
+  /// Destroys the owned handle, and takes ownership of a new one.
+  ///
+  /// \param handle The new handle to own.
+  void reset(VkT handle = VkT{}) {
+    VkT oldHandle = Handle;
+    Handle        = handle;
+    if (oldHandle != VkT{})
+      mutableDeleter()(oldHandle);
+  }
+
+ private:
+  VkT Handle;  //!< The owned handle.
+
+  /// Gets the deleter of the handle, for destroying or moving it.
+  Deleter& mutableDeleter() {
+    return *this;
+  }
+};
+
+namespace detail {
+
+/// The control block of a shared handle, which stores the reference count,
+/// the deleter and the handle together in a single allocation.
+///
+/// \tparam VkT        The type of the Vulkan handle.
+/// \tparam Deleter    The type of the deleter of the handle.
+/// \tparam RefCounter The type of the reference counter.
+template <typename VkT, typename Deleter, typename RefCounter>
+struct SharedHandleBlock : private Deleter {
+  RefCounter  counter;  //!< The number of shared handles referencing this.
+  VkT         handle;   //!< The handle being shared.
+
+  /// Constructor which creates the block with a single reference.
+  ///
+  /// \param vkHandle The handle to share.
+  /// \param deleter  The deleter to destroy the handle with.
+  SharedHandleBlock(VkT vkHandle, Deleter&& deleter)
+  :   Deleter(std::move(deleter)), handle(vkHandle) {
+    counter.initialize();
+  }
+
+  /// Destructor, which destroys the handle.
+  ~SharedHandleBlock() {
+    static_cast<Deleter&>(*this)(handle);
+  }
+};
+
+} // namespace detail
+
+/// A handle which is shared, and which is destroyed with the deleter when the
+/// last shared handle which references it is destroyed. The raw handle is
+/// stored in each shared handle as well as in the control block, so that
+/// accessing it never touches the control block.
+///
+/// \tparam VkT        The type of the Vulkan handle.
+/// \tparam Deleter    The type of the function object which destroys the
+///         handle.
+/// \tparam RefCounter The reference counting policy.
+template <typename VkT, typename Deleter, typename RefCounter>
+class SharedHandle {
+ public:
+  /// Default constructor, which does not reference a handle.
+  SharedHandle() noexcept : Handle{}, Block(nullptr) {}
+
+  /// Constructor which takes shared ownership of a handle.
+  ///
+  /// \param handle  The handle to share.
+  /// \param deleter The deleter to destroy the handle with.
+  explicit SharedHandle(VkT handle, Deleter deleter = Deleter())
+  :   Handle(handle), Block(nullptr) {
+    if (Handle != VkT{})
+      Block = new Block_t(handle, std::move(deleter));
+  }
+
+  /// Constructor which takes shared ownership of a uniquely owned handle.
+  ///
+  /// \param unique The unique handle to take ownership from.
+  explicit SharedHandle(UniqueHandle<VkT, Deleter>&& unique)
+  :   SharedHandle(unique.get(), unique.getDeleter()) {
+    unique.release();
+  }
+
+  /// Copy constructor, which references the handle of the other shared
+  /// handle.
+  ///
+  /// \param other The other shared handle to copy.
+  SharedHandle(const SharedHandle& other) noexcept
+  :   Handle(other.Handle), Block(other.Block) {
+    if (Block) Block->counter.increment();
+  }
+
+  /// Move constructor, which takes the reference of the other shared handle
+  /// without changing the reference count.
+  ///
+  /// \param other The other shared handle to move from.
+  SharedHandle(SharedHandle&& other) noexcept
+  :   Handle(other.Handle), Block(other.Block) {
+    other.Handle = VkT{};
+    other.Block  = nullptr;
+  }
+
+  /// Destructor, which destroys the handle if this is the last reference.
+  ~SharedHandle() {
+    release();
+  }
+
+  /// Copy assignment, which releases the current handle and references the
+  /// handle of the other shared handle.
+  ///
+  /// \param other The other shared handle to copy.
+  SharedHandle& operator=(const SharedHandle& other) noexcept {
+    if (Block != other.Block) {
+      if (other.Block) other.Block->counter.increment();
+      release();
+      Handle = other.Handle;
+      Block  = other.Block;
+    }
+    return *this;
+  }
+
+  /// Move assignment, which releases the current handle and takes the
+  /// reference of the other shared handle without changing its count.
+  ///
+  /// \param other The other shared handle to move from.
+  SharedHandle& operator=(SharedHandle&& other) noexcept {
+    if (this != &other) {
+      release();
+      Handle       = other.Handle;
+      Block        = other.Block;
+      other.Handle = VkT{};
+      other.Block  = nullptr;
+    }
+    return *this;
+  }
+
+  /// Gets the raw Vulkan handle.
+  VkT get() const {
+    return Handle;
+  }
+
+  /// Returns true if a handle is referenced.
+  explicit operator bool() const {
+    return Block != nullptr;
+  }
+
+  /// Gets the number of shared handles which reference the handle.
+  uint32_t useCount() const {
+    return Block ? Block->counter.count() : 0;
+  }
+
+  /// Releases the reference to the handle, destroying it if this was the
+  /// last reference.
+  void reset() {
+    release();
+  }
+
+ private:
+  /// Alias for the type of the control block.
+  using Block_t = detail::SharedHandleBlock<VkT, Deleter, RefCounter>;
+
+  VkT       Handle;  //!< The raw handle, for access without indirection.
+  Block_t*  Block;   //!< The control block of the handle.
+
+  /// Releases the reference to the handle, destroying the handle if this was
+  /// the last reference.
+  void release() {
+    if (Block && Block->counter.decrement())
+      delete Block;
+    Handle = VkT{};
+    Block  = nullptr;
+  }
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_UTIL_HANDLE_HPP
@@ -0,0 +1,88 @@
+//---- include/vulkawrap/util/hash.hpp --------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  hash.hpp
+/// \brief Defines the hash functions and signatures which Vulkawrap uses for
+///        cache keys and file checksums.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_UTIL_HASH_HPP
+#define VULKAWRAP_UTIL_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace vwrap {
+namespace util  {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The initial value of a 64 bit FNV-1a hash.
+static constexpr uint64_t FnvOffsetBasisCx = 14695981039346656037ull;
+
+/// The prime which a 64 bit FNV-1a hash is multiplied by for each byte.
+static constexpr uint64_t FnvPrimeCx       = 1099511628211ull;
+
+//---- Implementations ------------------------------------------------------//
+
+/// Computes the 64 bit FNV-1a hash of some data. The hash of data which is
+/// split into parts can be computed by passing the hash of the previous
+/// parts as the seed.
+///
+/// \param data The data to hash.
+/// \param size The number of bytes to hash.
+/// \param seed The hash to continue from.
+inline uint64_t fnv1a(const void* data, size_t size,
+                      uint64_t seed = FnvOffsetBasisCx) {
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  uint64_t    hash  = seed;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= FnvPrimeCx;
+  }
+  return hash;
+}
+
+/// The words which identify a cached object, such as the description of a
+/// render pass or the descriptors of a set. Handles are included by value,
+/// so two signatures are equal only if they describe the same object.
+using Signature = std::vector<uint64_t>;
+
+/// Hashes a signature.
+struct SignatureHash {
+  /// Gets the FNV-1a hash of the words of a signature.
+  ///
+  /// \param signature The signature to hash.
+  size_t operator()(const Signature& signature) const {
+    return static_cast<size_t>(
+      fnv1a(signature.data(), signature.size() * sizeof(uint64_t)));
+  }
+};
+
+/// Gets the bits of a handle or a value as a signature word.
+///
+/// \param value The value to convert.
+/// \tparam T    The type of the value.
+template <typename T>
+uint64_t toWord(T value) {
+  static_assert(sizeof(T) <= sizeof(uint64_t), "Value too large for a word");
+  uint64_t word = 0;
+  std::memcpy(&word, &value, sizeof(T));
+  return word;
+}
+
+} // namespace util
+} // namespace vwrap
+
+#endif  // VULKAWRAP_UTIL_HASH_HPP
@@ -0,0 +1,159 @@
+//---- include/vulkawrap/util/job_system.h ----------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  job_system.h
+/// \brief Defines a work stealing job system, which runs parallel loops on a
+///        fixed set of worker threads.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_UTIL_JOB_SYSTEM_H
+#define VULKAWRAP_UTIL_JOB_SYSTEM_H
+
+#include "work_stealing_deque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vwrap {
+namespace util  {
+
+/// Runs parallel loops across a fixed set of threads. Each thread has its own
+/// work stealing deque. A loop starts as a single task for the whole range in
+/// the deque of the calling thread, and whichever thread runs a task splits
+/// it in half, pushing the upper half for other threads to steal, until the
+/// task is a single index. Idle threads steal from the other deques, so the
+/// work spreads out without a shared queue which all threads contend on.
+///
+/// The thread which calls parallelFor takes part in the loop, and only one
+/// loop runs at a time, so parallelFor must not be called from inside a
+/// loop.
+///
+/// Example usage:
+/// \code
+/// JobSystem jobs;
+///
+/// jobs.parallelFor(chunkCount, [&] (size_t chunkIdx) {
+///   process(chunks[chunkIdx]);
+/// });
+/// \endcode
+class JobSystem {
+ public:
+  /// Constructor which starts the worker threads.
+  ///
+  /// \param threadCount The number of threads which run loops, including the
+  ///        thread which calls parallelFor.
+  explicit JobSystem(uint32_t threadCount = defaultThreadCount());
+
+  /// Destructor which stops and joins the worker threads.
+  ~JobSystem();
+
+  JobSystem(const JobSystem&)            = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  /// Calls a function for every index in [0, count), across all the threads,
+  /// and returns once all of the calls have returned. The order of the calls
+  /// is not defined.
+  ///
+  /// \param count    The number of indices.
+  /// \param function The function to call with each index.
+  /// \tparam Function The type of the function.
+  template <typename Function>
+  void parallelFor(size_t count, Function&& function) {
+    run(count, &invokeRange<std::remove_reference_t<Function>>,
+        static_cast<void*>(&function));
+  }
+
+  /// Gets the number of threads which run loops, including the caller.
+  uint32_t getThreadCount() const {
+    return static_cast<uint32_t>(Deques.size());
+  }
+
+  /// Gets the number of hardware threads, or one if it isn't known.
+  static uint32_t defaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+ private:
+  /// A range of the indices of the current loop.
+  struct Task {
+    size_t begin;  //!< The first index.
+    size_t end;    //!< One past the last index.
+  };
+
+  /// Calls a function for a range of indices.
+  using RangeFunction = void (*)(void* function, size_t begin, size_t end);
+
+  using DequeVec = std::vector<std::unique_ptr<WorkStealingDeque<Task>>>;
+
+  DequeVec                 Deques;         //!< The deque of each thread, the
+                                           //!< first of which is the caller's.
+  std::vector<std::thread> Workers;        //!< The worker threads.
+  std::vector<Task>        Tasks;          //!< Storage for the tasks of the
+                                           //!< current loop.
+  std::atomic<size_t>      NextTask;       //!< The next unused task.
+  std::atomic<size_t>      Remaining;      //!< Indices which haven't run.
+  RangeFunction            Function;       //!< Runs the current loop.
+  void*                    Context;        //!< The function of the loop.
+  std::mutex               RunMutex;       //!< Allows one loop at a time.
+  std::mutex               Mutex;          //!< Protects the state below.
+  std::condition_variable  WorkAvailable;  //!< Wakes the workers for a loop.
+  uint64_t                 Generation;     //!< The number of loops started.
+  bool                     Stopping;       //!< If the workers should exit.
+
+  /// Calls a function of a specific type for a range of indices.
+  ///
+  /// \param function The function.
+  /// \param begin    The first index.
+  /// \param end      One past the last index.
+  /// \tparam FunctionType The type of the function.
+  template <typename FunctionType>
+  static void invokeRange(void* function, size_t begin, size_t end) {
+    auto& typedFunction = *static_cast<FunctionType*>(function);
+    for (size_t index = begin; index < end; ++index) typedFunction(index);
+  }
+
+  /// Runs a loop, and returns once it has completed.
+  ///
+  /// \param count    The number of indices.
+  /// \param function Calls the function for a range of indices.
+  /// \param context  The function to call.
+  void run(size_t count, RangeFunction function, void* context);
+
+  /// The loop which each worker thread runs.
+  ///
+  /// \param threadIdx The index of the worker's deque.
+  void workerLoop(uint32_t threadIdx);
+
+  /// Runs a task from the thread's own deque, or one stolen from another
+  /// thread. Returns false if there was no task to run.
+  ///
+  /// \param threadIdx The index of the calling thread's deque.
+  bool runTask(uint32_t threadIdx);
+
+  /// Splits a task until it is a single index, pushing the upper halves onto
+  /// the thread's deque, and then runs it.
+  ///
+  /// \param threadIdx The index of the calling thread's deque.
+  /// \param task      The task to run.
+  void execute(uint32_t threadIdx, Task task);
+};
+
+} // namespace util
+} // namespace vwrap
+
+#endif  // VULKAWRAP_UTIL_JOB_SYSTEM_H
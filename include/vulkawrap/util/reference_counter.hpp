@@ -0,0 +1,120 @@
+//---- include/vulkawrap/util/reference_counter.hpp -------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  reference_counter.hpp
+/// \brief Defines the reference counting policies which are used by the
+///        shared instance and shared handle classes.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_UTIL_REFERENCE_COUNTER_HPP
+#define VULKAWRAP_UTIL_REFERENCE_COUNTER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace vwrap {
+
+/// Reference counting class. This implementation is thread safe and can
+/// be used concurrently, but incurrs the overhead that the cuncurrent 
+/// incrementation and decrementation brings.
+///
+/// Increments are relaxed, since a new reference can only be made from an
+/// existing one, which already keeps the object alive. The decrement is
+/// acquire-release, so that all uses of the object by other references
+/// happen before the last reference destroys it.
+class ConcurrentReferenceCounter {
+ public:
+  /// If the counter can be shared between threads.
+  static constexpr bool IsConcurrentCx = true;
+
+  /// Initializes the count.
+  void initialize() {
+    Count.store(1, std::memory_order_relaxed);
+  }
+
+  /// Increments the reference count.
+  void increment() { 
+    Count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Increments the reference count only if there is still a reference, for
+  /// when the object is found through something other than a reference,
+  /// such as a registry. Returns true if the count was incremented.
+  bool tryIncrement() {
+    auto count = Count.load(std::memory_order_relaxed);
+    while (count != 0) {
+      if (Count.compare_exchange_weak(count, count + 1,
+                                      std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  }
+
+  /// Decrements the reference count, and returns true if this was the last
+  /// reference.
+  bool decrement() {
+    return Count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  /// Gets the reference count.
+  uint32_t count() const {
+    return Count.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint32_t> Count;  //!< The number of references.
+};
+
+/// Reference counting class. This implementation is not thread safe, and is
+/// provided for the case that thread safety is not required and the additional
+/// performance gained by removing the thread-safe functionality is justified.
+class NonConcurrentReferenceCounter {
+ public:
+  /// If the counter can be shared between threads.
+  static constexpr bool IsConcurrentCx = false;
+
+  /// Initializes the count.
+  void initialize() {
+    Count = 1;
+  }
+
+  /// Increments the reference count.
+  void increment() { 
+    ++Count;
+  }
+
+  /// Increments the reference count only if there is still a reference.
+  /// Returns true if the count was incremented.
+  bool tryIncrement() {
+    if (Count == 0) return false;
+    ++Count;
+    return true;
+  }
+
+  /// Decrements the reference count, and returns true if this was the last
+  /// reference.
+  bool decrement() {
+    return --Count == 0;
+  }
+
+  /// Gets the reference count.
+  uint32_t count() const {
+    return Count;
+  }
+
+ private:
+  uint32_t Count;  //!< The number of references.
+};
+
+} // namespace vwrap
+
+#endif  // VULKAWRAP_UTIL_REFERENCE_COUNTER_HPP
@@ -0,0 +1,204 @@
+//---- include/vulkawrap/util/result.hpp ------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  result.hpp
+/// \brief Defines the names of Vulkan results, and a Result type which holds
+///        either a value or the VkResult of the call which failed to make
+///        it, so that recoverable errors can be returned to the caller.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_UTIL_RESULT_HPP
+#define VULKAWRAP_UTIL_RESULT_HPP
+
+#include <vulkan/vulkan.h>
+#include <utility>
+
+//---- Macros -----------------------------------------------------------------
+
+#if defined(__GNUC__) || defined(__clang__)
+  /// Marks a function as rarely called, so that it is kept out of line and
+  /// away from the code which calls it.
+  #define VWRAP_COLD __attribute__((cold, noinline))
+
+  /// Hints that a condition is almost always false.
+  #define VWRAP_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#elif defined(_MSC_VER)
+  #define VWRAP_COLD                __declspec(noinline)
+  #define VWRAP_UNLIKELY(condition) (condition)
+#else
+  #define VWRAP_COLD
+  #define VWRAP_UNLIKELY(condition) (condition)
+#endif
+
+namespace vwrap {
+namespace util  {
+
+//---- Implementations ------------------------------------------------------//
+
+/// Gets the name of a VkResult, or "UNKNOWN_ERROR" if it is not known.
+///
+/// \param result The result to get the name of.
+constexpr const char* resultName(VkResult result) {
+  switch (result) {
+    case VK_SUCCESS                       : return "VK_SUCCESS";
+    case VK_NOT_READY                     : return "VK_NOT_READY";
+    case VK_TIMEOUT                       : return "VK_TIMEOUT";
+    case VK_EVENT_SET                     : return "VK_EVENT_SET";
+    case VK_EVENT_RESET                   : return "VK_EVENT_RESET";
+    case VK_INCOMPLETE                    : return "VK_INCOMPLETE";
+    case VK_ERROR_OUT_OF_HOST_MEMORY      :
+      return "VK_ERROR_OUT_OF_HOST_MEMORY";
+    case VK_ERROR_OUT_OF_DEVICE_MEMORY    :
+      return "VK_ERROR_OUT_OF_DEVICE_MEMORY";
+    case VK_ERROR_INITIALIZATION_FAILED   :
+      return "VK_ERROR_INITIALIZATION_FAILED";
+    case VK_ERROR_DEVICE_LOST             : return "VK_ERROR_DEVICE_LOST";
+    case VK_ERROR_MEMORY_MAP_FAILED       : return "VK_ERROR_MEMORY_MAP_FAILED";
+    case VK_ERROR_LAYER_NOT_PRESENT       : return "VK_ERROR_LAYER_NOT_PRESENT";
+    case VK_ERROR_EXTENSION_NOT_PRESENT   :
+      return "VK_ERROR_EXTENSION_NOT_PRESENT";
+    case VK_ERROR_FEATURE_NOT_PRESENT     :
+      return "VK_ERROR_FEATURE_NOT_PRESENT";
+    case VK_ERROR_INCOMPATIBLE_DRIVER     :
+      return "VK_ERROR_INCOMPATIBLE_DRIVER";
+    case VK_ERROR_TOO_MANY_OBJECTS        : return "VK_ERROR_TOO_MANY_OBJECTS";
+    case VK_ERROR_FORMAT_NOT_SUPPORTED    :
+      return "VK_ERROR_FORMAT_NOT_SUPPORTED";
+    case VK_ERROR_FRAGMENTED_POOL         : return "VK_ERROR_FRAGMENTED_POOL";
+    case VK_ERROR_SURFACE_LOST_KHR        : return "VK_ERROR_SURFACE_LOST_KHR";
+    case VK_ERROR_NATIVE_WINDOW_IN_USE_KHR:
+      return "VK_ERROR_NATIVE_WINDOW_IN_USE_KHR";
+    case VK_SUBOPTIMAL_KHR                : return "VK_SUBOPTIMAL_KHR";
+    case VK_ERROR_OUT_OF_DATE_KHR         : return "VK_ERROR_OUT_OF_DATE_KHR";
+    case VK_ERROR_INCOMPATIBLE_DISPLAY_KHR:
+      return "VK_ERROR_INCOMPATIBLE_DISPLAY_KHR";
+    case VK_ERROR_VALIDATION_FAILED_EXT   :
+      return "VK_ERROR_VALIDATION_FAILED_EXT";
+    case VK_ERROR_OUT_OF_POOL_MEMORY_KHR  :
+      return "VK_ERROR_OUT_OF_POOL_MEMORY_KHR";
+    default                               : return "UNKNOWN_ERROR";
+  }
+}
+
+/// Returns true if a result is an error which the caller can recover from,
+/// such as a swapchain which is out of date and has to be recreated, or a
+/// descriptor pool which is full, rather than one which leaves the device
+/// unusable.
+///
+/// \param result The result to check.
+constexpr bool isRecoverable(VkResult result) {
+  return result == VK_ERROR_OUT_OF_DATE_KHR        ||
+         result == VK_ERROR_SURFACE_LOST_KHR       ||
+         result == VK_ERROR_FRAGMENTED_POOL        ||
+         result == VK_ERROR_OUT_OF_POOL_MEMORY_KHR;
+}
+
+/// Holds either a value, or the VkResult of the call which failed to make
+/// it. Non-negative results, such as VK_SUBOPTIMAL_KHR, still hold a value.
+///
+/// Example usage:
+/// \code
+/// Result<uint32_t> acquire(...) {
+///   uint32_t imageIndex;
+///   const auto result = vkAcquireNextImageKHR(..., &imageIndex);
+///   if (result < 0) return result;
+///   return Result<uint32_t>(imageIndex, result);
+/// }
+///
+/// const auto image = acquire(...);
+/// if (image.result() == VK_ERROR_OUT_OF_DATE_KHR) recreateSwapchain();
+/// \endcode
+///
+/// \tparam T The type of the value, which must be default constructible.
+template <typename T>
+class Result {
+ public:
+  /// Constructor for a value which was made successfully.
+  ///
+  /// \param value The value.
+  Result(T value) : Value(std::move(value)), Code(VK_SUCCESS) {}
+
+  /// Constructor for a value which was made with a status.
+  ///
+  /// \param value The value.
+  /// \param code  The status of the call which made it.
+  Result(T value, VkResult code) : Value(std::move(value)), Code(code) {}
+
+  /// Constructor for an error.
+  ///
+  /// \param code The error.
+  Result(VkResult code) : Value(), Code(code) {}
+
+  /// Returns true if there is a value.
+  bool hasValue() const {
+    return Code >= VK_SUCCESS;
+  }
+
+  /// Returns true if there is a value.
+  explicit operator bool() const {
+    return hasValue();
+  }
+
+  /// Gets the result of the call.
+  VkResult result() const {
+    return Code;
+  }
+
+  /// Gets the value, which is default constructed if there is an error.
+  const T& value() const {
+    return Value;
+  }
+
+  /// Gets the value, or a fallback if there is an error.
+  ///
+  /// \param fallback The value to use if there is an error.
+  T valueOr(T fallback) const {
+    return hasValue() ? Value : fallback;
+  }
+
+ private:
+  T        Value;  //!< The value, if there is one.
+  VkResult Code;   //!< The result of the call.
+};
+
+/// Specialization for calls which only return a VkResult.
+template <>
+class Result<void> {
+ public:
+  /// Constructor from the result of a call.
+  ///
+  /// \param code The result of the call.
+  Result(VkResult code = VK_SUCCESS) : Code(code) {}
+
+  /// Returns true if the call succeeded.
+  bool hasValue() const {
+    return Code >= VK_SUCCESS;
+  }
+
+  /// Returns true if the call succeeded.
+  explicit operator bool() const {
+    return hasValue();
+  }
+
+  /// Gets the result of the call.
+  VkResult result() const {
+    return Code;
+  }
+
+ private:
+  VkResult Code;  //!< The result of the call.
+};
+
+} // namespace util
+} // namespace vwrap
+
+#endif  // VULKAWRAP_UTIL_RESULT_HPP
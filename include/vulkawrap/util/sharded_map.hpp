@@ -0,0 +1,125 @@
+//---- include/vulkawrap/util/sharded_map.hpp -------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  sharded_map.hpp
+/// \brief Defines a concurrent hash map, which is split into shards which
+///        each have their own lock.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_UTIL_SHARDED_MAP_HPP
+#define VULKAWRAP_UTIL_SHARDED_MAP_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+namespace vwrap {
+namespace util  {
+
+//---- Constants ------------------------------------------------------------//
+
+/// The default number of shards of a sharded map.
+static constexpr size_t DefaultShardCountCx = 16;
+
+/// The size of a cache line, which the shards of a sharded map are kept
+/// apart by.
+static constexpr size_t ShardPaddingCx = 64;
+
+//---- Implementations ------------------------------------------------------//
+
+/// Concurrent hash map, which is split into a fixed number of shards by the
+/// hash of the key, each of which is a map with its own lock. Threads which
+/// use keys in different shards never contend, so the map scales with the
+/// number of threads as long as there are more shards than threads.
+///
+/// Values are created by getOrCreate with the shard's lock held, so that a
+/// value is only created once, even when several threads ask for it at the
+/// same time. Values are never removed, which is what interning needs.
+///
+/// \tparam Key        The type of the keys.
+/// \tparam Value      The type of the values.
+/// \tparam Hash       The type of the hash function for the keys.
+/// \tparam ShardCount The number of shards.
+template <typename Key                               ,
+          typename Value                             ,
+          typename Hash       = std::hash<Key>       ,
+          size_t   ShardCount = DefaultShardCountCx  >
+class ShardedMap {
+ public:
+  static_assert(ShardCount > 0, "A sharded map needs at least one shard");
+
+  /// Gets the value for a key, creating it if the key is not in the map. If
+  /// the create function returns a value which equals the invalid value, it
+  /// is returned but not inserted, so that it is created again next time.
+  ///
+  /// \param key            The key to get the value of.
+  /// \param createFunction The function which creates the value.
+  /// \param invalid        The value which means creation failed.
+  /// \tparam CreateFunction The type of the create function.
+  template <typename CreateFunction>
+  Value getOrCreate(const Key&       key           ,
+                    CreateFunction&& createFunction,
+                    const Value&     invalid = Value()) {
+    const auto hash  = Hasher(key);
+    auto&      shard = Shards[hash % ShardCount];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto found = shard.map.find(key);
+    if (found != shard.map.end()) return found->second;
+
+    Value value = createFunction();
+    if (!(value == invalid)) shard.map.emplace(key, value);
+    return value;
+  }
+
+  /// Calls a function for every key and value in the map. This must not be
+  /// called while other threads are using the map.
+  ///
+  /// \param function The function, which takes the key and the value.
+  /// \tparam Function The type of the function.
+  template <typename Function>
+  void forEach(Function&& function) const {
+    for (const auto& shard : Shards) {
+      for (const auto& entry : shard.map) function(entry.first, entry.second);
+    }
+  }
+
+  /// Gets the number of values in the map.
+  size_t size() const {
+    size_t count = 0;
+    for (auto& shard : Shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      count += shard.map.size();
+    }
+    return count;
+  }
+
+ private:
+  /// A single shard of the map. Shards are padded by a cache line, so that
+  /// the lock and map of one shard never share a line with the next shard,
+  /// wherever the map is allocated. Aligning the shards instead would need
+  /// an over-aligned allocation, which operator new doesn't provide before
+  /// C++17.
+  struct Shard {
+    mutable std::mutex                   mutex;  //!< Protects the map.
+    std::unordered_map<Key, Value, Hash> map;    //!< The values.
+    char padding[ShardPaddingCx];                //!< Separates the shards.
+  };
+
+  Hash  Hasher;              //!< Hashes the keys.
+  Shard Shards[ShardCount];  //!< The shards.
+};
+
+} // namespace util
+} // namespace vwrap
+
+#endif  // VULKAWRAP_UTIL_SHARDED_MAP_HPP
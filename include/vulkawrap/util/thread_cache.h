@@ -0,0 +1,134 @@
+//---- include/vulkawrap/util/thread_cache.h --------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  thread_cache.h
+/// \brief Defines a cache of a value for each thread which uses an object,
+///        which the thread finds without taking a lock.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_UTIL_THREAD_CACHE_H
+#define VULKAWRAP_UTIL_THREAD_CACHE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vwrap {
+namespace util  {
+namespace detail {
+
+struct ThreadCacheEntries;
+
+/// Maps the calling thread to its value for a single thread cache. Each
+/// thread keeps a list of the values it has for every index which it has
+/// used, which it searches without a lock. When an index is destroyed it
+/// clears its entry from the list of every thread which used it, and a
+/// thread removes the cleared entries the next time it adds one, so the
+/// lists only hold the indices which are alive.
+class ThreadCacheIndex {
+ public:
+  /// Default constructor, which creates an index with no entries.
+  ThreadCacheIndex() = default;
+
+  /// Destructor which clears the entries of every thread for the index.
+  ~ThreadCacheIndex();
+
+  ThreadCacheIndex(const ThreadCacheIndex&)            = delete;
+  ThreadCacheIndex& operator=(const ThreadCacheIndex&) = delete;
+
+  /// Gets the value of the calling thread, or nullptr if it has none.
+  void* find() const;
+
+  /// Sets the value of the calling thread, which must not have one.
+  ///
+  /// \param value The value of the thread.
+  void insert(void* value);
+
+ private:
+  friend struct ThreadCacheEntries;
+
+  std::vector<ThreadCacheEntries*> Threads;  //!< The threads with entries,
+                                             //!< guarded by the registry lock.
+};
+
+} // namespace detail
+
+/// A value of type T for each thread which uses an object. The value of the
+/// calling thread is found without a lock, so an object which keeps per
+/// thread state, such as a pool of command buffers, can be used from many
+/// threads without contention. The values are owned by the cache, and are
+/// destroyed with it, when the entries of the threads for the cache are
+/// removed as well.
+///
+/// The cache must not be destroyed while other threads are using it.
+///
+/// Example usage:
+/// \code
+/// util::ThreadCache<std::vector<VkFence>> fences;
+///
+/// // Each thread gets its own list, which it can use without a lock.
+/// auto& threadFences = fences.get([] (std::vector<VkFence>&) {});
+/// \endcode
+///
+/// \tparam T The type of the value of each thread.
+template <typename T>
+class ThreadCache {
+ public:
+  /// Default constructor, which creates a cache with no values.
+  ThreadCache() = default;
+
+  ThreadCache(const ThreadCache&)            = delete;
+  ThreadCache& operator=(const ThreadCache&) = delete;
+
+  /// Gets the value of the calling thread, creating it the first time the
+  /// thread uses the cache.
+  ///
+  /// \param initialize The function which initializes a new value.
+  /// \tparam Initialize The type of the function.
+  template <typename Initialize>
+  T& get(Initialize&& initialize) {
+    if (auto* value = static_cast<T*>(Index.find())) return *value;
+
+    auto  owned = std::make_unique<T>();
+    auto& value = *owned;
+    initialize(value);
+    {
+      std::lock_guard<std::mutex> lock(Mutex);
+      Values.push_back(std::move(owned));
+    }
+    Index.insert(&value);
+    return value;
+  }
+
+  /// Calls a function with the value of every thread. The function must not
+  /// use the cache.
+  ///
+  /// \param function The function to call.
+  /// \tparam Function The type of the function.
+  template <typename Function>
+  void forEach(Function&& function) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (const auto& value : Values) function(*value);
+  }
+
+ private:
+  std::mutex                      Mutex;   //!< Protects the values.
+  std::vector<std::unique_ptr<T>> Values;  //!< The value of each thread.
+  detail::ThreadCacheIndex        Index;   //!< Finds the value of a thread,
+                                           //!< destroyed before the values.
+};
+
+} // namespace util
+} // namespace vwrap
+
+#endif  // VULKAWRAP_UTIL_THREAD_CACHE_H
@@ -0,0 +1,128 @@
+//---- include/vulkawrap/util/work_stealing_deque.hpp ------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  work_stealing_deque.hpp
+/// \brief Defines a fixed capacity, lock free work stealing deque.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_UTIL_WORK_STEALING_DEQUE_HPP
+#define VULKAWRAP_UTIL_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace vwrap {
+namespace util {
+
+/// Chase-Lev work stealing deque of pointers. The thread which owns the deque
+/// pushes and pops at the bottom, like a stack, so it works on the items it
+/// pushed most recently, which are the most likely to be in its cache. Any
+/// other thread can steal from the top, which takes the oldest items, which
+/// are the largest when work is split recursively.
+///
+/// The capacity is fixed, so that the owner never allocates -- push returns
+/// false when the deque is full, and the owner should run the item itself.
+///
+/// \tparam T The type which the items point to.
+template <typename T>
+class WorkStealingDeque {
+ public:
+  /// Constructor which allocates the storage for the items.
+  ///
+  /// \param capacity The maximum number of items, which is rounded up to a
+  ///        power of two.
+  explicit WorkStealingDeque(size_t capacity = 1024) : Top(0), Bottom(0) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    Mask  = size - 1;
+    Items.reset(new std::atomic<T*>[size]);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&)            = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  /// Pushes an item onto the bottom of the deque. Returns false if the deque
+  /// is full. This must only be called by the owner.
+  ///
+  /// \param item The item to push.
+  bool push(T* item) {
+    const auto bottom = Bottom.load(std::memory_order_relaxed);
+    const auto top    = Top.load(std::memory_order_acquire);
+    if (bottom - top > static_cast<int64_t>(Mask)) return false;
+
+    Items[bottom & Mask].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// Pops the item from the bottom of the deque. Returns nullptr if the deque
+  /// is empty. This must only be called by the owner.
+  T* pop() {
+    const auto bottom = Bottom.load(std::memory_order_relaxed) - 1;
+    Bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = Top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      Bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    auto item = Items[bottom & Mask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // This is the last item, so a thief may be taking it at the same time.
+      if (!Top.compare_exchange_strong(top, top + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      Bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  /// Steals the item from the top of the deque. Returns nullptr if the deque
+  /// is empty, or if another thread took the item first. This can be called
+  /// from any thread.
+  T* steal() {
+    auto top = Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto bottom = Bottom.load(std::memory_order_acquire);
+    if (top >= bottom) return nullptr;
+
+    auto item = Items[top & Mask].load(std::memory_order_relaxed);
+    if (!Top.compare_exchange_strong(top, top + 1,
+          std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  /// Returns true if the deque looks empty. This is only a hint when other
+  /// threads are using the deque.
+  bool empty() const {
+    return Bottom.load(std::memory_order_relaxed) <=
+           Top.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t>                Top;     //!< Where items are stolen.
+  std::atomic<int64_t>                Bottom;  //!< Where the owner pushes.
+  size_t                              Mask;    //!< Capacity minus one.
+  std::unique_ptr<std::atomic<T*>[]>  Items;   //!< The ring of items.
+};
+
+} // namespace util
+} // namespace vwrap
+
+#endif  // VULKAWRAP_UTIL_WORK_STEALING_DEQUE_HPP
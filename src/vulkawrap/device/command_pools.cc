@@ -0,0 +1,176 @@
+//---- src/vulkawrap/device/command_pools.cc --------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  command_pools.cc
+/// \brief Implementation of the command pool manager.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/command_pools.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+
+namespace vwrap {
+namespace {
+
+/// Gets the number of queue families of a physical device, from its snapshot
+/// if it has one, otherwise from the families it tracks for its queues.
+///
+/// \param physicalDevice The physical device.
+uint32_t getFamilyCount(const PhysicalDevice& physicalDevice) {
+  if (physicalDevice.capabilities) {
+    return static_cast<uint32_t>(
+      physicalDevice.capabilities->queueFamilies.size());
+  }
+  uint32_t familyCount = 0;
+  while (familyCount < QueueFamilyMaskBitsCx &&
+         (physicalDevice.queueFamilies >> familyCount))
+    ++familyCount;
+  return familyCount;
+}
+
+/// A command pool for a queue family and frame slot, and the command buffers
+/// which have been allocated from it, for each level.
+struct FramePool {
+  VkCommandPool                 pool;        //!< The pool.
+  std::vector<VkCommandBuffer>  buffers[2];  //!< Primary and secondary
+                                             //!< buffers.
+  uint32_t                      used[2];     //!< The number of buffers of
+                                             //!< each level in use.
+
+  /// Default constructor, which creates an empty slot.
+  FramePool() : pool(VK_NULL_HANDLE), used{0, 0} {}
+};
+
+} // annonymous namespace
+
+struct CommandPoolManager::ThreadPools {
+  std::vector<FramePool> pools;  //!< The pool for each frame slot and queue
+                                 //!< family, indexed by slot, then family.
+};
+
+//---- Public ---------------------------------------------------------------//
+
+CommandPoolManager::CommandPoolManager(const Device& device        ,
+                                       uint32_t      framesInFlight)
+:   Owner(device), FrameCount(std::max(framesInFlight, 1u)),
+    FamilyCount(getFamilyCount(device.getPhysicalDevice())),
+    FrameIdx(0), FrameFences(FrameCount, VK_NULL_HANDLE) {
+  // The device may have allocated a family which the physical device doesn't
+  // track for its queue types.
+  for (const auto& allocation : device.getQueueAllocations())
+    FamilyCount = std::max(FamilyCount, allocation.familyIndex + 1);
+
+  // The first call to beginFrame moves to the first slot.
+  FrameIdx.store(FrameCount - 1, std::memory_order_relaxed);
+}
+
+CommandPoolManager::~CommandPoolManager() {
+  const auto& dispatch = Owner.getDispatch();
+  const auto  vkDevice = Owner.getVkDevice();
+
+  // Destroying a pool frees all of its command buffers.
+  Threads.forEach([&] (const ThreadPools& thread) {
+    for (const auto& framePool : thread.pools) {
+      if (framePool.pool != VK_NULL_HANDLE)
+        dispatch.vkDestroyCommandPool(vkDevice, framePool.pool, nullptr);
+    }
+  });
+}
+
+VkCommandBuffer CommandPoolManager::allocate(uint32_t             familyIndex,
+                                             VkCommandBufferLevel level      ) {
+  if (familyIndex >= FamilyCount) {
+    util::Assert(false, "Command buffer requested for an invalid family.\n");
+    return VK_NULL_HANDLE;
+  }
+
+  const auto  frameIdx  = FrameIdx.load(std::memory_order_acquire);
+  auto&       framePool =
+    getThreadPools().pools[frameIdx * FamilyCount + familyIndex];
+  const auto& dispatch  = Owner.getDispatch();
+  const auto  vkDevice  = Owner.getVkDevice();
+
+  if (framePool.pool == VK_NULL_HANDLE) {
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = familyIndex;
+    const auto result = dispatch.vkCreateCommandPool(vkDevice, &poolInfo,
+                          nullptr, &framePool.pool);
+    util::AssertSuccess(result, "Failed to create command pool.\n");
+    if (result != VK_SUCCESS) return VK_NULL_HANDLE;
+  }
+
+  const auto levelIdx = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? 0 : 1;
+  auto&      buffers  = framePool.buffers[levelIdx];
+  auto&      used     = framePool.used[levelIdx];
+  if (used == buffers.size()) {
+    VkCommandBufferAllocateInfo allocateInfo = {};
+    allocateInfo.sType              =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool        = framePool.pool;
+    allocateInfo.level              = level;
+    allocateInfo.commandBufferCount = CommandBufferBatchSizeCx;
+
+    buffers.resize(used + CommandBufferBatchSizeCx);
+    const auto result = dispatch.vkAllocateCommandBuffers(vkDevice,
+                          &allocateInfo, buffers.data() + used);
+    util::AssertSuccess(result, "Failed to allocate command buffers.\n");
+    if (result != VK_SUCCESS) {
+      buffers.resize(used);
+      return VK_NULL_HANDLE;
+    }
+  }
+  return buffers[used++];
+}
+
+uint32_t CommandPoolManager::beginFrame() {
+  const auto& dispatch = Owner.getDispatch();
+  const auto  vkDevice = Owner.getVkDevice();
+  const auto  frameIdx =
+    (FrameIdx.load(std::memory_order_relaxed) + 1) % FrameCount;
+
+  auto& fence = FrameFences[frameIdx];
+  if (fence != VK_NULL_HANDLE) {
+    dispatch.vkWaitForFences(vkDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+    fence = VK_NULL_HANDLE;
+  }
+
+  // Resetting a pool keeps its memory, so the next frame reuses it.
+  Threads.forEach([&] (ThreadPools& thread) {
+    for (uint32_t familyIdx = 0; familyIdx < FamilyCount; ++familyIdx) {
+      auto& framePool = thread.pools[frameIdx * FamilyCount + familyIdx];
+      if (framePool.used[0] == 0 && framePool.used[1] == 0) continue;
+
+      dispatch.vkResetCommandPool(vkDevice, framePool.pool, 0);
+      framePool.used[0] = 0;
+      framePool.used[1] = 0;
+    }
+  });
+
+  FrameIdx.store(frameIdx, std::memory_order_release);
+  return frameIdx;
+}
+
+void CommandPoolManager::endFrame(VkFence fence) {
+  FrameFences[FrameIdx.load(std::memory_order_relaxed)] = fence;
+}
+
+//---- Private --------------------------------------------------------------//
+
+CommandPoolManager::ThreadPools& CommandPoolManager::getThreadPools() {
+  return Threads.get([this] (ThreadPools& thread) {
+    thread.pools.resize(FrameCount * FamilyCount);
+  });
+}
+
+} // namespace vwrap
@@ -0,0 +1,353 @@
+//---- src/vulkawrap/device/descriptors.cc ----------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  descriptors.cc
+/// \brief Implementation of the descriptor allocator.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/descriptors.h"
+#include "vulkawrap/device/object_interner.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+
+namespace vwrap {
+namespace {
+
+/// Gets the sizes of a pool which holds DescriptorSetsPerPoolCx sets with a
+/// list of bindings.
+///
+/// \param bindings The bindings of the sets.
+std::vector<VkDescriptorPoolSize> getPoolSizes(
+    const LayoutBindingVec& bindings) {
+  std::vector<VkDescriptorPoolSize> poolSizes;
+  for (const auto& binding : bindings) {
+    if (binding.descriptorCount == 0) continue;
+    auto poolSize = std::find_if(poolSizes.begin(), poolSizes.end(),
+      [&binding] (const VkDescriptorPoolSize& size) {
+        return size.type == binding.descriptorType;
+      });
+    if (poolSize == poolSizes.end()) {
+      poolSizes.push_back(VkDescriptorPoolSize{ binding.descriptorType, 0 });
+      poolSize = poolSizes.end() - 1;
+    }
+    poolSize->descriptorCount +=
+      binding.descriptorCount * DescriptorSetsPerPoolCx;
+  }
+
+  // A pool needs at least one size, even for a layout with no descriptors.
+  if (poolSizes.empty())
+    poolSizes.push_back(VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 });
+  return poolSizes;
+}
+
+} // annonymous namespace
+
+//---- Signatures -----------------------------------------------------------//
+
+namespace detail {
+
+void appendSignature(const LayoutBindingVec& bindings ,
+                     DescriptorSignature&    signature) {
+  signature.push_back(bindings.size());
+  for (const auto& binding : bindings) {
+    signature.push_back(binding.binding);
+    signature.push_back(binding.descriptorType);
+    signature.push_back(binding.descriptorCount);
+    signature.push_back(binding.stageFlags);
+    signature.push_back(binding.pImmutableSamplers != nullptr);
+    if (binding.pImmutableSamplers == nullptr) continue;
+
+    const auto* samplers = binding.pImmutableSamplers;
+    for (uint32_t samplerIdx = 0; samplerIdx < binding.descriptorCount;
+         ++samplerIdx)
+      signature.push_back(util::toWord(samplers[samplerIdx]));
+  }
+}
+
+void appendSignature(uint32_t                  layoutIndex,
+                     const DescriptorWriteVec& writes     ,
+                     DescriptorSignature&      signature  ) {
+  signature.push_back(layoutIndex);
+  signature.push_back(writes.size());
+  for (const auto& write : writes) {
+    signature.push_back(write.binding);
+    signature.push_back(write.arrayElement);
+    signature.push_back(write.type);
+    signature.push_back(util::toWord(write.bufferInfo.buffer));
+    signature.push_back(write.bufferInfo.offset);
+    signature.push_back(write.bufferInfo.range);
+    signature.push_back(util::toWord(write.imageInfo.sampler));
+    signature.push_back(util::toWord(write.imageInfo.imageView));
+    signature.push_back(write.imageInfo.imageLayout);
+    signature.push_back(util::toWord(write.texelView));
+  }
+}
+
+} // namespace detail
+
+//---- Allocator ------------------------------------------------------------//
+
+struct DescriptorAllocator::LayoutPools {
+  std::vector<VkDescriptorPool> pools;    //!< The pools, in the order they
+                                          //!< are allocated from.
+  uint32_t                      current;  //!< The pool being allocated from.
+  uint32_t                      used;     //!< The sets allocated from it.
+
+  /// Default constructor, which creates an empty list.
+  LayoutPools() : current(0), used(0) {}
+};
+
+struct DescriptorAllocator::ThreadDescriptors {
+  std::vector<std::vector<LayoutPools>> frames;      //!< The pools of each
+                                                     //!< frame slot, indexed
+                                                     //!< by layout.
+  uint64_t                              cacheEpoch;  //!< The epoch of the
+                                                     //!< known sets.
+  SetMap                                knownSets;   //!< The cached sets the
+                                                     //!< thread has used.
+  detail::DescriptorSignature           signature;   //!< Signature scratch.
+  std::vector<VkWriteDescriptorSet>     writes;      //!< Write scratch.
+};
+
+//---- Public ---------------------------------------------------------------//
+
+DescriptorAllocator::DescriptorAllocator(ObjectInterner& interner      ,
+                                         uint32_t        framesInFlight)
+:   Interner(interner), Dispatch(interner.getDispatch()),
+    FrameCount(std::max(framesInFlight, 1u)), FrameIdx(0), CacheEpoch(0),
+    FrameFences(FrameCount, VK_NULL_HANDLE) {
+  // The first call to beginFrame moves to the first slot.
+  FrameIdx.store(FrameCount - 1, std::memory_order_relaxed);
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+  const auto destroyPools = [this] (const LayoutPools& pools) {
+    for (const auto pool : pools.pools)
+      Dispatch.vkDestroyDescriptorPool(Dispatch.device, pool, nullptr);
+  };
+
+  // Destroying a pool frees all of its sets.
+  Threads.forEach([&] (const ThreadDescriptors& thread) {
+    for (const auto& frame : thread.frames) {
+      for (const auto& pools : frame) destroyPools(pools);
+    }
+  });
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  for (const auto& pools : CachedPools) {
+    if (pools) destroyPools(*pools);
+  }
+}
+
+const DescriptorLayout*
+DescriptorAllocator::getLayout(const LayoutBindingVec& bindings) {
+  // Interned layouts have one handle for each distinct list of bindings, so
+  // the handle identifies the layout.
+  const auto vkLayout = Interner.getSetLayout(bindings);
+  if (vkLayout == VK_NULL_HANDLE) return nullptr;
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  auto& layout = Layouts[vkLayout];
+  if (!layout) {
+    layout            = std::make_unique<DescriptorLayout>();
+    layout->layout    = vkLayout;
+    layout->index     = static_cast<uint32_t>(Layouts.size() - 1);
+    layout->poolSizes = getPoolSizes(bindings);
+  }
+  return layout.get();
+}
+
+VkDescriptorSet
+DescriptorAllocator::allocate(const DescriptorLayout&   layout,
+                              const DescriptorWriteVec& writes) {
+  auto& thread = getThreadDescriptors();
+  auto& frame  = thread.frames[FrameIdx.load(std::memory_order_acquire)];
+  if (frame.size() <= layout.index) frame.resize(layout.index + 1);
+
+  const auto set = allocateFrom(frame[layout.index], layout);
+  if (set != VK_NULL_HANDLE && !writes.empty())
+    write(set, writes, thread.writes);
+  return set;
+}
+
+VkDescriptorSet
+DescriptorAllocator::getCachedSet(const DescriptorLayout&   layout,
+                                  const DescriptorWriteVec& writes) {
+  auto&      thread = getThreadDescriptors();
+  const auto epoch  = CacheEpoch.load(std::memory_order_acquire);
+  if (thread.cacheEpoch != epoch) {
+    thread.knownSets.clear();
+    thread.cacheEpoch = epoch;
+  }
+
+  thread.signature.clear();
+  detail::appendSignature(layout.index, writes, thread.signature);
+  const auto known = thread.knownSets.find(thread.signature);
+  if (known != thread.knownSets.end()) return known->second;
+
+  // The thread hasn't used the set yet, so look for it in the shared cache,
+  // which another thread may have added it to.
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto cached = CachedSets.find(thread.signature);
+    if (cached != CachedSets.end()) {
+      set = cached->second;
+    } else {
+      if (CachedPools.size() <= layout.index)
+        CachedPools.resize(layout.index + 1);
+      auto& pools = CachedPools[layout.index];
+      if (!pools) pools = std::make_unique<LayoutPools>();
+
+      set = allocateFrom(*pools, layout);
+      if (set == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+      write(set, writes, thread.writes);
+      CachedSets.emplace(thread.signature, set);
+    }
+  }
+  thread.knownSets.emplace(thread.signature, set);
+  return set;
+}
+
+void DescriptorAllocator::clearCachedSets() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  for (const auto& pools : CachedPools) {
+    if (pools) reset(*pools);
+  }
+  CachedSets.clear();
+  CacheEpoch.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t DescriptorAllocator::beginFrame() {
+  const auto frameIdx =
+    (FrameIdx.load(std::memory_order_relaxed) + 1) % FrameCount;
+
+  auto& fence = FrameFences[frameIdx];
+  if (fence != VK_NULL_HANDLE) {
+    Dispatch.vkWaitForFences(Dispatch.device, 1, &fence, VK_TRUE, UINT64_MAX);
+    fence = VK_NULL_HANDLE;
+  }
+
+  Threads.forEach([&] (ThreadDescriptors& thread) {
+    for (auto& pools : thread.frames[frameIdx]) reset(pools);
+  });
+
+  FrameIdx.store(frameIdx, std::memory_order_release);
+  return frameIdx;
+}
+
+void DescriptorAllocator::endFrame(VkFence fence) {
+  FrameFences[FrameIdx.load(std::memory_order_relaxed)] = fence;
+}
+
+size_t DescriptorAllocator::getCachedSetCount() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  return CachedSets.size();
+}
+
+//---- Private --------------------------------------------------------------//
+
+DescriptorAllocator::ThreadDescriptors&
+DescriptorAllocator::getThreadDescriptors() {
+  return Threads.get([this] (ThreadDescriptors& thread) {
+    thread.frames.resize(FrameCount);
+    thread.cacheEpoch = CacheEpoch.load(std::memory_order_acquire);
+  });
+}
+
+VkDescriptorSet
+DescriptorAllocator::allocateFrom(LayoutPools&            pools ,
+                                  const DescriptorLayout& layout) {
+  if (pools.used == DescriptorSetsPerPoolCx) {
+    ++pools.current;
+    pools.used = 0;
+  }
+
+  if (pools.current >= pools.pools.size()) {
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets       = DescriptorSetsPerPoolCx;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(layout.poolSizes.size());
+    poolInfo.pPoolSizes    = layout.poolSizes.data();
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    const auto result = Dispatch.vkCreateDescriptorPool(Dispatch.device,
+                          &poolInfo, nullptr, &pool);
+    util::AssertSuccess(result, "Failed to create descriptor pool.\n");
+    if (result != VK_SUCCESS) return VK_NULL_HANDLE;
+    pools.pools.push_back(pool);
+    pools.current = static_cast<uint32_t>(pools.pools.size() - 1);
+  }
+
+  VkDescriptorSetAllocateInfo allocateInfo = {};
+  allocateInfo.sType              =
+    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocateInfo.descriptorPool     = pools.pools[pools.current];
+  allocateInfo.descriptorSetCount = 1;
+  allocateInfo.pSetLayouts        = &layout.layout;
+
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  const auto result = Dispatch.vkAllocateDescriptorSets(Dispatch.device,
+                        &allocateInfo, &set);
+  util::AssertSuccess(result, "Failed to allocate descriptor set.\n");
+  if (result != VK_SUCCESS) return VK_NULL_HANDLE;
+  ++pools.used;
+  return set;
+}
+
+void DescriptorAllocator::write(VkDescriptorSet                    set    ,
+                                const DescriptorWriteVec&          writes ,
+                                std::vector<VkWriteDescriptorSet>& scratch) {
+  scratch.resize(writes.size());
+  for (size_t writeIdx = 0; writeIdx < writes.size(); ++writeIdx) {
+    const auto& write = writes[writeIdx];
+    auto&       info  = scratch[writeIdx];
+    info                 = {};
+    info.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    info.dstSet          = set;
+    info.dstBinding      = write.binding;
+    info.dstArrayElement = write.arrayElement;
+    info.descriptorCount = 1;
+    info.descriptorType  = write.type;
+
+    switch (write.type) {
+      case VK_DESCRIPTOR_TYPE_SAMPLER:
+      case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+      case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+      case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+      case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        info.pImageInfo = &write.imageInfo;
+        break;
+      case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        info.pTexelBufferView = &write.texelView;
+        break;
+      default:
+        info.pBufferInfo = &write.bufferInfo;
+    }
+  }
+
+  // All of the descriptors of the set are written with a single call.
+  Dispatch.vkUpdateDescriptorSets(Dispatch.device,
+    static_cast<uint32_t>(scratch.size()), scratch.data(), 0, nullptr);
+}
+
+void DescriptorAllocator::reset(LayoutPools& pools) {
+  const auto usedCount = std::min<size_t>(
+    pools.used == 0 ? pools.current : pools.current + 1, pools.pools.size());
+  for (size_t poolIdx = 0; poolIdx < usedCount; ++poolIdx)
+    Dispatch.vkResetDescriptorPool(Dispatch.device, pools.pools[poolIdx], 0);
+  pools.current = 0;
+  pools.used    = 0;
+}
+
+} // namespace vwrap
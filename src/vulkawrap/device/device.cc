@@ -0,0 +1,170 @@
+//---- src/vulkawrap/device/device.cc ---------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  device.cc
+/// \brief Implementation of the logical device wrapper for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/device.h"
+#include "vulkawrap/util/assert.hpp"
+
+namespace vwrap {
+namespace {
+
+/// Gets the queue families of a physical device, from its snapshot if it has
+/// one, otherwise from the driver.
+///
+/// \param dispatch       The dispatch of the instance of the device.
+/// \param physicalDevice The physical device.
+QueueFamilyPropVec getQueueFamilies(
+    const loader::InstanceDispatch& dispatch      ,
+    const PhysicalDevice&           physicalDevice) {
+  if (physicalDevice.capabilities)
+    return physicalDevice.capabilities->queueFamilies;
+
+  uint32_t queueCount = 0;
+  dispatch.vkGetPhysicalDeviceQueueFamilyProperties(
+    physicalDevice.device, &queueCount, nullptr);
+  QueueFamilyPropVec queueFamilies(queueCount);
+  dispatch.vkGetPhysicalDeviceQueueFamilyProperties(
+    physicalDevice.device, &queueCount, queueFamilies.data());
+  return queueFamilies;
+}
+
+/// Gets the properties and memory properties of a physical device, from its
+/// snapshot if it has one, otherwise from the driver.
+///
+/// \param dispatch         The dispatch of the instance of the device.
+/// \param physicalDevice   The physical device.
+/// \param properties       The properties to fill.
+/// \param memoryProperties The memory properties to fill.
+void getDeviceProperties(
+    const loader::InstanceDispatch&   dispatch        ,
+    const PhysicalDevice&             physicalDevice  ,
+    VkPhysicalDeviceProperties&       properties      ,
+    VkPhysicalDeviceMemoryProperties& memoryProperties) {
+  if (physicalDevice.capabilities) {
+    properties       = physicalDevice.capabilities->properties;
+    memoryProperties = physicalDevice.capabilities->memoryProperties;
+    return;
+  }
+  dispatch.vkGetPhysicalDeviceProperties(physicalDevice.device,
+    &properties);
+  dispatch.vkGetPhysicalDeviceMemoryProperties(physicalDevice.device,
+    &memoryProperties);
+}
+
+} // annonymous namespace
+
+//---- Public ---------------------------------------------------------------//
+
+Device::Device(
+    const detail::Instance&         instance      ,
+    const PhysicalDevice&           physicalDevice,
+    const QueueRequestVec&          queueRequests ,
+    const std::vector<const char*>& extensions    ,
+    const VkPhysicalDeviceFeatures* features      ,
+    const void*                     next          )
+:   Device(instance.dispatch, physicalDevice, queueRequests, extensions,
+           features, next) {}
+
+Device::Device(
+    const loader::InstanceDispatch& dispatch      ,
+    const PhysicalDevice&           physicalDevice,
+    const QueueRequestVec&          queueRequests ,
+    const std::vector<const char*>& extensions    ,
+    const VkPhysicalDeviceFeatures* features      ,
+    const void*                     next          )
+:   VulkanDevice(VK_NULL_HANDLE), Physical(physicalDevice), Properties{},
+    MemoryProperties{} {
+  getDeviceProperties(dispatch, physicalDevice, Properties, MemoryProperties);
+  QueueFamilies = getQueueFamilies(dispatch, physicalDevice);
+  Allocations   = allocateQueues(QueueFamilies, queueRequests);
+
+  // Gather the priorities of the queues in each family, indexed by the queue
+  // index, since the queues of a family are created with a single info.
+  std::vector<std::vector<float>> familyPriorities(QueueFamilies.size());
+  for (const auto& allocation : Allocations) {
+    if (allocation.familyIndex == VK_QUEUE_FAMILY_IGNORED || allocation.shared)
+      continue;
+    auto& priorities = familyPriorities[allocation.familyIndex];
+    if (priorities.size() <= allocation.queueIndex)
+      priorities.resize(allocation.queueIndex + 1, 0.0f);
+    priorities[allocation.queueIndex] = allocation.priority;
+  }
+
+  std::vector<VkDeviceQueueCreateInfo> queueInfos;
+  for (uint32_t familyIdx = 0; familyIdx < familyPriorities.size();
+       ++familyIdx) {
+    const auto& priorities = familyPriorities[familyIdx];
+    if (priorities.empty()) continue;
+
+    VkDeviceQueueCreateInfo queueInfo = {};
+    queueInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = familyIdx;
+    queueInfo.queueCount       = static_cast<uint32_t>(priorities.size());
+    queueInfo.pQueuePriorities = priorities.data();
+    queueInfos.push_back(queueInfo);
+  }
+
+  VkDeviceCreateInfo deviceInfo      = {};
+  deviceInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceInfo.pNext                   = next;
+  deviceInfo.queueCreateInfoCount    = 
+    static_cast<uint32_t>(queueInfos.size());
+  deviceInfo.pQueueCreateInfos       = queueInfos.data();
+  deviceInfo.enabledExtensionCount   = 
+    static_cast<uint32_t>(extensions.size());
+  deviceInfo.ppEnabledExtensionNames = extensions.data();
+  deviceInfo.pEnabledFeatures        = features;
+
+  VkResult result = dispatch.vkCreateDevice(physicalDevice.device,
+                      &deviceInfo, nullptr, &VulkanDevice);
+  util::AssertSuccess(result, "Failed to create logical device.\n");
+  if (result != VK_SUCCESS) return;
+
+  // Load the device functions directly from the driver for this device.
+  Dispatch.load(dispatch, VulkanDevice);
+
+  Queues.resize(Allocations.size(), VK_NULL_HANDLE);
+  for (size_t allocationIdx = 0; allocationIdx < Allocations.size();
+       ++allocationIdx) {
+    const auto& allocation = Allocations[allocationIdx];
+    if (allocation.familyIndex == VK_QUEUE_FAMILY_IGNORED) continue;
+    Dispatch.vkGetDeviceQueue(VulkanDevice, allocation.familyIndex,
+      allocation.queueIndex, &Queues[allocationIdx]);
+  }
+}
+
+Device::~Device() {
+  if (VulkanDevice != VK_NULL_HANDLE)
+    Dispatch.vkDestroyDevice(VulkanDevice, nullptr);
+}
+
+VkQueue Device::getQueue(QueueType queueType) const {
+  for (size_t allocationIdx = 0; allocationIdx < Allocations.size();
+       ++allocationIdx) {
+    if (Allocations[allocationIdx].type == queueType)
+      return Queues.empty() ? VK_NULL_HANDLE : Queues[allocationIdx];
+  }
+  return VK_NULL_HANDLE;
+}
+
+uint32_t Device::getQueueFamily(QueueType queueType) const {
+  for (const auto& allocation : Allocations) {
+    if (allocation.type == queueType)
+      return allocation.familyIndex;
+  }
+  return VK_QUEUE_FAMILY_IGNORED;
+}
+
+} // namespace vwrap
@@ -18,43 +18,80 @@
 
 #include "vulkawrap/device/filter.h"
 #include "vulkawrap/util/assert.hpp"
+#include <algorithm>
 
 namespace vwrap {
  
 //---- Public ---------------------------------------------------------------//
 
+float scoreDevice(const DeviceCapabilities& capabilities, 
+                  const ScoringPolicy&      policy      ) {
+  if (!policy.ranks()) return 0.0f;
+
+  // Find the largest device local heap.
+  const auto& memory          = capabilities.memoryProperties;
+  VkDeviceSize deviceLocalSize = 0;
+  for (uint32_t heapIdx = 0; heapIdx < memory.memoryHeapCount; ++heapIdx) {
+    const auto& heap = memory.memoryHeaps[heapIdx];
+    if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+      deviceLocalSize = std::max(deviceLocalSize, heap.size);
+  }
+
+  // Check for dedicated transfer and async compute families.
+  bool hasDedicatedTransfer = false, hasAsyncCompute = false;
+  for (const auto& family : capabilities.queueFamilies) {
+    const auto flags = family.queueFlags;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) && 
+       !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      hasDedicatedTransfer = true;
+    }
+    if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+      hasAsyncCompute = true;
+  }
+
+  const auto& limits = capabilities.properties.limits;
+  const float computeUnits = 
+    static_cast<float>(limits.maxComputeWorkGroupInvocations) / 1024.0f +
+    static_cast<float>(limits.maxComputeSharedMemorySize)     / 32768.0f;
+  const float memoryGiB    = 
+    static_cast<float>(deviceLocalSize) / (1024.0f * 1024.0f * 1024.0f);
+  const auto  deviceType   = capabilities.properties.deviceType;
+
+  float score = policy.deviceLocalMemory * memoryGiB
+              + policy.computeLimits     * computeUnits;
+  if (deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+    score += policy.discreteGpu;
+  if (deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
+    score += policy.integratedGpu;
+  if (hasDedicatedTransfer)
+    score += policy.dedicatedTransfer;
+  if (hasAsyncCompute)
+    score += policy.asyncCompute;
+  return score;
+}
+
 bool DeviceFilter::addIfQueuesAreSupported(
-    const VkPhysicalDevice& vkPhysicalDevice, 
-    const QueueTypeVec& queueTypes          , 
-    bool  mustSupportAllQueues              ) {
-  PhysicalDevices.emplace_back(vkPhysicalDevice);
-  PhysicalDevices.back().addSupportedQueues(queueTypes);
+    const DeviceCapabilities& capabilities, 
+    const DeviceSpecifier&    specifier   ) {
+  PhysicalDevice physicalDevice(capabilities);
+  physicalDevice.addSupportedQueues(capabilities.queueFamilies, 
+    specifier.queueTypes);
 
-  // Remove the device if it must support all queues
+  // Don't add the device if it must support all queues
   // and not all the requested queus were found.
-  if (mustSupportAllQueues && 
-      (PhysicalDevices.back().queueTypes.size() != queueTypes.size())) {
-    PhysicalDevices.pop_back();
+  if (!specifier.isSatisfiedBy(physicalDevice.queueTypes))
     return false;
-  } 
+
+  PhysicalDevices.push_back(physicalDevice);
   return true;
 }
 
-//---- Private --------------------------------------------------------------//
-
-std::vector<VkPhysicalDevice> DeviceFilter::getPhysicalDevices() const {
-  uint32_t deviceCount = 0;
-  VkResult result      = vkEnumeratePhysicalDevices(Instance->vkInstance, 
-                           &deviceCount, nullptr);
-  util::AssertSuccess(result, "Failed to enumerate physical devices.\n");
-  util::Assert(deviceCount >= 1, "Failed to find any physical devices.\n");
-
-  std::vector<VkPhysicalDevice> physicalDevices;
-  physicalDevices.resize(deviceCount); 
-  result = vkEnumeratePhysicalDevices(Instance->vkInstance, &deviceCount, 
-             physicalDevices.data());
-  util::AssertSuccess(result, "Could not enumerate physical devices.\n");
-  return physicalDevices;
+void rankPhysicalDevices(PhysicalDeviceVec& physicalDevices) {
+  std::stable_sort(physicalDevices.begin(), physicalDevices.end(),
+    [] (const PhysicalDevice& a, const PhysicalDevice& b) {
+      if (a.specifier != b.specifier) return a.specifier < b.specifier;
+      return a.score > b.score;
+    });
 }
 
 }  // namespace vwrap
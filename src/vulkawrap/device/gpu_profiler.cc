@@ -0,0 +1,288 @@
+//---- src/vulkawrap/device/gpu_profiler.cc ---------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  gpu_profiler.cc
+/// \brief Implementation of the GPU profiler.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/gpu_profiler.h"
+#include "vulkawrap/device/device.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace vwrap {
+namespace {
+
+/// The name of the scope which covers a whole frame.
+static constexpr const char* FrameScopeNameCx = "Frame";
+
+/// Writes a string to a stream as a JSON string.
+///
+/// \param stream The stream to write to.
+/// \param value  The string to write.
+void writeJsonString(std::ostream& stream, const std::string& value) {
+  stream << '"';
+  for (const auto c : value) {
+    switch (c) {
+      case '"' : stream << "\\\""; break;
+      case '\\': stream << "\\\\"; break;
+      case '\n': stream << "\\n";  break;
+      case '\r': stream << "\\r";  break;
+      case '\t': stream << "\\t";  break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          stream << escaped;
+        } else {
+          stream << c;
+        }
+    }
+  }
+  stream << '"';
+}
+
+/// Gets the number of valid timestamp bits of the queue family which a type
+/// of work is submitted to.
+///
+/// \param device    The device.
+/// \param queueType The type of work.
+uint32_t getTimestampBits(const Device& device, QueueType queueType) {
+  const auto  family   = device.getQueueFamily(queueType);
+  const auto& families = device.getQueueFamilyProperties();
+  if (family >= families.size()) {
+    util::Assert(false, "Profiled queue type has no queue family.\n");
+    return 0;
+  }
+
+  const auto validBits = families[family].timestampValidBits;
+  util::Assert(validBits != 0, "Profiled queue family has no timestamps.\n");
+  return validBits;
+}
+
+} // annonymous namespace
+
+//---- Public ---------------------------------------------------------------//
+
+GpuProfiler::GpuProfiler(const loader::DeviceDispatch& dispatch       ,
+                         float                         timestampPeriod,
+                         uint32_t                      validBits      ,
+                         uint32_t                      frameCount     ,
+                         uint32_t                      queryCount     )
+: Dispatch(dispatch), Period(timestampPeriod),
+  TickMask(validBits >= 64 ? ~0ull : (1ull << validBits) - 1),
+  QueryCount(queryCount), FrameIndex(0), HasEpoch(false), Epoch(0),
+  DroppedFrames(0) {
+  createPools(frameCount);
+}
+
+GpuProfiler::GpuProfiler(const Device& device    ,
+                         uint32_t      frameCount,
+                         uint32_t      queryCount,
+                         QueueType     queueType )
+: GpuProfiler(device.getDispatch(),
+              device.getProperties().limits.timestampPeriod,
+              getTimestampBits(device, queueType), frameCount, queryCount) {}
+
+GpuProfiler::~GpuProfiler() {
+  for (auto& slot : Slots) {
+    if (slot.pool != VK_NULL_HANDLE)
+      Dispatch.vkDestroyQueryPool(Dispatch.device, slot.pool, nullptr);
+  }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer) {
+  util::Assert(OpenScopes.empty(), "Profiler frame begun inside a scope.\n");
+  resolve();
+
+  // The results of the frame which last used the queries are lost once the
+  // queries are reset, so they are dropped rather than waited for.
+  auto& slot = currentSlot();
+  if (slot.pending) ++DroppedFrames;
+  slot.frame     = FrameIndex;
+  slot.pending   = false;
+  slot.usedCount = 0;
+  slot.scopes.clear();
+  OpenScopes.clear();
+
+  if (slot.pool == VK_NULL_HANDLE) return;
+  Dispatch.vkCmdResetQueryPool(commandBuffer, slot.pool, 0, QueryCount);
+  beginScope(commandBuffer, FrameScopeNameCx,
+             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+  if (!OpenScopes.empty()) {
+    util::Assert(OpenScopes.size() == 1,
+                 "Profiler frame ended with open scopes.\n");
+    while (!OpenScopes.empty()) {
+      endScope(commandBuffer, OpenScopes.back(),
+               VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    }
+  }
+
+  auto& slot = currentSlot();
+  slot.pending = !slot.scopes.empty();
+  ++FrameIndex;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer         commandBuffer,
+                                 const std::string&      name         ,
+                                 VkPipelineStageFlagBits stage        ) {
+  auto& slot = currentSlot();
+  if (slot.pool == VK_NULL_HANDLE || slot.usedCount + 2 > QueryCount)
+    return InvalidScopeCx;
+
+  const auto scope = static_cast<uint32_t>(slot.scopes.size());
+  slot.scopes.push_back(PendingScope{ name,
+    OpenScopes.empty() ? InvalidScopeCx : OpenScopes.back(),
+    static_cast<uint32_t>(OpenScopes.size()), slot.usedCount,
+    slot.usedCount + 1 });
+  slot.usedCount += 2;
+  OpenScopes.push_back(scope);
+
+  Dispatch.vkCmdWriteTimestamp(commandBuffer, stage, slot.pool,
+                               slot.scopes.back().beginQuery);
+  return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer         commandBuffer,
+                           uint32_t                scope        ,
+                           VkPipelineStageFlagBits stage        ) {
+  if (scope == InvalidScopeCx) return;
+  if (OpenScopes.empty() || OpenScopes.back() != scope) {
+    util::Assert(false, "Profiler scopes must end in the reverse order to "
+                        "which they began.\n");
+    return;
+  }
+  OpenScopes.pop_back();
+
+  auto& slot = currentSlot();
+  Dispatch.vkCmdWriteTimestamp(commandBuffer, stage, slot.pool,
+                               slot.scopes[scope].endQuery);
+}
+
+void GpuProfiler::resolve() {
+  // Frames finish in the order they were submitted, so the results are read
+  // oldest first, and reading stops at the first frame which isn't done.
+  std::vector<FrameSlot*> pending;
+  for (auto& slot : Slots) {
+    if (slot.pending) pending.push_back(&slot);
+  }
+  std::sort(pending.begin(), pending.end(),
+    [] (const FrameSlot* a, const FrameSlot* b) {
+      return a->frame < b->frame;
+    });
+
+  for (auto* slot : pending) {
+    if (!resolve(*slot)) break;
+  }
+}
+
+std::vector<GpuFrameTimings> GpuProfiler::takeFrames() {
+  std::vector<GpuFrameTimings> frames;
+  frames.swap(Resolved);
+  return frames;
+}
+
+std::string
+GpuProfiler::toChromeTrace(const std::vector<GpuFrameTimings>& frames) {
+  std::ostringstream trace;
+  trace.setf(std::ios::fixed);
+  trace.precision(3);
+
+  // Chrome trace timestamps are in microseconds.
+  trace << "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto& frame : frames) {
+    for (const auto& scope : frame.scopes) {
+      trace << (first ? "\n" : ",\n") << "{\"name\":";
+      writeJsonString(trace, scope.name);
+      trace << ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+            << ",\"ts\":"  << scope.beginNs    / 1000.0
+            << ",\"dur\":" << scope.durationNs / 1000.0
+            << ",\"args\":{\"frame\":" << frame.frame << "}}";
+      first = false;
+    }
+  }
+  trace << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  return trace.str();
+}
+
+bool GpuProfiler::writeChromeTrace(const std::string&                  path  ,
+                                   const std::vector<GpuFrameTimings>& frames) {
+  std::ofstream file(path, std::ios::trunc);
+  if (!file) return false;
+  file << toChromeTrace(frames);
+  return static_cast<bool>(file);
+}
+
+//---- Private --------------------------------------------------------------//
+
+void GpuProfiler::createPools(uint32_t frameCount) {
+  util::Assert(frameCount > 0, "Profiler needs at least one frame.\n");
+  Slots.resize(std::max(frameCount, 1u));
+
+  VkQueryPoolCreateInfo createInfo = {};
+  createInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  createInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+  createInfo.queryCount = QueryCount;
+
+  for (auto& slot : Slots) {
+    slot.pool      = VK_NULL_HANDLE;
+    slot.frame     = 0;
+    slot.pending   = false;
+    slot.usedCount = 0;
+    if (Dispatch.vkCreateQueryPool(Dispatch.device, &createInfo, nullptr,
+                                   &slot.pool) != VK_SUCCESS) {
+      util::Assert(false, "Failed to create profiler query pool.\n");
+      slot.pool = VK_NULL_HANDLE;
+    }
+  }
+}
+
+bool GpuProfiler::resolve(FrameSlot& slot) {
+  // Without the wait flag the driver returns VK_NOT_READY, rather than
+  // blocking, if any of the results aren't available yet.
+  Results.resize(slot.usedCount);
+  const auto result = Dispatch.vkGetQueryPoolResults(Dispatch.device,
+    slot.pool, 0, slot.usedCount, Results.size() * sizeof(uint64_t),
+    Results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS) return false;
+
+  if (!HasEpoch) {
+    Epoch    = Results[slot.scopes.front().beginQuery] & TickMask;
+    HasEpoch = true;
+  }
+
+  // Differences are masked so that they stay correct when the counter wraps
+  // around within its valid bits.
+  GpuFrameTimings frame{ slot.frame, {} };
+  frame.scopes.reserve(slot.scopes.size());
+  for (const auto& scope : slot.scopes) {
+    const auto begin = Results[scope.beginQuery] & TickMask;
+    const auto end   = Results[scope.endQuery]   & TickMask;
+    frame.scopes.push_back(GpuScopeTiming{ scope.name, scope.parent,
+      scope.depth, ((begin - Epoch) & TickMask) * Period,
+      ((end - begin) & TickMask) * Period });
+  }
+
+  if (Resolved.size() >= ProfilerHistoryCx) Resolved.erase(Resolved.begin());
+  Resolved.push_back(std::move(frame));
+  slot.pending = false;
+  return true;
+}
+
+} // namespace vwrap
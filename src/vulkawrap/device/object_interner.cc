@@ -0,0 +1,175 @@
+//---- src/vulkawrap/device/object_interner.cc ------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  object_interner.cc
+/// \brief Implementation of the object interner.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/object_interner.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+
+namespace vwrap {
+namespace {
+
+/// Gets the signature word of a float, with negative zero made positive, so
+/// that values which compare equal have the same word.
+///
+/// \param value The value to get the word of.
+uint64_t floatWord(float value) {
+  return util::toWord(value + 0.0f);
+}
+
+} // annonymous namespace
+
+//---- Signatures -----------------------------------------------------------//
+
+namespace detail {
+
+void appendSignature(const VkSamplerCreateInfo& createInfo,
+                     util::Signature&           signature ) {
+  // The anisotropy and compare op are only used when they are enabled, so
+  // they are left out otherwise.
+  signature.push_back(createInfo.flags);
+  signature.push_back(createInfo.magFilter);
+  signature.push_back(createInfo.minFilter);
+  signature.push_back(createInfo.mipmapMode);
+  signature.push_back(createInfo.addressModeU);
+  signature.push_back(createInfo.addressModeV);
+  signature.push_back(createInfo.addressModeW);
+  signature.push_back(floatWord(createInfo.mipLodBias));
+  signature.push_back(createInfo.anisotropyEnable);
+  signature.push_back(createInfo.anisotropyEnable ?
+                        floatWord(createInfo.maxAnisotropy) : 0);
+  signature.push_back(createInfo.compareEnable);
+  signature.push_back(createInfo.compareEnable ? createInfo.compareOp : 0);
+  signature.push_back(floatWord(createInfo.minLod));
+  signature.push_back(floatWord(createInfo.maxLod));
+  signature.push_back(createInfo.borderColor);
+  signature.push_back(createInfo.unnormalizedCoordinates);
+}
+
+void appendSignature(const SetLayoutVec&         setLayouts,
+                     const PushConstantRangeVec& ranges    ,
+                     util::Signature&            signature ) {
+  signature.push_back(setLayouts.size());
+  for (const auto setLayout : setLayouts)
+    signature.push_back(util::toWord(setLayout));
+
+  auto sortedRanges = ranges;
+  std::sort(sortedRanges.begin(), sortedRanges.end(),
+    [] (const VkPushConstantRange& a, const VkPushConstantRange& b) {
+      return a.offset != b.offset ? a.offset < b.offset :
+             a.size   != b.size   ? a.size   < b.size   :
+                                    a.stageFlags < b.stageFlags;
+    });
+  signature.push_back(sortedRanges.size());
+  for (const auto& range : sortedRanges) {
+    signature.push_back(range.stageFlags);
+    signature.push_back(range.offset);
+    signature.push_back(range.size);
+  }
+}
+
+} // namespace detail
+
+//---- Public ---------------------------------------------------------------//
+
+ObjectInterner::~ObjectInterner() {
+  const auto device = Dispatch.device;
+  PipelineLayouts.forEach(
+    [this, device] (const util::Signature&, VkPipelineLayout layout) {
+      Dispatch.vkDestroyPipelineLayout(device, layout, nullptr);
+    });
+  SetLayouts.forEach(
+    [this, device] (const util::Signature&, VkDescriptorSetLayout layout) {
+      Dispatch.vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    });
+  Samplers.forEach(
+    [this, device] (const util::Signature&, VkSampler sampler) {
+      Dispatch.vkDestroySampler(device, sampler, nullptr);
+    });
+}
+
+VkSampler ObjectInterner::getSampler(const VkSamplerCreateInfo& createInfo) {
+  if (createInfo.pNext != nullptr) {
+    util::Assert(false, "Samplers with extensions can't be interned.\n");
+    return VK_NULL_HANDLE;
+  }
+
+  util::Signature signature;
+  detail::appendSignature(createInfo, signature);
+  return Samplers.getOrCreate(signature, [this, &createInfo] {
+    VkSampler sampler = VK_NULL_HANDLE;
+    const auto result = Dispatch.vkCreateSampler(Dispatch.device,
+                          &createInfo, nullptr, &sampler);
+    util::AssertSuccess(result, "Failed to create sampler.\n");
+    return result == VK_SUCCESS ? sampler : VK_NULL_HANDLE;
+  }, VK_NULL_HANDLE);
+}
+
+VkDescriptorSetLayout ObjectInterner::getSetLayout(
+    const LayoutBindingVec& bindings) {
+  // Sorting the bindings means that the same bindings in another order are
+  // the same layout.
+  auto sortedBindings = bindings;
+  std::sort(sortedBindings.begin(), sortedBindings.end(),
+    [] (const VkDescriptorSetLayoutBinding& a,
+        const VkDescriptorSetLayoutBinding& b) {
+      return a.binding < b.binding;
+    });
+
+  util::Signature signature;
+  detail::appendSignature(sortedBindings, signature);
+  return SetLayouts.getOrCreate(signature, [this, &sortedBindings] {
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType        =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(sortedBindings.size());
+    layoutInfo.pBindings    = sortedBindings.data();
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    const auto result = Dispatch.vkCreateDescriptorSetLayout(Dispatch.device,
+                          &layoutInfo, nullptr, &layout);
+    util::AssertSuccess(result, "Failed to create descriptor set layout.\n");
+    return result == VK_SUCCESS ? layout : VK_NULL_HANDLE;
+  }, VK_NULL_HANDLE);
+}
+
+VkPipelineLayout ObjectInterner::getPipelineLayout(
+    const SetLayoutVec&         setLayouts,
+    const PushConstantRangeVec& ranges    ) {
+  util::Signature signature;
+  detail::appendSignature(setLayouts, ranges, signature);
+  return PipelineLayouts.getOrCreate(signature,
+    [this, &setLayouts, &ranges] {
+      VkPipelineLayoutCreateInfo layoutInfo = {};
+      layoutInfo.sType                  =
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+      layoutInfo.setLayoutCount         =
+        static_cast<uint32_t>(setLayouts.size());
+      layoutInfo.pSetLayouts            =
+        setLayouts.empty() ? nullptr : setLayouts.data();
+      layoutInfo.pushConstantRangeCount =
+        static_cast<uint32_t>(ranges.size());
+      layoutInfo.pPushConstantRanges    =
+        ranges.empty() ? nullptr : ranges.data();
+
+      VkPipelineLayout layout = VK_NULL_HANDLE;
+      const auto result = Dispatch.vkCreatePipelineLayout(Dispatch.device,
+                            &layoutInfo, nullptr, &layout);
+      util::AssertSuccess(result, "Failed to create pipeline layout.\n");
+      return result == VK_SUCCESS ? layout : VK_NULL_HANDLE;
+    }, VK_NULL_HANDLE);
+}
+
+} // namespace vwrap
@@ -0,0 +1,58 @@
+//---- src/vulkawrap/device/parallel_recorder.cc ----------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  parallel_recorder.cc
+/// \brief Implementation of the parallel recorder.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/parallel_recorder.h"
+#include "vulkawrap/util/assert.hpp"
+
+namespace vwrap {
+
+//---- Private --------------------------------------------------------------//
+
+VkCommandBuffer ParallelRecorder::beginSecondary(
+    uint32_t                              familyIndex,
+    const VkCommandBufferInheritanceInfo& inheritance) {
+  auto secondary = CommandPools.allocate(familyIndex,
+                     VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+  if (secondary == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritance;
+  if (inheritance.renderPass != VK_NULL_HANDLE)
+    beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+
+  const auto result = Owner.getDispatch().vkBeginCommandBuffer(secondary,
+                        &beginInfo);
+  util::AssertSuccess(result, "Failed to begin secondary command buffer.\n");
+  return result == VK_SUCCESS ? secondary : VK_NULL_HANDLE;
+}
+
+bool ParallelRecorder::executeSecondaries(VkCommandBuffer primary) {
+  // Executing the chunks which did record would silently drop the commands
+  // of the others, so nothing is executed.
+  if (std::find(Secondaries.begin(), Secondaries.end(), VkCommandBuffer{}) !=
+      Secondaries.end()) {
+    util::Assert(false, "Failed to record a secondary command buffer.\n");
+    return false;
+  }
+
+  Owner.getDispatch().vkCmdExecuteCommands(primary,
+    static_cast<uint32_t>(Secondaries.size()), Secondaries.data());
+  return true;
+}
+
+} // namespace vwrap
@@ -0,0 +1,242 @@
+//---- src/vulkawrap/device/pipeline_cache.cc -------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  pipeline_cache.cc
+/// \brief Implementation of the pipeline cache.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/pipeline_cache.h"
+#include "vulkawrap/device/device.h"
+#include "vulkawrap/util/assert.hpp"
+#include "vulkawrap/util/hash.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#if defined(_WIN32)
+  #include <process.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace vwrap {
+namespace {
+
+using Header = detail::PipelineCacheFileHeader;
+
+/// The identifier at the start of every pipeline cache file.
+static constexpr char CacheMagicCx[4] = { 'V', 'W', 'P', 'C' };
+
+/// The size of the header which the driver writes at the start of its data:
+/// the header size, the header version, the vendor and device ids, and the
+/// pipeline cache UUID.
+static constexpr size_t DriverHeaderSizeCx = 4 * sizeof(uint32_t) +
+                                             VK_UUID_SIZE;
+
+/// Returns true if a file header was written for a device.
+///
+/// \param header     The header of the file.
+/// \param properties The properties of the device.
+bool headerMatches(const Header&                     header    ,
+                   const VkPhysicalDeviceProperties& properties) {
+  return std::memcmp(header.magic, CacheMagicCx, sizeof(CacheMagicCx)) == 0 &&
+         header.version       == PipelineCacheVersionCx                   &&
+         header.vendorID      == properties.vendorID                      &&
+         header.deviceID      == properties.deviceID                      &&
+         header.driverVersion == properties.driverVersion                 &&
+         std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+}
+
+} // annonymous namespace
+
+//---- Public ---------------------------------------------------------------//
+
+PipelineCache::PipelineCache(const Device& device, const std::string& path)
+:   Owner(device), Path(path),
+    Cache(VK_NULL_HANDLE), Loaded(false),
+    InitialData(load(path, device.getProperties())) {
+  Loaded = !InitialData.empty();
+  Cache  = create(InitialData);
+
+  // The driver may still reject data which looked valid, in which case the
+  // cache starts empty.
+  if (Cache == VK_NULL_HANDLE && Loaded) {
+    InitialData.clear();
+    Loaded = false;
+    Cache  = create(InitialData);
+  }
+}
+
+PipelineCache::~PipelineCache() {
+  const auto& dispatch = Owner.getDispatch();
+  const auto  vkDevice = Owner.getVkDevice();
+
+  ThreadCaches.forEach([&] (VkPipelineCache threadCache) {
+    if (threadCache != VK_NULL_HANDLE)
+      dispatch.vkDestroyPipelineCache(vkDevice, threadCache, nullptr);
+  });
+  if (Cache != VK_NULL_HANDLE)
+    dispatch.vkDestroyPipelineCache(vkDevice, Cache, nullptr);
+}
+
+VkPipelineCache PipelineCache::getThreadCache() {
+  // A thread whose cache could not be created uses the main cache.
+  const auto threadCache = ThreadCaches.get([this] (VkPipelineCache& cache) {
+    cache = create(InitialData);
+  });
+  return threadCache != VK_NULL_HANDLE ? threadCache : Cache;
+}
+
+void PipelineCache::mergeThreadCaches() {
+  if (Cache == VK_NULL_HANDLE) return;
+
+  std::vector<VkPipelineCache> threadCaches;
+  ThreadCaches.forEach([&] (VkPipelineCache threadCache) {
+    if (threadCache != VK_NULL_HANDLE) threadCaches.push_back(threadCache);
+  });
+  if (threadCaches.empty()) return;
+
+  const auto result = Owner.getDispatch().vkMergePipelineCaches(
+                        Owner.getVkDevice(), Cache,
+                        static_cast<uint32_t>(threadCaches.size()),
+                        threadCaches.data());
+  util::AssertSuccess(result, "Failed to merge pipeline caches.\n");
+}
+
+bool PipelineCache::save() {
+  if (Cache == VK_NULL_HANDLE) return false;
+  mergeThreadCaches();
+
+  const auto& dispatch = Owner.getDispatch();
+  const auto  vkDevice = Owner.getVkDevice();
+  size_t      size     = 0;
+  auto result = dispatch.vkGetPipelineCacheData(vkDevice, Cache, &size,
+                  nullptr);
+  if (result != VK_SUCCESS || size == 0) return false;
+
+  std::vector<char> data(size);
+  result = dispatch.vkGetPipelineCacheData(vkDevice, Cache, &size,
+             data.data());
+  util::AssertSuccess(result, "Failed to get pipeline cache data.\n");
+  if (result != VK_SUCCESS) return false;
+  data.resize(size);
+
+  return store(Path, Owner.getProperties(), data);
+}
+
+std::vector<char> PipelineCache::load(
+    const std::string&                path      ,
+    const VkPhysicalDeviceProperties& properties) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) return std::vector<char>();
+
+  const auto fileSize = static_cast<size_t>(file.tellg());
+  Header     header;
+  if (fileSize < sizeof(Header)) return std::vector<char>();
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(Header)) ||
+      !headerMatches(header, properties)                          ||
+      header.dataSize != fileSize - sizeof(Header)                ) {
+    return std::vector<char>();
+  }
+
+  std::vector<char> data(static_cast<size_t>(header.dataSize));
+  if (!file.read(data.data(), data.size())                        ||
+      util::fnv1a(data.data(), data.size()) != header.checksum    ||
+      !isValidData(data.data(), data.size(), properties)          ) {
+    return std::vector<char>();
+  }
+  return data;
+}
+
+bool PipelineCache::store(const std::string&                path      ,
+                          const VkPhysicalDeviceProperties& properties,
+                          const std::vector<char>&          data      ) {
+  Header header;
+  std::memset(&header, 0, sizeof(Header));
+  std::memcpy(header.magic, CacheMagicCx, sizeof(CacheMagicCx));
+  header.version       = PipelineCacheVersionCx;
+  header.vendorID      = properties.vendorID;
+  header.deviceID      = properties.deviceID;
+  header.driverVersion = properties.driverVersion;
+  std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID,
+              VK_UUID_SIZE);
+  header.dataSize      = data.size();
+  header.checksum      = util::fnv1a(data.data(), data.size());
+
+  // Write to a file which is unique to this process and thread, so that
+  // concurrent writers never interleave, and then swap it into place.
+#if defined(_WIN32)
+  const auto processId = _getpid();
+#else
+  const auto processId = getpid();
+#endif
+  const auto threadId  = std::hash<std::thread::id>()(
+                           std::this_thread::get_id());
+  const auto tempPath  = path + ".tmp." + std::to_string(processId) + "." +
+                         std::to_string(threadId);
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(data.data(), data.size());
+    if (!file) {
+      std::remove(tempPath.c_str());
+      return false;
+    }
+  }
+
+#if defined(_WIN32)
+  std::remove(path.c_str());
+#endif
+  if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    std::remove(tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool PipelineCache::isValidData(const void*                       data      ,
+                                size_t                            size      ,
+                                const VkPhysicalDeviceProperties& properties) {
+  if (size < DriverHeaderSizeCx) return false;
+
+  uint32_t fields[4];
+  std::memcpy(fields, data, sizeof(fields));
+  const auto* uuid = static_cast<const uint8_t*>(data) + sizeof(fields);
+  return fields[0] >= DriverHeaderSizeCx                         &&
+         fields[0] <= size                                       &&
+         fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE       &&
+         fields[2] == properties.vendorID                        &&
+         fields[3] == properties.deviceID                        &&
+         std::memcmp(uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+//---- Private --------------------------------------------------------------//
+
+VkPipelineCache PipelineCache::create(const std::vector<char>& data) const {
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData    = data.empty() ? nullptr : data.data();
+
+  VkPipelineCache cache = VK_NULL_HANDLE;
+  const auto result = Owner.getDispatch().vkCreatePipelineCache(
+                        Owner.getVkDevice(), &cacheInfo, nullptr, &cache);
+  util::AssertSuccess(result, "Failed to create pipeline cache.\n");
+  return result == VK_SUCCESS ? cache : VK_NULL_HANDLE;
+}
+
+} // namespace vwrap
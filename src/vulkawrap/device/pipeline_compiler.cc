@@ -0,0 +1,88 @@
+//---- src/vulkawrap/device/pipeline_compiler.cc ----------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  pipeline_compiler.cc
+/// \brief Implementation of the pipeline compiler.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/pipeline_compiler.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+
+namespace vwrap {
+
+//---- Public ---------------------------------------------------------------//
+
+PipelineCompiler::PipelineCompiler(const Device&  device       ,
+                                   PipelineCache& pipelineCache,
+                                   uint32_t       threadCount  )
+:   Owner(device), Cache(pipelineCache), Stopping(false) {
+  threadCount = std::max(threadCount, 1u);
+  Workers.reserve(threadCount);
+  for (uint32_t threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+    Workers.emplace_back([this] { run(); });
+}
+
+PipelineCompiler::~PipelineCompiler() {
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Stopping = true;
+  }
+  WorkReady.notify_all();
+  for (auto& worker : Workers) worker.join();
+}
+
+std::future<VkPipeline> PipelineCompiler::compile(
+    const VkGraphicsPipelineCreateInfo& createInfo) {
+  return submit([this, createInfo] (VkPipelineCache cache) {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    const auto result = Owner.getDispatch().vkCreateGraphicsPipelines(
+                          Owner.getVkDevice(), cache, 1, &createInfo,
+                          nullptr, &pipeline);
+    util::AssertSuccess(result, "Failed to create graphics pipeline.\n");
+    return result == VK_SUCCESS ? pipeline : VK_NULL_HANDLE;
+  });
+}
+
+std::future<VkPipeline> PipelineCompiler::compile(
+    const VkComputePipelineCreateInfo& createInfo) {
+  return submit([this, createInfo] (VkPipelineCache cache) {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    const auto result = Owner.getDispatch().vkCreateComputePipelines(
+                          Owner.getVkDevice(), cache, 1, &createInfo,
+                          nullptr, &pipeline);
+    util::AssertSuccess(result, "Failed to create compute pipeline.\n");
+    return result == VK_SUCCESS ? pipeline : VK_NULL_HANDLE;
+  });
+}
+
+//---- Private --------------------------------------------------------------//
+
+void PipelineCompiler::run() {
+  const auto cache = Cache.getThreadCache();
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(Mutex);
+      WorkReady.wait(lock, [this] { return Stopping || !Tasks.empty(); });
+
+      // The requests which were made before stopping are still finished, so
+      // that none of the futures are abandoned.
+      if (Tasks.empty()) return;
+      task = std::move(Tasks.front());
+      Tasks.pop_front();
+    }
+    task(cache);
+  }
+}
+
+} // namespace vwrap
@@ -0,0 +1,382 @@
+//---- src/vulkawrap/device/queue.cc ----------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  queue.cc
+/// \brief Implementation of the queue functionality for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/queue.h"
+#include "vulkawrap/device/device.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace vwrap {
+namespace {
+
+/// The queue capabilities which make a family less dedicated.
+static constexpr VkQueueFlags CapabilityFlagsCx =
+  VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+
+/// Cost of placing a request on a family which has no free queues.
+static constexpr uint32_t SharedQueueCostCx  = 1000;
+
+/// Cost of placing a request on a family which other work is using.
+static constexpr uint32_t SharedFamilyCostCx = 100;
+
+/// Cost of each capability a family has, so that dedicated families win.
+static constexpr uint32_t CapabilityCostCx   = 10;
+
+/// Raises the known completed value of a timeline to a value, if the value is
+/// higher, so that the known value only ever increases.
+///
+/// \param current The known completed value.
+/// \param value   The value which has completed.
+void raiseTo(std::atomic<uint64_t>& current, uint64_t value) {
+  auto known = current.load(std::memory_order_relaxed);
+  while (known < value && !current.compare_exchange_weak(known, value,
+           std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+/// Counts the capabilities of a queue family.
+///
+/// \param flags The flags of the queue family.
+uint32_t capabilityCount(VkQueueFlags flags) {
+  uint32_t count = 0;
+  for (flags &= CapabilityFlagsCx; flags; flags &= flags - 1) ++count;
+  return count;
+}
+
+/// Gets the index of the first request of a device for a type of work, or
+/// the number of requests if there is none.
+///
+/// \param device    The device.
+/// \param queueType The type of work.
+size_t findRequest(const Device& device, QueueType queueType) {
+  const auto& allocations = device.getQueueAllocations();
+  for (size_t allocationIdx = 0; allocationIdx < allocations.size();
+       ++allocationIdx) {
+    if (allocations[allocationIdx].type == queueType) return allocationIdx;
+  }
+  return allocations.size();
+}
+
+} // annonymous namespace
+
+bool queueFamilySupports(const VkQueueFamilyProperties& family,
+                         QueueType                      queueType) {
+  if (family.queueCount == 0) return false;
+
+  switch (queueType) {
+    case QueueType::VW_ANY:
+      return true;
+    case QueueType::VW_TRANSFER_QUEUE:
+      return (family.queueFlags & CapabilityFlagsCx) != 0;
+    default:
+      return (family.queueFlags & static_cast<VkQueueFlags>(queueType)) != 0;
+  }
+}
+
+QueueAllocationVec allocateQueues(const QueueFamilyPropVec& families,
+                                  const QueueRequestVec&    requests) {
+  const auto familyCount = static_cast<uint32_t>(families.size());
+  QueueAllocationVec allocations(requests.size());
+
+  // Place the most constrained requests first, so that a request which only
+  // one family supports is not pushed off it by a more flexible request.
+  std::vector<size_t> order(requests.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&] (size_t a, size_t b) {
+    auto supportCount = [&] (QueueType type) {
+      return std::count_if(families.begin(), families.end(),
+        [type] (const VkQueueFamilyProperties& family) {
+          return queueFamilySupports(family, type);
+        });
+    };
+    return supportCount(requests[a].type) < supportCount(requests[b].type);
+  });
+
+  std::vector<uint32_t> usedQueues(familyCount, 0);
+  std::vector<uint8_t>  familyTypes(familyCount, 0);
+
+  for (const auto requestIdx : order) {
+    const auto& request    = requests[requestIdx];
+    const auto  typeBits   = static_cast<uint8_t>(request.type);
+    auto&       allocation = allocations[requestIdx];
+    allocation.type        = request.type;
+    allocation.familyIndex = VK_QUEUE_FAMILY_IGNORED;
+    allocation.queueIndex  = 0;
+    allocation.priority    = request.priority;
+    allocation.shared      = false;
+
+    uint32_t bestCost = ~0u;
+    for (uint32_t familyIdx = 0; familyIdx < familyCount; ++familyIdx) {
+      const auto& family = families[familyIdx];
+      if (!queueFamilySupports(family, request.type)) continue;
+
+      uint32_t cost = capabilityCount(family.queueFlags) * CapabilityCostCx;
+      if (usedQueues[familyIdx] >= family.queueCount)
+        cost += SharedQueueCostCx;
+      if (familyTypes[familyIdx] & ~typeBits)
+        cost += SharedFamilyCostCx;
+
+      if (cost < bestCost) {
+        bestCost               = cost;
+        allocation.familyIndex = familyIdx;
+      }
+    }
+
+    if (allocation.familyIndex == VK_QUEUE_FAMILY_IGNORED) continue;
+
+    const auto familyIdx    = allocation.familyIndex;
+    const auto queueCount   = families[familyIdx].queueCount;
+    familyTypes[familyIdx] |= typeBits;
+    if (usedQueues[familyIdx] < queueCount) {
+      allocation.queueIndex = usedQueues[familyIdx]++;
+    } else {
+      // No free queues, so share the last queue of the family.
+      allocation.queueIndex = queueCount - 1;
+      allocation.shared     = true;
+    }
+  }
+  return allocations;
+}
+
+//---- Submit Batch ---------------------------------------------------------//
+
+namespace detail {
+
+void SubmitBatch::add(const VkCommandBuffer* commandBuffers    ,
+                      uint32_t               commandBufferCount,
+                      const SemaphoreWait*   waits             ,
+                      uint32_t               waitCount         ,
+                      VkSemaphore            signal            ,
+                      uint64_t               value             ) {
+  // The command buffers of the last entry are always at the end, so they can
+  // be extended in place.
+  if (Entries.empty() || waitCount > 0 ||
+      Entries.back().signal != VK_NULL_HANDLE) {
+    Entry entry;
+    entry.waitBegin    = static_cast<uint32_t>(WaitSemaphores.size());
+    entry.waitCount    = waitCount;
+    entry.commandBegin = static_cast<uint32_t>(CommandBuffers.size());
+    entry.commandCount = 0;
+    Entries.push_back(entry);
+
+    for (uint32_t waitIdx = 0; waitIdx < waitCount; ++waitIdx) {
+      WaitSemaphores.push_back(waits[waitIdx].semaphore);
+      WaitValues.push_back(waits[waitIdx].value);
+      WaitStages.push_back(waits[waitIdx].stage);
+    }
+  }
+
+  auto& entry         = Entries.back();
+  entry.commandCount += commandBufferCount;
+  entry.signal        = signal;
+  entry.value         = value;
+  CommandBuffers.insert(CommandBuffers.end(), commandBuffers,
+                        commandBuffers + commandBufferCount);
+}
+
+const std::vector<VkSubmitInfo>& SubmitBatch::build(VkSemaphore timeline) {
+  SignalSemaphores.clear();
+  SignalValues.clear();
+  for (const auto& entry : Entries) {
+    SignalSemaphores.push_back(timeline);
+    SignalValues.push_back(entry.value);
+    if (entry.signal != VK_NULL_HANDLE) {
+      SignalSemaphores.push_back(entry.signal);
+      SignalValues.push_back(0);
+    }
+  }
+
+  // The signal arrays are complete, so pointers into them are now stable.
+  TimelineInfos.resize(Entries.size());
+  SubmitInfos.resize(Entries.size());
+  uint32_t signalBegin = 0;
+  for (size_t entryIdx = 0; entryIdx < Entries.size(); ++entryIdx) {
+    const auto& entry       = Entries[entryIdx];
+    const auto  signalCount = entry.signal != VK_NULL_HANDLE ? 2u : 1u;
+
+    auto& timelineInfo = TimelineInfos[entryIdx];
+    timelineInfo       = {};
+    timelineInfo.sType =
+      VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timelineInfo.waitSemaphoreValueCount   = entry.waitCount;
+    timelineInfo.pWaitSemaphoreValues      = WaitValues.data() +
+                                             entry.waitBegin;
+    timelineInfo.signalSemaphoreValueCount = signalCount;
+    timelineInfo.pSignalSemaphoreValues    = SignalValues.data() + signalBegin;
+
+    auto& submitInfo                = SubmitInfos[entryIdx];
+    submitInfo                      = {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.waitSemaphoreCount   = entry.waitCount;
+    submitInfo.pWaitSemaphores      = WaitSemaphores.data() + entry.waitBegin;
+    submitInfo.pWaitDstStageMask    = WaitStages.data() + entry.waitBegin;
+    submitInfo.commandBufferCount   = entry.commandCount;
+    submitInfo.pCommandBuffers      = CommandBuffers.data() +
+                                      entry.commandBegin;
+    submitInfo.signalSemaphoreCount = signalCount;
+    submitInfo.pSignalSemaphores    = SignalSemaphores.data() + signalBegin;
+    signalBegin += signalCount;
+  }
+  return SubmitInfos;
+}
+
+void SubmitBatch::clear() {
+  Entries.clear();
+  WaitSemaphores.clear();
+  WaitValues.clear();
+  WaitStages.clear();
+  CommandBuffers.clear();
+}
+
+} // namespace detail
+
+//---- Queue ----------------------------------------------------------------//
+
+Queue::Queue(const Device& device, size_t requestIdx)
+:   Owner(device), VulkanQueue(VK_NULL_HANDLE),
+    FamilyIndex(VK_QUEUE_FAMILY_IGNORED), Timeline(VK_NULL_HANDLE),
+    NextValue(1), SubmittedValue(0), CompletedValue(0) {
+  const auto& allocations = device.getQueueAllocations();
+  if (requestIdx < allocations.size()) {
+    // Another Queue would submit to the same Vulkan queue without holding
+    // this queue's lock, and on another timeline.
+    if (allocations[requestIdx].shared) {
+      util::Assert(false, "Queue is shared with an earlier request, which "
+                          "must be wrapped instead.\n");
+      return;
+    }
+    VulkanQueue = device.getQueue(requestIdx);
+    FamilyIndex = allocations[requestIdx].familyIndex;
+  }
+  createTimeline();
+}
+
+Queue::Queue(const Device& device, QueueType queueType)
+:   Queue(device, findRequest(device, queueType)) {}
+
+Queue::~Queue() {
+  if (Timeline == VK_NULL_HANDLE) return;
+
+  // Submissions which fail to flush never signal the timeline, so only the
+  // ones which were submitted are waited for.
+  flush();
+  wait(getSubmittedValue());
+  Owner.getDispatch().vkDestroySemaphore(Owner.getVkDevice(), Timeline,
+    nullptr);
+}
+
+uint64_t Queue::submit(const VkCommandBuffer* commandBuffers    ,
+                       uint32_t               commandBufferCount,
+                       const SemaphoreWait*   waits             ,
+                       uint32_t               waitCount         ,
+                       VkSemaphore            signal            ) {
+  if (Timeline == VK_NULL_HANDLE) {
+    util::Assert(false, "Submitting to a queue which wasn't created.\n");
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  const auto value = NextValue++;
+  Batch.add(commandBuffers, commandBufferCount, waits, waitCount, signal,
+            value);
+  return value;
+}
+
+uint64_t Queue::flush(VkFence fence) {
+  if (Timeline == VK_NULL_HANDLE) return 0;
+
+  std::lock_guard<std::mutex> lock(Mutex);
+  if (Batch.empty() && fence == VK_NULL_HANDLE)
+    return SubmittedValue.load(std::memory_order_relaxed);
+
+  // The submissions are kept if they fail, so that a later flush can submit
+  // them, and their values are not marked as submitted.
+  const auto& submitInfos = Batch.build(Timeline);
+  const auto  result      = Owner.getDispatch().vkQueueSubmit(VulkanQueue,
+                              static_cast<uint32_t>(submitInfos.size()),
+                              submitInfos.data(), fence);
+  util::AssertSuccess(result, "Failed to submit to queue.\n");
+  if (result != VK_SUCCESS) return 0;
+  Batch.clear();
+
+  SubmittedValue.store(NextValue - 1, std::memory_order_release);
+  return NextValue - 1;
+}
+
+uint64_t Queue::getCompletedValue() const {
+  if (Timeline == VK_NULL_HANDLE) return 0;
+
+  uint64_t   value  = 0;
+  const auto result = Owner.getDispatch().vkGetSemaphoreCounterValueKHR(
+                        Owner.getVkDevice(), Timeline, &value);
+  util::AssertSuccess(result, "Failed to get timeline value.\n");
+  if (result == VK_SUCCESS) raiseTo(CompletedValue, value);
+  return CompletedValue.load(std::memory_order_acquire);
+}
+
+bool Queue::isComplete(uint64_t value) const {
+  return CompletedValue.load(std::memory_order_acquire) >= value ||
+         getCompletedValue() >= value;
+}
+
+bool Queue::wait(uint64_t value) const {
+  if (isComplete(value)) return true;
+
+  // A value which was never submitted would never be signalled.
+  if (value > getSubmittedValue()) {
+    util::Assert(false, "Waiting for a submission which wasn't flushed.\n");
+    return false;
+  }
+
+  VkSemaphoreWaitInfoKHR waitInfo = {};
+  waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores    = &Timeline;
+  waitInfo.pValues        = &value;
+  const auto result = Owner.getDispatch().vkWaitSemaphoresKHR(
+                        Owner.getVkDevice(), &waitInfo, UINT64_MAX);
+  util::AssertSuccess(result, "Failed to wait for timeline value.\n");
+  if (result != VK_SUCCESS) return false;
+  raiseTo(CompletedValue, value);
+  return true;
+}
+
+void Queue::createTimeline() {
+  const auto& dispatch = Owner.getDispatch();
+  util::Assert(VulkanQueue != VK_NULL_HANDLE, "Queue was not allocated.\n");
+  util::Assert(dispatch.vkGetSemaphoreCounterValueKHR != nullptr,
+    "Queue requires VK_KHR_timeline_semaphore.\n");
+  if (VulkanQueue == VK_NULL_HANDLE ||
+      dispatch.vkGetSemaphoreCounterValueKHR == nullptr) {
+    return;
+  }
+
+  VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+  typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+  typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+  typeInfo.initialValue  = 0;
+
+  VkSemaphoreCreateInfo semaphoreInfo = {};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &typeInfo;
+  const auto result = dispatch.vkCreateSemaphore(Owner.getVkDevice(),
+                        &semaphoreInfo, nullptr, &Timeline);
+  util::AssertSuccess(result, "Failed to create timeline semaphore.\n");
+  if (result != VK_SUCCESS) Timeline = VK_NULL_HANDLE;
+}
+
+} // namespace vwrap
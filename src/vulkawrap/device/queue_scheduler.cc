@@ -0,0 +1,293 @@
+//---- src/vulkawrap/device/queue_scheduler.cc ------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  queue_scheduler.cc
+/// \brief Implementation of the queue scheduler.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/queue_scheduler.h"
+#include "vulkawrap/device/device.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+
+namespace vwrap {
+namespace {
+
+/// Returns true if two allocations are the same Vulkan queue.
+///
+/// \param allocations The allocations of the device.
+/// \param a           The index of the first allocation.
+/// \param b           The index of the second allocation.
+bool isSameQueue(const QueueAllocationVec& allocations, size_t a, size_t b) {
+  if (a == b) return true;
+  if (a >= allocations.size() || b >= allocations.size()) return false;
+  return allocations[a].familyIndex == allocations[b].familyIndex &&
+         allocations[a].queueIndex  == allocations[b].queueIndex;
+}
+
+/// Gets the index of the allocation which owns the Vulkan queue of an
+/// allocation, which is the allocation itself unless it is shared.
+///
+/// \param allocations The allocations of the device.
+/// \param requestIdx  The index of the allocation.
+size_t ownerOf(const QueueAllocationVec& allocations, size_t requestIdx) {
+  if (requestIdx >= allocations.size() || !allocations[requestIdx].shared)
+    return requestIdx;
+  for (size_t ownerIdx = 0; ownerIdx < allocations.size(); ++ownerIdx) {
+    if (!allocations[ownerIdx].shared &&
+        isSameQueue(allocations, requestIdx, ownerIdx))
+      return ownerIdx;
+  }
+  return requestIdx;
+}
+
+} // annonymous namespace
+
+//---- Routing --------------------------------------------------------------//
+
+namespace detail {
+
+size_t routeIndex(QueueType queueType) {
+  switch (queueType) {
+    case QueueType::VW_GRAPHICS_QUEUE: return 0;
+    case QueueType::VW_COMPUTE_QUEUE : return 1;
+    case QueueType::VW_TRANSFER_QUEUE: return 2;
+    default:
+      util::Assert(false, "Queue scheduler only routes graphics, compute and "
+                          "transfer work.\n");
+      return 0;
+  }
+}
+
+std::array<size_t, ScheduledQueueCountCx> routeQueues(
+    const QueueAllocationVec& allocations) {
+  const auto noQueue = allocations.size();
+  auto findQueue = [&allocations, noQueue] (QueueType queueType) {
+    for (size_t allocationIdx = 0; allocationIdx < allocations.size();
+         ++allocationIdx) {
+      const auto& allocation = allocations[allocationIdx];
+      if (allocation.familyIndex != VK_QUEUE_FAMILY_IGNORED &&
+          (queueType == QueueType::VW_ANY || allocation.type == queueType))
+        return allocationIdx;
+    }
+    return noQueue;
+  };
+
+  std::array<size_t, ScheduledQueueCountCx> routes;
+  auto& graphics = routes[routeIndex(QueueType::VW_GRAPHICS_QUEUE)];
+  auto& compute  = routes[routeIndex(QueueType::VW_COMPUTE_QUEUE )];
+  auto& transfer = routes[routeIndex(QueueType::VW_TRANSFER_QUEUE)];
+
+  graphics = findQueue(QueueType::VW_GRAPHICS_QUEUE);
+  if (graphics == noQueue) graphics = findQueue(QueueType::VW_ANY);
+  compute  = findQueue(QueueType::VW_COMPUTE_QUEUE);
+  if (compute  == noQueue) compute  = graphics;
+  transfer = findQueue(QueueType::VW_TRANSFER_QUEUE);
+  if (transfer == noQueue) transfer = compute;
+  return routes;
+}
+
+VkSharingMode chooseSharingMode(bool     isImage         ,
+                                uint32_t familyCount     ,
+                                uint32_t handoffsPerFrame) {
+  if (familyCount <= 1) return VK_SHARING_MODE_EXCLUSIVE;
+  if (!isImage || handoffsPerFrame >= ConcurrentImageHandoffsCx)
+    return VK_SHARING_MODE_CONCURRENT;
+  return VK_SHARING_MODE_EXCLUSIVE;
+}
+
+void planHandoff(const QueueHandoff& handoff  ,
+                 uint32_t            srcFamily,
+                 uint32_t            dstFamily,
+                 bool                sameQueue,
+                 HandoffBarrier&     release  ,
+                 HandoffBarrier&     acquire  ) {
+  release = HandoffBarrier{ false, 0, 0, 0, 0, VK_QUEUE_FAMILY_IGNORED,
+                            VK_QUEUE_FAMILY_IGNORED };
+  acquire = release;
+
+  // A barrier needs a source stage, so one which waits for nothing is used
+  // when the source work has no stages.
+  const auto srcStages = handoff.srcStages != 0 ? handoff.srcStages :
+                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+  // The release makes the writes available, and the acquire makes them
+  // visible, and both do the same layout transition, which runs once.
+  if (!sameQueue && srcFamily != dstFamily &&
+      handoff.sharingMode == VK_SHARING_MODE_EXCLUSIVE) {
+    release = HandoffBarrier{ true, srcStages,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, handoff.srcAccess, 0, srcFamily,
+      dstFamily };
+    acquire = HandoffBarrier{ true, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      handoff.dstStages, 0, handoff.dstAccess, srcFamily, dstFamily };
+    return;
+  }
+
+  if (sameQueue) {
+    acquire = HandoffBarrier{ true, srcStages, handoff.dstStages,
+      handoff.srcAccess, handoff.dstAccess, VK_QUEUE_FAMILY_IGNORED,
+      VK_QUEUE_FAMILY_IGNORED };
+    return;
+  }
+
+  // The semaphore wait makes the writes visible to the waiting stages, so
+  // the transition only has to wait for those stages.
+  if (handoff.oldLayout != handoff.newLayout) {
+    acquire = HandoffBarrier{ true, handoff.dstStages, handoff.dstStages, 0,
+      handoff.dstAccess, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED };
+  }
+}
+
+} // namespace detail
+
+//---- Public ---------------------------------------------------------------//
+
+QueueScheduler::QueueScheduler(const Device& device)
+:   Owner(device), Routes{} {
+  const auto& allocations = device.getQueueAllocations();
+  const auto  routes      = detail::routeQueues(allocations);
+  if (routes[0] >= allocations.size()) {
+    util::Assert(false, "Queue scheduler device has no queues.\n");
+    return;
+  }
+
+  // Types of work which are routed to the same Vulkan queue share a Queue,
+  // since only one Queue may submit to each Vulkan queue.
+  std::vector<size_t> queueRequests;
+  for (size_t routeIdx = 0; routeIdx < routes.size(); ++routeIdx) {
+    const auto requestIdx = routes[routeIdx];
+    const auto existing   = std::find_if(queueRequests.begin(),
+      queueRequests.end(), [&] (size_t other) {
+        return isSameQueue(allocations, requestIdx, other);
+      });
+    if (existing != queueRequests.end()) {
+      Routes[routeIdx] = Queues[existing - queueRequests.begin()].get();
+      continue;
+    }
+
+    Queues.push_back(std::make_unique<Queue>(device,
+                       ownerOf(allocations, requestIdx)));
+    queueRequests.push_back(requestIdx);
+    Routes[routeIdx] = Queues.back().get();
+
+    const auto family = Queues.back()->getFamilyIndex();
+    if (family != VK_QUEUE_FAMILY_IGNORED &&
+        std::find(Families.begin(), Families.end(), family) == Families.end())
+      Families.push_back(family);
+  }
+}
+
+uint64_t QueueScheduler::submitAfter(QueueType            queueType    ,
+                                     VkCommandBuffer      commandBuffer,
+                                     QueueType            waitType     ,
+                                     uint64_t             waitValue    ,
+                                     VkPipelineStageFlags waitStages   ) {
+  auto& queue     = getQueue(queueType);
+  auto& waitQueue = getQueue(waitType);
+  if (&queue == &waitQueue) return queue.submit(commandBuffer);
+
+  const auto wait = waitQueue.waitPoint(waitValue, waitStages);
+  return queue.submit(&commandBuffer, 1, &wait, 1);
+}
+
+void QueueScheduler::flush() {
+  // The queues were created in route order, so the graphics queue is last.
+  for (auto queue = Queues.rbegin(); queue != Queues.rend(); ++queue)
+    (*queue)->flush();
+}
+
+void QueueScheduler::releaseImage(VkCommandBuffer     commandBuffer,
+                                  const QueueHandoff& handoff      ,
+                                  VkImage             image        ,
+                                  VkImageAspectFlags  aspects      ) const {
+  HandoffBarrier release, acquire;
+  plan(handoff, release, acquire);
+  if (release.record)
+    recordImage(commandBuffer, handoff, release, image, aspects);
+}
+
+void QueueScheduler::acquireImage(VkCommandBuffer     commandBuffer,
+                                  const QueueHandoff& handoff      ,
+                                  VkImage             image        ,
+                                  VkImageAspectFlags  aspects      ) const {
+  HandoffBarrier release, acquire;
+  plan(handoff, release, acquire);
+  if (acquire.record)
+    recordImage(commandBuffer, handoff, acquire, image, aspects);
+}
+
+void QueueScheduler::releaseBuffer(VkCommandBuffer     commandBuffer,
+                                   const QueueHandoff& handoff      ,
+                                   VkBuffer            buffer       ) const {
+  HandoffBarrier release, acquire;
+  plan(handoff, release, acquire);
+  if (release.record) recordBuffer(commandBuffer, release, buffer);
+}
+
+void QueueScheduler::acquireBuffer(VkCommandBuffer     commandBuffer,
+                                   const QueueHandoff& handoff      ,
+                                   VkBuffer            buffer       ) const {
+  HandoffBarrier release, acquire;
+  plan(handoff, release, acquire);
+  if (acquire.record) recordBuffer(commandBuffer, acquire, buffer);
+}
+
+//---- Private --------------------------------------------------------------//
+
+void QueueScheduler::plan(const QueueHandoff& handoff,
+                          HandoffBarrier&     release,
+                          HandoffBarrier&     acquire) const {
+  const auto& srcQueue = getQueue(handoff.srcType);
+  const auto& dstQueue = getQueue(handoff.dstType);
+  detail::planHandoff(handoff, srcQueue.getFamilyIndex(),
+    dstQueue.getFamilyIndex(), &srcQueue == &dstQueue, release, acquire);
+}
+
+void QueueScheduler::recordImage(VkCommandBuffer       commandBuffer,
+                                 const QueueHandoff&   handoff      ,
+                                 const HandoffBarrier& barrier      ,
+                                 VkImage               image        ,
+                                 VkImageAspectFlags    aspects      ) const {
+  VkImageMemoryBarrier imageBarrier = {};
+  imageBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  imageBarrier.srcAccessMask       = barrier.srcAccess;
+  imageBarrier.dstAccessMask       = barrier.dstAccess;
+  imageBarrier.oldLayout           = handoff.oldLayout;
+  imageBarrier.newLayout           = handoff.newLayout;
+  imageBarrier.srcQueueFamilyIndex = barrier.srcFamily;
+  imageBarrier.dstQueueFamilyIndex = barrier.dstFamily;
+  imageBarrier.image               = image;
+  imageBarrier.subresourceRange    = { aspects, 0, VK_REMAINING_MIP_LEVELS, 0,
+                                       VK_REMAINING_ARRAY_LAYERS };
+
+  Owner.getDispatch().vkCmdPipelineBarrier(commandBuffer, barrier.srcStages,
+    barrier.dstStages, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+}
+
+void QueueScheduler::recordBuffer(VkCommandBuffer       commandBuffer,
+                                  const HandoffBarrier& barrier      ,
+                                  VkBuffer              buffer       ) const {
+  VkBufferMemoryBarrier bufferBarrier = {};
+  bufferBarrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  bufferBarrier.srcAccessMask       = barrier.srcAccess;
+  bufferBarrier.dstAccessMask       = barrier.dstAccess;
+  bufferBarrier.srcQueueFamilyIndex = barrier.srcFamily;
+  bufferBarrier.dstQueueFamilyIndex = barrier.dstFamily;
+  bufferBarrier.buffer              = buffer;
+  bufferBarrier.offset              = 0;
+  bufferBarrier.size                = VK_WHOLE_SIZE;
+
+  Owner.getDispatch().vkCmdPipelineBarrier(commandBuffer, barrier.srcStages,
+    barrier.dstStages, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+} // namespace vwrap
@@ -0,0 +1,286 @@
+//---- src/vulkawrap/device/render_pass_cache.cc ----------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  render_pass_cache.cc
+/// \brief Implementation of the render pass cache.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/render_pass_cache.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+
+namespace vwrap {
+namespace {
+
+/// Appends the signature of a list of attachment references.
+///
+/// \param references The references to append.
+/// \param signature  The signature to append to.
+void appendReferences(const std::vector<VkAttachmentReference>& references,
+                      util::Signature&                          signature ) {
+  signature.push_back(references.size());
+  for (const auto& reference : references) {
+    signature.push_back(reference.attachment);
+    signature.push_back(reference.layout);
+  }
+}
+
+/// Gets a pointer to the data of a list, or nullptr if it is empty.
+///
+/// \param list The list to get the data of.
+/// \tparam T   The type of the elements.
+template <typename T>
+const T* dataOrNull(const std::vector<T>& list) {
+  return list.empty() ? nullptr : list.data();
+}
+
+} // annonymous namespace
+
+//---- Signatures -----------------------------------------------------------//
+
+namespace detail {
+
+void appendSignature(const RenderPassDescription& description,
+                     util::Signature&             signature  ) {
+  signature.push_back(description.attachments.size());
+  for (const auto& attachment : description.attachments) {
+    signature.push_back(attachment.flags);
+    signature.push_back(attachment.format);
+    signature.push_back(attachment.samples);
+    signature.push_back(attachment.loadOp);
+    signature.push_back(attachment.storeOp);
+    signature.push_back(attachment.stencilLoadOp);
+    signature.push_back(attachment.stencilStoreOp);
+    signature.push_back(attachment.initialLayout);
+    signature.push_back(attachment.finalLayout);
+  }
+
+  signature.push_back(description.subpasses.size());
+  for (const auto& subpass : description.subpasses) {
+    appendReferences(subpass.inputs  , signature);
+    appendReferences(subpass.colors  , signature);
+    appendReferences(subpass.resolves, signature);
+    signature.push_back(subpass.depthStencil.attachment);
+    signature.push_back(subpass.depthStencil.layout);
+    signature.push_back(subpass.preserves.size());
+    signature.insert(signature.end(), subpass.preserves.begin(),
+                     subpass.preserves.end());
+  }
+
+  signature.push_back(description.dependencies.size());
+  for (const auto& dependency : description.dependencies) {
+    signature.push_back(dependency.srcSubpass);
+    signature.push_back(dependency.dstSubpass);
+    signature.push_back(dependency.srcStageMask);
+    signature.push_back(dependency.dstStageMask);
+    signature.push_back(dependency.srcAccessMask);
+    signature.push_back(dependency.dstAccessMask);
+    signature.push_back(dependency.dependencyFlags);
+  }
+}
+
+void appendSignature(const FramebufferDescription& description,
+                     util::Signature&              signature  ) {
+  signature.push_back(util::toWord(description.renderPass));
+  signature.push_back(description.width);
+  signature.push_back(description.height);
+  signature.push_back(description.layers);
+  signature.push_back(description.attachments.size());
+  for (const auto view : description.attachments)
+    signature.push_back(util::toWord(view));
+}
+
+} // namespace detail
+
+//---- Cache ----------------------------------------------------------------//
+
+struct RenderPassCache::ThreadObjects {
+  uint64_t        epoch;         //!< The epoch of the framebuffers.
+  RenderPassMap   renderPasses;  //!< The render passes the thread has used.
+  FramebufferMap  framebuffers;  //!< The framebuffers the thread has used.
+  util::Signature signature;     //!< Signature scratch.
+};
+
+//---- Public ---------------------------------------------------------------//
+
+RenderPassCache::RenderPassCache(const loader::DeviceDispatch& dispatch)
+:   Dispatch(dispatch), Epoch(0) {}
+
+RenderPassCache::~RenderPassCache() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  for (const auto& entry : Framebuffers) {
+    Dispatch.vkDestroyFramebuffer(Dispatch.device, entry.second.framebuffer,
+      nullptr);
+  }
+  for (const auto& entry : RenderPasses)
+    Dispatch.vkDestroyRenderPass(Dispatch.device, entry.second, nullptr);
+}
+
+VkRenderPass RenderPassCache::getRenderPass(
+    const RenderPassDescription& description) {
+  auto& thread = getThreadObjects();
+  thread.signature.clear();
+  detail::appendSignature(description, thread.signature);
+  const auto known = thread.renderPasses.find(thread.signature);
+  if (known != thread.renderPasses.end()) return known->second;
+
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  {
+    // Creating the render pass with the lock held means that threads which
+    // ask for it at the same time never create it twice.
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto cached = RenderPasses.find(thread.signature);
+    if (cached != RenderPasses.end()) {
+      renderPass = cached->second;
+    } else {
+      renderPass = create(description);
+      if (renderPass == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+      RenderPasses.emplace(thread.signature, renderPass);
+    }
+  }
+  thread.renderPasses.emplace(thread.signature, renderPass);
+  return renderPass;
+}
+
+VkFramebuffer RenderPassCache::getFramebuffer(
+    const FramebufferDescription& description) {
+  auto&      thread = getThreadObjects();
+  const auto epoch  = Epoch.load(std::memory_order_acquire);
+  if (thread.epoch != epoch) {
+    thread.framebuffers.clear();
+    thread.epoch = epoch;
+  }
+
+  thread.signature.clear();
+  detail::appendSignature(description, thread.signature);
+  const auto known = thread.framebuffers.find(thread.signature);
+  if (known != thread.framebuffers.end()) return known->second.framebuffer;
+
+  VkFramebuffer framebuffer = VK_NULL_HANDLE;
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto cached = Framebuffers.find(thread.signature);
+    if (cached != Framebuffers.end()) {
+      framebuffer = cached->second.framebuffer;
+    } else {
+      framebuffer = create(description);
+      if (framebuffer == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+      Framebuffers.emplace(thread.signature,
+        FramebufferEntry{ framebuffer, description.attachments });
+    }
+  }
+
+  // The thread's own entry doesn't need the views, since eviction clears
+  // all of the thread's framebuffers.
+  thread.framebuffers.emplace(thread.signature,
+    FramebufferEntry{ framebuffer, std::vector<VkImageView>() });
+  return framebuffer;
+}
+
+void RenderPassCache::evictImageView(VkImageView imageView) {
+  std::lock_guard<std::mutex> lock(Mutex);
+  bool evicted = false;
+  for (auto entry = Framebuffers.begin(); entry != Framebuffers.end(); ) {
+    const auto& views = entry->second.views;
+    if (std::find(views.begin(), views.end(), imageView) == views.end()) {
+      ++entry;
+      continue;
+    }
+    Dispatch.vkDestroyFramebuffer(Dispatch.device, entry->second.framebuffer,
+      nullptr);
+    entry   = Framebuffers.erase(entry);
+    evicted = true;
+  }
+
+  // Threads drop the framebuffers they know of the next time they look one
+  // up, so none of them can find an evicted framebuffer.
+  if (evicted) Epoch.fetch_add(1, std::memory_order_release);
+}
+
+size_t RenderPassCache::getRenderPassCount() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  return RenderPasses.size();
+}
+
+size_t RenderPassCache::getFramebufferCount() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  return Framebuffers.size();
+}
+
+//---- Private --------------------------------------------------------------//
+
+RenderPassCache::ThreadObjects& RenderPassCache::getThreadObjects() {
+  return Threads.get([this] (ThreadObjects& thread) {
+    thread.epoch = Epoch.load(std::memory_order_acquire);
+  });
+}
+
+VkRenderPass RenderPassCache::create(
+    const RenderPassDescription& description) const {
+  std::vector<VkSubpassDescription> subpasses(description.subpasses.size());
+  for (size_t subpassIdx = 0; subpassIdx < subpasses.size(); ++subpassIdx) {
+    const auto& source  = description.subpasses[subpassIdx];
+    auto&       subpass = subpasses[subpassIdx];
+    subpass                      = {};
+    subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.inputAttachmentCount =
+      static_cast<uint32_t>(source.inputs.size());
+    subpass.pInputAttachments    = dataOrNull(source.inputs);
+    subpass.colorAttachmentCount =
+      static_cast<uint32_t>(source.colors.size());
+    subpass.pColorAttachments    = dataOrNull(source.colors);
+    subpass.pResolveAttachments  = dataOrNull(source.resolves);
+    if (source.depthStencil.attachment != VK_ATTACHMENT_UNUSED)
+      subpass.pDepthStencilAttachment = &source.depthStencil;
+    subpass.preserveAttachmentCount =
+      static_cast<uint32_t>(source.preserves.size());
+    subpass.pPreserveAttachments    = dataOrNull(source.preserves);
+  }
+
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount =
+    static_cast<uint32_t>(description.attachments.size());
+  renderPassInfo.pAttachments    = dataOrNull(description.attachments);
+  renderPassInfo.subpassCount    = static_cast<uint32_t>(subpasses.size());
+  renderPassInfo.pSubpasses      = dataOrNull(subpasses);
+  renderPassInfo.dependencyCount =
+    static_cast<uint32_t>(description.dependencies.size());
+  renderPassInfo.pDependencies   = dataOrNull(description.dependencies);
+
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  const auto result = Dispatch.vkCreateRenderPass(Dispatch.device,
+                        &renderPassInfo, nullptr, &renderPass);
+  util::AssertSuccess(result, "Failed to create render pass.\n");
+  return result == VK_SUCCESS ? renderPass : VK_NULL_HANDLE;
+}
+
+VkFramebuffer RenderPassCache::create(
+    const FramebufferDescription& description) const {
+  VkFramebufferCreateInfo framebufferInfo = {};
+  framebufferInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass      = description.renderPass;
+  framebufferInfo.attachmentCount =
+    static_cast<uint32_t>(description.attachments.size());
+  framebufferInfo.pAttachments    = dataOrNull(description.attachments);
+  framebufferInfo.width           = description.width;
+  framebufferInfo.height          = description.height;
+  framebufferInfo.layers          = description.layers;
+
+  VkFramebuffer framebuffer = VK_NULL_HANDLE;
+  const auto result = Dispatch.vkCreateFramebuffer(Dispatch.device,
+                        &framebufferInfo, nullptr, &framebuffer);
+  util::AssertSuccess(result, "Failed to create framebuffer.\n");
+  return result == VK_SUCCESS ? framebuffer : VK_NULL_HANDLE;
+}
+
+} // namespace vwrap
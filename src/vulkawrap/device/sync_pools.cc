@@ -0,0 +1,89 @@
+//---- src/vulkawrap/device/sync_pools.cc ------------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  sync_pools.cc
+/// \brief Implementation of the traits of the synchronization object pools.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/device/sync_pools.h"
+#include "vulkawrap/util/assert.hpp"
+
+namespace vwrap  {
+namespace detail {
+
+//---- Fences ---------------------------------------------------------------//
+
+VkFence FenceTraits::create(const loader::DeviceDispatch& dispatch) {
+  VkFenceCreateInfo createInfo = {};
+  createInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+  VkFence fence = VK_NULL_HANDLE;
+  const auto result = dispatch.vkCreateFence(dispatch.device, &createInfo,
+                        nullptr, &fence);
+  util::AssertSuccess(result, "Failed to create fence.\n");
+  return fence;
+}
+
+void FenceTraits::reset(const loader::DeviceDispatch& dispatch,
+                        const VkFence* fences, uint32_t count) {
+  dispatch.vkResetFences(dispatch.device, count, fences);
+}
+
+void FenceTraits::destroy(const loader::DeviceDispatch& dispatch,
+                          VkFence                       fence   ) {
+  dispatch.vkDestroyFence(dispatch.device, fence, nullptr);
+}
+
+//---- Semaphores -----------------------------------------------------------//
+
+VkSemaphore SemaphoreTraits::create(const loader::DeviceDispatch& dispatch) {
+  VkSemaphoreCreateInfo createInfo = {};
+  createInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  VkSemaphore semaphore = VK_NULL_HANDLE;
+  const auto result = dispatch.vkCreateSemaphore(dispatch.device, &createInfo,
+                        nullptr, &semaphore);
+  util::AssertSuccess(result, "Failed to create semaphore.\n");
+  return semaphore;
+}
+
+void SemaphoreTraits::destroy(const loader::DeviceDispatch& dispatch ,
+                              VkSemaphore                   semaphore) {
+  dispatch.vkDestroySemaphore(dispatch.device, semaphore, nullptr);
+}
+
+//---- Events ---------------------------------------------------------------//
+
+VkEvent EventTraits::create(const loader::DeviceDispatch& dispatch) {
+  VkEventCreateInfo createInfo = {};
+  createInfo.sType             = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO;
+
+  VkEvent event = VK_NULL_HANDLE;
+  const auto result = dispatch.vkCreateEvent(dispatch.device, &createInfo,
+                        nullptr, &event);
+  util::AssertSuccess(result, "Failed to create event.\n");
+  return event;
+}
+
+void EventTraits::reset(const loader::DeviceDispatch& dispatch,
+                        const VkEvent* events, uint32_t count) {
+  for (uint32_t eventIdx = 0; eventIdx < count; ++eventIdx)
+    dispatch.vkResetEvent(dispatch.device, events[eventIdx]);
+}
+
+void EventTraits::destroy(const loader::DeviceDispatch& dispatch,
+                          VkEvent                       event   ) {
+  dispatch.vkDestroyEvent(dispatch.device, event, nullptr);
+}
+
+} // namespace detail
+} // namespace vwrap
@@ -0,0 +1,496 @@
+//---- src/vulkawrap/graph/render_graph.cc ----------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  render_graph.cc
+/// \brief Implementation of the render graph.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/graph/render_graph.h"
+#include "vulkawrap/memory/sub_allocators.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+
+namespace vwrap {
+namespace {
+
+/// The access flags which write memory. Only writes need to be made
+/// available, reads only need to wait.
+static constexpr VkAccessFlags WriteAccessCx =
+  VK_ACCESS_SHADER_WRITE_BIT                  |
+  VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT        |
+  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|
+  VK_ACCESS_TRANSFER_WRITE_BIT                |
+  VK_ACCESS_HOST_WRITE_BIT                    |
+  VK_ACCESS_MEMORY_WRITE_BIT;
+
+/// The synchronisation state of a resource, as the passes are walked in
+/// order.
+struct ResourceState {
+  VkImageLayout        layout;         //!< The current layout of an image.
+  VkPipelineStageFlags writeStages;    //!< The stages of the last write.
+  VkAccessFlags        writeAccess;    //!< The accesses of the last write.
+  VkPipelineStageFlags readStages;     //!< Stages which read since the write.
+  VkPipelineStageFlags visibleStages;  //!< Stages the write is visible to.
+  VkAccessFlags        visibleAccess;  //!< Accesses the write is visible to.
+};
+
+/// Returns true if two ranges of memory overlap.
+///
+/// \param offsetA The offset of the first range.
+/// \param sizeA   The size of the first range.
+/// \param offsetB The offset of the second range.
+/// \param sizeB   The size of the second range.
+bool overlaps(VkDeviceSize offsetA, VkDeviceSize sizeA,
+              VkDeviceSize offsetB, VkDeviceSize sizeB) {
+  return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+}
+
+/// Adds a dependency to a list, if it is not already in it.
+///
+/// \param dependencies The list of dependencies.
+/// \param pass         The pass which is depended on.
+void addDependency(std::vector<uint32_t>& dependencies, uint32_t pass) {
+  if (std::find(dependencies.begin(), dependencies.end(), pass) ==
+      dependencies.end()) {
+    dependencies.push_back(pass);
+  }
+}
+
+} // annonymous namespace
+
+//---- Public ---------------------------------------------------------------//
+
+uint32_t RenderGraph::createImage(const std::string& name     ,
+                                  VkImageAspectFlags aspects  ,
+                                  VkDeviceSize       size     ,
+                                  VkDeviceSize       alignment) {
+  return addResource(Resource{ name, true, false, aspects,
+    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, size, alignment,
+    VK_NULL_HANDLE });
+}
+
+uint32_t RenderGraph::createBuffer(const std::string& name     ,
+                                   VkDeviceSize       size     ,
+                                   VkDeviceSize       alignment) {
+  return addResource(Resource{ name, false, false, 0,
+    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, size, alignment,
+    VK_NULL_HANDLE });
+}
+
+uint32_t RenderGraph::importImage(const std::string& name         ,
+                                  VkImageAspectFlags aspects      ,
+                                  VkImageLayout      initialLayout,
+                                  VkImageLayout      finalLayout  ) {
+  return addResource(Resource{ name, true, true, aspects, initialLayout,
+    finalLayout, 0, 1, VK_NULL_HANDLE });
+}
+
+uint32_t RenderGraph::importBuffer(const std::string& name) {
+  return addResource(Resource{ name, false, true, 0,
+    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, 0, 1,
+    VK_NULL_HANDLE });
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, PassFunction function) {
+  Passes.push_back(Pass{ name, std::move(function),
+                         std::vector<ResourceUse>() });
+  return static_cast<uint32_t>(Passes.size() - 1);
+}
+
+void RenderGraph::read(uint32_t             pass    ,
+                       uint32_t             resource,
+                       VkPipelineStageFlags stages  ,
+                       VkAccessFlags        access  ,
+                       VkImageLayout        layout  ) {
+  addUse(pass, ResourceUse{ resource, stages, access, layout, true, false });
+}
+
+void RenderGraph::write(uint32_t             pass    ,
+                        uint32_t             resource,
+                        VkPipelineStageFlags stages  ,
+                        VkAccessFlags        access  ,
+                        VkImageLayout        layout  ) {
+  addUse(pass, ResourceUse{ resource, stages, access, layout, false, true });
+}
+
+void RenderGraph::compile() {
+  Plan = RenderGraphPlan();
+  std::vector<bool> needed;
+  const auto dependencies = findDependencies(needed);
+  orderPasses(dependencies, needed);
+  placeResources();
+  buildBarriers();
+}
+
+void RenderGraph::record(const loader::DeviceDispatch& dispatch     ,
+                         VkCommandBuffer               commandBuffer) const {
+  for (size_t orderIdx = 0; orderIdx < Plan.order.size(); ++orderIdx) {
+    recordBarriers(dispatch, commandBuffer, Plan.barriers[orderIdx]);
+    const auto& pass = Passes[Plan.order[orderIdx]];
+    if (pass.function) pass.function(commandBuffer);
+  }
+  recordBarriers(dispatch, commandBuffer, Plan.finalBarriers);
+}
+
+//---- Private --------------------------------------------------------------//
+
+uint32_t RenderGraph::addResource(Resource&& resource) {
+  Resources.push_back(std::move(resource));
+  return static_cast<uint32_t>(Resources.size() - 1);
+}
+
+void RenderGraph::addUse(uint32_t pass, const ResourceUse& use) {
+  if (pass >= Passes.size() || use.resource >= Resources.size()) {
+    util::Assert(false, "Render graph pass or resource doesn't exist.\n");
+    return;
+  }
+  util::Assert(!Resources[use.resource].isImage ||
+               use.layout != VK_IMAGE_LAYOUT_UNDEFINED,
+               "Render graph images must be used in a layout.\n");
+
+  // A pass which uses a resource more than once uses it once, with all the
+  // stages and accesses, since there can't be a barrier inside the pass.
+  auto& uses = Passes[pass].uses;
+  for (auto& other : uses) {
+    if (other.resource != use.resource) continue;
+    util::Assert(other.layout == use.layout,
+                 "Render graph pass uses an image in two layouts.\n");
+    other.stages |= use.stages;
+    other.access |= use.access;
+    other.reads  |= use.reads;
+    other.writes |= use.writes;
+    return;
+  }
+  uses.push_back(use);
+}
+
+std::vector<std::vector<uint32_t>> RenderGraph::findDependencies(
+    std::vector<bool>& needed) const {
+  const auto passCount = Passes.size();
+  std::vector<std::vector<uint32_t>> dependencies(passCount);
+  std::vector<std::vector<uint32_t>> producers(passCount);
+
+  // Passes can only use what earlier passes have written, so walking the
+  // passes in the order they were added finds every dependency.
+  std::vector<uint32_t>              lastWriters(Resources.size(),
+                                                 InvalidGraphIdCx);
+  std::vector<std::vector<uint32_t>> readers(Resources.size());
+  for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx) {
+    for (const auto& use : Passes[passIdx].uses) {
+      const auto writer = lastWriters[use.resource];
+      auto&      reads  = readers[use.resource];
+      if (writer != InvalidGraphIdCx) {
+        addDependency(dependencies[passIdx], writer);
+        if (use.reads) addDependency(producers[passIdx], writer);
+      }
+      if (!use.writes) {
+        reads.push_back(passIdx);
+        continue;
+      }
+      for (const auto reader : reads) {
+        if (reader != passIdx) addDependency(dependencies[passIdx], reader);
+      }
+      reads.clear();
+      lastWriters[use.resource] = passIdx;
+    }
+  }
+
+  // Passes which write imported resources are needed, and so are the passes
+  // which produce what needed passes read.
+  needed.assign(passCount, false);
+  std::vector<uint32_t> unvisited;
+  for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx) {
+    for (const auto& use : Passes[passIdx].uses) {
+      if (use.writes && Resources[use.resource].imported) {
+        needed[passIdx] = true;
+        unvisited.push_back(passIdx);
+        break;
+      }
+    }
+  }
+  while (!unvisited.empty()) {
+    const auto passIdx = unvisited.back();
+    unvisited.pop_back();
+    for (const auto producer : producers[passIdx]) {
+      if (needed[producer]) continue;
+      needed[producer] = true;
+      unvisited.push_back(producer);
+    }
+  }
+
+  for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx) {
+    auto& passDependencies = dependencies[passIdx];
+    if (!needed[passIdx]) {
+      passDependencies.clear();
+      continue;
+    }
+    passDependencies.erase(std::remove_if(passDependencies.begin(),
+      passDependencies.end(), [&needed] (uint32_t dependency) {
+        return !needed[dependency];
+      }), passDependencies.end());
+  }
+  return dependencies;
+}
+
+void RenderGraph::orderPasses(
+    const std::vector<std::vector<uint32_t>>& dependencies,
+    const std::vector<bool>&                  needed      ) {
+  const auto passCount = Passes.size();
+  std::vector<uint32_t> positions(passCount, InvalidGraphIdCx);
+  const auto neededCount = static_cast<size_t>(
+    std::count(needed.begin(), needed.end(), true));
+
+  // Of the passes which are ready, the one whose dependencies finished
+  // earliest goes next, which puts independent work between a pass and the
+  // passes which wait for it. Ties keep the order the passes were added in.
+  while (Plan.order.size() < neededCount) {
+    uint32_t nextPass   = InvalidGraphIdCx;
+    int64_t  nextLatest = 0;
+    for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx) {
+      if (!needed[passIdx] || positions[passIdx] != InvalidGraphIdCx)
+        continue;
+
+      bool    ready  = true;
+      int64_t latest = -1;
+      for (const auto dependency : dependencies[passIdx]) {
+        if (positions[dependency] == InvalidGraphIdCx) {
+          ready = false;
+          break;
+        }
+        latest = std::max(latest, static_cast<int64_t>(positions[dependency]));
+      }
+      if (ready && (nextPass == InvalidGraphIdCx || latest < nextLatest)) {
+        nextPass   = passIdx;
+        nextLatest = latest;
+      }
+    }
+
+    positions[nextPass] = static_cast<uint32_t>(Plan.order.size());
+    Plan.order.push_back(nextPass);
+  }
+}
+
+void RenderGraph::placeResources() {
+  auto& placements = Plan.placements;
+  placements.assign(Resources.size(), ResourcePlacement());
+  for (uint32_t orderIdx = 0; orderIdx < Plan.order.size(); ++orderIdx) {
+    for (const auto& use : Passes[Plan.order[orderIdx]].uses) {
+      auto& placement = placements[use.resource];
+      if (!placement.used()) placement.firstPass = orderIdx;
+      placement.lastPass = orderIdx;
+    }
+  }
+
+  std::vector<uint32_t> transients;
+  for (uint32_t resourceIdx = 0; resourceIdx < Resources.size();
+       ++resourceIdx) {
+    if (!Resources[resourceIdx].imported && placements[resourceIdx].used())
+      transients.push_back(resourceIdx);
+  }
+
+  // Placing the largest resources first packs the memory more tightly. Each
+  // resource goes at the lowest offset where it doesn't overlap a resource
+  // which is alive at the same time.
+  std::stable_sort(transients.begin(), transients.end(),
+    [this] (uint32_t a, uint32_t b) {
+      return Resources[a].size > Resources[b].size;
+    });
+
+  std::vector<uint32_t> placed;
+  for (const auto resourceIdx : transients) {
+    const auto& resource  = Resources[resourceIdx];
+    auto&       placement = placements[resourceIdx];
+
+    std::vector<uint32_t> alive;
+    std::vector<VkDeviceSize> candidates(1, 0);
+    for (const auto other : placed) {
+      const auto& otherPlacement = placements[other];
+      if (otherPlacement.lastPass  < placement.firstPass ||
+          otherPlacement.firstPass > placement.lastPass)
+        continue;
+      alive.push_back(other);
+      candidates.push_back(alignUp(
+        otherPlacement.offset + Resources[other].size, resource.alignment));
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto offset : candidates) {
+      const bool fits = std::none_of(alive.begin(), alive.end(),
+        [&] (uint32_t other) {
+          return overlaps(offset, resource.size, placements[other].offset,
+                          Resources[other].size);
+        });
+      if (!fits) continue;
+      placement.offset = offset;
+      break;
+    }
+
+    placed.push_back(resourceIdx);
+    Plan.transientSize = std::max(Plan.transientSize,
+                                  placement.offset + resource.size);
+  }
+}
+
+void RenderGraph::buildBarriers() {
+  const auto& placements = Plan.placements;
+  std::vector<ResourceState> states(Resources.size());
+  for (size_t resourceIdx = 0; resourceIdx < Resources.size(); ++resourceIdx)
+    states[resourceIdx] = { Resources[resourceIdx].initialLayout, 0, 0, 0, 0,
+                            0 };
+
+  // The transient resources which used the same memory before each transient
+  // resource, whose last uses must finish before it is first used.
+  std::vector<std::vector<uint32_t>> aliases(Resources.size());
+  for (uint32_t resourceIdx = 0; resourceIdx < Resources.size();
+       ++resourceIdx) {
+    const auto& placement = placements[resourceIdx];
+    if (Resources[resourceIdx].imported || !placement.used()) continue;
+    for (uint32_t otherIdx = 0; otherIdx < Resources.size(); ++otherIdx) {
+      const auto& other = placements[otherIdx];
+      if (Resources[otherIdx].imported || !other.used() ||
+          other.lastPass >= placement.firstPass)
+        continue;
+      if (overlaps(placement.offset, Resources[resourceIdx].size,
+                   other.offset    , Resources[otherIdx].size   ))
+        aliases[resourceIdx].push_back(otherIdx);
+    }
+  }
+
+  Plan.barriers.resize(Plan.order.size());
+  for (uint32_t orderIdx = 0; orderIdx < Plan.order.size(); ++orderIdx) {
+    auto& batch = Plan.barriers[orderIdx];
+    for (const auto& use : Passes[Plan.order[orderIdx]].uses) {
+      const auto& resource = Resources[use.resource];
+      auto&       state    = states[use.resource];
+
+      VkPipelineStageFlags srcStages = 0;
+      VkAccessFlags        srcAccess = 0;
+      if (placements[use.resource].firstPass == orderIdx) {
+        for (const auto alias : aliases[use.resource]) {
+          srcStages |= states[alias].readStages | states[alias].writeStages;
+          srcAccess |= states[alias].writeAccess;
+        }
+      }
+
+      // Writes and layout transitions must wait for all earlier accesses,
+      // while reads only wait for a write which isn't visible to them yet.
+      const bool transition = resource.isImage && use.layout != state.layout;
+      if (transition || use.writes) {
+        srcStages |= state.readStages | state.writeStages;
+        srcAccess |= state.writeAccess;
+      } else if (state.writeStages != 0 &&
+                 ((use.stages & ~state.visibleStages) != 0 ||
+                  (use.access & ~state.visibleAccess) != 0)) {
+        srcStages |= state.writeStages;
+        srcAccess |= state.writeAccess;
+      }
+
+      if (transition) {
+        batch.images.push_back(BarrierBatch::ImageTransition{ use.resource,
+          srcAccess, use.access, state.layout, use.layout });
+        batch.srcStages |= srcStages;
+        batch.dstStages |= use.stages;
+      } else if (srcStages != 0 || srcAccess != 0) {
+        batch.srcStages |= srcStages;
+        batch.dstStages |= use.stages;
+        if (srcAccess != 0) {
+          batch.srcAccess |= srcAccess;
+          batch.dstAccess |= use.access;
+        }
+      }
+
+      state.layout = resource.isImage ? use.layout : state.layout;
+      if (use.writes) {
+        state.writeStages   = use.stages;
+        state.writeAccess   = use.access & WriteAccessCx;
+        state.readStages    = 0;
+        state.visibleStages = 0;
+        state.visibleAccess = 0;
+        continue;
+      }
+      if (transition) {
+        // The transition is a write which is visible to this use.
+        state.writeStages   = use.stages;
+        state.writeAccess   = 0;
+        state.visibleStages = 0;
+        state.visibleAccess = 0;
+      }
+      if (srcStages != 0 || transition) {
+        state.visibleStages |= use.stages;
+        state.visibleAccess |= use.access;
+      }
+      state.readStages |= use.stages;
+    }
+
+    if (batch.empty()) continue;
+    if (batch.srcStages == 0)
+      batch.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  }
+
+  // Imported images are left in the layout which the code outside the graph
+  // expects them in.
+  auto& finalBatch = Plan.finalBarriers;
+  for (uint32_t resourceIdx = 0; resourceIdx < Resources.size();
+       ++resourceIdx) {
+    const auto& resource = Resources[resourceIdx];
+    const auto& state    = states[resourceIdx];
+    if (!resource.imported || !resource.isImage                  ||
+        resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED        ||
+        resource.finalLayout == state.layout)
+      continue;
+
+    finalBatch.images.push_back(BarrierBatch::ImageTransition{ resourceIdx,
+      state.writeAccess, 0, state.layout, resource.finalLayout });
+    finalBatch.srcStages |= state.readStages | state.writeStages;
+    finalBatch.dstStages  = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+  }
+  if (!finalBatch.empty() && finalBatch.srcStages == 0)
+    finalBatch.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+}
+
+void RenderGraph::recordBarriers(const loader::DeviceDispatch& dispatch     ,
+                                 VkCommandBuffer               commandBuffer,
+                                 const BarrierBatch&           batch        )
+    const {
+  if (batch.empty()) return;
+
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = batch.srcAccess;
+  memoryBarrier.dstAccessMask = batch.dstAccess;
+  const bool hasMemoryBarrier = batch.srcAccess != 0;
+
+  std::vector<VkImageMemoryBarrier> imageBarriers(batch.images.size());
+  for (size_t imageIdx = 0; imageIdx < imageBarriers.size(); ++imageIdx) {
+    const auto& transition = batch.images[imageIdx];
+    const auto& resource   = Resources[transition.resource];
+    auto&       barrier    = imageBarriers[imageIdx];
+    barrier                     = {};
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask       = transition.srcAccess;
+    barrier.dstAccessMask       = transition.dstAccess;
+    barrier.oldLayout           = transition.oldLayout;
+    barrier.newLayout           = transition.newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = resource.image;
+    barrier.subresourceRange    = { resource.aspects, 0,
+      VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+  }
+
+  dispatch.vkCmdPipelineBarrier(commandBuffer, batch.srcStages,
+    batch.dstStages, 0, hasMemoryBarrier ? 1 : 0, &memoryBarrier, 0, nullptr,
+    static_cast<uint32_t>(imageBarriers.size()),
+    imageBarriers.empty() ? nullptr : imageBarriers.data());
+}
+
+} // namespace vwrap
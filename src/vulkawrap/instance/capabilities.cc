@@ -0,0 +1,88 @@
+//---- src/vulkawrap/instance/capabilities.cc --------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  capabilities.cc
+/// \brief Implementation of the capturing of physical device capabilities.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/instance/capabilities.h"
+#include "vulkawrap/util/assert.hpp"
+#include "vulkawrap/util/job_system.h"
+#include <algorithm>
+
+namespace vwrap {
+
+DeviceCapabilities::DeviceCapabilities(
+    const loader::InstanceDispatch& dispatch, VkPhysicalDevice vkPhysicalDevice)
+:   device(vkPhysicalDevice), properties{}, features{}, memoryProperties{} {
+  dispatch.vkGetPhysicalDeviceProperties(device, &properties);
+  dispatch.vkGetPhysicalDeviceFeatures(device, &features);
+  dispatch.vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+
+  uint32_t queueCount = 0;
+  dispatch.vkGetPhysicalDeviceQueueFamilyProperties(device, &queueCount,
+    nullptr);
+  queueFamilies.resize(queueCount);
+  dispatch.vkGetPhysicalDeviceQueueFamilyProperties(device, &queueCount,
+    queueFamilies.data());
+
+  formats.resize(CoreFormatCountCx);
+  for (uint32_t formatIdx = 0; formatIdx < CoreFormatCountCx; ++formatIdx) {
+    dispatch.vkGetPhysicalDeviceFormatProperties(device,
+      static_cast<VkFormat>(formatIdx), &formats[formatIdx]);
+  }
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(
+    const loader::InstanceDispatch& dispatch, VkInstance instance) {
+  if (!dispatch.vkEnumeratePhysicalDevices) {
+    util::Assert(false, "Failed to load the instance functions.\n");
+    return std::vector<VkPhysicalDevice>();
+  }
+
+  uint32_t deviceCount = 0;
+  VkResult result      = dispatch.vkEnumeratePhysicalDevices(instance,
+                           &deviceCount, nullptr);
+  util::AssertSuccess(result, "Failed to enumerate physical devices.\n");
+  util::Assert(deviceCount >= 1, "Failed to find any physical devices.\n");
+
+  std::vector<VkPhysicalDevice> physicalDevices;
+  physicalDevices.resize(deviceCount);
+  result = dispatch.vkEnumeratePhysicalDevices(instance, &deviceCount,
+             physicalDevices.data());
+  util::AssertSuccess(result, "Could not enumerate physical devices.\n");
+  return physicalDevices;
+}
+
+DeviceCapabilitiesVec captureDeviceCapabilities(
+    const loader::InstanceDispatch&      dispatch       ,
+    const std::vector<VkPhysicalDevice>& physicalDevices) {
+  // Each device writes only its own slot, so the result doesn't depend on
+  // which thread captured which device, or in which order. A single device
+  // is captured on the calling thread, without starting any workers.
+  DeviceCapabilitiesVec capabilities(physicalDevices.size());
+  util::JobSystem jobs(std::min(util::JobSystem::defaultThreadCount(),
+    static_cast<uint32_t>(physicalDevices.size())));
+  jobs.parallelFor(physicalDevices.size(), [&] (size_t deviceIdx) {
+    capabilities[deviceIdx] =
+      DeviceCapabilities(dispatch, physicalDevices[deviceIdx]);
+  });
+  return capabilities;
+}
+
+DeviceCapabilitiesVec captureDeviceCapabilities(
+    const loader::InstanceDispatch& dispatch, VkInstance instance) {
+  return captureDeviceCapabilities(dispatch,
+           enumeratePhysicalDevices(dispatch, instance));
+}
+
+} // namespace vwrap
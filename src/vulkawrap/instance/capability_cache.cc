@@ -0,0 +1,307 @@
+//---- src/vulkawrap/instance/capability_cache.cc ----------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  capability_cache.cc
+/// \brief Implementation of the persistent device capability cache.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/instance/capability_cache.h"
+#include "vulkawrap/util/hash.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if defined(_WIN32)
+  #include <process.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace vwrap {
+namespace {
+
+using Header = detail::CapabilityCacheHeader;
+using Record = detail::CapabilityCacheRecord;
+
+/// The identifier at the start of every cache file.
+static constexpr char CacheMagicCx[4] = { 'V', 'W', 'D', 'C' };
+
+/// Returns true if a record is for the device with the given properties.
+///
+/// \param record     The record to check.
+/// \param properties The live properties of the device.
+bool recordMatches(const Record& record,
+                   const VkPhysicalDeviceProperties& properties) {
+  return record.properties.vendorID      == properties.vendorID      &&
+         record.properties.deviceID      == properties.deviceID      &&
+         record.properties.driverVersion == properties.driverVersion &&
+         std::memcmp(record.properties.pipelineCacheUUID,
+                     properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+/// Returns true if two records are for the same model of device, whatever
+/// the driver is, so that a record for a new driver replaces the old one.
+///
+/// \param a The first record.
+/// \param b The second record.
+bool sameDevice(const Record& a, const Record& b) {
+  return a.properties.vendorID == b.properties.vendorID &&
+         a.properties.deviceID == b.properties.deviceID;
+}
+
+/// Maps a file into memory, returning nullptr if it could not be mapped.
+///
+/// \param path The path of the file to map.
+/// \param size The size of the mapping, which is set on success.
+void* mapFile(const std::string& path, size_t& size) {
+#if defined(_WIN32)
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) return nullptr;
+  size = static_cast<size_t>(file.tellg());
+  if (size == 0) return nullptr;
+  char* data = new char[size];
+  file.seekg(0);
+  if (!file.read(data, size)) {
+    delete[] data;
+    return nullptr;
+  }
+  return data;
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+
+  struct stat fileStats;
+  if (fstat(fd, &fileStats) != 0 || fileStats.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  size = static_cast<size_t>(fileStats.st_size);
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  return mapping == MAP_FAILED ? nullptr : mapping;
+#endif
+}
+
+/// Unmaps a file which was mapped with mapFile.
+///
+/// \param mapping The mapping to unmap.
+/// \param size    The size of the mapping.
+void unmapFile(void* mapping, size_t size) {
+#if defined(_WIN32)
+  delete[] static_cast<char*>(mapping);
+#else
+  munmap(mapping, size);
+#endif
+}
+
+/// Makes a cache record from the capabilities of a device. Returns false if
+/// the device cannot be stored in a record.
+///
+/// \param capabilities The capabilities to make the record from.
+/// \param record       The record to fill.
+bool toRecord(const DeviceCapabilities& capabilities, Record& record) {
+  if (capabilities.queueFamilies.size() > MaxCachedQueueFamiliesCx ||
+      capabilities.formats.size()       != CoreFormatCountCx       ) {
+    return false;
+  }
+
+  // Clear the padding too, so that the checksum is deterministic.
+  std::memset(&record, 0, sizeof(Record));
+  record.properties       = capabilities.properties;
+  record.features         = capabilities.features;
+  record.memoryProperties = capabilities.memoryProperties;
+  record.queueFamilyCount =
+    static_cast<uint32_t>(capabilities.queueFamilies.size());
+  std::copy(capabilities.queueFamilies.begin(),
+            capabilities.queueFamilies.end()  , record.queueFamilies);
+  std::copy(capabilities.formats.begin(),
+            capabilities.formats.end()  , record.formats);
+  return true;
+}
+
+} // annonymous namespace
+
+//---- Public ---------------------------------------------------------------//
+
+CapabilityCache::CapabilityCache(const std::string& path)
+:   Mapping(nullptr), MappingSize(0), RecordCount(0), Records(nullptr) {
+  Mapping = mapFile(path, MappingSize);
+  if (!Mapping || MappingSize < sizeof(Header)) return;
+
+  const auto* header = static_cast<const Header*>(Mapping);
+  if (std::memcmp(header->magic, CacheMagicCx, sizeof(CacheMagicCx)) != 0 ||
+      header->version    != CapabilityCacheVersionCx                     ||
+      header->recordSize != sizeof(Record)                               ||
+      MappingSize != sizeof(Header) + header->recordCount * sizeof(Record)) {
+    return;
+  }
+
+  const auto* records = reinterpret_cast<const Record*>(header + 1);
+  const auto checksum =
+    util::fnv1a(records, header->recordCount * sizeof(Record));
+  if (checksum != header->checksum) return;
+
+  RecordCount = header->recordCount;
+  Records     = records;
+}
+
+CapabilityCache::~CapabilityCache() {
+  if (Mapping) unmapFile(Mapping, MappingSize);
+}
+
+const detail::CapabilityCacheRecord* CapabilityCache::find(
+    const VkPhysicalDeviceProperties& properties) const {
+  for (uint32_t recordIdx = 0; recordIdx < RecordCount; ++recordIdx) {
+    if (recordMatches(Records[recordIdx], properties))
+      return &Records[recordIdx];
+  }
+  return nullptr;
+}
+
+DeviceCapabilities CapabilityCache::toCapabilities(
+    const detail::CapabilityCacheRecord& record,
+    VkPhysicalDevice                     vkPhysicalDevice) {
+  DeviceCapabilities capabilities;
+  capabilities.device           = vkPhysicalDevice;
+  capabilities.properties       = record.properties;
+  capabilities.features         = record.features;
+  capabilities.memoryProperties = record.memoryProperties;
+  capabilities.queueFamilies.assign(record.queueFamilies,
+    record.queueFamilies + record.queueFamilyCount);
+  capabilities.formats.assign(record.formats,
+    record.formats + CoreFormatCountCx);
+  return capabilities;
+}
+
+bool CapabilityCache::store(const std::string&           path        ,
+                            const DeviceCapabilitiesVec& capabilities) {
+  std::vector<Record> records;
+  records.reserve(capabilities.size());
+  for (const auto& deviceCapabilities : capabilities) {
+    records.emplace_back();
+    if (!toRecord(deviceCapabilities, records.back())) {
+      records.pop_back();
+      continue;
+    }
+
+    // Identical devices only need a single record.
+    const auto& record = records.back();
+    if (std::any_of(records.begin(), records.end() - 1,
+          [&record] (const Record& other) {
+            return sameDevice(record, other);
+          })) {
+      records.pop_back();
+    }
+  }
+
+  // The file may be shared by instances which see other devices, so the
+  // records for the devices which weren't captured are kept.
+  {
+    CapabilityCache existing(path);
+    const auto newRecordCount = records.size();
+    for (uint32_t recordIdx = 0; recordIdx < existing.RecordCount;
+         ++recordIdx) {
+      const auto& record = existing.Records[recordIdx];
+      if (std::none_of(records.begin(), records.begin() + newRecordCount,
+            [&record] (const Record& other) {
+              return sameDevice(record, other);
+            })) {
+        records.push_back(record);
+      }
+    }
+  }
+
+  Header header;
+  std::memcpy(header.magic, CacheMagicCx, sizeof(CacheMagicCx));
+  header.version     = CapabilityCacheVersionCx;
+  header.recordSize  = sizeof(Record);
+  header.recordCount = static_cast<uint32_t>(records.size());
+  header.checksum    =
+    util::fnv1a(records.data(), records.size() * sizeof(Record));
+
+  // Write to a file which is unique to this process, so that concurrent
+  // writers never interleave, and then swap it into place.
+#if defined(_WIN32)
+  const auto tempPath = path + ".tmp." + std::to_string(_getpid());
+#else
+  const auto tempPath = path + ".tmp." + std::to_string(getpid());
+#endif
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char*>(records.data()),
+               records.size() * sizeof(Record));
+    if (!file) {
+      std::remove(tempPath.c_str());
+      return false;
+    }
+  }
+
+#if defined(_WIN32)
+  std::remove(path.c_str());
+#endif
+  if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    std::remove(tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+DeviceCapabilitiesVec captureDeviceCapabilities(
+    const loader::InstanceDispatch& dispatch ,
+    VkInstance                      instance ,
+    const std::string&              cachePath) {
+  const auto physicalDevices = enumeratePhysicalDevices(dispatch, instance);
+
+  DeviceCapabilitiesVec          capabilities(physicalDevices.size());
+  std::vector<VkPhysicalDevice>  missingDevices;
+  std::vector<size_t>            missingSlots;
+  {
+    CapabilityCache cache(cachePath);
+    for (size_t deviceIdx = 0; deviceIdx < physicalDevices.size();
+         ++deviceIdx) {
+      const auto physicalDevice = physicalDevices[deviceIdx];
+      VkPhysicalDeviceProperties properties = {};
+      dispatch.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+      const auto* record = cache.valid() ? cache.find(properties) : nullptr;
+      if (record) {
+        capabilities[deviceIdx] =
+          CapabilityCache::toCapabilities(*record, physicalDevice);
+        continue;
+      }
+      missingDevices.push_back(physicalDevice);
+      missingSlots.push_back(deviceIdx);
+    }
+  }
+
+  // The devices which weren't cached are captured in parallel, and put back
+  // in enumeration order.
+  auto captured = captureDeviceCapabilities(dispatch, missingDevices);
+  for (size_t missingIdx = 0; missingIdx < captured.size(); ++missingIdx)
+    capabilities[missingSlots[missingIdx]] = std::move(captured[missingIdx]);
+  const bool cacheIsStale = !missingDevices.empty();
+
+  // The cache is only rewritten if a device was missing, so that the common
+  // case of a warm cache never writes to disk.
+  if (cacheIsStale)
+    CapabilityCache::store(cachePath, capabilities);
+  return capabilities;
+}
+
+} // namespace vwrap
@@ -17,6 +17,7 @@
 
 #include "vulkawrap/instance/instance.h"
 #include "vulkawrap/util/assert.hpp"
+#include <algorithm>
 
 namespace vwrap  {
 namespace detail {
@@ -24,7 +25,8 @@ namespace detail {
 Instance::Instance(const char* appName, const char* engineName, 
     const std::vector<const char*>& extensions                , 
     const std::vector<const char*>& layers                    ,
-    uint32_t apiVersion                                       ) {
+    uint32_t apiVersion, const std::string& cachePath         ) 
+:   vkInstance(VK_NULL_HANDLE), dispatch(), CapabilityCachePath(cachePath) {
   // Set the application properties.
   VkApplicationInfo appInfo = {};
   appInfo.sType             = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -55,9 +57,63 @@ Instance::Instance(const char* appName, const char* engineName,
     instanceInfo.enabledLayerCount   = static_cast<uint32_t>(layers.size());
     instanceInfo.ppEnabledLayerNames = layers.data();
   }
-  VkResult result = vkCreateInstance(&instanceInfo, nullptr, &vkInstance);  
-  util::AssertSuccess(result, "Failed to create instance.\n");
+  const loader::GlobalDispatch& globalDispatch = loader::globalDispatch();
+  util::Assert(globalDispatch.valid(), "Failed to load the Vulkan library.\n");
+  if (!globalDispatch.valid()) return;
+
+  // The handle is undefined if creation fails, so it is reset, and the
+  // dispatch table is left empty.
+  VkResult result = globalDispatch.vkCreateInstance(&instanceInfo, nullptr, 
+                      &vkInstance);  
+  if (result != VK_SUCCESS) {
+    util::AssertSuccess(result, "Failed to create instance.\n");
+    vkInstance = VK_NULL_HANDLE;
+    return;
+  }
+
+  // Load the instance functions for this specific instance.
+  dispatch.load(vkInstance);
+}
+
+std::string instanceKey(const char*                     appName   ,
+                        const char*                     engineName,
+                        const std::vector<const char*>& extensions,
+                        const std::vector<const char*>& layers    ,
+                        uint32_t                        apiVersion,
+                        const std::string&              cachePath ) {
+  // Names can't contain a null, so each field is null terminated, and the
+  // lists are prefixed with their sizes, so that no two sets of parameters
+  // have the same key.
+  std::string key;
+  auto append = [&key] (const std::string& field) {
+    key.append(field);
+    key.push_back('\0');
+  };
+
+  std::vector<std::string> sortedExtensions(extensions.begin(),
+                                            extensions.end());
+  std::sort(sortedExtensions.begin(), sortedExtensions.end());
+  sortedExtensions.erase(
+    std::unique(sortedExtensions.begin(), sortedExtensions.end()),
+    sortedExtensions.end());
+
+  append(std::to_string(apiVersion));
+  append(cachePath);
+  append(appName    ? appName    : "");
+  append(engineName ? engineName : "");
+  append(std::to_string(sortedExtensions.size()));
+  for (const auto& extension : sortedExtensions) append(extension);
+  append(std::to_string(layers.size()));
+  for (const auto* layer : layers) append(layer);
+  return key;
 }
 
 } // namespace detail
+
+void InstanceDeleter::operator()(VkInstance instance) const {
+  auto destroyInstance = reinterpret_cast<PFN_vkDestroyInstance>(
+    loader::getInstanceProcAddr()(instance, "vkDestroyInstance"));
+  if (destroyInstance) destroyInstance(instance, nullptr);
+}
+
 } // namespace vwrap
@@ -0,0 +1,116 @@
+//---- src/vulkawrap/loader/dispatch.cc -------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  dispatch.cc
+/// \brief Implementation of the lazy loading of the Vulkan library and the
+///        filling of the dispatch tables.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/loader/dispatch.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <dlfcn.h>
+#endif
+
+namespace vwrap  {
+namespace loader {
+namespace {
+
+/// Opens the Vulkan library and gets vkGetInstanceProcAddr from it. The
+/// library is intentionally never closed, since the function pointers which
+/// are loaded from it are used until the process exits.
+PFN_vkGetInstanceProcAddr openVulkanLibrary() {
+#if defined(_WIN32)
+  HMODULE library = LoadLibraryA("vulkan-1.dll");
+  if (!library) return nullptr;
+  return reinterpret_cast<PFN_vkGetInstanceProcAddr>(
+           GetProcAddress(library, "vkGetInstanceProcAddr"));
+#else
+  void* library = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+  if (!library) library = dlopen("libvulkan.so", RTLD_NOW | RTLD_LOCAL);
+  if (!library) return nullptr;
+  return reinterpret_cast<PFN_vkGetInstanceProcAddr>(
+           dlsym(library, "vkGetInstanceProcAddr"));
+#endif
+}
+
+/// Loads the global functions from the library.
+GlobalDispatch loadGlobalDispatch() {
+  GlobalDispatch dispatch;
+  PFN_vkGetInstanceProcAddr getProcAddr = getInstanceProcAddr();
+  if (!getProcAddr) return dispatch;
+
+#define VWRAP_LOAD_GLOBAL(name)                                               \
+  dispatch.name = reinterpret_cast<PFN_##name>(getProcAddr(nullptr, #name));
+  VWRAP_GLOBAL_FUNCTIONS(VWRAP_LOAD_GLOBAL)
+#undef VWRAP_LOAD_GLOBAL
+
+  return dispatch;
+}
+
+/// The names of the functions in the tables, by id.
+static constexpr const char* FunctionNamesCx[] = {
+#define VWRAP_FUNCTION_NAME(name) #name,
+  VWRAP_ALL_FUNCTIONS(VWRAP_FUNCTION_NAME)
+#undef VWRAP_FUNCTION_NAME
+};
+
+} // annonymous namespace
+
+//---- Public ---------------------------------------------------------------//
+
+const char* functionName(uint32_t function) {
+  return function < VulkanFunctionCountCx ? FunctionNamesCx[function] :
+                                            "unknown";
+}
+
+PFN_vkGetInstanceProcAddr getInstanceProcAddr() {
+  static const PFN_vkGetInstanceProcAddr getProcAddr = openVulkanLibrary();
+  return getProcAddr;
+}
+
+const GlobalDispatch& globalDispatch() {
+  static const GlobalDispatch dispatch = loadGlobalDispatch();
+  return dispatch;
+}
+
+void InstanceDispatch::load(VkInstance instance) {
+  // If the library isn't loaded the table is left empty, so that the
+  // functions can be checked before they are called.
+  PFN_vkGetInstanceProcAddr getProcAddr = getInstanceProcAddr();
+  *this = InstanceDispatch();
+  if (!getProcAddr) return;
+
+#define VWRAP_LOAD_INSTANCE(name)                                             \
+  name = reinterpret_cast<PFN_##name>(getProcAddr(instance, #name));
+  VWRAP_INSTANCE_FUNCTIONS(VWRAP_LOAD_INSTANCE)
+#undef VWRAP_LOAD_INSTANCE
+}
+
+void DeviceDispatch::load(const InstanceDispatch& instanceDispatch,
+    VkDevice device) {
+  PFN_vkGetDeviceProcAddr getProcAddr = instanceDispatch.vkGetDeviceProcAddr;
+  *this        = DeviceDispatch();
+  this->device = device;
+  if (!getProcAddr) return;
+
+#define VWRAP_LOAD_DEVICE(name)                                               \
+  name = reinterpret_cast<PFN_##name>(getProcAddr(device, #name));
+  VWRAP_DEVICE_FUNCTIONS(VWRAP_LOAD_DEVICE)
+  VWRAP_DEVICE_EXTENSION_FUNCTIONS(VWRAP_LOAD_DEVICE)
+#undef VWRAP_LOAD_DEVICE
+}
+
+} // namespace loader
+} // namespace vwrap
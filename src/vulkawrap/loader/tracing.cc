@@ -0,0 +1,216 @@
+//---- src/vulkawrap/loader/tracing.cc --------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  tracing.cc
+/// \brief Implementation of the tracing of Vulkan calls.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/loader/tracing.h"
+#include "vulkawrap/loader/dispatch.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace vwrap  {
+namespace loader {
+namespace {
+
+/// The counters for the calls which a thread has made to a function.
+struct FunctionCounters {
+  std::atomic<uint64_t> calls{0};    //!< The number of calls.
+  std::atomic<uint64_t> totalNs{0};  //!< The time spent in the calls.
+  std::atomic<uint64_t> maxNs{0};    //!< The longest call.
+  std::atomic<uint64_t> buckets[TraceBucketCountCx] = {};  //!< Histogram.
+};
+
+/// The counters of a thread. Only the thread writes to them, so they are
+/// updated without read-modify-write operations, and are only atomic so
+/// that snapshots can read them while the thread is running.
+struct ThreadTrace {
+  FunctionCounters functions[VulkanFunctionCountCx];  //!< Counters by id.
+};
+
+/// The function which emits spans, with its data. A sink is never changed
+/// once it is published, so a call always sees a callback with its own data.
+struct SpanSink {
+  TraceSpanCallback callback;  //!< The function to call for each span.
+  void*             user;      //!< The data to pass to the function.
+};
+
+/// The counters of every thread which has made a call, and the span sink.
+/// The counters of a thread which exits are kept so that its calls are still
+/// counted, and are given to the next thread which makes a call, which adds
+/// to them, so there are only as many as the most threads which have made
+/// calls at once.
+struct TraceRegistry {
+  std::mutex                                mutex;    //!< Guards the rest.
+  std::vector<std::unique_ptr<ThreadTrace>> threads;  //!< Thread counters.
+  std::vector<ThreadTrace*>                 exited;   //!< Unused counters.
+  std::vector<std::unique_ptr<SpanSink>>    sinks;    //!< Published sinks.
+  std::atomic<const SpanSink*>              sink{nullptr};  //!< Spans.
+};
+
+/// Gets the registry.
+TraceRegistry& registry() {
+  static TraceRegistry traceRegistry;
+  return traceRegistry;
+}
+
+/// The counters which a thread is using, which are given back to the
+/// registry when the thread exits.
+struct ThreadTraceSlot {
+  ThreadTrace* trace;  //!< The counters of the thread.
+
+  /// Constructor which takes the counters of an exited thread, or adds new
+  /// counters if there are none.
+  ThreadTraceSlot() {
+    auto& traceRegistry = registry();
+    std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+    if (!traceRegistry.exited.empty()) {
+      trace = traceRegistry.exited.back();
+      traceRegistry.exited.pop_back();
+      return;
+    }
+    traceRegistry.threads.push_back(std::make_unique<ThreadTrace>());
+    trace = traceRegistry.threads.back().get();
+  }
+
+  /// Destructor which gives the counters back to the registry.
+  ~ThreadTraceSlot() {
+    auto& traceRegistry = registry();
+    std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+    traceRegistry.exited.push_back(trace);
+  }
+};
+
+/// Gets the counters of the calling thread, registering them on the first
+/// call from the thread.
+ThreadTrace& threadTrace() {
+  thread_local ThreadTraceSlot slot;
+  return *slot.trace;
+}
+
+/// Adds to a counter which only the calling thread writes.
+///
+/// \param counter The counter to add to.
+/// \param value   The value to add.
+void add(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+/// Gets the histogram bucket for a duration.
+///
+/// \param durationNs The duration, in nanoseconds.
+size_t bucketIndex(uint64_t durationNs) {
+  size_t bucket = 0;
+  while (bucket < TraceBucketCountCx - 1 && (durationNs >> bucket) != 0)
+    ++bucket;
+  return bucket;
+}
+
+} // annonymous namespace
+
+//---- Public ---------------------------------------------------------------//
+
+uint64_t TraceSnapshot::totalNs() const {
+  uint64_t total = 0;
+  for (const auto& function : functions) total += function.totalNs;
+  return total;
+}
+
+TraceSnapshot TraceSnapshot::since(const TraceSnapshot& earlier) const {
+  TraceSnapshot interval = *this;
+  const auto count = std::min(functions.size(), earlier.functions.size());
+  for (size_t functionIdx = 0; functionIdx < count; ++functionIdx) {
+    auto&       function = interval.functions[functionIdx];
+    const auto& before   = earlier.functions[functionIdx];
+    function.calls   -= before.calls;
+    function.totalNs -= before.totalNs;
+    for (size_t bucketIdx = 0; bucketIdx < TraceBucketCountCx; ++bucketIdx)
+      function.buckets[bucketIdx] -= before.buckets[bucketIdx];
+  }
+  return interval;
+}
+
+TraceSnapshot traceSnapshot() {
+  TraceSnapshot snapshot;
+  snapshot.functions.resize(VulkanFunctionCountCx);
+  for (uint32_t functionIdx = 0; functionIdx < VulkanFunctionCountCx;
+       ++functionIdx) {
+    auto& function = snapshot.functions[functionIdx];
+    function = FunctionTrace{ functionName(functionIdx), 0, 0, 0, {} };
+  }
+
+  auto& traceRegistry = registry();
+  std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+  for (const auto& thread : traceRegistry.threads) {
+    for (uint32_t functionIdx = 0; functionIdx < VulkanFunctionCountCx;
+         ++functionIdx) {
+      const auto& counters = thread->functions[functionIdx];
+      auto&       function = snapshot.functions[functionIdx];
+      function.calls   += counters.calls.load(std::memory_order_relaxed);
+      function.totalNs += counters.totalNs.load(std::memory_order_relaxed);
+      function.maxNs    = std::max(function.maxNs,
+                            counters.maxNs.load(std::memory_order_relaxed));
+      for (size_t bucketIdx = 0; bucketIdx < TraceBucketCountCx; ++bucketIdx)
+        function.buckets[bucketIdx] +=
+          counters.buckets[bucketIdx].load(std::memory_order_relaxed);
+    }
+  }
+  return snapshot;
+}
+
+void setTraceSpanCallback(TraceSpanCallback callback, void* user) {
+  auto& traceRegistry = registry();
+  if (callback == nullptr) {
+    traceRegistry.sink.store(nullptr, std::memory_order_release);
+    return;
+  }
+
+  // Calls may still be using the sinks which were published before, so they
+  // are kept, and a sink which was published before is used again.
+  std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+  auto& sinks = traceRegistry.sinks;
+  auto  found = std::find_if(sinks.begin(), sinks.end(),
+    [callback, user] (const std::unique_ptr<SpanSink>& sink) {
+      return sink->callback == callback && sink->user == user;
+    });
+  if (found == sinks.end()) {
+    sinks.push_back(std::make_unique<SpanSink>(SpanSink{ callback, user }));
+    found = sinks.end() - 1;
+  }
+  traceRegistry.sink.store(found->get(), std::memory_order_release);
+}
+
+namespace detail {
+
+void recordCall(uint32_t function, uint64_t beginNs, uint64_t endNs) {
+  if (function >= VulkanFunctionCountCx) return;
+
+  const auto durationNs = endNs - beginNs;
+  auto&      counters   = threadTrace().functions[function];
+  add(counters.calls, 1);
+  add(counters.totalNs, durationNs);
+  add(counters.buckets[bucketIndex(durationNs)], 1);
+  if (durationNs > counters.maxNs.load(std::memory_order_relaxed))
+    counters.maxNs.store(durationNs, std::memory_order_relaxed);
+
+  const auto* sink = registry().sink.load(std::memory_order_acquire);
+  if (sink != nullptr)
+    sink->callback(functionName(function), beginNs, endNs, sink->user);
+}
+
+} // namespace detail
+} // namespace loader
+} // namespace vwrap
@@ -0,0 +1,325 @@
+//---- src/vulkawrap/memory/allocator.cc ------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  allocator.cc
+/// \brief Implementation of the device memory allocator.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/memory/allocator.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+
+namespace vwrap {
+namespace detail {
+
+/// A block of the general allocator, which is sub allocated with TLSF.
+struct AllocatorBlock {
+  DeviceMemoryBlock memory;     //!< The memory of the block.
+  TlsfAllocator     allocator;  //!< Allocates from the memory.
+  ResourceKind      kind;       //!< The kind of resources in the block.
+  bool              dedicated;  //!< If the block is for a single resource.
+
+  /// Constructor which allocates the memory of the block.
+  ///
+  /// \param device       The device to allocate the memory from.
+  /// \param memoryType   The memory type of the block.
+  /// \param size         The size of the block.
+  /// \param resourceKind The kind of resources in the block.
+  /// \param isDedicated  If the block is for a single resource.
+  AllocatorBlock(const Device& device    , uint32_t     memoryType  ,
+                 VkDeviceSize  size      , ResourceKind resourceKind,
+                 bool          isDedicated                          )
+  : memory(device, memoryType, size), allocator(memory.valid() ? size : 0),
+    kind(resourceKind), dedicated(isDedicated) {}
+};
+
+} // namespace detail
+namespace {
+
+/// Makes an allocation from a sub allocation of a block.
+///
+/// \param memory        The memory of the block.
+/// \param memoryType    The memory type of the block.
+/// \param subAllocation The region of the block.
+MemoryAllocation makeAllocation(
+    const detail::DeviceMemoryBlock& memory       ,
+    uint32_t                         memoryType   ,
+    const SubAllocation&             subAllocation) {
+  MemoryAllocation allocation;
+  allocation.memory     = memory.getMemory();
+  allocation.offset     = subAllocation.offset;
+  allocation.size       = subAllocation.size;
+  allocation.mapped     = memory.getMapped(subAllocation.offset);
+  allocation.memoryType = memoryType;
+  allocation.handle     = subAllocation.handle;
+  return allocation;
+}
+
+/// Gets the slot size of a pool block, rounded up to the granularity.
+///
+/// \param device   The device of the pool.
+/// \param slotSize The requested slot size.
+VkDeviceSize poolSlotSize(const Device& device, VkDeviceSize slotSize) {
+  return alignUp(std::max<VkDeviceSize>(slotSize, 1),
+    device.getProperties().limits.bufferImageGranularity);
+}
+
+} // annonymous namespace
+
+//---- DeviceMemoryBlock ----------------------------------------------------//
+
+namespace detail {
+
+DeviceMemoryBlock::DeviceMemoryBlock(const Device& device    ,
+                                     uint32_t      memoryType,
+                                     VkDeviceSize  size      )
+:   Owner(device), Memory(VK_NULL_HANDLE), Size(size), Mapped(nullptr) {
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize       = size;
+  allocateInfo.memoryTypeIndex      = memoryType;
+
+  const auto& dispatch = device.getDispatch();
+  if (dispatch.vkAllocateMemory(device.getVkDevice(), &allocateInfo, nullptr,
+        &Memory) != VK_SUCCESS) {
+    Memory = VK_NULL_HANDLE;
+    return;
+  }
+
+  const auto& types = device.getMemoryProperties().memoryTypes;
+  if (types[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    VkResult result = dispatch.vkMapMemory(device.getVkDevice(), Memory, 0,
+                        VK_WHOLE_SIZE, 0, &Mapped);
+    util::AssertSuccess(result, "Failed to map device memory block.\n");
+    if (result != VK_SUCCESS) Mapped = nullptr;
+  }
+}
+
+DeviceMemoryBlock::~DeviceMemoryBlock() {
+  if (Memory == VK_NULL_HANDLE) return;
+
+  const auto& dispatch = Owner.getDispatch();
+  if (Mapped) dispatch.vkUnmapMemory(Owner.getVkDevice(), Memory);
+  dispatch.vkFreeMemory(Owner.getVkDevice(), Memory, nullptr);
+}
+
+} // namespace detail
+
+//---- MemoryAllocator ------------------------------------------------------//
+
+MemoryAllocator::MemoryAllocator(const Device& device, VkDeviceSize blockSize)
+:   Owner(device),
+    Granularity(device.getProperties().limits.bufferImageGranularity),
+    Pools(new MemoryTypePool[VK_MAX_MEMORY_TYPES]) {
+  const auto& memoryProperties = device.getMemoryProperties();
+  BlockSizes.resize(memoryProperties.memoryTypeCount, blockSize);
+  for (uint32_t typeIdx = 0; typeIdx < memoryProperties.memoryTypeCount;
+       ++typeIdx) {
+    const auto heapIdx  = memoryProperties.memoryTypes[typeIdx].heapIndex;
+    const auto heapSize = memoryProperties.memoryHeaps[heapIdx].size;
+    BlockSizes[typeIdx] = std::max<VkDeviceSize>(
+      std::min(blockSize, heapSize / 8), 1);
+  }
+}
+
+MemoryAllocator::~MemoryAllocator() = default;
+
+MemoryAllocation MemoryAllocator::allocate(
+    const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags       required    ,
+    VkMemoryPropertyFlags       preferred   ,
+    ResourceKind                kind        ) {
+  // Try the preferred type first, and fall back to any type with the
+  // required properties if it has no memory left.
+  const auto preferredType = findMemoryType(requirements.memoryTypeBits,
+                                            required | preferred);
+  if (preferredType != InvalidMemoryTypeCx) {
+    auto allocation = allocateFromType(requirements, preferredType, kind);
+    if (allocation.valid()) return allocation;
+  }
+
+  uint32_t typeBits = requirements.memoryTypeBits;
+  if (preferredType != InvalidMemoryTypeCx)
+    typeBits &= ~(1u << preferredType);
+  while (true) {
+    const auto memoryType = findMemoryType(typeBits, required);
+    if (memoryType == InvalidMemoryTypeCx) break;
+
+    auto allocation = allocateFromType(requirements, memoryType, kind);
+    if (allocation.valid()) return allocation;
+    typeBits &= ~(1u << memoryType);
+  }
+  return MemoryAllocation();
+}
+
+MemoryAllocation MemoryAllocator::allocateForBuffer(
+    VkBuffer buffer, VkMemoryPropertyFlags required,
+    VkMemoryPropertyFlags preferred) {
+  const auto& dispatch = Owner.getDispatch();
+  VkMemoryRequirements requirements;
+  dispatch.vkGetBufferMemoryRequirements(Owner.getVkDevice(), buffer,
+    &requirements);
+
+  auto allocation = allocate(requirements, required, preferred,
+                             ResourceKind::VW_LINEAR_RESOURCE);
+  if (allocation.valid()) {
+    VkResult result = dispatch.vkBindBufferMemory(Owner.getVkDevice(), buffer,
+                        allocation.memory, allocation.offset);
+    util::AssertSuccess(result, "Failed to bind buffer memory.\n");
+  }
+  return allocation;
+}
+
+MemoryAllocation MemoryAllocator::allocateForImage(
+    VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags required,
+    VkMemoryPropertyFlags preferred) {
+  const auto& dispatch = Owner.getDispatch();
+  VkMemoryRequirements requirements;
+  dispatch.vkGetImageMemoryRequirements(Owner.getVkDevice(), image,
+    &requirements);
+
+  const auto kind = tiling == VK_IMAGE_TILING_OPTIMAL
+                  ? ResourceKind::VW_OPTIMAL_RESOURCE
+                  : ResourceKind::VW_LINEAR_RESOURCE;
+  auto allocation = allocate(requirements, required, preferred, kind);
+  if (allocation.valid()) {
+    VkResult result = dispatch.vkBindImageMemory(Owner.getVkDevice(), image,
+                        allocation.memory, allocation.offset);
+    util::AssertSuccess(result, "Failed to bind image memory.\n");
+  }
+  return allocation;
+}
+
+void MemoryAllocator::free(const MemoryAllocation& allocation) {
+  if (!allocation.valid() || !allocation.block) return;
+
+  auto& pool = Pools[allocation.memoryType];
+  std::lock_guard<std::mutex> lock(pool.Mutex);
+
+  auto* block = allocation.block;
+  block->allocator.free(allocation.handle);
+  if (!block->allocator.empty()) return;
+
+  // Keep an empty shared block if it is the only one of its kind, so that
+  // freeing and allocating a single resource doesn't churn a whole block.
+  const auto otherBlock = std::find_if(pool.Blocks.begin(), pool.Blocks.end(),
+    [block] (const std::unique_ptr<detail::AllocatorBlock>& other) {
+      return other.get() != block && !other->dedicated &&
+             other->kind == block->kind;
+    });
+  if (!block->dedicated && otherBlock == pool.Blocks.end()) return;
+
+  pool.Blocks.erase(std::find_if(pool.Blocks.begin(), pool.Blocks.end(),
+    [block] (const std::unique_ptr<detail::AllocatorBlock>& other) {
+      return other.get() == block;
+    }));
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t              typeBits  ,
+                                         VkMemoryPropertyFlags properties)
+    const {
+  const auto& memoryProperties = Owner.getMemoryProperties();
+  for (uint32_t typeIdx = 0; typeIdx < memoryProperties.memoryTypeCount;
+       ++typeIdx) {
+    const auto flags = memoryProperties.memoryTypes[typeIdx].propertyFlags;
+    if ((typeBits & (1u << typeIdx)) && (flags & properties) == properties)
+      return typeIdx;
+  }
+  return InvalidMemoryTypeCx;
+}
+
+size_t MemoryAllocator::getBlockCount(uint32_t memoryType) const {
+  auto& pool = Pools[memoryType];
+  std::lock_guard<std::mutex> lock(pool.Mutex);
+  return pool.Blocks.size();
+}
+
+MemoryAllocation MemoryAllocator::allocateFromType(
+    const VkMemoryRequirements& requirements,
+    uint32_t                    memoryType  ,
+    ResourceKind                kind        ) {
+  // Without a granularity, linear and optimal resources can share blocks.
+  if (Granularity <= 1) kind = ResourceKind::VW_LINEAR_RESOURCE;
+
+  const auto blockSize = BlockSizes[memoryType];
+  const auto dedicated = requirements.size > blockSize / 2;
+  auto& pool           = Pools[memoryType];
+  std::lock_guard<std::mutex> lock(pool.Mutex);
+
+  if (!dedicated) {
+    for (auto& block : pool.Blocks) {
+      if (block->dedicated || block->kind != kind) continue;
+
+      const auto subAllocation = block->allocator.allocate(requirements.size,
+                                   requirements.alignment);
+      if (!subAllocation.valid()) continue;
+
+      auto allocation  = makeAllocation(block->memory, memoryType,
+                                        subAllocation);
+      allocation.block = block.get();
+      return allocation;
+    }
+  }
+
+  std::unique_ptr<detail::AllocatorBlock> block(new detail::AllocatorBlock(
+    Owner, memoryType, dedicated ? requirements.size : blockSize, kind,
+    dedicated));
+  if (!block->memory.valid()) return MemoryAllocation();
+
+  const auto subAllocation = block->allocator.allocate(requirements.size,
+                               requirements.alignment);
+  if (!subAllocation.valid()) return MemoryAllocation();
+
+  auto allocation  = makeAllocation(block->memory, memoryType, subAllocation);
+  allocation.block = block.get();
+  pool.Blocks.push_back(std::move(block));
+  return allocation;
+}
+
+//---- LinearMemoryBlock ----------------------------------------------------//
+
+LinearMemoryBlock::LinearMemoryBlock(const Device& device    ,
+                                     uint32_t      memoryType,
+                                     VkDeviceSize  size      )
+:   Memory(device, memoryType, size), Allocator(Memory.valid() ? size : 0),
+    MemoryType(memoryType),
+    Granularity(device.getProperties().limits.bufferImageGranularity) {}
+
+MemoryAllocation LinearMemoryBlock::allocate(
+    const VkMemoryRequirements& requirements) {
+  if (!(requirements.memoryTypeBits & (1u << MemoryType)))
+    return MemoryAllocation();
+
+  const auto alignment = std::max(requirements.alignment, Granularity);
+  const auto subAllocation = Allocator.allocate(
+    alignUp(requirements.size, alignment), alignment);
+  if (!subAllocation.valid()) return MemoryAllocation();
+  return makeAllocation(Memory, MemoryType, subAllocation);
+}
+
+//---- PoolMemoryBlock ------------------------------------------------------//
+
+PoolMemoryBlock::PoolMemoryBlock(const Device& device  ,
+                                 uint32_t      memoryType,
+                                 VkDeviceSize  slotSize,
+                                 uint32_t      slotCount )
+:   Memory(device, memoryType, poolSlotSize(device, slotSize) * slotCount),
+    Allocator(poolSlotSize(device, slotSize), Memory.valid() ? slotCount : 0),
+    MemoryType(memoryType) {}
+
+MemoryAllocation PoolMemoryBlock::allocate() {
+  const auto subAllocation = Allocator.allocate();
+  if (!subAllocation.valid()) return MemoryAllocation();
+  return makeAllocation(Memory, MemoryType, subAllocation);
+}
+
+} // namespace vwrap
@@ -0,0 +1,303 @@
+//---- src/vulkawrap/memory/staging.cc --------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  staging.cc
+/// \brief Implementation of the staging ring.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/memory/staging.h"
+#include "vulkawrap/util/assert.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace vwrap {
+
+StagingRing::StagingRing(const Device&    device   ,
+                         MemoryAllocator& allocator,
+                         VkDeviceSize     size     )
+:   Owner(device), Allocator(allocator), Buffer(VK_NULL_HANDLE),
+    Coherent(true),
+    AtomSize(device.getProperties().limits.nonCoherentAtomSize),
+    Queue(VK_NULL_HANDLE), CommandPool(VK_NULL_HANDLE),
+    NextFlushId(1) {
+  const auto& dispatch = Owner.getDispatch();
+  const auto  vkDevice = Owner.getVkDevice();
+
+  // Uploads go to the dedicated transfer queue when there is one.
+  auto queueType = QueueType::VW_TRANSFER_QUEUE;
+  if (Owner.getQueue(queueType) == VK_NULL_HANDLE)
+    queueType = QueueType::VW_GRAPHICS_QUEUE;
+  Queue = Owner.getQueue(queueType);
+  util::Assert(Queue != VK_NULL_HANDLE, "No queue for staging uploads.\n");
+
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                              VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = Owner.getQueueFamily(queueType);
+  VkResult result = dispatch.vkCreateCommandPool(vkDevice, &poolInfo, nullptr,
+                      &CommandPool);
+  util::AssertSuccess(result, "Failed to create staging command pool.\n");
+
+  // The ring is a multiple of the atom size, and is allocated aligned to the
+  // atom size, so that flushes of any range of it stay inside its memory.
+  size = alignUp(size, AtomSize);
+  VkBufferCreateInfo bufferInfo = {};
+  bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size               = size;
+  bufferInfo.usage              = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+  result = dispatch.vkCreateBuffer(vkDevice, &bufferInfo, nullptr, &Buffer);
+  util::AssertSuccess(result, "Failed to create staging buffer.\n");
+  if (result != VK_SUCCESS) return;
+
+  VkMemoryRequirements requirements;
+  dispatch.vkGetBufferMemoryRequirements(vkDevice, Buffer, &requirements);
+  requirements.size      = alignUp(requirements.size, AtomSize);
+  requirements.alignment = std::max(requirements.alignment, AtomSize);
+  Memory = Allocator.allocate(requirements,
+             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (!Memory.valid()) return;
+
+  result = dispatch.vkBindBufferMemory(vkDevice, Buffer, Memory.memory,
+             Memory.offset);
+  util::AssertSuccess(result, "Failed to bind staging memory.\n");
+
+  const auto& types = Owner.getMemoryProperties().memoryTypes;
+  Coherent = (types[Memory.memoryType].propertyFlags &
+              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+  Ring     = RingAllocator(size);
+}
+
+StagingRing::~StagingRing() {
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (!InFlight.empty()) retireLocked(InFlight.back().id);
+  }
+
+  const auto& dispatch = Owner.getDispatch();
+  const auto  vkDevice = Owner.getVkDevice();
+  for (const auto& submission : FreeSubmissions)
+    dispatch.vkDestroyFence(vkDevice, submission.fence, nullptr);
+  if (CommandPool != VK_NULL_HANDLE)
+    dispatch.vkDestroyCommandPool(vkDevice, CommandPool, nullptr);
+  if (Buffer != VK_NULL_HANDLE)
+    dispatch.vkDestroyBuffer(vkDevice, Buffer, nullptr);
+  Allocator.free(Memory);
+}
+
+StagingRange StagingRing::reserve(VkDeviceSize size, VkDeviceSize alignment) {
+  std::lock_guard<std::mutex> lock(Mutex);
+  if (!Memory.valid() || size > Ring.size()) return StagingRange();
+
+  auto allocation = Ring.allocate(size, alignment);
+  if (!allocation.valid()) {
+    retireLocked(0);
+    allocation = Ring.allocate(size, alignment);
+  }
+
+  // Waiting for the oldest submission frees the most space, and if nothing
+  // is in flight, the pending copies are holding the ring.
+  while (!allocation.valid()) {
+    if (InFlight.empty() && flushLocked() == 0) return StagingRange();
+    retireLocked(InFlight.front().id);
+    allocation = Ring.allocate(size, alignment);
+  }
+
+  Reserved.push_back(Reservation{ allocation.offset,
+                                  Ring.head() - allocation.size });
+
+  StagingRange range;
+  range.data   = static_cast<char*>(Memory.mapped) + allocation.offset;
+  range.offset = allocation.offset;
+  range.size   = allocation.size;
+  return range;
+}
+
+void StagingRing::copyToBuffer(const StagingRange& range, VkBuffer buffer,
+                               VkDeviceSize        dstOffset               ) {
+  PendingCopy copy            = {};
+  copy.buffer                 = buffer;
+  copy.bufferRegion.srcOffset = range.offset;
+  copy.bufferRegion.dstOffset = dstOffset;
+  copy.bufferRegion.size      = range.size;
+  copy.rangeOffset            = range.offset;
+  copy.rangeSize              = range.size;
+  addCopy(copy);
+}
+
+void StagingRing::copyToImage(const StagingRange& range, VkImage image,
+                              VkBufferImageCopy   region               ) {
+  region.bufferOffset += range.offset;
+
+  PendingCopy copy = {};
+  copy.image       = image;
+  copy.imageRegion = region;
+  copy.rangeOffset = range.offset;
+  copy.rangeSize   = range.size;
+  addCopy(copy);
+}
+
+bool StagingRing::upload(const void* data, VkDeviceSize size, VkBuffer buffer,
+                         VkDeviceSize dstOffset                           ) {
+  auto range = reserve(size);
+  if (!range.valid()) return false;
+
+  std::memcpy(range.data, data, static_cast<size_t>(size));
+  copyToBuffer(range, buffer, dstOffset);
+  return true;
+}
+
+uint64_t StagingRing::flush() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  return flushLocked();
+}
+
+void StagingRing::retire() {
+  std::lock_guard<std::mutex> lock(Mutex);
+  retireLocked(0);
+}
+
+void StagingRing::wait(uint64_t flushId) {
+  std::lock_guard<std::mutex> lock(Mutex);
+  retireLocked(flushId);
+}
+
+uint64_t StagingRing::flushLocked() {
+  if (PendingCopies.empty()) return 0;
+
+  const auto& dispatch = Owner.getDispatch();
+  const auto  vkDevice = Owner.getVkDevice();
+
+  Submission submission;
+  if (!FreeSubmissions.empty()) {
+    submission = FreeSubmissions.back();
+    FreeSubmissions.pop_back();
+    dispatch.vkResetFences(vkDevice, 1, &submission.fence);
+  } else {
+    VkCommandBufferAllocateInfo allocateInfo = {};
+    allocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = CommandPool;
+    allocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+    VkResult result = dispatch.vkAllocateCommandBuffers(vkDevice,
+                        &allocateInfo, &submission.commandBuffer);
+    util::AssertSuccess(result, "Failed to allocate staging commands.\n");
+    if (result != VK_SUCCESS) return 0;
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    result = dispatch.vkCreateFence(vkDevice, &fenceInfo, nullptr,
+               &submission.fence);
+    util::AssertSuccess(result, "Failed to create staging fence.\n");
+    if (result != VK_SUCCESS) {
+      dispatch.vkFreeCommandBuffers(vkDevice, CommandPool, 1,
+        &submission.commandBuffer);
+      return 0;
+    }
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  dispatch.vkBeginCommandBuffer(submission.commandBuffer, &beginInfo);
+  for (const auto& copy : PendingCopies) {
+    if (copy.buffer != VK_NULL_HANDLE) {
+      dispatch.vkCmdCopyBuffer(submission.commandBuffer, Buffer, copy.buffer,
+        1, &copy.bufferRegion);
+    } else {
+      dispatch.vkCmdCopyBufferToImage(submission.commandBuffer, Buffer,
+        copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+        &copy.imageRegion);
+    }
+  }
+  dispatch.vkEndCommandBuffer(submission.commandBuffer);
+  flushMappedRanges();
+
+  VkSubmitInfo submitInfo       = {};
+  submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers    = &submission.commandBuffer;
+  VkResult result = dispatch.vkQueueSubmit(Queue, 1, &submitInfo,
+                      submission.fence);
+  util::AssertSuccess(result, "Failed to submit staging uploads.\n");
+  if (result != VK_SUCCESS) {
+    // The fence will never signal, so it isn't waited on, and the copies are
+    // kept for the next flush.
+    FreeSubmissions.push_back(submission);
+    return 0;
+  }
+  PendingCopies.clear();
+
+  // Ranges which are still being written must outlive this submission, so
+  // it only retires up to the oldest of them.
+  submission.id      = NextFlushId++;
+  submission.ringEnd = Reserved.empty() ? Ring.head()
+                                        : Reserved.front().position;
+  InFlight.push_back(submission);
+  return submission.id;
+}
+
+void StagingRing::retireLocked(uint64_t waitForId) {
+  const auto& dispatch = Owner.getDispatch();
+  const auto  vkDevice = Owner.getVkDevice();
+
+  // Submissions complete in order on a queue, so retiring stops at the first
+  // one which hasn't completed.
+  while (!InFlight.empty()) {
+    auto& submission = InFlight.front();
+    if (submission.id <= waitForId) {
+      dispatch.vkWaitForFences(vkDevice, 1, &submission.fence, VK_TRUE,
+        UINT64_MAX);
+    } else if (dispatch.vkGetFenceStatus(vkDevice, submission.fence)
+               != VK_SUCCESS) {
+      break;
+    }
+    Ring.retire(submission.ringEnd);
+    FreeSubmissions.push_back(submission);
+    InFlight.pop_front();
+  }
+}
+
+void StagingRing::addCopy(const PendingCopy& copy) {
+  std::lock_guard<std::mutex> lock(Mutex);
+  PendingCopies.push_back(copy);
+
+  const auto reservation = std::find_if(Reserved.begin(), Reserved.end(),
+    [&copy] (const Reservation& reserved) {
+      return reserved.offset == copy.rangeOffset;
+    });
+  if (reservation != Reserved.end()) Reserved.erase(reservation);
+}
+
+void StagingRing::flushMappedRanges() {
+  if (Coherent) return;
+
+  std::vector<VkMappedMemoryRange> ranges;
+  ranges.reserve(PendingCopies.size());
+  for (const auto& copy : PendingCopies) {
+    const auto start = copy.rangeOffset / AtomSize * AtomSize;
+    const auto end   = alignUp(copy.rangeOffset + copy.rangeSize, AtomSize);
+
+    VkMappedMemoryRange range = {};
+    range.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = Memory.memory;
+    range.offset = Memory.offset + start;
+    range.size   = std::min(end, Ring.size()) - start;
+    ranges.push_back(range);
+  }
+  Owner.getDispatch().vkFlushMappedMemoryRanges(Owner.getVkDevice(),
+    static_cast<uint32_t>(ranges.size()), ranges.data());
+}
+
+} // namespace vwrap
@@ -0,0 +1,365 @@
+//---- src/vulkawrap/memory/sub_allocators.cc -------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  sub_allocators.cc
+/// \brief Implementation of the sub allocation strategies.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/memory/sub_allocators.h"
+#include <algorithm>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace vwrap {
+namespace {
+
+/// Gets the index of the most significant set bit of a non-zero value.
+///
+/// \param value The value to get the bit of.
+uint32_t mostSignificantBit(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+/// Gets the index of the least significant set bit of a non-zero value.
+///
+/// \param value The value to get the bit of.
+uint32_t leastSignificantBit(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+/// Gets the first and second level indices of the list which a free region
+/// of a size is stored in.
+///
+/// \param size        The size of the region.
+/// \param firstLevel  The first level index to set.
+/// \param secondLevel The second level index to set.
+void mapSize(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel) {
+  if (size < TlsfSecondLevelCountCx) {
+    firstLevel  = 0;
+    secondLevel = static_cast<uint32_t>(size);
+    return;
+  }
+  const auto msb = mostSignificantBit(size);
+  firstLevel     = msb - TlsfSecondLevelBitsCx + 1;
+  secondLevel    = static_cast<uint32_t>(
+    (size >> (msb - TlsfSecondLevelBitsCx)) - TlsfSecondLevelCountCx);
+}
+
+} // annonymous namespace
+
+//---- Tlsf -----------------------------------------------------------------//
+
+TlsfAllocator::TlsfAllocator(VkDeviceSize size)
+:   Size(size), UsedSize(0), FirstLevelBitmap(0) {
+  std::fill(std::begin(SecondLevelBitmaps), std::end(SecondLevelBitmaps), 0);
+  for (auto& lists : FreeLists)
+    std::fill(std::begin(lists), std::end(lists), InvalidSubAllocationCx);
+
+  if (size == 0) return;
+  const auto regionIdx = makeRegion();
+  auto& region         = Regions[regionIdx];
+  region.offset        = 0;
+  region.size          = size;
+  insertFree(regionIdx);
+}
+
+SubAllocation TlsfAllocator::allocate(VkDeviceSize size,
+                                      VkDeviceSize alignment) {
+  size      = std::max<VkDeviceSize>(size, 1);
+  alignment = std::max<VkDeviceSize>(alignment, 1);
+
+  // The worst case size would wrap around, and no region could fit it.
+  if (size > UINT64_MAX - (alignment - 1)) return SubAllocation();
+
+  // Search for a region which fits the worst case alignment padding, so that
+  // the region which is found always fits. If there is none, a region which
+  // only just fits may still be in the list for the size itself.
+  auto regionIdx = findFree(size + alignment - 1);
+  if (regionIdx == InvalidSubAllocationCx)
+    regionIdx = findFreeInList(size, alignment);
+  if (regionIdx == InvalidSubAllocationCx) return SubAllocation();
+  removeFree(regionIdx);
+
+  // Split the alignment padding off the front as a free region. The region
+  // before this one is never free, since free neighbours are always merged.
+  const auto alignedOffset = alignUp(Regions[regionIdx].offset, alignment);
+  const auto padding       = alignedOffset - Regions[regionIdx].offset;
+  if (padding > 0) {
+    const auto frontIdx = makeRegion();
+    auto& front         = Regions[frontIdx];
+    auto& region        = Regions[regionIdx];
+    front.offset        = region.offset;
+    front.size          = padding;
+    front.prevPhysical  = region.prevPhysical;
+    front.nextPhysical  = regionIdx;
+    if (front.prevPhysical != InvalidSubAllocationCx)
+      Regions[front.prevPhysical].nextPhysical = frontIdx;
+    region.prevPhysical = frontIdx;
+    region.offset       = alignedOffset;
+    region.size        -= padding;
+    insertFree(frontIdx);
+  }
+
+  // Split the rest of the region off the back as a free region.
+  if (Regions[regionIdx].size > size) {
+    const auto backIdx = makeRegion();
+    auto& back         = Regions[backIdx];
+    auto& region       = Regions[regionIdx];
+    back.offset        = region.offset + size;
+    back.size          = region.size - size;
+    back.prevPhysical  = regionIdx;
+    back.nextPhysical  = region.nextPhysical;
+    if (back.nextPhysical != InvalidSubAllocationCx)
+      Regions[back.nextPhysical].prevPhysical = backIdx;
+    region.nextPhysical = backIdx;
+    region.size         = size;
+    insertFree(backIdx);
+  }
+
+  auto& region = Regions[regionIdx];
+  region.free  = false;
+  UsedSize    += region.size;
+  return SubAllocation(region.offset, region.size, regionIdx);
+}
+
+void TlsfAllocator::free(uint32_t handle) {
+  if (handle == InvalidSubAllocationCx) return;
+  auto regionIdx = handle;
+  UsedSize      -= Regions[regionIdx].size;
+
+  // Merge with the next region, if it's free.
+  const auto nextIdx = Regions[regionIdx].nextPhysical;
+  if (nextIdx != InvalidSubAllocationCx && Regions[nextIdx].free) {
+    removeFree(nextIdx);
+    auto& region        = Regions[regionIdx];
+    region.size        += Regions[nextIdx].size;
+    region.nextPhysical = Regions[nextIdx].nextPhysical;
+    if (region.nextPhysical != InvalidSubAllocationCx)
+      Regions[region.nextPhysical].prevPhysical = regionIdx;
+    UnusedRegions.push_back(nextIdx);
+  }
+
+  // Merge into the previous region, if it's free.
+  const auto prevIdx = Regions[regionIdx].prevPhysical;
+  if (prevIdx != InvalidSubAllocationCx && Regions[prevIdx].free) {
+    removeFree(prevIdx);
+    auto& previous        = Regions[prevIdx];
+    previous.size        += Regions[regionIdx].size;
+    previous.nextPhysical = Regions[regionIdx].nextPhysical;
+    if (previous.nextPhysical != InvalidSubAllocationCx)
+      Regions[previous.nextPhysical].prevPhysical = prevIdx;
+    UnusedRegions.push_back(regionIdx);
+    regionIdx = prevIdx;
+  }
+  insertFree(regionIdx);
+}
+
+uint32_t TlsfAllocator::makeRegion() {
+  uint32_t regionIdx;
+  if (!UnusedRegions.empty()) {
+    regionIdx = UnusedRegions.back();
+    UnusedRegions.pop_back();
+  } else {
+    regionIdx = static_cast<uint32_t>(Regions.size());
+    Regions.emplace_back();
+  }
+  auto& region        = Regions[regionIdx];
+  region.offset       = 0;
+  region.size         = 0;
+  region.prevPhysical = InvalidSubAllocationCx;
+  region.nextPhysical = InvalidSubAllocationCx;
+  region.prevFree     = InvalidSubAllocationCx;
+  region.nextFree     = InvalidSubAllocationCx;
+  region.free         = false;
+  return regionIdx;
+}
+
+void TlsfAllocator::insertFree(uint32_t regionIdx) {
+  uint32_t firstLevel, secondLevel;
+  mapSize(Regions[regionIdx].size, firstLevel, secondLevel);
+
+  auto& head      = FreeLists[firstLevel][secondLevel];
+  auto& region    = Regions[regionIdx];
+  region.free     = true;
+  region.prevFree = InvalidSubAllocationCx;
+  region.nextFree = head;
+  if (head != InvalidSubAllocationCx)
+    Regions[head].prevFree = regionIdx;
+  head = regionIdx;
+
+  FirstLevelBitmap               |= uint64_t(1) << firstLevel;
+  SecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::removeFree(uint32_t regionIdx) {
+  uint32_t firstLevel, secondLevel;
+  mapSize(Regions[regionIdx].size, firstLevel, secondLevel);
+
+  auto& region = Regions[regionIdx];
+  if (region.prevFree != InvalidSubAllocationCx)
+    Regions[region.prevFree].nextFree = region.nextFree;
+  else
+    FreeLists[firstLevel][secondLevel] = region.nextFree;
+  if (region.nextFree != InvalidSubAllocationCx)
+    Regions[region.nextFree].prevFree = region.prevFree;
+  region.free = false;
+
+  if (FreeLists[firstLevel][secondLevel] == InvalidSubAllocationCx) {
+    SecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+    if (SecondLevelBitmaps[firstLevel] == 0)
+      FirstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+  }
+}
+
+uint32_t TlsfAllocator::findFree(VkDeviceSize size) const {
+  // Round the size up to the next list, so that every region in the list
+  // which is found is large enough.
+  if (size >= TlsfSecondLevelCountCx) {
+    const auto roundUp =
+      (VkDeviceSize(1) << (mostSignificantBit(size) - TlsfSecondLevelBitsCx))
+      - 1;
+    if (size > ~VkDeviceSize(0) - roundUp) return InvalidSubAllocationCx;
+    size += roundUp;
+  }
+
+  uint32_t firstLevel, secondLevel;
+  mapSize(size, firstLevel, secondLevel);
+
+  uint32_t secondLevelMap =
+    SecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+  if (secondLevelMap == 0) {
+    if (firstLevel + 1 >= TlsfFirstLevelCountCx) return InvalidSubAllocationCx;
+    const auto firstLevelMap =
+      FirstLevelBitmap & (~uint64_t(0) << (firstLevel + 1));
+    if (firstLevelMap == 0) return InvalidSubAllocationCx;
+
+    firstLevel     = leastSignificantBit(firstLevelMap);
+    secondLevelMap = SecondLevelBitmaps[firstLevel];
+  }
+  secondLevel = leastSignificantBit(secondLevelMap);
+  return FreeLists[firstLevel][secondLevel];
+}
+
+uint32_t TlsfAllocator::findFreeInList(VkDeviceSize size,
+                                       VkDeviceSize alignment) const {
+  uint32_t firstLevel, secondLevel;
+  mapSize(size, firstLevel, secondLevel);
+
+  for (auto regionIdx = FreeLists[firstLevel][secondLevel];
+       regionIdx != InvalidSubAllocationCx;
+       regionIdx = Regions[regionIdx].nextFree) {
+    const auto& region = Regions[regionIdx];
+    const auto  offset = alignUp(region.offset, alignment);
+    if (offset + size <= region.offset + region.size)
+      return regionIdx;
+  }
+  return InvalidSubAllocationCx;
+}
+
+//---- Linear ---------------------------------------------------------------//
+
+LinearAllocator::LinearAllocator(VkDeviceSize size) : Size(size), Head(0) {}
+
+SubAllocation LinearAllocator::allocate(VkDeviceSize size,
+                                        VkDeviceSize alignment) {
+  alignment = std::max<VkDeviceSize>(alignment, 1);
+
+  auto head = Head.load(std::memory_order_relaxed);
+  VkDeviceSize offset;
+  do {
+    offset = alignUp(head, alignment);
+    if (offset > Size || size > Size - offset) return SubAllocation();
+  } while (!Head.compare_exchange_weak(head, offset + size,
+             std::memory_order_relaxed, std::memory_order_relaxed));
+  return SubAllocation(offset, size, 0);
+}
+
+//---- Ring -----------------------------------------------------------------//
+
+RingAllocator::RingAllocator(VkDeviceSize size)
+:   Size(size), Head(0), Tail(0) {}
+
+SubAllocation RingAllocator::allocate(VkDeviceSize size,
+                                      VkDeviceSize alignment) {
+  if (Size == 0 || size > Size) return SubAllocation();
+
+  // Skip the rest of the range if the region doesn't fit before the end.
+  auto position = alignUp(Head, std::max<VkDeviceSize>(alignment, 1));
+  if (position % Size + size > Size)
+    position = (position / Size + 1) * Size;
+  if (position + size - Tail > Size) return SubAllocation();
+
+  Head = position + size;
+  return SubAllocation(position % Size, size, 0);
+}
+
+//---- Pool -----------------------------------------------------------------//
+
+PoolAllocator::PoolAllocator(VkDeviceSize slotSize, uint32_t slotCount)
+:   SlotSize(slotSize), SlotCount(slotCount),
+    Next(new std::atomic<uint32_t>[slotCount]), Head(0) {
+  for (uint32_t slotIdx = 0; slotIdx < slotCount; ++slotIdx) {
+    Next[slotIdx].store(slotIdx + 1 < slotCount ? slotIdx + 1
+                                                : InvalidSubAllocationCx,
+                        std::memory_order_relaxed);
+  }
+  Head.store(slotCount ? 0 : InvalidSubAllocationCx,
+             std::memory_order_relaxed);
+}
+
+SubAllocation PoolAllocator::allocate() {
+  auto head = Head.load(std::memory_order_acquire);
+  uint32_t slotIdx;
+  do {
+    slotIdx = static_cast<uint32_t>(head);
+    if (slotIdx == InvalidSubAllocationCx) return SubAllocation();
+
+    // The tag is incremented on every change of the head, so that if the
+    // slot is taken and given back between the load and the exchange, the
+    // exchange fails rather than using a stale next slot.
+    const uint64_t tag = (head >> 32) + 1;
+    const auto next    = Next[slotIdx].load(std::memory_order_relaxed);
+    if (Head.compare_exchange_weak(head, (tag << 32) | next,
+          std::memory_order_acquire, std::memory_order_acquire)) {
+      break;
+    }
+  } while (true);
+  return SubAllocation(slotIdx * SlotSize, SlotSize, slotIdx);
+}
+
+void PoolAllocator::free(uint32_t handle) {
+  if (handle == InvalidSubAllocationCx) return;
+
+  auto head = Head.load(std::memory_order_relaxed);
+  uint64_t newHead;
+  do {
+    Next[handle].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    newHead = (((head >> 32) + 1) << 32) | handle;
+  } while (!Head.compare_exchange_weak(head, newHead,
+             std::memory_order_release, std::memory_order_relaxed));
+}
+
+} // namespace vwrap
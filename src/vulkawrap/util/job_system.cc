@@ -0,0 +1,120 @@
+//---- src/vulkawrap/util/job_system.cc -------------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  job_system.cc
+/// \brief Implementation of the work stealing job system.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/util/job_system.h"
+
+namespace vwrap {
+namespace util  {
+
+//---- Public ---------------------------------------------------------------//
+
+JobSystem::JobSystem(uint32_t threadCount)
+:   NextTask(0), Remaining(0), Function(nullptr), Context(nullptr),
+    Generation(0), Stopping(false) {
+  threadCount = std::max(threadCount, 1u);
+  for (uint32_t threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+    Deques.push_back(std::make_unique<WorkStealingDeque<Task>>());
+  for (uint32_t threadIdx = 1; threadIdx < threadCount; ++threadIdx)
+    Workers.emplace_back(&JobSystem::workerLoop, this, threadIdx);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Stopping = true;
+  }
+  WorkAvailable.notify_all();
+  for (auto& worker : Workers) worker.join();
+}
+
+//---- Private --------------------------------------------------------------//
+
+void JobSystem::run(size_t count, RangeFunction function, void* context) {
+  if (count == 0) return;
+  std::lock_guard<std::mutex> runLock(RunMutex);
+  if (Workers.empty() || count == 1) {
+    function(context, 0, count);
+    return;
+  }
+
+  // Every split makes one task, and each execution wastes at most one when
+  // the deque is full, so twice the count is always enough.
+  Tasks.resize(2 * count);
+  NextTask.store(0, std::memory_order_relaxed);
+  Remaining.store(count, std::memory_order_relaxed);
+  Function = function;
+  Context  = context;
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    ++Generation;
+  }
+  WorkAvailable.notify_all();
+
+  execute(0, Task{ 0, count });
+  while (Remaining.load(std::memory_order_acquire) > 0) {
+    if (!runTask(0)) std::this_thread::yield();
+  }
+}
+
+void JobSystem::workerLoop(uint32_t threadIdx) {
+  uint64_t seenGeneration = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(Mutex);
+      WorkAvailable.wait(lock, [this, seenGeneration] {
+        return Stopping || Generation != seenGeneration;
+      });
+      if (Stopping) return;
+      seenGeneration = Generation;
+    }
+
+    while (Remaining.load(std::memory_order_acquire) > 0) {
+      if (!runTask(threadIdx)) std::this_thread::yield();
+    }
+  }
+}
+
+bool JobSystem::runTask(uint32_t threadIdx) {
+  auto task = Deques[threadIdx]->pop();
+
+  // Victims are visited in order from the next thread, so that thieves start
+  // at different deques.
+  const auto threadCount = getThreadCount();
+  for (uint32_t offset = 1; !task && offset < threadCount; ++offset)
+    task = Deques[(threadIdx + offset) % threadCount]->steal();
+
+  if (!task) return false;
+  execute(threadIdx, *task);
+  return true;
+}
+
+void JobSystem::execute(uint32_t threadIdx, Task task) {
+  auto& deque = *Deques[threadIdx];
+  while (task.end - task.begin > 1) {
+    const auto middle = task.begin + (task.end - task.begin) / 2;
+    auto&      upper  = Tasks[NextTask.fetch_add(1, std::memory_order_relaxed)];
+    upper.begin       = middle;
+    upper.end         = task.end;
+    if (!deque.push(&upper)) break;
+    task.end = middle;
+  }
+
+  Function(Context, task.begin, task.end);
+  Remaining.fetch_sub(task.end - task.begin, std::memory_order_acq_rel);
+}
+
+} // namespace util
+} // namespace vwrap
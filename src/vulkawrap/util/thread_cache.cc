@@ -0,0 +1,124 @@
+//---- src/vulkawrap/util/thread_cache.cc ------------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  thread_cache.cc
+/// \brief Implementation of the index of the per thread caches.
+//
+//---------------------------------------------------------------------------//
+
+#include "vulkawrap/util/thread_cache.h"
+#include <algorithm>
+
+namespace vwrap {
+namespace util  {
+namespace detail {
+
+/// The value of a thread for an index. The index is cleared by the index's
+/// destructor, from another thread, while the owning thread may be searching
+/// its entries for another index, so it is atomic.
+struct ThreadCacheEntry {
+  std::atomic<ThreadCacheIndex*> index;  //!< The index, or nullptr.
+  void*                          value;  //!< The value of the thread.
+
+  /// Constructor which sets the index and the value.
+  ///
+  /// \param entryIndex The index of the entry.
+  /// \param entryValue The value of the thread.
+  ThreadCacheEntry(ThreadCacheIndex* entryIndex, void* entryValue)
+  : index(entryIndex), value(entryValue) {}
+
+  /// Copy constructor, for the list of entries. The registry lock must be
+  /// held.
+  ///
+  /// \param other The entry to copy.
+  ThreadCacheEntry(const ThreadCacheEntry& other)
+  : index(other.index.load(std::memory_order_relaxed)), value(other.value) {}
+
+  /// Copy assignment, for the list of entries. The registry lock must be
+  /// held.
+  ///
+  /// \param other The entry to copy.
+  ThreadCacheEntry& operator=(const ThreadCacheEntry& other) {
+    index.store(other.index.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    value = other.value;
+    return *this;
+  }
+};
+
+/// The entries of a thread, for every index which it has used. When the
+/// thread exits the indices which it used forget it.
+struct ThreadCacheEntries {
+  std::vector<ThreadCacheEntry> entries;  //!< The entries of the thread.
+
+  /// Destructor which removes the thread from the indices it used.
+  ~ThreadCacheEntries();
+};
+
+namespace {
+
+/// Gets the lock which guards the list of threads of every index, and every
+/// change to the entries of a thread which another thread could see.
+std::mutex& registryMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+/// The entries of the calling thread.
+thread_local ThreadCacheEntries ThreadEntries;
+
+} // annonymous namespace
+
+ThreadCacheEntries::~ThreadCacheEntries() {
+  std::lock_guard<std::mutex> lock(registryMutex());
+  for (const auto& entry : entries) {
+    auto* index = entry.index.load(std::memory_order_relaxed);
+    if (!index) continue;
+    auto& threads = index->Threads;
+    threads.erase(std::remove(threads.begin(), threads.end(), this),
+                  threads.end());
+  }
+}
+
+//---- Public ---------------------------------------------------------------//
+
+ThreadCacheIndex::~ThreadCacheIndex() {
+  std::lock_guard<std::mutex> lock(registryMutex());
+  for (auto* thread : Threads) {
+    for (auto& entry : thread->entries) {
+      if (entry.index.load(std::memory_order_relaxed) == this)
+        entry.index.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+}
+
+void* ThreadCacheIndex::find() const {
+  for (const auto& entry : ThreadEntries.entries) {
+    if (entry.index.load(std::memory_order_relaxed) == this)
+      return entry.value;
+  }
+  return nullptr;
+}
+
+void ThreadCacheIndex::insert(void* value) {
+  std::lock_guard<std::mutex> lock(registryMutex());
+  auto& entries = ThreadEntries.entries;
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+    [] (const ThreadCacheEntry& entry) {
+      return entry.index.load(std::memory_order_relaxed) == nullptr;
+    }), entries.end());
+  entries.emplace_back(this, value);
+  Threads.push_back(&ThreadEntries);
+}
+
+} // namespace detail
+} // namespace util
+} // namespace vwrap
@@ -0,0 +1,109 @@
+//---- tests/vulkawrap/device/command_pools_tests.cc -------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  command_pools_tests.cc
+/// \brief Tests the command pool manager for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapCommandPoolsTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/command_pools.h"
+#include <boost/test/unit_test.hpp>
+#include <set>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapCommandPoolsSuite )
+
+using namespace vwrap;
+
+BOOST_AUTO_TEST_CASE( CommandPoolsReuseThePoolOfAThread ) {
+  mock::MockDevice mock;
+  {
+    CommandPoolManager commandPools(mock.device);
+    commandPools.beginFrame();
+
+    // A batch of buffers comes from a single pool, with one driver call.
+    std::set<VkCommandBuffer> buffers;
+    for (uint32_t bufferIdx = 0; bufferIdx < CommandBufferBatchSizeCx;
+         ++bufferIdx) {
+      buffers.insert(commandPools.allocate(0));
+    }
+    BOOST_CHECK_EQUAL( buffers.size(), CommandBufferBatchSizeCx );
+    BOOST_CHECK( buffers.count(VK_NULL_HANDLE) == 0 );
+    BOOST_CHECK_EQUAL( mock::counts().liveCommandPools.load(), 1 );
+    BOOST_CHECK_EQUAL( mock::counts().commandBuffers.load(),
+                       static_cast<int>(CommandBufferBatchSizeCx) );
+
+    // Another thread gets a pool of its own.
+    VkCommandBuffer otherBuffer = VK_NULL_HANDLE;
+    std::thread other([&] { otherBuffer = commandPools.allocate(0); });
+    other.join();
+    BOOST_CHECK( otherBuffer != VK_NULL_HANDLE );
+    BOOST_CHECK( buffers.count(otherBuffer) == 0 );
+    BOOST_CHECK_EQUAL( mock::counts().liveCommandPools.load(), 2 );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveCommandPools.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( CommandPoolsResetASlotWhenItComesAround ) {
+  mock::MockDevice   mock;
+  CommandPoolManager commandPools(mock.device, 2);
+  const auto         frameFence = mock::fakeHandle<VkFence>(1);
+
+  BOOST_CHECK_EQUAL( commandPools.beginFrame(), 0u );
+  const auto firstBuffer = commandPools.allocate(0);
+  commandPools.endFrame(frameFence);
+
+  // The other slot has its own pool, and nothing to wait for.
+  BOOST_CHECK_EQUAL( commandPools.beginFrame(), 1u );
+  BOOST_CHECK( commandPools.allocate(0) != firstBuffer );
+  commandPools.endFrame(VK_NULL_HANDLE);
+  BOOST_CHECK_EQUAL( mock::counts().fenceWaits.load(), 0 );
+  BOOST_CHECK_EQUAL( mock::counts().liveCommandPools.load(), 2 );
+
+  // When the first slot comes around its fence is waited on, and its pool is
+  // reset, so the buffers are reused without calling the driver.
+  const auto allocated = mock::counts().commandBuffers.load();
+  BOOST_CHECK_EQUAL( commandPools.beginFrame(), 0u );
+  BOOST_CHECK_EQUAL( mock::counts().fenceWaits.load(), 1 );
+  BOOST_CHECK_EQUAL( mock::counts().commandPoolResets.load(), 1 );
+  BOOST_CHECK( commandPools.allocate(0) == firstBuffer );
+  BOOST_CHECK_EQUAL( mock::counts().commandBuffers.load(), allocated );
+  BOOST_CHECK_EQUAL( mock::counts().liveCommandPools.load(), 2 );
+}
+
+BOOST_AUTO_TEST_CASE( CommandPoolsHaveAPoolForEachFamily ) {
+  mock::MockDevice   mock(3);
+  CommandPoolManager commandPools(mock.device);
+  commandPools.beginFrame();
+
+  // The families come from the capabilities of the physical device, so the
+  // last family is valid and the one after it isn't.
+  BOOST_CHECK( commandPools.allocate(0) != VK_NULL_HANDLE );
+  BOOST_CHECK( commandPools.allocate(2) != VK_NULL_HANDLE );
+  BOOST_CHECK( commandPools.allocate(3) == VK_NULL_HANDLE );
+  BOOST_CHECK_EQUAL( mock::counts().liveCommandPools.load(), 2 );
+
+  // A type of work uses the pool of the family it was allocated from.
+  const auto transferFamily =
+    mock.device.getQueueFamily(QueueType::VW_TRANSFER_QUEUE);
+  BOOST_CHECK( commandPools.allocate(QueueType::VW_TRANSFER_QUEUE) !=
+               VK_NULL_HANDLE );
+  BOOST_CHECK_EQUAL( mock::counts().liveCommandPools.load(),
+                     transferFamily == 1 ? 3 : 2 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,173 @@
+//---- tests/vulkawrap/device/descriptors_tests.cc --------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  descriptors_tests.cc
+/// \brief Tests the descriptor allocator for Vulkawrap, against a mock
+///        driver.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapDescriptorTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/descriptors.h"
+#include "vulkawrap/device/object_interner.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <set>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapDescriptorSuite )
+
+using namespace vwrap;
+
+// Makes a list of bindings with a uniform buffer and a sampled texture.
+LayoutBindingVec materialBindings() {
+  LayoutBindingVec bindings(2);
+  bindings[0].binding         = 0;
+  bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+  bindings[1].binding         = 1;
+  bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[1].descriptorCount = 1;
+  bindings[1].stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+  return bindings;
+}
+
+BOOST_AUTO_TEST_CASE( IdenticalBindingsShareALayout ) {
+  const auto dispatch = mock::mockDispatch();
+  {
+    ObjectInterner      interner(dispatch);
+    DescriptorAllocator descriptors(interner, 2);
+    auto bindings = materialBindings();
+    const auto first  = descriptors.getLayout(bindings);
+    const auto second = descriptors.getLayout(materialBindings());
+    BOOST_CHECK( first != nullptr );
+    BOOST_CHECK( first == second );
+
+    // The layout is the interned one, so bindings in another order, or from
+    // the interner, are the same layout.
+    const LayoutBindingVec reversed = { bindings[1], bindings[0] };
+    BOOST_CHECK( descriptors.getLayout(reversed) == first );
+    BOOST_CHECK( interner.getSetLayout(reversed) == first->layout );
+    BOOST_CHECK_EQUAL( mock::counts().liveSetLayouts.load(), 1 );
+    BOOST_CHECK_EQUAL( first->poolSizes.size(), 2u );
+    BOOST_CHECK_EQUAL( first->poolSizes[0].descriptorCount,
+                       DescriptorSetsPerPoolCx );
+
+    bindings[1].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    BOOST_CHECK( descriptors.getLayout(bindings) != first );
+    BOOST_CHECK_EQUAL( mock::counts().liveSetLayouts.load(), 2 );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveSetLayouts.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( FramePoolsAreResetAndReused ) {
+  const auto dispatch = mock::mockDispatch();
+  {
+    ObjectInterner      interner(dispatch);
+    DescriptorAllocator descriptors(interner, 2);
+    const auto layout = descriptors.getLayout(materialBindings());
+
+    // Filling more than one pool grows the list for the layout.
+    descriptors.beginFrame();
+    for (uint32_t setIdx = 0; setIdx < DescriptorSetsPerPoolCx + 1; ++setIdx)
+      BOOST_CHECK( descriptors.allocate(*layout) != VK_NULL_HANDLE );
+    BOOST_CHECK_EQUAL( mock::counts().liveDescriptorPools.load(), 2 );
+
+    // The other slot gets its own pool.
+    descriptors.beginFrame();
+    descriptors.allocate(*layout);
+    BOOST_CHECK_EQUAL( mock::counts().liveDescriptorPools.load(), 3 );
+    BOOST_CHECK_EQUAL( mock::counts().descriptorPoolResets.load(), 0 );
+
+    // Coming back to the first slot resets both of its pools, which are then
+    // reused rather than creating more.
+    descriptors.beginFrame();
+    BOOST_CHECK_EQUAL( mock::counts().descriptorPoolResets.load(), 2 );
+    for (uint32_t setIdx = 0; setIdx < DescriptorSetsPerPoolCx + 1; ++setIdx)
+      descriptors.allocate(*layout);
+    BOOST_CHECK_EQUAL( mock::counts().liveDescriptorPools.load(), 3 );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveDescriptorPools.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( AllocatedSetsAreWrittenOnce ) {
+  const auto          dispatch = mock::mockDispatch();
+  ObjectInterner      interner(dispatch);
+  DescriptorAllocator descriptors(interner, 2);
+  const auto layout = descriptors.getLayout(materialBindings());
+
+  descriptors.allocate(*layout);
+  BOOST_CHECK_EQUAL( mock::counts().descriptorUpdates.load(), 0 );
+  descriptors.allocate(*layout, {
+    DescriptorWrite::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                            VK_NULL_HANDLE, 0, 64),
+    DescriptorWrite::image(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                           VK_NULL_HANDLE, VK_NULL_HANDLE,
+                           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) });
+  BOOST_CHECK_EQUAL( mock::counts().descriptorUpdates.load(), 1 );
+}
+
+BOOST_AUTO_TEST_CASE( CachedSetsAreReused ) {
+  const auto          dispatch = mock::mockDispatch();
+  ObjectInterner      interner(dispatch);
+  DescriptorAllocator descriptors(interner, 2);
+  const auto layout = descriptors.getLayout(materialBindings());
+  const DescriptorWriteVec first  = {
+    DescriptorWrite::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                            VK_NULL_HANDLE, 0, 64) };
+  const DescriptorWriteVec second = {
+    DescriptorWrite::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                            VK_NULL_HANDLE, 64, 64) };
+
+  const auto set = descriptors.getCachedSet(*layout, first);
+  BOOST_CHECK( descriptors.getCachedSet(*layout, first) == set );
+  BOOST_CHECK( descriptors.getCachedSet(*layout, second) != set );
+  BOOST_CHECK_EQUAL( mock::counts().descriptorUpdates.load(), 2 );
+
+  // Another thread finds the set in the shared cache.
+  VkDescriptorSet otherSet = VK_NULL_HANDLE;
+  std::thread other([&] {
+    otherSet = descriptors.getCachedSet(*layout, first);
+  });
+  other.join();
+  BOOST_CHECK( otherSet == set );
+  BOOST_CHECK_EQUAL( mock::counts().descriptorUpdates.load(), 2 );
+  BOOST_CHECK_EQUAL( descriptors.getCachedSetCount(), 2u );
+
+  // Clearing the cache makes every thread write the set again.
+  descriptors.clearCachedSets();
+  BOOST_CHECK_EQUAL( descriptors.getCachedSetCount(), 0u );
+  descriptors.getCachedSet(*layout, first);
+  BOOST_CHECK_EQUAL( mock::counts().descriptorUpdates.load(), 3 );
+}
+
+BOOST_AUTO_TEST_CASE( SignaturesDifferForDifferentDescriptors ) {
+  const detail::DescriptorSignatureHash hash;
+  std::set<size_t> hashes;
+  for (uint32_t binding = 0; binding < 4; ++binding) {
+    for (VkDeviceSize offset = 0; offset < 256; offset += 64) {
+      detail::DescriptorSignature signature;
+      detail::appendSignature(0, {
+        DescriptorWrite::buffer(binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                VK_NULL_HANDLE, offset, 64) }, signature);
+      hashes.insert(hash(signature));
+    }
+  }
+  BOOST_CHECK_EQUAL( hashes.size(), 16u );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+//---- tests/vulkawrap/device/filter_tests.cc -------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  filter_tests.cc
+/// \brief Tests the device filtering functionality for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapFilterTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/filter.h"
+#include <boost/test/unit_test.hpp>
+#include <type_traits>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapFilterSuite )
+
+using namespace vwrap;
+
+// Makes the capabilities of a fake device.
+DeviceCapabilities makeDevice(VkPhysicalDeviceType type, 
+    VkDeviceSize localMemoryGiB, bool dedicatedTransfer) {
+  DeviceCapabilities capabilities;
+  capabilities.properties.deviceType                            = type;
+  capabilities.properties.limits.maxComputeWorkGroupInvocations = 1024;
+  capabilities.memoryProperties.memoryHeapCount                 = 1;
+  capabilities.memoryProperties.memoryHeaps[0].flags            = 
+    VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+  capabilities.memoryProperties.memoryHeaps[0].size             = 
+    localMemoryGiB << 30;
+
+  VkQueueFamilyProperties family = {};
+  family.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+  family.queueCount = 1;
+  capabilities.queueFamilies.push_back(family);
+  if (dedicatedTransfer) {
+    family.queueFlags = VK_QUEUE_TRANSFER_BIT;
+    capabilities.queueFamilies.push_back(family);
+  }
+  return capabilities;
+}
+
+BOOST_AUTO_TEST_CASE( DefaultScoringPolicyScoresZero ) {
+  const auto device = makeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, true);
+  BOOST_CHECK_EQUAL( scoreDevice(device, ScoringPolicy()), 0.0f );
+}
+
+BOOST_AUTO_TEST_CASE( ThroughputPolicyPrefersDiscreteGpu ) {
+  const auto policy     = ScoringPolicy::throughput();
+  const auto integrated = 
+    makeDevice(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 16, true);
+  const auto discrete   = 
+    makeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4, false);
+
+  BOOST_CHECK_GT( scoreDevice(discrete, policy), 
+                  scoreDevice(integrated, policy) );
+}
+
+BOOST_AUTO_TEST_CASE( ThroughputPolicyPrefersMoreMemoryAndTransferFamily ) {
+  const auto policy  = ScoringPolicy::throughput();
+  const auto small   = makeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4, 
+                         false);
+  const auto large   = makeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, 
+                         false);
+  const auto largeDt = makeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, 
+                         true);
+
+  BOOST_CHECK_GT( scoreDevice(large, policy)  , scoreDevice(small, policy) );
+  BOOST_CHECK_GT( scoreDevice(largeDt, policy), scoreDevice(large, policy) );
+}
+
+// Makes a device which has been matched and scored.
+PhysicalDevice makeMatch(uintptr_t handle, uint32_t specifier, float score) {
+  PhysicalDevice device(mock::fakeHandle<VkPhysicalDevice>(handle));
+  device.specifier = specifier;
+  device.score     = score;
+  return device;
+}
+
+BOOST_AUTO_TEST_CASE( DevicesAreRankedWithinTheirSpecifier ) {
+  // Devices are added device by device, so the specifiers are interleaved,
+  // and the second specifier's scores are on a much larger scale.
+  PhysicalDeviceVec devices = {
+    makeMatch(1, 0, 1.0f), makeMatch(1, 1, 500.0f),
+    makeMatch(2, 0, 3.0f), makeMatch(2, 1, 100.0f),
+    makeMatch(3, 0, 1.0f), makeMatch(3, 1, 900.0f),
+    makeMatch(4, 0, 3.0f)
+  };
+  rankPhysicalDevices(devices);
+
+  // Ties stay in enumeration order.
+  const uintptr_t expectedHandles[]    = { 2, 4, 1, 3, 3, 1, 2 };
+  const uint32_t  expectedSpecifiers[] = { 0, 0, 0, 0, 1, 1, 1 };
+  BOOST_REQUIRE_EQUAL( devices.size(), 7u );
+  for (size_t deviceIdx = 0; deviceIdx < devices.size(); ++deviceIdx) {
+    BOOST_CHECK_EQUAL( reinterpret_cast<uintptr_t>(devices[deviceIdx].device),
+                       expectedHandles[deviceIdx] );
+    BOOST_CHECK_EQUAL( devices[deviceIdx].specifier, 
+                       expectedSpecifiers[deviceIdx] );
+  }
+}
+
+// Specifiers are built at compile time.
+constexpr DeviceSpecifier computeDevice(DeviceType::VW_DISCRETE_GPU,
+  QueueType::VW_COMPUTE_QUEUE, QueueType::VW_TRANSFER_QUEUE);
+static_assert(computeDevice.queueTypes == 0x06 &&
+              computeDevice.needsQueue(QueueType::VW_TRANSFER_QUEUE) &&
+              !computeDevice.needsQueue(QueueType::VW_GRAPHICS_QUEUE),
+              "Specifiers must be constant expressions.");
+static_assert(queueFamilyTypes(VK_QUEUE_TRANSFER_BIT) ==
+              queueTypeMask(QueueType::VW_TRANSFER_QUEUE, QueueType::VW_ANY),
+              "Every queue family must match VW_ANY.");
+
+// Constant and temporary specifiers can be given to a filter.
+static_assert(std::is_constructible<DeviceFilter, UniqueInstance,
+                const DeviceSpecifier&, DeviceSpecifier>::value,
+              "Filters must only read their specifiers.");
+
+BOOST_AUTO_TEST_CASE( SupportedQueuesAreMatchedAgainstTheMask ) {
+  const auto device = makeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, true);
+  const DeviceSpecifier graphicsAndTransfer(DeviceType::VW_ANY,
+    QueueType::VW_GRAPHICS_QUEUE, QueueType::VW_TRANSFER_QUEUE);
+
+  PhysicalDevice physicalDevice(device);
+  physicalDevice.addSupportedQueues(device.queueFamilies, 
+    graphicsAndTransfer.queueTypes);
+  BOOST_CHECK( physicalDevice.queueTypes == graphicsAndTransfer.queueTypes );
+  BOOST_CHECK_EQUAL( physicalDevice.queueFamilies, 0x3u );
+  BOOST_CHECK( graphicsAndTransfer.isSatisfiedBy(physicalDevice.queueTypes) );
+
+  // Without the transfer family, only some of the queues are supported.
+  const auto noTransfer = 
+    makeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, false);
+  PhysicalDevice partialDevice(noTransfer);
+  partialDevice.addSupportedQueues(noTransfer.queueFamilies, 
+    graphicsAndTransfer.queueTypes);
+  BOOST_CHECK( !graphicsAndTransfer.isSatisfiedBy(partialDevice.queueTypes) );
+  BOOST_CHECK( DeviceSpecifier(DeviceType::VW_ANY, false, 
+                 QueueType::VW_GRAPHICS_QUEUE, QueueType::VW_TRANSFER_QUEUE)
+                 .isSatisfiedBy(partialDevice.queueTypes) );
+}
+
+BOOST_AUTO_TEST_CASE( AnyQueueMatchesEveryFamily ) {
+  const auto device = makeDevice(VK_PHYSICAL_DEVICE_TYPE_CPU, 1, true);
+  const DeviceSpecifier anyQueue(DeviceType::VW_ANY, QueueType::VW_ANY);
+
+  PhysicalDevice physicalDevice(device);
+  physicalDevice.addSupportedQueues(device.queueFamilies, anyQueue.queueTypes);
+  BOOST_CHECK_EQUAL( physicalDevice.queueFamilies, 0x3u );
+  BOOST_CHECK( anyQueue.isSatisfiedBy(physicalDevice.queueTypes) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,215 @@
+//---- tests/vulkawrap/device/gpu_profiler_tests.cc -------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  gpu_profiler_tests.cc
+/// \brief Tests the GPU profiler for Vulkawrap, against a mock driver which
+///        writes timestamps from a fake clock.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapGpuProfilerTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/gpu_profiler.h"
+#include <boost/test/unit_test.hpp>
+#include <map>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapGpuProfilerSuite )
+
+using namespace vwrap;
+
+// The state of the timestamp queries of the mock driver. Each timestamp which
+// is written reads the fake clock, and the results of a pool are only
+// available once the test marks them as finished.
+static uint64_t                                      clockTicks = 0;
+static std::map<VkQueryPool, std::vector<uint64_t>> timestamps;
+static std::map<VkQueryPool, bool>                   finished;
+static int                                           resultCalls = 0;
+
+VkResult VKAPI_PTR mockCreateQueryPool(VkDevice device,
+    const VkQueryPoolCreateInfo* createInfo,
+    const VkAllocationCallbacks* allocator, VkQueryPool* pool) {
+  mock::createQueryPool(device, createInfo, allocator, pool);
+  timestamps[*pool].assign(createInfo->queryCount, 0);
+  return VK_SUCCESS;
+}
+
+void VKAPI_PTR mockCmdResetQueryPool(VkCommandBuffer, VkQueryPool pool,
+    uint32_t, uint32_t) {
+  finished[pool] = false;
+}
+
+void VKAPI_PTR mockCmdWriteTimestamp(VkCommandBuffer, VkPipelineStageFlagBits,
+    VkQueryPool pool, uint32_t query) {
+  timestamps[pool][query] = clockTicks;
+}
+
+VkResult VKAPI_PTR mockGetQueryPoolResults(VkDevice, VkQueryPool pool,
+    uint32_t firstQuery, uint32_t queryCount, size_t, void* data,
+    VkDeviceSize stride, VkQueryResultFlags flags) {
+  ++resultCalls;
+  BOOST_CHECK( (flags & VK_QUERY_RESULT_WAIT_BIT) == 0 );
+  if (!finished[pool]) return VK_NOT_READY;
+  auto* results = static_cast<uint8_t*>(data);
+  for (uint32_t queryIdx = 0; queryIdx < queryCount; ++queryIdx) {
+    *reinterpret_cast<uint64_t*>(results + queryIdx * stride) =
+      timestamps[pool][firstQuery + queryIdx];
+  }
+  return VK_SUCCESS;
+}
+
+// Creates a dispatch table which uses the mock driver, with timestamps.
+loader::DeviceDispatch timestampDispatch() {
+  auto dispatch = mock::mockDispatch();
+  dispatch.vkCreateQueryPool     = mockCreateQueryPool;
+  dispatch.vkCmdResetQueryPool   = mockCmdResetQueryPool;
+  dispatch.vkCmdWriteTimestamp   = mockCmdWriteTimestamp;
+  dispatch.vkGetQueryPoolResults = mockGetQueryPoolResults;
+  return dispatch;
+}
+
+// Marks the work of every pool as finished.
+void finishAll() {
+  for (auto& pool : finished) pool.second = true;
+}
+
+BOOST_AUTO_TEST_CASE( ScopesNestAndAreConvertedWithThePeriod ) {
+  const auto dispatch = timestampDispatch();
+  {
+    GpuProfiler profiler(dispatch, 2.0f, 64, 2, 16);
+    BOOST_CHECK_EQUAL( mock::counts().liveQueryPools.load(), 2 );
+
+    clockTicks = 100;
+    profiler.beginFrame(VK_NULL_HANDLE);
+    {
+      GpuScope shadows(profiler, VK_NULL_HANDLE, "shadows");
+      clockTicks = 110;
+      {
+        GpuScope cascade(profiler, VK_NULL_HANDLE, "cascade");
+        clockTicks = 130;
+      }
+    }
+    clockTicks = 150;
+    profiler.endFrame(VK_NULL_HANDLE);
+
+    finishAll();
+    profiler.resolve();
+    const auto frames = profiler.takeFrames();
+    BOOST_REQUIRE_EQUAL( frames.size(), 1u );
+    const auto& scopes = frames[0].scopes;
+    BOOST_REQUIRE_EQUAL( scopes.size(), 3u );
+
+    BOOST_CHECK_EQUAL( scopes[0].parent, InvalidScopeCx );
+    BOOST_CHECK_EQUAL( scopes[0].durationNs, 100.0 );
+    BOOST_CHECK_EQUAL( scopes[1].name, "shadows" );
+    BOOST_CHECK_EQUAL( scopes[1].parent, 0u );
+    BOOST_CHECK_EQUAL( scopes[1].durationNs, 60.0 );
+    BOOST_CHECK_EQUAL( scopes[2].parent, 1u );
+    BOOST_CHECK_EQUAL( scopes[2].depth, 2u );
+    BOOST_CHECK_EQUAL( scopes[2].beginNs, 20.0 );
+    BOOST_CHECK_EQUAL( scopes[2].durationNs, 40.0 );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveQueryPools.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( UnfinishedFramesAreDroppedRatherThanWaitedFor ) {
+  const auto dispatch = timestampDispatch();
+  GpuProfiler profiler(dispatch, 1.0f, 64, 2, 16);
+  finished.clear();
+
+  // Nothing finishes for three frames, so the first frame's queries are
+  // reused before its results are read.
+  resultCalls = 0;
+  for (int frameIdx = 0; frameIdx < 3; ++frameIdx) {
+    profiler.beginFrame(VK_NULL_HANDLE);
+    profiler.endFrame(VK_NULL_HANDLE);
+  }
+  BOOST_CHECK( resultCalls > 0 );
+  BOOST_CHECK( profiler.takeFrames().empty() );
+  BOOST_CHECK_EQUAL( profiler.getDroppedFrameCount(), 1u );
+
+  finishAll();
+  profiler.resolve();
+  const auto frames = profiler.takeFrames();
+  BOOST_REQUIRE_EQUAL( frames.size(), 2u );
+  BOOST_CHECK_EQUAL( frames[0].frame, 1u );
+  BOOST_CHECK_EQUAL( frames[1].frame, 2u );
+}
+
+BOOST_AUTO_TEST_CASE( ScopesBeyondTheQueryBudgetAreSkipped ) {
+  const auto dispatch = timestampDispatch();
+  GpuProfiler profiler(dispatch, 1.0f, 64, 1, 4);
+
+  profiler.beginFrame(VK_NULL_HANDLE);
+  const auto first  = profiler.beginScope(VK_NULL_HANDLE, "first");
+  const auto second = profiler.beginScope(VK_NULL_HANDLE, "second");
+  BOOST_CHECK( first  != InvalidScopeCx );
+  BOOST_CHECK_EQUAL( second, InvalidScopeCx );
+  profiler.endScope(VK_NULL_HANDLE, second);
+  profiler.endScope(VK_NULL_HANDLE, first);
+  profiler.endFrame(VK_NULL_HANDLE);
+
+  finishAll();
+  profiler.resolve();
+  const auto frames = profiler.takeFrames();
+  BOOST_REQUIRE_EQUAL( frames.size(), 1u );
+  BOOST_CHECK_EQUAL( frames[0].scopes.size(), 2u );
+}
+
+BOOST_AUTO_TEST_CASE( DeviceProfilersUseTheValidBitsOfTheFamily ) {
+  auto capabilities = mock::mockCapabilities();
+  capabilities.queueFamilies[0].timestampValidBits = 8;
+  const auto instance    = mock::mockInstanceDispatch();
+  mock::deviceFunctions() = timestampDispatch();
+  Device device(instance, PhysicalDevice(capabilities));
+  GpuProfiler profiler(device, 1, 4);
+
+  // The clock wraps past the eight valid bits during the frame, and only
+  // those bits are written to the queries.
+  clockTicks = 250;
+  profiler.beginFrame(VK_NULL_HANDLE);
+  clockTicks = 260 & 0xFF;
+  profiler.endFrame(VK_NULL_HANDLE);
+
+  finishAll();
+  profiler.resolve();
+  const auto frames = profiler.takeFrames();
+  BOOST_REQUIRE_EQUAL( frames.size(), 1u );
+  BOOST_CHECK_EQUAL( frames[0].scopes[0].durationNs, 10.0 );
+}
+
+BOOST_AUTO_TEST_CASE( ChromeTraceHasACompleteEventPerScope ) {
+  GpuFrameTimings frame{ 7, {} };
+  frame.scopes.push_back(
+    GpuScopeTiming{ "Frame", InvalidScopeCx, 0, 0.0, 2000.0 });
+  frame.scopes.push_back(
+    GpuScopeTiming{ "say \"hi\"", 0, 1, 500.0, 1000.0 });
+
+  const auto trace = GpuProfiler::toChromeTrace({ frame });
+  BOOST_CHECK( trace.find("\"traceEvents\"") != std::string::npos );
+  BOOST_CHECK( trace.find("\"name\":\"say \\\"hi\\\"\"") !=
+               std::string::npos );
+  BOOST_CHECK( trace.find("\"ts\":0.500,\"dur\":1.000") !=
+               std::string::npos );
+  BOOST_CHECK( trace.find("\"frame\":7") != std::string::npos );
+
+  size_t events = 0;
+  for (auto pos = trace.find("\"ph\":\"X\""); pos != std::string::npos;
+       pos = trace.find("\"ph\":\"X\"", pos + 1))
+    ++events;
+  BOOST_CHECK_EQUAL( events, 2u );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
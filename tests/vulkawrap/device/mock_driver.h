@@ -0,0 +1,637 @@
+//---- tests/vulkawrap/device/mock_driver.h ----------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  mock_driver.h
+/// \brief A mock Vulkan driver for the tests, which makes fake handles and
+///        counts the objects which it has alive. Tests which need a
+///        function to behave differently replace it in the dispatch table.
+//
+//---------------------------------------------------------------------------//
+
+#ifndef VULKAWRAP_TESTS_DEVICE_MOCK_DRIVER_H
+#define VULKAWRAP_TESTS_DEVICE_MOCK_DRIVER_H
+
+#include "vulkawrap/device/device.h"
+#include "vulkawrap/loader/dispatch.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace mock {
+
+/// Makes a fake handle, which is only compared and never used.
+///
+/// \param  value The value of the handle.
+/// \tparam VkT   The type of the handle.
+template <typename VkT>
+VkT fakeHandle(uintptr_t value) {
+  return reinterpret_cast<VkT>(value);
+}
+
+/// Counts of the objects which the mock driver has alive, and of the calls
+/// which are made to it.
+struct DriverCounts {
+  std::atomic<uintptr_t> nextObject;           //!< The next handle value.
+  std::atomic<int>       liveFences;           //!< Fences alive.
+  std::atomic<int>       fenceResetCalls;      //!< Calls to vkResetFences.
+  std::atomic<int>       resetFences;          //!< Fences which were reset.
+  std::atomic<int>       liveSetLayouts;       //!< Set layouts alive.
+  std::atomic<int>       livePipelineLayouts;  //!< Pipeline layouts alive.
+  std::atomic<int>       liveSamplers;         //!< Samplers alive.
+  std::atomic<int>       liveDescriptorPools;  //!< Descriptor pools alive.
+  std::atomic<int>       descriptorPoolResets; //!< Descriptor pool resets.
+  std::atomic<int>       descriptorUpdates;    //!< Descriptor set updates.
+  std::atomic<int>       liveRenderPasses;     //!< Render passes alive.
+  std::atomic<int>       liveFramebuffers;     //!< Framebuffers alive.
+  std::atomic<int>       liveQueryPools;       //!< Query pools alive.
+  std::atomic<int>       liveCommandPools;     //!< Command pools alive.
+  std::atomic<int>       commandPoolResets;    //!< Command pool resets.
+  std::atomic<int>       commandBuffers;       //!< Command buffers made.
+  std::atomic<int>       fenceWaits;           //!< Calls to vkWaitForFences.
+  std::atomic<int>       liveBuffers;          //!< Buffers alive.
+  std::atomic<int>       liveMemory;           //!< Memory allocations alive.
+  std::atomic<int>       bufferCopies;         //!< Buffer regions copied.
+  std::atomic<int>       submits;              //!< Queue submissions.
+  std::atomic<int>       completedSubmits;     //!< Submissions which the
+                                               //!< device has finished.
+  std::atomic<int>       liveSemaphores;       //!< Semaphores alive.
+
+  /// Resets all the counts.
+  void reset() {
+    nextObject           = 1;
+    liveFences           = 0;
+    fenceResetCalls      = 0;
+    resetFences          = 0;
+    liveSetLayouts       = 0;
+    livePipelineLayouts  = 0;
+    liveSamplers         = 0;
+    liveDescriptorPools  = 0;
+    descriptorPoolResets = 0;
+    descriptorUpdates    = 0;
+    liveRenderPasses     = 0;
+    liveFramebuffers     = 0;
+    liveQueryPools       = 0;
+    liveCommandPools     = 0;
+    commandPoolResets    = 0;
+    commandBuffers       = 0;
+    fenceWaits           = 0;
+    liveBuffers          = 0;
+    liveMemory           = 0;
+    bufferCopies         = 0;
+    submits              = 0;
+    completedSubmits     = 0;
+    liveSemaphores       = 0;
+
+    std::lock_guard<std::mutex> lock(submitMutex);
+    submitFences.clear();
+  }
+
+  /// Gets the number of submissions which must complete before a fence is
+  /// signalled, or zero if it was never submitted. The submit lock must be
+  /// held.
+  ///
+  /// \param fence The fence to look for.
+  int submitsForFence(VkFence fence) const {
+    const auto submit = std::find(submitFences.rbegin(), submitFences.rend(),
+                          fence);
+    return static_cast<int>(submitFences.rend() - submit);
+  }
+
+  std::mutex           submitMutex;   //!< Protects the submitted fences.
+  std::vector<VkFence> submitFences;  //!< The fence of each submission.
+};
+
+/// Gets the counts of the mock driver.
+inline DriverCounts& counts() {
+  static DriverCounts driverCounts;
+  return driverCounts;
+}
+
+/// Makes a new fake handle, which no other object of the mock driver has.
+///
+/// \tparam VkT The type of the handle.
+template <typename VkT>
+VkT nextFakeHandle() {
+  return fakeHandle<VkT>(counts().nextObject.fetch_add(1));
+}
+
+//---- Device functions -----------------------------------------------------//
+
+inline VkResult VKAPI_PTR createFence(VkDevice, const VkFenceCreateInfo*,
+    const VkAllocationCallbacks*, VkFence* fence) {
+  *fence = nextFakeHandle<VkFence>();
+  ++counts().liveFences;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroyFence(VkDevice, VkFence,
+    const VkAllocationCallbacks*) {
+  --counts().liveFences;
+}
+
+inline VkResult VKAPI_PTR resetFences(VkDevice, uint32_t count,
+    const VkFence*) {
+  ++counts().fenceResetCalls;
+  counts().resetFences += count;
+  return VK_SUCCESS;
+}
+
+inline VkResult VKAPI_PTR createSetLayout(VkDevice,
+    const VkDescriptorSetLayoutCreateInfo*, const VkAllocationCallbacks*,
+    VkDescriptorSetLayout* layout) {
+  *layout = nextFakeHandle<VkDescriptorSetLayout>();
+  ++counts().liveSetLayouts;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroySetLayout(VkDevice, VkDescriptorSetLayout,
+    const VkAllocationCallbacks*) {
+  --counts().liveSetLayouts;
+}
+
+inline VkResult VKAPI_PTR createPipelineLayout(VkDevice,
+    const VkPipelineLayoutCreateInfo*, const VkAllocationCallbacks*,
+    VkPipelineLayout* layout) {
+  *layout = nextFakeHandle<VkPipelineLayout>();
+  ++counts().livePipelineLayouts;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroyPipelineLayout(VkDevice, VkPipelineLayout,
+    const VkAllocationCallbacks*) {
+  --counts().livePipelineLayouts;
+}
+
+inline VkResult VKAPI_PTR createSampler(VkDevice, const VkSamplerCreateInfo*,
+    const VkAllocationCallbacks*, VkSampler* sampler) {
+  *sampler = nextFakeHandle<VkSampler>();
+  ++counts().liveSamplers;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroySampler(VkDevice, VkSampler,
+    const VkAllocationCallbacks*) {
+  --counts().liveSamplers;
+}
+
+inline VkResult VKAPI_PTR createDescriptorPool(VkDevice,
+    const VkDescriptorPoolCreateInfo*, const VkAllocationCallbacks*,
+    VkDescriptorPool* pool) {
+  *pool = nextFakeHandle<VkDescriptorPool>();
+  ++counts().liveDescriptorPools;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroyDescriptorPool(VkDevice, VkDescriptorPool,
+    const VkAllocationCallbacks*) {
+  --counts().liveDescriptorPools;
+}
+
+inline VkResult VKAPI_PTR resetDescriptorPool(VkDevice, VkDescriptorPool,
+    VkDescriptorPoolResetFlags) {
+  ++counts().descriptorPoolResets;
+  return VK_SUCCESS;
+}
+
+inline VkResult VKAPI_PTR allocateDescriptorSets(VkDevice,
+    const VkDescriptorSetAllocateInfo* allocateInfo, VkDescriptorSet* sets) {
+  for (uint32_t setIdx = 0; setIdx < allocateInfo->descriptorSetCount;
+       ++setIdx) {
+    sets[setIdx] = nextFakeHandle<VkDescriptorSet>();
+  }
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR updateDescriptorSets(VkDevice, uint32_t,
+    const VkWriteDescriptorSet*, uint32_t, const VkCopyDescriptorSet*) {
+  ++counts().descriptorUpdates;
+}
+
+inline VkResult VKAPI_PTR createRenderPass(VkDevice,
+    const VkRenderPassCreateInfo*, const VkAllocationCallbacks*,
+    VkRenderPass* renderPass) {
+  *renderPass = nextFakeHandle<VkRenderPass>();
+  ++counts().liveRenderPasses;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroyRenderPass(VkDevice, VkRenderPass,
+    const VkAllocationCallbacks*) {
+  --counts().liveRenderPasses;
+}
+
+inline VkResult VKAPI_PTR createFramebuffer(VkDevice,
+    const VkFramebufferCreateInfo*, const VkAllocationCallbacks*,
+    VkFramebuffer* framebuffer) {
+  *framebuffer = nextFakeHandle<VkFramebuffer>();
+  ++counts().liveFramebuffers;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroyFramebuffer(VkDevice, VkFramebuffer,
+    const VkAllocationCallbacks*) {
+  --counts().liveFramebuffers;
+}
+
+inline VkResult VKAPI_PTR createQueryPool(VkDevice,
+    const VkQueryPoolCreateInfo*, const VkAllocationCallbacks*,
+    VkQueryPool* pool) {
+  *pool = nextFakeHandle<VkQueryPool>();
+  ++counts().liveQueryPools;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroyQueryPool(VkDevice, VkQueryPool,
+    const VkAllocationCallbacks*) {
+  --counts().liveQueryPools;
+}
+
+inline void VKAPI_PTR destroyDevice(VkDevice, const VkAllocationCallbacks*) {}
+
+inline void VKAPI_PTR getDeviceQueue(VkDevice, uint32_t familyIndex,
+    uint32_t queueIndex, VkQueue* queue) {
+  // Queues get handles which no other object has, so that each queue of a
+  // family has its own.
+  *queue = fakeHandle<VkQueue>(((familyIndex + 1) << 24) | (queueIndex + 1));
+}
+
+inline VkResult VKAPI_PTR waitForFences(VkDevice, uint32_t fenceCount,
+    const VkFence* fences, VkBool32, uint64_t) {
+  // Submissions complete in order, so waiting for a fence completes every
+  // submission up to the one it was submitted with.
+  auto& driver = counts();
+  std::lock_guard<std::mutex> lock(driver.submitMutex);
+  for (uint32_t fenceIdx = 0; fenceIdx < fenceCount; ++fenceIdx) {
+    const auto submits = driver.submitsForFence(fences[fenceIdx]);
+    if (driver.completedSubmits < submits) driver.completedSubmits = submits;
+  }
+  ++driver.fenceWaits;
+  return VK_SUCCESS;
+}
+
+inline VkResult VKAPI_PTR getFenceStatus(VkDevice, VkFence fence) {
+  auto& driver = counts();
+  std::lock_guard<std::mutex> lock(driver.submitMutex);
+  const auto submits = driver.submitsForFence(fence);
+  return submits != 0 && submits <= driver.completedSubmits ? VK_SUCCESS
+                                                            : VK_NOT_READY;
+}
+
+inline VkResult VKAPI_PTR queueSubmit(VkQueue, uint32_t, const VkSubmitInfo*,
+    VkFence fence) {
+  auto& driver = counts();
+  std::lock_guard<std::mutex> lock(driver.submitMutex);
+  driver.submitFences.push_back(fence);
+  ++driver.submits;
+  return VK_SUCCESS;
+}
+
+inline VkResult VKAPI_PTR createCommandPool(VkDevice,
+    const VkCommandPoolCreateInfo*, const VkAllocationCallbacks*,
+    VkCommandPool* pool) {
+  *pool = nextFakeHandle<VkCommandPool>();
+  ++counts().liveCommandPools;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroyCommandPool(VkDevice, VkCommandPool,
+    const VkAllocationCallbacks*) {
+  --counts().liveCommandPools;
+}
+
+inline VkResult VKAPI_PTR resetCommandPool(VkDevice, VkCommandPool,
+    VkCommandPoolResetFlags) {
+  ++counts().commandPoolResets;
+  return VK_SUCCESS;
+}
+
+inline VkResult VKAPI_PTR allocateCommandBuffers(VkDevice,
+    const VkCommandBufferAllocateInfo* allocateInfo,
+    VkCommandBuffer* commandBuffers) {
+  for (uint32_t bufferIdx = 0; bufferIdx < allocateInfo->commandBufferCount;
+       ++bufferIdx) {
+    commandBuffers[bufferIdx] = nextFakeHandle<VkCommandBuffer>();
+  }
+  counts().commandBuffers += allocateInfo->commandBufferCount;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR freeCommandBuffers(VkDevice, VkCommandPool, uint32_t,
+    const VkCommandBuffer*) {}
+
+inline VkResult VKAPI_PTR beginCommandBuffer(VkCommandBuffer,
+    const VkCommandBufferBeginInfo*) {
+  return VK_SUCCESS;
+}
+
+inline VkResult VKAPI_PTR endCommandBuffer(VkCommandBuffer) {
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR cmdCopyBuffer(VkCommandBuffer, VkBuffer, VkBuffer,
+    uint32_t regionCount, const VkBufferCopy*) {
+  counts().bufferCopies += regionCount;
+}
+
+inline VkResult VKAPI_PTR createSemaphore(VkDevice,
+    const VkSemaphoreCreateInfo*, const VkAllocationCallbacks*,
+    VkSemaphore* semaphore) {
+  *semaphore = nextFakeHandle<VkSemaphore>();
+  ++counts().liveSemaphores;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroySemaphore(VkDevice, VkSemaphore,
+    const VkAllocationCallbacks*) {
+  --counts().liveSemaphores;
+}
+
+inline VkResult VKAPI_PTR getSemaphoreCounterValue(VkDevice, VkSemaphore,
+    uint64_t* value) {
+  *value = 0;
+  return VK_SUCCESS;
+}
+
+inline VkResult VKAPI_PTR waitSemaphores(VkDevice,
+    const VkSemaphoreWaitInfoKHR*, uint64_t) {
+  return VK_SUCCESS;
+}
+
+// Buffers and memory are real allocations, as the size of a buffer is needed
+// for its requirements, and memory is written to through its mapping.
+
+inline VkResult VKAPI_PTR createBuffer(VkDevice,
+    const VkBufferCreateInfo* bufferInfo, const VkAllocationCallbacks*,
+    VkBuffer* buffer) {
+  *buffer = fakeHandle<VkBuffer>(
+    reinterpret_cast<uintptr_t>(new VkDeviceSize(bufferInfo->size)));
+  ++counts().liveBuffers;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR destroyBuffer(VkDevice, VkBuffer buffer,
+    const VkAllocationCallbacks*) {
+  delete reinterpret_cast<VkDeviceSize*>(buffer);
+  --counts().liveBuffers;
+}
+
+inline void VKAPI_PTR getBufferMemoryRequirements(VkDevice, VkBuffer buffer,
+    VkMemoryRequirements* requirements) {
+  requirements->size           = *reinterpret_cast<VkDeviceSize*>(buffer);
+  requirements->alignment      = 1;
+  requirements->memoryTypeBits = ~0u;
+}
+
+inline VkResult VKAPI_PTR bindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory,
+    VkDeviceSize) {
+  return VK_SUCCESS;
+}
+
+inline VkResult VKAPI_PTR allocateMemory(VkDevice,
+    const VkMemoryAllocateInfo* allocateInfo, const VkAllocationCallbacks*,
+    VkDeviceMemory* memory) {
+  *memory = fakeHandle<VkDeviceMemory>(reinterpret_cast<uintptr_t>(
+    new char[static_cast<size_t>(allocateInfo->allocationSize)]));
+  ++counts().liveMemory;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR freeMemory(VkDevice, VkDeviceMemory memory,
+    const VkAllocationCallbacks*) {
+  delete[] reinterpret_cast<char*>(memory);
+  --counts().liveMemory;
+}
+
+inline VkResult VKAPI_PTR mapMemory(VkDevice, VkDeviceMemory memory,
+    VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags, void** data) {
+  *data = reinterpret_cast<char*>(memory) + offset;
+  return VK_SUCCESS;
+}
+
+inline void VKAPI_PTR unmapMemory(VkDevice, VkDeviceMemory) {}
+
+inline VkResult VKAPI_PTR flushMappedMemoryRanges(VkDevice, uint32_t,
+    const VkMappedMemoryRange*) {
+  return VK_SUCCESS;
+}
+
+/// Makes a device dispatch table which uses the mock driver, and resets the
+/// counts of the driver.
+inline vwrap::loader::DeviceDispatch mockDispatch() {
+  counts().reset();
+
+  vwrap::loader::DeviceDispatch dispatch;
+  dispatch.vkCreateFence                 = createFence;
+  dispatch.vkDestroyFence                = destroyFence;
+  dispatch.vkResetFences                 = resetFences;
+  dispatch.vkCreateDescriptorSetLayout   = createSetLayout;
+  dispatch.vkDestroyDescriptorSetLayout  = destroySetLayout;
+  dispatch.vkCreatePipelineLayout        = createPipelineLayout;
+  dispatch.vkDestroyPipelineLayout       = destroyPipelineLayout;
+  dispatch.vkCreateSampler               = createSampler;
+  dispatch.vkDestroySampler              = destroySampler;
+  dispatch.vkCreateDescriptorPool        = createDescriptorPool;
+  dispatch.vkDestroyDescriptorPool       = destroyDescriptorPool;
+  dispatch.vkResetDescriptorPool         = resetDescriptorPool;
+  dispatch.vkAllocateDescriptorSets      = allocateDescriptorSets;
+  dispatch.vkUpdateDescriptorSets        = updateDescriptorSets;
+  dispatch.vkCreateRenderPass            = createRenderPass;
+  dispatch.vkDestroyRenderPass           = destroyRenderPass;
+  dispatch.vkCreateFramebuffer           = createFramebuffer;
+  dispatch.vkDestroyFramebuffer          = destroyFramebuffer;
+  dispatch.vkCreateQueryPool             = createQueryPool;
+  dispatch.vkDestroyQueryPool            = destroyQueryPool;
+  dispatch.vkDestroyDevice               = destroyDevice;
+  dispatch.vkGetDeviceQueue              = getDeviceQueue;
+  dispatch.vkWaitForFences               = waitForFences;
+  dispatch.vkCreateCommandPool           = createCommandPool;
+  dispatch.vkDestroyCommandPool          = destroyCommandPool;
+  dispatch.vkResetCommandPool            = resetCommandPool;
+  dispatch.vkAllocateCommandBuffers      = allocateCommandBuffers;
+  dispatch.vkFreeCommandBuffers          = freeCommandBuffers;
+  dispatch.vkBeginCommandBuffer          = beginCommandBuffer;
+  dispatch.vkEndCommandBuffer            = endCommandBuffer;
+  dispatch.vkCmdCopyBuffer               = cmdCopyBuffer;
+  dispatch.vkGetFenceStatus              = getFenceStatus;
+  dispatch.vkQueueSubmit                 = queueSubmit;
+  dispatch.vkCreateBuffer                = createBuffer;
+  dispatch.vkDestroyBuffer               = destroyBuffer;
+  dispatch.vkGetBufferMemoryRequirements = getBufferMemoryRequirements;
+  dispatch.vkBindBufferMemory            = bindBufferMemory;
+  dispatch.vkAllocateMemory              = allocateMemory;
+  dispatch.vkFreeMemory                  = freeMemory;
+  dispatch.vkMapMemory                   = mapMemory;
+  dispatch.vkUnmapMemory                 = unmapMemory;
+  dispatch.vkFlushMappedMemoryRanges     = flushMappedMemoryRanges;
+  dispatch.vkCreateSemaphore             = createSemaphore;
+  dispatch.vkDestroySemaphore            = destroySemaphore;
+  dispatch.vkGetSemaphoreCounterValueKHR = getSemaphoreCounterValue;
+  dispatch.vkWaitSemaphoresKHR           = waitSemaphores;
+  return dispatch;
+}
+
+//---- Instance functions ---------------------------------------------------//
+
+inline void VKAPI_PTR getPhysicalDeviceProperties(VkPhysicalDevice,
+    VkPhysicalDeviceProperties*) {}
+
+inline void VKAPI_PTR getPhysicalDeviceFeatures(VkPhysicalDevice,
+    VkPhysicalDeviceFeatures*) {}
+
+inline void VKAPI_PTR getPhysicalDeviceMemoryProperties(VkPhysicalDevice,
+    VkPhysicalDeviceMemoryProperties*) {}
+
+inline void VKAPI_PTR getPhysicalDeviceQueueFamilies(VkPhysicalDevice,
+    uint32_t* count, VkQueueFamilyProperties*) {
+  *count = 0;
+}
+
+inline void VKAPI_PTR getPhysicalDeviceFormatProperties(VkPhysicalDevice,
+    VkFormat, VkFormatProperties*) {}
+
+/// Gets the device functions which the mock driver gives to the devices
+/// which are created through it.
+inline vwrap::loader::DeviceDispatch& deviceFunctions() {
+  static vwrap::loader::DeviceDispatch functions;
+  return functions;
+}
+
+inline VkResult VKAPI_PTR createDevice(VkPhysicalDevice,
+    const VkDeviceCreateInfo*, const VkAllocationCallbacks*,
+    VkDevice* device) {
+  *device = nextFakeHandle<VkDevice>();
+  return VK_SUCCESS;
+}
+
+inline PFN_vkVoidFunction VKAPI_PTR getDeviceProcAddr(VkDevice,
+    const char* name) {
+  const auto& functions = deviceFunctions();
+#define VWRAP_MOCK_FUNCTION(function)                                         \
+  if (!std::strcmp(name, #function)) {                                        \
+    return reinterpret_cast<PFN_vkVoidFunction>(                              \
+      static_cast<PFN_##function>(functions.function));                       \
+  }
+  VWRAP_DEVICE_FUNCTIONS(VWRAP_MOCK_FUNCTION)
+  VWRAP_DEVICE_EXTENSION_FUNCTIONS(VWRAP_MOCK_FUNCTION)
+#undef VWRAP_MOCK_FUNCTION
+  return nullptr;
+}
+
+/// Makes an instance dispatch table which uses the mock driver, for which
+/// physical devices have no properties, and resets the counts of the driver.
+/// Devices which are created through the table get the device functions of
+/// the mock driver.
+inline vwrap::loader::InstanceDispatch mockInstanceDispatch() {
+  counts().reset();
+
+  vwrap::loader::InstanceDispatch dispatch = {};
+  dispatch.vkCreateDevice                      = createDevice;
+  dispatch.vkGetDeviceProcAddr                 = getDeviceProcAddr;
+  dispatch.vkGetPhysicalDeviceProperties       = getPhysicalDeviceProperties;
+  dispatch.vkGetPhysicalDeviceFeatures         = getPhysicalDeviceFeatures;
+  dispatch.vkGetPhysicalDeviceMemoryProperties =
+    getPhysicalDeviceMemoryProperties;
+  dispatch.vkGetPhysicalDeviceQueueFamilyProperties =
+    getPhysicalDeviceQueueFamilies;
+  dispatch.vkGetPhysicalDeviceFormatProperties =
+    getPhysicalDeviceFormatProperties;
+  return dispatch;
+}
+
+/// Makes the properties of a queue family.
+///
+/// \param flags      The types of work the family supports.
+/// \param queueCount The number of queues in the family.
+inline VkQueueFamilyProperties makeFamily(VkQueueFlags flags,
+                                          uint32_t     queueCount) {
+  VkQueueFamilyProperties family = {};
+  family.queueFlags = flags;
+  family.queueCount = queueCount;
+  return family;
+}
+
+/// Gets the requests for a queue for each type of work -- graphics, async
+/// compute and transfers.
+inline const vwrap::QueueRequestVec& workloadRequests() {
+  static const vwrap::QueueRequestVec requests = {
+    vwrap::QueueRequest(vwrap::QueueType::VW_GRAPHICS_QUEUE),
+    vwrap::QueueRequest(vwrap::QueueType::VW_COMPUTE_QUEUE ),
+    vwrap::QueueRequest(vwrap::QueueType::VW_TRANSFER_QUEUE)
+  };
+  return requests;
+}
+
+/// Makes the capabilities of a physical device, with families which each
+/// support all types of work with one queue, and one host visible memory
+/// type.
+///
+/// \param familyCount The number of queue families.
+inline vwrap::DeviceCapabilities mockCapabilities(uint32_t familyCount = 1) {
+  vwrap::DeviceCapabilities capabilities;
+  capabilities.device = fakeHandle<VkPhysicalDevice>(1);
+
+  auto& limits                  = capabilities.properties.limits;
+  limits.bufferImageGranularity = 1;
+  limits.nonCoherentAtomSize    = 1;
+  limits.timestampPeriod        = 1.0f;
+
+  auto family = makeFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT |
+                           VK_QUEUE_TRANSFER_BIT, 1);
+  family.timestampValidBits = 64;
+  capabilities.queueFamilies.assign(familyCount, family);
+
+  auto& memory                        = capabilities.memoryProperties;
+  memory.memoryTypeCount              = 1;
+  memory.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT  |
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT  |
+                                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  memory.memoryHeapCount              = 1;
+  memory.memoryHeaps[0].size          = 1ull << 30;
+  return capabilities;
+}
+
+/// A logical device which is created through the mock driver. The counts of
+/// the driver are reset when it is created.
+struct MockDevice {
+  vwrap::DeviceCapabilities       capabilities;  //!< The physical device.
+  vwrap::loader::InstanceDispatch instance;      //!< The instance functions.
+  vwrap::Device                   device;        //!< The device.
+
+  /// Constructor which creates the device.
+  ///
+  /// \param familyCount The number of queue families of the device.
+  /// \param functions   The device functions, which default to the functions
+  ///        of the mock driver.
+  explicit MockDevice(
+    uint32_t                             familyCount = 1             ,
+    const vwrap::loader::DeviceDispatch& functions   = mockDispatch())
+  : capabilities(mockCapabilities(familyCount)),
+    instance(instanceFor(functions)),
+    device(instance, vwrap::PhysicalDevice(capabilities)) {}
+
+ private:
+  /// Makes the instance dispatch table for devices with some functions.
+  ///
+  /// \param functions The device functions.
+  static vwrap::loader::InstanceDispatch instanceFor(
+      const vwrap::loader::DeviceDispatch& functions) {
+    auto dispatch     = mockInstanceDispatch();
+    deviceFunctions() = functions;
+    return dispatch;
+  }
+};
+
+} // namespace mock
+
+#endif  // VULKAWRAP_TESTS_DEVICE_MOCK_DRIVER_H
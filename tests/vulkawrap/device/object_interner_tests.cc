@@ -0,0 +1,128 @@
+//---- tests/vulkawrap/device/object_interner_tests.cc ----- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  object_interner_tests.cc
+/// \brief Tests the object interner for Vulkawrap, against a mock driver.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapObjectInternerTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/object_interner.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapObjectInternerSuite )
+
+using namespace vwrap;
+
+// Makes the create info of a linear sampler.
+VkSamplerCreateInfo linearSampler() {
+  VkSamplerCreateInfo createInfo = {};
+  createInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  createInfo.magFilter    = VK_FILTER_LINEAR;
+  createInfo.minFilter    = VK_FILTER_LINEAR;
+  createInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  createInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  createInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  createInfo.maxLod       = 16.0f;
+  return createInfo;
+}
+
+// Makes a binding of a descriptor for the fragment stage.
+VkDescriptorSetLayoutBinding binding(uint32_t index, VkDescriptorType type) {
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.binding         = index;
+  layoutBinding.descriptorType  = type;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+  return layoutBinding;
+}
+
+BOOST_AUTO_TEST_CASE( IdenticalSamplersAreCreatedOnce ) {
+  const auto dispatch = mock::mockDispatch();
+  {
+    ObjectInterner interner(dispatch);
+    const auto first = interner.getSampler(linearSampler());
+    BOOST_CHECK( first != VK_NULL_HANDLE );
+    BOOST_CHECK( interner.getSampler(linearSampler()) == first );
+
+    // Fields which are ignored by the driver don't make another sampler.
+    auto ignored = linearSampler();
+    ignored.maxAnisotropy = 8.0f;
+    ignored.compareOp     = VK_COMPARE_OP_LESS;
+    ignored.mipLodBias    = -0.0f;
+    BOOST_CHECK( interner.getSampler(ignored) == first );
+
+    auto nearest = linearSampler();
+    nearest.magFilter = VK_FILTER_NEAREST;
+    BOOST_CHECK( interner.getSampler(nearest) != first );
+    BOOST_CHECK_EQUAL( mock::counts().liveSamplers.load(), 2 );
+    BOOST_CHECK_EQUAL( interner.getSamplerCount(), 2u );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveSamplers.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( LayoutsIgnoreTheOrderOfTheirParts ) {
+  const auto dispatch = mock::mockDispatch();
+  {
+    ObjectInterner interner(dispatch);
+    const auto uniform = binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    const auto texture =
+      binding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+
+    const auto setLayout = interner.getSetLayout({ uniform, texture });
+    BOOST_CHECK( interner.getSetLayout({ texture, uniform }) == setLayout );
+    BOOST_CHECK( interner.getSetLayout({ uniform }) != setLayout );
+    BOOST_CHECK_EQUAL( mock::counts().liveSetLayouts.load(), 2 );
+
+    const VkPushConstantRange vertex   = { VK_SHADER_STAGE_VERTEX_BIT, 0,
+                                           64 };
+    const VkPushConstantRange fragment = { VK_SHADER_STAGE_FRAGMENT_BIT, 64,
+                                           16 };
+    const auto pipelineLayout =
+      interner.getPipelineLayout({ setLayout }, { vertex, fragment });
+    BOOST_CHECK( interner.getPipelineLayout({ setLayout },
+                   { fragment, vertex }) == pipelineLayout );
+    BOOST_CHECK( interner.getPipelineLayout({ setLayout }) !=
+                 pipelineLayout );
+    BOOST_CHECK_EQUAL( mock::counts().livePipelineLayouts.load(), 2 );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveSetLayouts.load()     , 0 );
+  BOOST_CHECK_EQUAL( mock::counts().livePipelineLayouts.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( ConcurrentRequestsCreateOneObject ) {
+  const auto dispatch = mock::mockDispatch();
+  ObjectInterner interner(dispatch);
+
+  const int threadCount = 8;
+  std::vector<VkSampler>   samplers(threadCount, VK_NULL_HANDLE);
+  std::vector<std::thread> threads;
+  for (int threadIdx = 0; threadIdx < threadCount; ++threadIdx) {
+    threads.emplace_back([&, threadIdx] {
+      for (int request = 0; request < 1000; ++request)
+        samplers[threadIdx] = interner.getSampler(linearSampler());
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (const auto sampler : samplers) BOOST_CHECK( sampler == samplers[0] );
+  BOOST_CHECK_EQUAL( mock::counts().liveSamplers.load(), 1 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
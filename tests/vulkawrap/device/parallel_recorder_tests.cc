@@ -0,0 +1,89 @@
+//---- tests/vulkawrap/device/parallel_recorder_tests.cc ---- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  parallel_recorder_tests.cc
+/// \brief Tests the parallel recorder for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapParallelRecorderTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/parallel_recorder.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapParallelRecorderSuite )
+
+using namespace vwrap;
+
+// The number of secondaries which were executed, and the number of calls to
+// begin a command buffer.
+static std::atomic<int> executedSecondaries;
+static std::atomic<int> begunCommandBuffers;
+
+void VKAPI_PTR countExecuteCommands(VkCommandBuffer, uint32_t count,
+    const VkCommandBuffer*) {
+  executedSecondaries += count;
+}
+
+// Fails to begin every second command buffer.
+VkResult VKAPI_PTR failSomeBegins(VkCommandBuffer,
+    const VkCommandBufferBeginInfo*) {
+  return ++begunCommandBuffers % 2 ? VK_SUCCESS
+                                   : VK_ERROR_OUT_OF_HOST_MEMORY;
+}
+
+// Makes the device functions for the tests.
+loader::DeviceDispatch recorderDispatch() {
+  executedSecondaries = 0;
+  begunCommandBuffers = 0;
+
+  auto dispatch = mock::mockDispatch();
+  dispatch.vkCmdExecuteCommands = countExecuteCommands;
+  return dispatch;
+}
+
+BOOST_AUTO_TEST_CASE( ParallelRecorderExecutesEveryChunk ) {
+  mock::MockDevice   mock(1, recorderDispatch());
+  CommandPoolManager commandPools(mock.device);
+  util::JobSystem    jobs(2);
+  ParallelRecorder   recorder(mock.device, commandPools, jobs);
+  commandPools.beginFrame();
+
+  std::atomic<size_t> recorded(0);
+  BOOST_CHECK( recorder.record(commandPools.allocate(0), 0, {}, 10,
+    [&recorded] (VkCommandBuffer, size_t begin, size_t end) {
+      recorded += end - begin;
+    }, 3) );
+  BOOST_CHECK_EQUAL( recorded.load(), 10u );
+  BOOST_CHECK_EQUAL( executedSecondaries.load(), 4 );
+}
+
+BOOST_AUTO_TEST_CASE( ParallelRecorderExecutesNothingWhenAChunkFails ) {
+  auto dispatch = recorderDispatch();
+  dispatch.vkBeginCommandBuffer = failSomeBegins;
+
+  mock::MockDevice   mock(1, dispatch);
+  CommandPoolManager commandPools(mock.device);
+  util::JobSystem    jobs(2);
+  ParallelRecorder   recorder(mock.device, commandPools, jobs);
+  commandPools.beginFrame();
+
+  BOOST_CHECK( !recorder.record(commandPools.allocate(0), 0, {}, 10,
+    [] (VkCommandBuffer, size_t, size_t) {}, 3) );
+  BOOST_CHECK_EQUAL( executedSecondaries.load(), 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,131 @@
+//---- tests/vulkawrap/device/pipeline_cache_tests.cc ------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  pipeline_cache_tests.cc
+/// \brief Tests the pipeline cache files for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapPipelineCacheTests
+#endif
+
+#include "vulkawrap/device/pipeline_cache.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapPipelineCacheSuite )
+
+// Makes the properties of a fake device.
+VkPhysicalDeviceProperties makeProperties(uint32_t driverVersion) {
+  VkPhysicalDeviceProperties properties = {};
+  properties.vendorID      = 0x10DE;
+  properties.deviceID      = 1;
+  properties.driverVersion = driverVersion;
+  for (uint32_t byteIdx = 0; byteIdx < VK_UUID_SIZE; ++byteIdx)
+    properties.pipelineCacheUUID[byteIdx] = static_cast<uint8_t>(byteIdx);
+  return properties;
+}
+
+// Makes pipeline cache data, as a driver would, for a device.
+std::vector<char> makeData(const VkPhysicalDeviceProperties& properties) {
+  const uint32_t fields[4] = {
+    16 + VK_UUID_SIZE, VK_PIPELINE_CACHE_HEADER_VERSION_ONE,
+    properties.vendorID, properties.deviceID
+  };
+  std::vector<char> data(sizeof(fields) + VK_UUID_SIZE + 64, 'p');
+  std::memcpy(data.data(), fields, sizeof(fields));
+  std::memcpy(data.data() + sizeof(fields), properties.pipelineCacheUUID,
+              VK_UUID_SIZE);
+  return data;
+}
+
+BOOST_AUTO_TEST_CASE( PipelineCacheRoundTripsData ) {
+  const std::string path       = "pipeline_cache_round_trip.bin";
+  const auto        properties = makeProperties(100);
+  const auto        data       = makeData(properties);
+  BOOST_REQUIRE( vwrap::PipelineCache::store(path, properties, data) );
+
+  const auto loaded = vwrap::PipelineCache::load(path, properties);
+  BOOST_CHECK( loaded == data );
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( ConcurrentStoresToOnePathNeverMix ) {
+  const std::string path        = "pipeline_cache_concurrent.bin";
+  const auto        properties  = makeProperties(100);
+  constexpr int     threadCount = 4, storesPerThread = 50;
+
+  // Each thread stores data of a different size, so a file with writes of
+  // two threads mixed together fails its checksum or size check.
+  std::vector<std::thread> threads;
+  for (int threadIdx = 0; threadIdx < threadCount; ++threadIdx) {
+    threads.emplace_back([&path, &properties, threadIdx] {
+      auto data = makeData(properties);
+      data.resize(data.size() + threadIdx * 1024, char('a' + threadIdx));
+      for (int storeIdx = 0; storeIdx < storesPerThread; ++storeIdx)
+        vwrap::PipelineCache::store(path, properties, data);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  BOOST_CHECK( !vwrap::PipelineCache::load(path, properties).empty() );
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( PipelineCacheIsNotLoadedForNewDriverVersion ) {
+  const std::string path       = "pipeline_cache_driver_version.bin";
+  const auto        properties = makeProperties(100);
+  BOOST_REQUIRE( vwrap::PipelineCache::store(path, properties,
+                   makeData(properties)) );
+
+  BOOST_CHECK( vwrap::PipelineCache::load(path, makeProperties(101)).empty() );
+  BOOST_CHECK( vwrap::PipelineCache::load("missing.bin", properties).empty() );
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( PipelineCacheIsNotLoadedWhenCorrupted ) {
+  const std::string path       = "pipeline_cache_corrupted.bin";
+  const auto        properties = makeProperties(100);
+  BOOST_REQUIRE( vwrap::PipelineCache::store(path, properties,
+                   makeData(properties)) );
+
+  {
+    // Flip a byte in the driver data, after the header.
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(sizeof(vwrap::detail::PipelineCacheFileHeader) + 40);
+    file.put('\x7f');
+  }
+
+  BOOST_CHECK( vwrap::PipelineCache::load(path, properties).empty() );
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( PipelineCacheDataMustMatchTheDevice ) {
+  const auto properties = makeProperties(100);
+  auto       data       = makeData(properties);
+  BOOST_CHECK( vwrap::PipelineCache::isValidData(data.data(), data.size(),
+                 properties) );
+  BOOST_CHECK( !vwrap::PipelineCache::isValidData(data.data(), 8,
+                 properties) );
+
+  // A different pipeline cache UUID means the data is from another driver.
+  data[20] ^= 1;
+  BOOST_CHECK( !vwrap::PipelineCache::isValidData(data.data(), data.size(),
+                 properties) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
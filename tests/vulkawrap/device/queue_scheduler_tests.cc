@@ -0,0 +1,156 @@
+//---- tests/vulkawrap/device/queue_scheduler_tests.cc ----- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  queue_scheduler_tests.cc
+/// \brief Tests the routing and handoffs of the queue scheduler for
+///        Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapQueueSchedulerTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/queue_scheduler.h"
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapQueueSchedulerSuite )
+
+using namespace vwrap;
+
+using mock::makeFamily;
+using mock::workloadRequests;
+
+static const VkQueueFlags allFlags =
+  VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+
+// Makes a handoff of an image from compute to graphics.
+QueueHandoff computeToGraphics(VkSharingMode sharingMode) {
+  QueueHandoff handoff;
+  handoff.srcType     = QueueType::VW_COMPUTE_QUEUE;
+  handoff.dstType     = QueueType::VW_GRAPHICS_QUEUE;
+  handoff.srcStages   = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  handoff.srcAccess   = VK_ACCESS_SHADER_WRITE_BIT;
+  handoff.dstStages   = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  handoff.dstAccess   = VK_ACCESS_SHADER_READ_BIT;
+  handoff.oldLayout   = VK_IMAGE_LAYOUT_GENERAL;
+  handoff.newLayout   = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  handoff.sharingMode = sharingMode;
+  return handoff;
+}
+
+BOOST_AUTO_TEST_CASE( WorkIsRoutedToDedicatedFamilies ) {
+  const auto allocations = allocateQueues({ makeFamily(allFlags, 1),
+    makeFamily(VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 1),
+    makeFamily(VK_QUEUE_TRANSFER_BIT, 1) }, workloadRequests());
+  const auto routes = detail::routeQueues(allocations);
+
+  BOOST_CHECK_EQUAL( allocations[routes[0]].familyIndex, 0u );
+  BOOST_CHECK_EQUAL( allocations[routes[1]].familyIndex, 1u );
+  BOOST_CHECK_EQUAL( allocations[routes[2]].familyIndex, 2u );
+}
+
+BOOST_AUTO_TEST_CASE( WorkFallsBackToTheGraphicsQueue ) {
+  // The compute and transfer requests share the only queue.
+  const auto allocations = allocateQueues({ makeFamily(allFlags, 1) },
+                                          workloadRequests());
+  const auto routes = detail::routeQueues(allocations);
+  BOOST_CHECK_EQUAL( allocations[routes[1]].queueIndex,
+                     allocations[routes[0]].queueIndex );
+  BOOST_CHECK_EQUAL( allocations[routes[2]].queueIndex,
+                     allocations[routes[0]].queueIndex );
+
+  // Without any compute or transfer requests, they run on graphics.
+  const auto graphicsOnly = allocateQueues({ makeFamily(allFlags, 1) },
+    { QueueRequest(QueueType::VW_GRAPHICS_QUEUE) });
+  const auto fallback = detail::routeQueues(graphicsOnly);
+  BOOST_CHECK_EQUAL( fallback[1], 0u );
+  BOOST_CHECK_EQUAL( fallback[2], 0u );
+}
+
+BOOST_AUTO_TEST_CASE( OnlyFrequentlySharedImagesAreConcurrent ) {
+  BOOST_CHECK_EQUAL( detail::chooseSharingMode(false, 1, 10),
+                     VK_SHARING_MODE_EXCLUSIVE );
+  BOOST_CHECK_EQUAL( detail::chooseSharingMode(false, 2, 1),
+                     VK_SHARING_MODE_CONCURRENT );
+  BOOST_CHECK_EQUAL( detail::chooseSharingMode(true, 2, 2),
+                     VK_SHARING_MODE_EXCLUSIVE );
+  BOOST_CHECK_EQUAL( detail::chooseSharingMode(true, 2,
+                       ConcurrentImageHandoffsCx),
+                     VK_SHARING_MODE_CONCURRENT );
+}
+
+BOOST_AUTO_TEST_CASE( OwnershipIsOnlyTransferredBetweenFamilies ) {
+  HandoffBarrier release, acquire;
+
+  // Exclusive across families releases and acquires.
+  detail::planHandoff(computeToGraphics(VK_SHARING_MODE_EXCLUSIVE), 1, 0,
+                      false, release, acquire);
+  BOOST_CHECK( release.record && acquire.record );
+  BOOST_CHECK_EQUAL( release.srcFamily, 1u );
+  BOOST_CHECK_EQUAL( release.dstFamily, 0u );
+  BOOST_CHECK_EQUAL( release.srcAccess, VK_ACCESS_SHADER_WRITE_BIT );
+  BOOST_CHECK_EQUAL( acquire.dstAccess, VK_ACCESS_SHADER_READ_BIT );
+  BOOST_CHECK_EQUAL( acquire.dstStages,
+                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT );
+
+  // Concurrent across families only transitions the layout.
+  detail::planHandoff(computeToGraphics(VK_SHARING_MODE_CONCURRENT), 1, 0,
+                      false, release, acquire);
+  BOOST_CHECK( !release.record && acquire.record );
+  BOOST_CHECK_EQUAL( acquire.srcFamily, VK_QUEUE_FAMILY_IGNORED );
+  BOOST_CHECK_EQUAL( acquire.srcAccess, 0u );
+
+  // On a single queue it is a regular barrier.
+  detail::planHandoff(computeToGraphics(VK_SHARING_MODE_EXCLUSIVE), 0, 0,
+                      true, release, acquire);
+  BOOST_CHECK( !release.record && acquire.record );
+  BOOST_CHECK_EQUAL( acquire.srcStages,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT );
+  BOOST_CHECK_EQUAL( acquire.srcAccess, VK_ACCESS_SHADER_WRITE_BIT );
+}
+
+BOOST_AUTO_TEST_CASE( ReleasesWithoutSourceStagesWaitForNothing ) {
+  auto handoff = computeToGraphics(VK_SHARING_MODE_EXCLUSIVE);
+  handoff.srcStages = 0;
+
+  HandoffBarrier release, acquire;
+  detail::planHandoff(handoff, 1, 0, false, release, acquire);
+  BOOST_CHECK( release.record );
+  BOOST_CHECK_EQUAL( release.srcStages, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT );
+}
+
+BOOST_AUTO_TEST_CASE( SchedulerWithoutQueuesCreatesNone ) {
+  mock::MockDevice mock(0);
+  QueueScheduler   scheduler(mock.device);
+  BOOST_CHECK( scheduler.getFamilies().empty() );
+  BOOST_CHECK_EQUAL( mock::counts().liveSemaphores.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( SharedQueuesAreWrappedByTheirOwner ) {
+  // The mock device has a single queue, which all the requests share.
+  mock::MockDevice mock;
+  {
+    QueueScheduler scheduler(mock.device);
+    const auto&    graphics = scheduler.getQueue(QueueType::VW_GRAPHICS_QUEUE);
+    BOOST_CHECK( graphics.getVkQueue() != VK_NULL_HANDLE );
+    BOOST_CHECK( &scheduler.getQueue(QueueType::VW_COMPUTE_QUEUE ) ==
+                 &graphics );
+    BOOST_CHECK( &scheduler.getQueue(QueueType::VW_TRANSFER_QUEUE) ==
+                 &graphics );
+    BOOST_CHECK_EQUAL( mock::counts().liveSemaphores.load(), 1 );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveSemaphores.load(), 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,236 @@
+//---- tests/vulkawrap/device/queue_tests.cc --------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  queue_tests.cc
+/// \brief Tests the queue functionality for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapQueueTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/queue.h"
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapQueueSuite )
+
+using namespace vwrap;
+
+using mock::makeFamily;
+using mock::workloadRequests;
+
+static int      failingSubmits = 0;           // Submits left to fail.
+static VkResult waitResult     = VK_SUCCESS;  // Result of the waits.
+
+VkResult VKAPI_PTR mockQueueSubmit(VkQueue queue, uint32_t submitCount,
+    const VkSubmitInfo* submits, VkFence fence) {
+  if (failingSubmits > 0) {
+    --failingSubmits;
+    return VK_ERROR_DEVICE_LOST;
+  }
+  return mock::queueSubmit(queue, submitCount, submits, fence);
+}
+
+VkResult VKAPI_PTR failingCreateDevice(VkPhysicalDevice,
+    const VkDeviceCreateInfo*, const VkAllocationCallbacks*, VkDevice*) {
+  return VK_ERROR_INITIALIZATION_FAILED;
+}
+
+VkResult VKAPI_PTR mockWaitSemaphores(VkDevice,
+    const VkSemaphoreWaitInfoKHR*, uint64_t) {
+  return waitResult;
+}
+
+BOOST_AUTO_TEST_CASE( AllocateQueuesUsesDedicatedFamilies ) {
+  const QueueFamilyPropVec families = {
+    makeFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | 
+               VK_QUEUE_TRANSFER_BIT, 16),
+    makeFamily(VK_QUEUE_COMPUTE_BIT  | VK_QUEUE_TRANSFER_BIT, 8 ),
+    makeFamily(VK_QUEUE_TRANSFER_BIT, 2)
+  };
+  const auto allocations = allocateQueues(families, workloadRequests());
+
+  BOOST_REQUIRE_EQUAL( allocations.size(), 3u );
+  BOOST_CHECK_EQUAL( allocations[0].familyIndex, 0u );
+  BOOST_CHECK_EQUAL( allocations[1].familyIndex, 1u );
+  BOOST_CHECK_EQUAL( allocations[2].familyIndex, 2u );
+}
+
+BOOST_AUTO_TEST_CASE( AllocateQueuesUsesDistinctIndicesInOneFamily ) {
+  const QueueFamilyPropVec families = {
+    makeFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | 
+               VK_QUEUE_TRANSFER_BIT, 4)
+  };
+  const auto allocations = allocateQueues(families, workloadRequests());
+
+  BOOST_CHECK_EQUAL( allocations[0].queueIndex, 0u );
+  BOOST_CHECK_EQUAL( allocations[1].queueIndex, 1u );
+  BOOST_CHECK_EQUAL( allocations[2].queueIndex, 2u );
+  BOOST_CHECK( !allocations[2].shared );
+}
+
+BOOST_AUTO_TEST_CASE( AllocateQueuesSharesQueueWhenFamilyIsFull ) {
+  const QueueFamilyPropVec families = {
+    makeFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | 
+               VK_QUEUE_TRANSFER_BIT, 1)
+  };
+  const auto allocations = allocateQueues(families, workloadRequests());
+
+  BOOST_CHECK( !allocations[0].shared );
+  BOOST_CHECK( allocations[1].shared );
+  BOOST_CHECK_EQUAL( allocations[1].queueIndex, 0u );
+}
+
+BOOST_AUTO_TEST_CASE( AllocateQueuesIgnoresUnsupportedRequests ) {
+  const QueueFamilyPropVec families = { makeFamily(VK_QUEUE_TRANSFER_BIT, 1) };
+  const auto allocations = allocateQueues(families, workloadRequests());
+
+  BOOST_CHECK_EQUAL( allocations[0].familyIndex, VK_QUEUE_FAMILY_IGNORED );
+  BOOST_CHECK_EQUAL( allocations[2].familyIndex, 0u );
+}
+
+BOOST_AUTO_TEST_CASE( SubmitBatchCoalescesSubmissionsWithoutWaits ) {
+  detail::SubmitBatch batch;
+  const VkCommandBuffer commands[3] = {
+    mock::fakeHandle<VkCommandBuffer>(1), mock::fakeHandle<VkCommandBuffer>(2),
+    mock::fakeHandle<VkCommandBuffer>(3)
+  };
+  batch.add(&commands[0], 1, nullptr, 0, VK_NULL_HANDLE, 1);
+  batch.add(&commands[1], 2, nullptr, 0, VK_NULL_HANDLE, 2);
+
+  const auto  timeline    = mock::fakeHandle<VkSemaphore>(10);
+  const auto& submitInfos = batch.build(timeline);
+  BOOST_CHECK_EQUAL( submitInfos.size(), 1u );
+  BOOST_CHECK_EQUAL( submitInfos[0].commandBufferCount, 3u );
+  BOOST_CHECK( submitInfos[0].pCommandBuffers[2] == commands[2] );
+  BOOST_CHECK_EQUAL( submitInfos[0].signalSemaphoreCount, 1u );
+  BOOST_CHECK( submitInfos[0].pSignalSemaphores[0] == timeline );
+
+  // The merged submission signals the value of the last submission in it.
+  const auto timelineInfo = static_cast<
+    const VkTimelineSemaphoreSubmitInfoKHR*>(submitInfos[0].pNext);
+  BOOST_CHECK_EQUAL( timelineInfo->pSignalSemaphoreValues[0], 2u );
+}
+
+BOOST_AUTO_TEST_CASE( SubmitBatchSplitsAtWaitsAndBinarySignals ) {
+  detail::SubmitBatch batch;
+  const auto command   = mock::fakeHandle<VkCommandBuffer>(1);
+  const auto acquired  = mock::fakeHandle<VkSemaphore>(20);
+  const auto rendered  = mock::fakeHandle<VkSemaphore>(21);
+  const auto other     = mock::fakeHandle<VkSemaphore>(22);
+  const SemaphoreWait waits[2] = {
+    { acquired, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT },
+    { other   , 7, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT            }
+  };
+
+  batch.add(&command, 1, nullptr , 0, VK_NULL_HANDLE, 1);
+  batch.add(&command, 1, waits   , 2, rendered      , 2);
+  batch.add(&command, 1, nullptr , 0, VK_NULL_HANDLE, 3);
+
+  const auto  timeline    = mock::fakeHandle<VkSemaphore>(10);
+  const auto& submitInfos = batch.build(timeline);
+  BOOST_CHECK_EQUAL( submitInfos.size(), 3u );
+
+  const auto& waiting = submitInfos[1];
+  BOOST_CHECK_EQUAL( waiting.waitSemaphoreCount, 2u );
+  BOOST_CHECK( waiting.pWaitSemaphores[1] == other );
+  BOOST_CHECK_EQUAL( waiting.pWaitDstStageMask[1],
+                     VkPipelineStageFlags(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT) );
+  BOOST_CHECK_EQUAL( waiting.signalSemaphoreCount, 2u );
+  BOOST_CHECK( waiting.pSignalSemaphores[1] == rendered );
+
+  const auto timelineInfo = static_cast<
+    const VkTimelineSemaphoreSubmitInfoKHR*>(waiting.pNext);
+  BOOST_CHECK_EQUAL( timelineInfo->pWaitSemaphoreValues[1], 7u );
+  BOOST_CHECK_EQUAL( timelineInfo->pSignalSemaphoreValues[0], 2u );
+
+  batch.clear();
+  BOOST_CHECK( batch.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( QueueOnlyWrapsQueuesWhichAreNotShared ) {
+  // The mock device has a single queue, which all the requests share.
+  mock::MockDevice mock;
+  const auto&      allocations = mock.device.getQueueAllocations();
+  size_t           wrapped     = 0;
+  for (size_t requestIdx = 0; requestIdx < allocations.size(); ++requestIdx) {
+    Queue queue(mock.device, requestIdx);
+    BOOST_CHECK_EQUAL( queue.getVkQueue() == VK_NULL_HANDLE,
+                       allocations[requestIdx].shared );
+    if (queue.getVkQueue() != VK_NULL_HANDLE) ++wrapped;
+  }
+  BOOST_CHECK_EQUAL( wrapped, 1u );
+  BOOST_CHECK_EQUAL( mock::counts().liveSemaphores.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( FailedDevicesHaveNoQueues ) {
+  auto instance           = mock::mockInstanceDispatch();
+  instance.vkCreateDevice = failingCreateDevice;
+  Device device(instance, PhysicalDevice(mock::mockCapabilities()));
+
+  // The queues are still allocated, but none were created.
+  BOOST_REQUIRE( !device.getQueueAllocations().empty() );
+  BOOST_CHECK( device.getQueue(size_t(0)) == VK_NULL_HANDLE );
+  BOOST_CHECK( device.getQueue(QueueType::VW_GRAPHICS_QUEUE) ==
+               VK_NULL_HANDLE );
+
+  Queue queue(device, size_t(0));
+  BOOST_CHECK( queue.getVkQueue() == VK_NULL_HANDLE );
+  BOOST_CHECK( queue.getTimeline() == VK_NULL_HANDLE );
+}
+
+BOOST_AUTO_TEST_CASE( QueueKeepsSubmissionsWhichFailToFlush ) {
+  auto dispatch = mock::mockDispatch();
+  dispatch.vkQueueSubmit       = mockQueueSubmit;
+  dispatch.vkWaitSemaphoresKHR = mockWaitSemaphores;
+  mock::MockDevice mock(1, dispatch);
+  {
+    Queue queue(mock.device, QueueType::VW_GRAPHICS_QUEUE);
+    const auto value = queue.submit(VkCommandBuffer(VK_NULL_HANDLE));
+    BOOST_CHECK_EQUAL( value, 1u );
+
+    failingSubmits = 1;
+    BOOST_CHECK_EQUAL( queue.flush(), 0u );
+    BOOST_CHECK_EQUAL( queue.getSubmittedValue(), 0u );
+    BOOST_CHECK( !queue.wait(value) );
+
+    BOOST_CHECK_EQUAL( queue.flush(), value );
+    BOOST_CHECK_EQUAL( queue.getSubmittedValue(), value );
+    BOOST_CHECK_EQUAL( mock::counts().submits.load(), 1 );
+
+    // The mock timeline never advances, so only a wait which succeeds
+    // completes the submission.
+    waitResult = VK_TIMEOUT;
+    BOOST_CHECK( !queue.wait(value) );
+    BOOST_CHECK( !queue.isComplete(value) );
+    waitResult = VK_SUCCESS;
+    BOOST_CHECK( queue.wait(value) );
+    BOOST_CHECK( queue.isComplete(value) );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveSemaphores.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( QueueWithoutATimelineDoesNotSubmit ) {
+  auto dispatch = mock::mockDispatch();
+  dispatch.vkGetSemaphoreCounterValueKHR = nullptr;
+  mock::MockDevice mock(1, dispatch);
+
+  Queue queue(mock.device, QueueType::VW_GRAPHICS_QUEUE);
+  BOOST_CHECK( queue.getTimeline() == VK_NULL_HANDLE );
+  BOOST_CHECK_EQUAL( queue.submit(VkCommandBuffer(VK_NULL_HANDLE)), 0u );
+  BOOST_CHECK_EQUAL( queue.flush(), 0u );
+  BOOST_CHECK_EQUAL( mock::counts().submits.load(), 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
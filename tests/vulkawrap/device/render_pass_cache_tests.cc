@@ -0,0 +1,125 @@
+//---- tests/vulkawrap/device/render_pass_cache_tests.cc --- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  render_pass_cache_tests.cc
+/// \brief Tests the render pass cache for Vulkawrap, against a mock driver.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapRenderPassCacheTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/render_pass_cache.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapRenderPassCacheSuite )
+
+using namespace vwrap;
+
+// Makes the description of a render pass with one color attachment.
+RenderPassDescription colorPass(VkFormat format) {
+  VkAttachmentDescription attachment = {};
+  attachment.format      = format;
+  attachment.samples     = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  attachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+  SubpassDescription subpass;
+  subpass.colors.push_back(
+    VkAttachmentReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+
+  RenderPassDescription description;
+  description.attachments.push_back(attachment);
+  description.subpasses.push_back(subpass);
+  return description;
+}
+
+// Makes the description of a framebuffer with one view.
+FramebufferDescription framebuffer(VkRenderPass renderPass, uintptr_t view,
+                                   uint32_t width) {
+  FramebufferDescription description;
+  description.renderPass = renderPass;
+  description.attachments.push_back(mock::fakeHandle<VkImageView>(view));
+  description.width      = width;
+  description.height     = 720;
+  return description;
+}
+
+BOOST_AUTO_TEST_CASE( IdenticalRenderPassesAreCreatedOnce ) {
+  const auto dispatch = mock::mockDispatch();
+  {
+    RenderPassCache cache(dispatch);
+    const auto first = cache.getRenderPass(colorPass(VK_FORMAT_B8G8R8A8_UNORM));
+    BOOST_CHECK( first != VK_NULL_HANDLE );
+    BOOST_CHECK( cache.getRenderPass(colorPass(VK_FORMAT_B8G8R8A8_UNORM)) ==
+                 first );
+    BOOST_CHECK( cache.getRenderPass(colorPass(VK_FORMAT_R8G8B8A8_UNORM)) !=
+                 first );
+
+    // Another thread finds the same render pass.
+    VkRenderPass other = VK_NULL_HANDLE;
+    std::thread thread([&] {
+      other = cache.getRenderPass(colorPass(VK_FORMAT_B8G8R8A8_UNORM));
+    });
+    thread.join();
+    BOOST_CHECK( other == first );
+    BOOST_CHECK_EQUAL( mock::counts().liveRenderPasses.load(), 2 );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveRenderPasses.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( FramebuffersAreKeyedByViewsAndExtent ) {
+  const auto dispatch = mock::mockDispatch();
+  {
+    RenderPassCache cache(dispatch);
+    const auto renderPass =
+      cache.getRenderPass(colorPass(VK_FORMAT_B8G8R8A8_UNORM));
+
+    const auto first = cache.getFramebuffer(framebuffer(renderPass, 1, 1280));
+    BOOST_CHECK( cache.getFramebuffer(framebuffer(renderPass, 1, 1280)) ==
+                 first );
+    BOOST_CHECK( cache.getFramebuffer(framebuffer(renderPass, 1, 1920)) !=
+                 first );
+    BOOST_CHECK( cache.getFramebuffer(framebuffer(renderPass, 2, 1280)) !=
+                 first );
+    BOOST_CHECK_EQUAL( cache.getFramebufferCount(), 3u );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveFramebuffers.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( EvictingAViewDestroysItsFramebuffers ) {
+  const auto dispatch = mock::mockDispatch();
+  RenderPassCache cache(dispatch);
+  const auto renderPass =
+    cache.getRenderPass(colorPass(VK_FORMAT_B8G8R8A8_UNORM));
+
+  cache.getFramebuffer(framebuffer(renderPass, 1, 1280));
+  cache.getFramebuffer(framebuffer(renderPass, 1, 1920));
+  cache.getFramebuffer(framebuffer(renderPass, 2, 1280));
+  BOOST_CHECK_EQUAL( mock::counts().liveFramebuffers.load(), 3 );
+
+  cache.evictImageView(mock::fakeHandle<VkImageView>(1));
+  BOOST_CHECK_EQUAL( mock::counts().liveFramebuffers.load(), 1 );
+  BOOST_CHECK_EQUAL( cache.getFramebufferCount(), 1u );
+
+  // The thread must not find the evicted framebuffer, so it is created again.
+  cache.getFramebuffer(framebuffer(renderPass, 1, 1280));
+  BOOST_CHECK_EQUAL( mock::counts().liveFramebuffers.load(), 2 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
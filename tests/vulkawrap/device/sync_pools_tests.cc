@@ -0,0 +1,120 @@
+//---- tests/vulkawrap/device/sync_pools_tests.cc ---------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  sync_pools_tests.cc
+/// \brief Tests the synchronization object pools for Vulkawrap, against a
+///        mock driver.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapSyncPoolTests
+#endif
+
+#include "mock_driver.h"
+#include "vulkawrap/device/sync_pools.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapSyncPoolSuite )
+
+using namespace vwrap;
+
+BOOST_AUTO_TEST_CASE( FencePoolReusesReleasedFences ) {
+  const auto dispatch = mock::mockDispatch();
+  {
+    FencePool fences(dispatch);
+    const auto first = fences.acquire();
+    fences.release(first);
+    const auto second = fences.acquire();
+    BOOST_CHECK( second == first );
+    BOOST_CHECK_EQUAL( fences.getCreatedCount(), 1u );
+    fences.release(second);
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveFences.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( FencePoolResetsReturnedFencesInOneCall ) {
+  const auto dispatch = mock::mockDispatch();
+  FencePool fences(dispatch);
+
+  std::vector<VkFence> acquired;
+  for (int fenceIdx = 0; fenceIdx < 10; ++fenceIdx)
+    acquired.push_back(fences.acquire());
+  BOOST_CHECK_EQUAL( mock::counts().fenceResetCalls.load(), 0 );
+
+  for (auto fence : acquired) fences.release(fence);
+  std::set<VkFence> reacquired;
+  for (int fenceIdx = 0; fenceIdx < 10; ++fenceIdx)
+    reacquired.insert(fences.acquire());
+
+  BOOST_CHECK_EQUAL( mock::counts().fenceResetCalls.load(), 1 );
+  BOOST_CHECK_EQUAL( mock::counts().resetFences.load(), 10 );
+  BOOST_CHECK_EQUAL( reacquired.size(), 10u );
+  BOOST_CHECK_EQUAL( fences.getCreatedCount(), 10u );
+  for (auto fence : reacquired) fences.release(fence);
+}
+
+BOOST_AUTO_TEST_CASE( FencePoolSharesFencesBetweenThreads ) {
+  const auto dispatch = mock::mockDispatch();
+  const uint32_t cacheSize = 8;
+  {
+    FencePool fences(dispatch, cacheSize);
+
+    // One thread releases more fences than its cache holds, so the rest go
+    // to the shared list, where another thread picks them up.
+    std::vector<VkFence> acquired;
+    for (int fenceIdx = 0; fenceIdx < 32; ++fenceIdx)
+      acquired.push_back(fences.acquire());
+    for (auto fence : acquired) fences.release(fence);
+
+    std::thread consumer([&fences] {
+      std::vector<VkFence> taken;
+      for (int fenceIdx = 0; fenceIdx < 4; ++fenceIdx)
+        taken.push_back(fences.acquire());
+      for (auto fence : taken) fences.release(fence);
+    });
+    consumer.join();
+    BOOST_CHECK_EQUAL( fences.getCreatedCount(), 32u );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveFences.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( FencePoolIsThreadSafe ) {
+  const auto dispatch = mock::mockDispatch();
+  {
+    FencePool fences(dispatch, 4);
+    std::vector<std::thread> threads;
+    for (int threadIdx = 0; threadIdx < 4; ++threadIdx) {
+      threads.emplace_back([&fences] {
+        std::vector<VkFence> held;
+        for (int iteration = 0; iteration < 10000; ++iteration) {
+          held.push_back(fences.acquire());
+          if (held.size() > 6) {
+            for (auto fence : held) fences.release(fence);
+            held.clear();
+          }
+        }
+        for (auto fence : held) fences.release(fence);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    BOOST_CHECK_EQUAL( static_cast<size_t>(mock::counts().liveFences.load()),
+                       fences.getCreatedCount() );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveFences.load(), 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,226 @@
+//---- tests/vulkawrap/graph/render_graph_tests.cc --------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  render_graph_tests.cc
+/// \brief Tests the render graph for Vulkawrap, by inspecting the plans it
+///        compiles.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapRenderGraphTests
+#endif
+
+#include "vulkawrap/graph/render_graph.h"
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapRenderGraphSuite )
+
+using namespace vwrap;
+
+static constexpr VkDeviceSize targetSize = 1 << 20;
+
+// The number of barrier calls the mock driver has recorded.
+static int barrierCalls = 0;
+
+void VKAPI_PTR mockCmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags,
+    VkPipelineStageFlags, VkDependencyFlags, uint32_t, const VkMemoryBarrier*,
+    uint32_t, const VkBufferMemoryBarrier*, uint32_t,
+    const VkImageMemoryBarrier*) {
+  ++barrierCalls;
+}
+
+// Declares that a pass renders to a color target.
+void writeColor(RenderGraph& graph, uint32_t pass, uint32_t target) {
+  graph.write(pass, target, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+}
+
+// Declares that a pass samples a target in its fragment shader.
+void sample(RenderGraph& graph, uint32_t pass, uint32_t target) {
+  graph.read(pass, target, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+    VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+// Adds a transient color target.
+uint32_t colorTarget(RenderGraph& graph, const std::string& name) {
+  return graph.createImage(name, VK_IMAGE_ASPECT_COLOR_BIT, targetSize, 256);
+}
+
+// Adds an imported swapchain image.
+uint32_t swapchain(RenderGraph& graph) {
+  return graph.importImage("swapchain", VK_IMAGE_ASPECT_COLOR_BIT,
+    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+}
+
+BOOST_AUTO_TEST_CASE( UnusedPassesAreRemovedAndIndependentWorkIsInterleaved ) {
+  RenderGraph graph;
+  const auto shadows   = colorTarget(graph, "shadows");
+  const auto ao        = colorTarget(graph, "ao");
+  const auto debug     = colorTarget(graph, "debug");
+  const auto output    = swapchain(graph);
+
+  const auto shadowPass = graph.addPass("shadows");
+  writeColor(graph, shadowPass, shadows);
+  const auto debugPass  = graph.addPass("debug");
+  writeColor(graph, debugPass, debug);
+  const auto aoPass     = graph.addPass("ao");
+  writeColor(graph, aoPass, ao);
+  const auto resolvePass = graph.addPass("resolve");
+  sample(graph, resolvePass, shadows);
+  sample(graph, resolvePass, ao);
+  writeColor(graph, resolvePass, output);
+
+  graph.compile();
+  const auto& plan = graph.getPlan();
+  BOOST_CHECK( (plan.order ==
+                std::vector<uint32_t>{ shadowPass, aoPass, resolvePass }) );
+  BOOST_CHECK( !plan.placements[debug].used() );
+
+  // A pass which reads a result goes after independent work.
+  RenderGraph chain;
+  const auto first  = colorTarget(chain, "first");
+  const auto second = colorTarget(chain, "second");
+  const auto target = swapchain(chain);
+  const auto producer    = chain.addPass("producer");
+  writeColor(chain, producer, first);
+  const auto consumer    = chain.addPass("consumer");
+  sample(chain, consumer, first);
+  writeColor(chain, consumer, target);
+  const auto independent = chain.addPass("independent");
+  writeColor(chain, independent, second);
+  const auto composite   = chain.addPass("composite");
+  sample(chain, composite, second);
+  writeColor(chain, composite, target);
+
+  chain.compile();
+  BOOST_CHECK( (chain.getPlan().order == std::vector<uint32_t>{ producer,
+                  independent, consumer, composite }) );
+}
+
+BOOST_AUTO_TEST_CASE( BarriersOnlyCoverConflictingAccesses ) {
+  RenderGraph graph;
+  const auto gBuffer = colorTarget(graph, "gbuffer");
+  const auto normals = colorTarget(graph, "normals");
+  const auto output  = swapchain(graph);
+
+  const auto geometry = graph.addPass("geometry");
+  writeColor(graph, geometry, gBuffer);
+  writeColor(graph, geometry, normals);
+  const auto lighting = graph.addPass("lighting");
+  sample(graph, lighting, gBuffer);
+  sample(graph, lighting, normals);
+  writeColor(graph, lighting, output);
+  const auto post = graph.addPass("post");
+  sample(graph, post, gBuffer);
+  writeColor(graph, post, output);
+
+  graph.compile();
+  const auto& plan = graph.getPlan();
+  BOOST_REQUIRE_EQUAL( plan.order.size(), 3u );
+
+  // Both targets are transitioned from undefined in one batch.
+  const auto& geometryBarriers = plan.barriers[0];
+  BOOST_CHECK_EQUAL( geometryBarriers.images.size(), 2u );
+  BOOST_CHECK_EQUAL( geometryBarriers.images[0].oldLayout,
+                     VK_IMAGE_LAYOUT_UNDEFINED );
+
+  // Lighting waits for the color writes, and transitions both targets for
+  // sampling, along with the swapchain image.
+  const auto& lightingBarriers = plan.barriers[1];
+  BOOST_CHECK_EQUAL( lightingBarriers.images.size(), 3u );
+  BOOST_CHECK_EQUAL( lightingBarriers.srcStages,
+                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+  BOOST_CHECK_EQUAL( lightingBarriers.dstStages,
+                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+  BOOST_CHECK_EQUAL( lightingBarriers.images[0].srcAccess,
+                     VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT );
+  BOOST_CHECK_EQUAL( lightingBarriers.images[0].newLayout,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+  // The second read of the gbuffer is already visible, so post only waits
+  // for lighting's write of the swapchain image.
+  const auto& postBarriers = plan.barriers[2];
+  BOOST_CHECK( postBarriers.images.empty() );
+  BOOST_CHECK_EQUAL( postBarriers.srcStages,
+                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+  BOOST_CHECK_EQUAL( postBarriers.srcAccess,
+                     VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT );
+
+  // The swapchain image is left ready to present.
+  BOOST_REQUIRE_EQUAL( plan.finalBarriers.images.size(), 1u );
+  BOOST_CHECK_EQUAL( plan.finalBarriers.images[0].newLayout,
+                     VK_IMAGE_LAYOUT_PRESENT_SRC_KHR );
+}
+
+BOOST_AUTO_TEST_CASE( TransientsWithDisjointLifetimesShareMemory ) {
+  RenderGraph graph;
+  const auto first  = colorTarget(graph, "first");
+  const auto second = colorTarget(graph, "second");
+  const auto third  = colorTarget(graph, "third");
+  const auto output = swapchain(graph);
+
+  const auto passA = graph.addPass("a");
+  writeColor(graph, passA, first);
+  const auto passB = graph.addPass("b");
+  sample(graph, passB, first);
+  writeColor(graph, passB, second);
+  const auto passC = graph.addPass("c");
+  sample(graph, passC, second);
+  writeColor(graph, passC, third);
+  const auto passD = graph.addPass("d");
+  sample(graph, passD, third);
+  writeColor(graph, passD, output);
+
+  graph.compile();
+  const auto& plan = graph.getPlan();
+  BOOST_CHECK_EQUAL( plan.placements[first].offset,
+                     plan.placements[third].offset );
+  BOOST_CHECK( plan.placements[first].offset !=
+               plan.placements[second].offset );
+  BOOST_CHECK_EQUAL( plan.transientSize, 2 * targetSize );
+
+  // The third target's first use waits for the last use of the first
+  // target, whose memory it reuses.
+  const auto& aliasBarriers = plan.barriers[2];
+  BOOST_CHECK( (aliasBarriers.srcStages &
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) != 0 );
+}
+
+BOOST_AUTO_TEST_CASE( RecordingBatchesBarriersPerPass ) {
+  RenderGraph graph;
+  const auto gBuffer = colorTarget(graph, "gbuffer");
+  const auto output  = swapchain(graph);
+
+  std::vector<uint32_t> recorded;
+  const auto geometry = graph.addPass("geometry",
+    [&] (VkCommandBuffer) { recorded.push_back(0); });
+  writeColor(graph, geometry, gBuffer);
+  const auto lighting = graph.addPass("lighting",
+    [&] (VkCommandBuffer) { recorded.push_back(1); });
+  sample(graph, lighting, gBuffer);
+  writeColor(graph, lighting, output);
+  graph.compile();
+
+  loader::DeviceDispatch dispatch;
+  dispatch.vkCmdPipelineBarrier = mockCmdPipelineBarrier;
+  barrierCalls = 0;
+  graph.record(dispatch, VK_NULL_HANDLE);
+
+  BOOST_CHECK( (recorded == std::vector<uint32_t>{ 0, 1 }) );
+  BOOST_CHECK_EQUAL( barrierCalls, 3 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
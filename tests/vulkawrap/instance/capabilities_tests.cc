@@ -0,0 +1,112 @@
+//---- tests/vulkawrap/instance/capabilities_tests.cc ------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  capabilities_tests.cc
+/// \brief Tests the capture of device capabilities for Vulkawrap, with a mock
+///        driver which is slow to answer queries.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapCapabilitiesTests
+#endif
+
+#include "../device/mock_driver.h"
+#include "vulkawrap/instance/capabilities.h"
+#include "vulkawrap/util/job_system.h"
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapCapabilitiesSuite )
+
+using namespace vwrap;
+
+static constexpr uint32_t deviceCount = 4;
+
+static std::atomic<int> activeQueries(0);
+static std::atomic<int> maxActiveQueries(0);
+
+// Gets the index of a fake device from its handle.
+uint32_t deviceIndex(VkPhysicalDevice device) {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(device)) - 1;
+}
+
+// Answers slowest for the first device, so that the devices finish in the
+// reverse of the order in which they are enumerated.
+void VKAPI_PTR mockGetProperties(VkPhysicalDevice device,
+    VkPhysicalDeviceProperties* properties) {
+  const int active = ++activeQueries;
+  int observed     = maxActiveQueries.load();
+  while (active > observed &&
+         !maxActiveQueries.compare_exchange_weak(observed, active)) {}
+
+  const auto index = deviceIndex(device);
+  std::this_thread::sleep_for(
+    std::chrono::milliseconds(10 * (deviceCount - index)));
+  properties->deviceID = index;
+  --activeQueries;
+}
+
+void VKAPI_PTR mockGetQueueFamilies(VkPhysicalDevice device, uint32_t* count,
+    VkQueueFamilyProperties* families) {
+  if (!families) {
+    *count = 1;
+    return;
+  }
+  families[0].queueCount = deviceIndex(device) + 1;
+}
+
+// Makes a dispatch table which uses the mock driver, with the properties
+// and queue families of the fake devices.
+loader::InstanceDispatch makeDispatch() {
+  auto dispatch = mock::mockInstanceDispatch();
+  dispatch.vkGetPhysicalDeviceProperties            = mockGetProperties;
+  dispatch.vkGetPhysicalDeviceQueueFamilyProperties = mockGetQueueFamilies;
+  return dispatch;
+}
+
+BOOST_AUTO_TEST_CASE( CapabilitiesAreInEnumerationOrder ) {
+  std::vector<VkPhysicalDevice> devices;
+  for (uintptr_t deviceIdx = 1; deviceIdx <= deviceCount; ++deviceIdx)
+    devices.push_back(mock::fakeHandle<VkPhysicalDevice>(deviceIdx));
+
+  maxActiveQueries = 0;
+  const auto capabilities = captureDeviceCapabilities(makeDispatch(),
+                              devices);
+
+  BOOST_REQUIRE_EQUAL( capabilities.size(), deviceCount );
+  for (uint32_t deviceIdx = 0; deviceIdx < deviceCount; ++deviceIdx) {
+    const auto& device = capabilities[deviceIdx];
+    BOOST_CHECK( device.device == devices[deviceIdx] );
+    BOOST_CHECK_EQUAL( device.properties.deviceID, deviceIdx );
+    BOOST_REQUIRE_EQUAL( device.queueFamilies.size(), 1u );
+    BOOST_CHECK_EQUAL( device.queueFamilies[0].queueCount, deviceIdx + 1 );
+    BOOST_CHECK_EQUAL( device.formats.size(), CoreFormatCountCx );
+  }
+
+  // The devices are only queried at the same time if there is more than one
+  // hardware thread to query them on.
+  if (util::JobSystem::defaultThreadCount() > 1)
+    BOOST_CHECK( maxActiveQueries.load() > 1 );
+}
+
+BOOST_AUTO_TEST_CASE( CapturingNoDevicesGivesNoCapabilities ) {
+  BOOST_CHECK( captureDeviceCapabilities(makeDispatch(),
+                std::vector<VkPhysicalDevice>()).empty() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
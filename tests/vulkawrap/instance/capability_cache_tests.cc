@@ -0,0 +1,130 @@
+//---- tests/vulkawrap/instance/capability_cache_tests.cc --- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  capability_cache_tests.cc
+/// \brief Tests the persistent device capability cache for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapCapabilityCacheTests
+#endif
+
+#include "vulkawrap/instance/capability_cache.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapCapabilityCacheSuite )
+
+// Makes the capabilities for a fake device.
+vwrap::DeviceCapabilities makeCapabilities(uint32_t deviceId, 
+    uint32_t driverVersion) {
+  vwrap::DeviceCapabilities capabilities;
+  capabilities.properties.vendorID      = 0x10DE;
+  capabilities.properties.deviceID      = deviceId;
+  capabilities.properties.driverVersion = driverVersion;
+  capabilities.queueFamilies.resize(2);
+  capabilities.queueFamilies[0].queueFlags = VK_QUEUE_GRAPHICS_BIT;
+  capabilities.queueFamilies[1].queueFlags = VK_QUEUE_TRANSFER_BIT;
+  capabilities.formats.resize(vwrap::CoreFormatCountCx);
+  capabilities.formats[VK_FORMAT_R8G8B8A8_UNORM].optimalTilingFeatures = 1;
+  return capabilities;
+}
+
+BOOST_AUTO_TEST_CASE( CapabilityCacheRoundTripsDeviceCapabilities ) {
+  const std::string path = "capability_cache_round_trip.bin";
+  vwrap::DeviceCapabilitiesVec capabilities = { 
+    makeCapabilities(1, 100), makeCapabilities(2, 100) 
+  };
+  BOOST_REQUIRE( vwrap::CapabilityCache::store(path, capabilities) );
+
+  {
+    vwrap::CapabilityCache cache(path);
+    BOOST_REQUIRE( cache.valid() );
+
+    const auto* record = cache.find(capabilities[1].properties);
+    BOOST_REQUIRE( record != nullptr );
+
+    const auto loaded = vwrap::CapabilityCache::toCapabilities(*record, 
+                          VK_NULL_HANDLE);
+    BOOST_CHECK_EQUAL( loaded.properties.deviceID, 2u );
+    BOOST_CHECK_EQUAL( loaded.queueFamilies.size(), 2u );
+    BOOST_CHECK( loaded.supportsFormat(VK_FORMAT_R8G8B8A8_UNORM, 
+                   VK_IMAGE_TILING_OPTIMAL, 1) );
+  }
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( CapabilityCacheMissesForNewDriverVersion ) {
+  const std::string path = "capability_cache_driver_version.bin";
+  BOOST_REQUIRE( vwrap::CapabilityCache::store(path, 
+                   vwrap::DeviceCapabilitiesVec{ makeCapabilities(1, 100) }) );
+
+  {
+    vwrap::CapabilityCache cache(path);
+    BOOST_REQUIRE( cache.valid() );
+    BOOST_CHECK( cache.find(makeCapabilities(1, 101).properties) == nullptr );
+  }
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( CapabilityCacheKeepsRecordsForOtherDevices ) {
+  const std::string path = "capability_cache_merge.bin";
+  BOOST_REQUIRE( vwrap::CapabilityCache::store(path, 
+    vwrap::DeviceCapabilitiesVec{ makeCapabilities(1, 100), 
+                                  makeCapabilities(2, 100) }) );
+
+  // Another instance sees a new driver for the first device, and a third
+  // device, but not the second device.
+  BOOST_REQUIRE( vwrap::CapabilityCache::store(path, 
+    vwrap::DeviceCapabilitiesVec{ makeCapabilities(1, 101), 
+                                  makeCapabilities(3, 100),
+                                  makeCapabilities(3, 100) }) );
+
+  {
+    vwrap::CapabilityCache cache(path);
+    BOOST_REQUIRE( cache.valid() );
+    BOOST_CHECK( cache.find(makeCapabilities(1, 100).properties) == nullptr );
+    BOOST_CHECK( cache.find(makeCapabilities(1, 101).properties) != nullptr );
+    BOOST_CHECK( cache.find(makeCapabilities(2, 100).properties) != nullptr );
+    BOOST_CHECK( cache.find(makeCapabilities(3, 100).properties) != nullptr );
+  }
+  {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    BOOST_CHECK_EQUAL( static_cast<size_t>(file.tellg()), 
+      sizeof(vwrap::detail::CapabilityCacheHeader) + 
+      3 * sizeof(vwrap::detail::CapabilityCacheRecord) );
+  }
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( CapabilityCacheIsInvalidWhenCorrupted ) {
+  const std::string path = "capability_cache_corrupted.bin";
+  BOOST_REQUIRE( vwrap::CapabilityCache::store(path, 
+                   vwrap::DeviceCapabilitiesVec{ makeCapabilities(1, 100) }) );
+
+  {
+    // Flip a byte in the record, after the header.
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(sizeof(vwrap::detail::CapabilityCacheHeader) + 8);
+    file.put('\x7f');
+  }
+
+  {
+    vwrap::CapabilityCache cache(path);
+    BOOST_CHECK( !cache.valid() );
+  }
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,179 @@
+//---- tests/vulkawrap/instance/instance_tests.cc ---------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  instance_tests.cc
+/// \brief Tests the keys which the instance registry shares instances by.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapInstanceTests
+#endif
+
+#include "vulkawrap/instance/instance.h"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapInstanceSuite )
+
+using namespace vwrap;
+
+static constexpr uint32_t apiVersion = VK_MAKE_VERSION(1, 0, 2);
+
+static int createdBlocks = 0, liveBlocks = 0;
+
+// A control block with a fake instance, so that the registry can be tested
+// without a Vulkan library.
+struct FakeBlock {
+  ConcurrentReferenceCounter counter;
+  struct { VkInstance vkInstance; } instance;
+  std::string key;
+
+  FakeBlock(std::string blockKey, VkInstance handle)
+  : instance{ handle }, key(std::move(blockKey)) {
+    counter.initialize();
+    ++createdBlocks;
+    ++liveBlocks;
+  }
+
+  ~FakeBlock() { --liveBlocks; }
+};
+
+using FakeRegistry = detail::InstanceRegistry<FakeBlock>;
+
+// Gets a fake instance handle.
+VkInstance fakeInstance() {
+  return reinterpret_cast<VkInstance>(uintptr_t(1));
+}
+
+// Releases a reference to a block, as a shared instance does.
+void releaseBlock(FakeRegistry& registry, FakeBlock* block) {
+  if (block->counter.decrement()) registry.release(block);
+}
+
+BOOST_AUTO_TEST_CASE( ExtensionOrderAndDuplicatesDoNotChangeTheKey ) {
+  const auto key = detail::instanceKey("app", "engine",
+    { "VK_KHR_xcb_surface", "VK_EXT_debug_report" }, {}, apiVersion, "");
+  BOOST_CHECK_EQUAL( key, detail::instanceKey("app", "engine",
+    { "VK_EXT_debug_report", "VK_KHR_xcb_surface", "VK_EXT_debug_report" },
+    {}, apiVersion, "") );
+}
+
+BOOST_AUTO_TEST_CASE( LayerOrderAndOtherParametersChangeTheKey ) {
+  const std::vector<const char*> layers = { "first", "second" };
+  const auto key = detail::instanceKey("app", "engine", {}, layers,
+                                       apiVersion, "");
+
+  BOOST_CHECK( key != detail::instanceKey("app", "engine", {},
+                        { "second", "first" }, apiVersion, "") );
+  BOOST_CHECK( key != detail::instanceKey("app", "engine", {}, layers,
+                        VK_MAKE_VERSION(1, 1, 0), "") );
+  BOOST_CHECK( key != detail::instanceKey("app2", "engine", {}, layers,
+                        apiVersion, "") );
+
+  // A name which moves between the fields gives a different key.
+  BOOST_CHECK( detail::instanceKey("ab", "", {}, {}, apiVersion, "") !=
+               detail::instanceKey("a", "b", {}, {}, apiVersion, "") );
+  BOOST_CHECK( detail::instanceKey("", "", { "x" }, {}, apiVersion, "") !=
+               detail::instanceKey("", "", {}, { "x" }, apiVersion, "") );
+
+  // Instances with different capability caches are not shared.
+  BOOST_CHECK( key != detail::instanceKey("app", "engine", {}, layers,
+                        apiVersion, "devices.cache") );
+}
+
+BOOST_AUTO_TEST_CASE( TryIncrementFailsOnceTheLastReferenceIsReleased ) {
+  ConcurrentReferenceCounter counter;
+  counter.initialize();
+  BOOST_CHECK( counter.tryIncrement() );
+  BOOST_CHECK_EQUAL( counter.count(), 2u );
+  BOOST_CHECK( !counter.decrement() );
+  BOOST_CHECK( counter.decrement() );
+  BOOST_CHECK( !counter.tryIncrement() );
+  BOOST_CHECK_EQUAL( counter.count(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( RegistrySharesLiveInstancesByKey ) {
+  FakeRegistry registry;
+  createdBlocks = 0;
+  auto* first  = registry.acquire("a", fakeInstance());
+  auto* second = registry.acquire("a", fakeInstance());
+  auto* other  = registry.acquire("b", fakeInstance());
+  BOOST_CHECK( first == second );
+  BOOST_CHECK( first != other );
+  BOOST_CHECK_EQUAL( first->counter.count(), 2u );
+  BOOST_CHECK_EQUAL( createdBlocks, 2 );
+
+  releaseBlock(registry, first);
+  releaseBlock(registry, second);
+  releaseBlock(registry, other);
+  BOOST_CHECK_EQUAL( liveBlocks, 0 );
+
+  // Once the last reference is released the instance is created again.
+  auto* recreated = registry.acquire("a", fakeInstance());
+  BOOST_CHECK_EQUAL( createdBlocks, 3 );
+  releaseBlock(registry, recreated);
+  BOOST_CHECK_EQUAL( liveBlocks, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( RegistryReplacesInstancesWhichAreBeingReleased ) {
+  FakeRegistry registry;
+  auto* releasing = registry.acquire("a", fakeInstance());
+
+  // The last reference is dropped, but the block hasn't been removed yet,
+  // so it can't be shared, and a replacement is created.
+  BOOST_REQUIRE( releasing->counter.decrement() );
+  auto* replacement = registry.acquire("a", fakeInstance());
+  BOOST_CHECK( replacement != releasing );
+
+  // Releasing the old block must not remove the replacement.
+  registry.release(releasing);
+  auto* shared = registry.acquire("a", fakeInstance());
+  BOOST_CHECK( shared == replacement );
+  releaseBlock(registry, shared);
+  releaseBlock(registry, replacement);
+  BOOST_CHECK_EQUAL( liveBlocks, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( RegistryDoesNotShareFailedInstances ) {
+  FakeRegistry registry;
+  auto* first  = registry.acquire("a", VkInstance(VK_NULL_HANDLE));
+  auto* second = registry.acquire("a", VkInstance(VK_NULL_HANDLE));
+  BOOST_CHECK( first != second );
+  releaseBlock(registry, first);
+  releaseBlock(registry, second);
+  BOOST_CHECK_EQUAL( liveBlocks, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( ConcurrentAcquiresCreateOneInstance ) {
+  FakeRegistry registry;
+  constexpr int threadCount = 8;
+  createdBlocks = 0;
+
+  std::vector<FakeBlock*>  blocks(threadCount);
+  std::vector<std::thread> threads;
+  for (int threadIdx = 0; threadIdx < threadCount; ++threadIdx) {
+    threads.emplace_back([&registry, &blocks, threadIdx] {
+      blocks[threadIdx] = registry.acquire("a", fakeInstance());
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  BOOST_CHECK_EQUAL( createdBlocks, 1 );
+  BOOST_CHECK_EQUAL( blocks[0]->counter.count(), uint32_t(threadCount) );
+  for (auto* block : blocks) releaseBlock(registry, block);
+  BOOST_CHECK_EQUAL( liveBlocks, 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
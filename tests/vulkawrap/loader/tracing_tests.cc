@@ -0,0 +1,151 @@
+//---- tests/vulkawrap/loader/tracing_tests.cc ------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  tracing_tests.cc
+/// \brief Tests the tracing of Vulkan calls for Vulkawrap, by calling mock
+///        functions through traced entries.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapTracingTests
+#endif
+
+#include "vulkawrap/loader/dispatch.h"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapTracingSuite )
+
+using namespace vwrap;
+using namespace vwrap::loader;
+
+static constexpr auto waitIdleId =
+  static_cast<uint32_t>(VulkanFunction::vkQueueWaitIdle);
+static constexpr auto destroyFenceId =
+  static_cast<uint32_t>(VulkanFunction::vkDestroyFence);
+
+using TracedWaitIdle     = TracedEntry<PFN_vkQueueWaitIdle, waitIdleId>;
+using TracedDestroyFence = TracedEntry<PFN_vkDestroyFence, destroyFenceId>;
+
+static int destroyedFences = 0;
+
+VkResult VKAPI_PTR mockQueueWaitIdle(VkQueue) {
+  return VK_TIMEOUT;
+}
+
+void VKAPI_PTR mockDestroyFence(VkDevice, VkFence,
+    const VkAllocationCallbacks*) {
+  ++destroyedFences;
+}
+
+// Records the names of the spans which are emitted.
+void recordSpan(const char* name, uint64_t beginNs, uint64_t endNs,
+    void* user) {
+  BOOST_CHECK( beginNs <= endNs );
+  static_cast<std::vector<std::string>*>(user)->push_back(name);
+}
+
+BOOST_AUTO_TEST_CASE( TableEntriesArePlainPointersUnlessTracing ) {
+  using WaitIdleEntry = Entry<PFN_vkQueueWaitIdle, waitIdleId>;
+  BOOST_CHECK( (std::is_same<WaitIdleEntry, PFN_vkQueueWaitIdle>::value ==
+                (config::TracingCx != config::EnabledCx)) );
+  BOOST_CHECK_EQUAL( std::string(functionName(waitIdleId)),
+                     "vkQueueWaitIdle" );
+}
+
+BOOST_AUTO_TEST_CASE( TracedCallsAreCountedAndForwarded ) {
+  const auto before = traceSnapshot();
+
+  TracedWaitIdle     waitIdle     = mockQueueWaitIdle;
+  TracedDestroyFence destroyFence = nullptr;
+  BOOST_CHECK( destroyFence == nullptr );
+  destroyFence = mockDestroyFence;
+
+  destroyedFences = 0;
+  BOOST_CHECK_EQUAL( waitIdle(VK_NULL_HANDLE), VK_TIMEOUT );
+  BOOST_CHECK_EQUAL( waitIdle(VK_NULL_HANDLE), VK_TIMEOUT );
+  destroyFence(VK_NULL_HANDLE, VK_NULL_HANDLE, nullptr);
+  BOOST_CHECK_EQUAL( destroyedFences, 1 );
+
+  const auto interval = traceSnapshot().since(before);
+  const auto& waits   = interval.functions[waitIdleId];
+  BOOST_CHECK_EQUAL( std::string(waits.name), "vkQueueWaitIdle" );
+  BOOST_CHECK_EQUAL( waits.calls, 2u );
+  BOOST_CHECK_EQUAL( interval.functions[destroyFenceId].calls, 1u );
+
+  uint64_t bucketed = 0;
+  for (const auto count : waits.buckets) bucketed += count;
+  BOOST_CHECK_EQUAL( bucketed, waits.calls );
+  BOOST_CHECK( waits.maxNs <= waits.totalNs );
+}
+
+BOOST_AUTO_TEST_CASE( CallsFromAllThreadsAreSummed ) {
+  const auto before = traceSnapshot();
+  constexpr int threadCount = 4, callsPerThread = 100;
+
+  TracedWaitIdle waitIdle = mockQueueWaitIdle;
+  std::vector<std::thread> threads;
+  for (int threadIdx = 0; threadIdx < threadCount; ++threadIdx) {
+    threads.emplace_back([&waitIdle] () {
+      for (int callIdx = 0; callIdx < callsPerThread; ++callIdx)
+        waitIdle(VK_NULL_HANDLE);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  const auto interval = traceSnapshot().since(before);
+  BOOST_CHECK_EQUAL( interval.functions[waitIdleId].calls,
+                     uint64_t(threadCount * callsPerThread) );
+}
+
+BOOST_AUTO_TEST_CASE( CallsOfExitedThreadsAreKept ) {
+  const auto before = traceSnapshot();
+  constexpr int threadCount = 4, callsPerThread = 100;
+
+  // Each thread exits before the next starts, so they share counters.
+  TracedWaitIdle waitIdle = mockQueueWaitIdle;
+  for (int threadIdx = 0; threadIdx < threadCount; ++threadIdx) {
+    std::thread thread([&waitIdle] () {
+      for (int callIdx = 0; callIdx < callsPerThread; ++callIdx)
+        waitIdle(VK_NULL_HANDLE);
+    });
+    thread.join();
+  }
+
+  const auto interval = traceSnapshot().since(before);
+  BOOST_CHECK_EQUAL( interval.functions[waitIdleId].calls,
+                     uint64_t(threadCount * callsPerThread) );
+}
+
+BOOST_AUTO_TEST_CASE( SpansAreEmittedToTheCallback ) {
+  std::vector<std::string> spans;
+  setTraceSpanCallback(recordSpan, &spans);
+
+  TracedWaitIdle waitIdle = mockQueueWaitIdle;
+  waitIdle(VK_NULL_HANDLE);
+  setTraceSpanCallback(nullptr);
+  waitIdle(VK_NULL_HANDLE);
+
+  // Setting the same callback again emits to the same data.
+  setTraceSpanCallback(recordSpan, &spans);
+  waitIdle(VK_NULL_HANDLE);
+  setTraceSpanCallback(nullptr);
+
+  BOOST_CHECK( (spans == std::vector<std::string>{
+                 "vkQueueWaitIdle", "vkQueueWaitIdle" }) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
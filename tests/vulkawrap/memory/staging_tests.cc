@@ -0,0 +1,142 @@
+//---- tests/vulkawrap/memory/staging_tests.cc -------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  staging_tests.cc
+/// \brief Tests the staging ring for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapStagingTests
+#endif
+
+#include "../device/mock_driver.h"
+#include "vulkawrap/memory/staging.h"
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapStagingSuite )
+
+using namespace vwrap;
+
+// The size of the rings in the tests.
+static constexpr VkDeviceSize RingSizeCx = 256;
+
+// Makes the device finish everything which has been submitted to it.
+void completeSubmissions() {
+  mock::counts().completedSubmits = mock::counts().submits.load();
+}
+
+BOOST_AUTO_TEST_CASE( StagingRingWrapsAroundRetiredUploads ) {
+  mock::MockDevice mock;
+  MemoryAllocator  allocator(mock.device, 4096);
+  {
+    StagingRing staging(mock.device, allocator, RingSizeCx);
+    const auto  vkBuffer = mock::fakeHandle<VkBuffer>(1);
+
+    auto first = staging.reserve(160);
+    BOOST_REQUIRE( first.valid() );
+    BOOST_CHECK_EQUAL( first.offset, 0u );
+    staging.copyToBuffer(first, vkBuffer, 0);
+    BOOST_CHECK( staging.flush() != 0 );
+    BOOST_CHECK_EQUAL( mock::counts().bufferCopies.load(), 1 );
+    completeSubmissions();
+
+    auto second = staging.reserve(64);
+    BOOST_CHECK_EQUAL( second.offset, 160u );
+
+    // There is no room at the end of the ring, so the next range wraps to
+    // the start, which the completed upload no longer holds.
+    auto third = staging.reserve(64);
+    BOOST_REQUIRE( third.valid() );
+    BOOST_CHECK_EQUAL( third.offset, 0u );
+    BOOST_CHECK( third.data == first.data );
+    BOOST_CHECK_EQUAL( mock::counts().fenceWaits.load(), 0 );
+  }
+  BOOST_CHECK_EQUAL( mock::counts().liveBuffers.load(), 0 );
+  BOOST_CHECK_EQUAL( mock::counts().liveFences.load(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( StagingRingReusesSubmissionsWhenTheirFenceSignals ) {
+  mock::MockDevice mock;
+  MemoryAllocator  allocator(mock.device, 4096);
+  StagingRing      staging(mock.device, allocator, RingSizeCx);
+  const auto       vkBuffer = mock::fakeHandle<VkBuffer>(1);
+  const char       data[16] = {};
+
+  // An upload which is still executing keeps its fence and command buffer.
+  BOOST_CHECK( staging.upload(data, sizeof(data), vkBuffer) );
+  staging.flush();
+  staging.retire();
+  BOOST_CHECK( staging.upload(data, sizeof(data), vkBuffer) );
+  staging.flush();
+  BOOST_CHECK_EQUAL( mock::counts().liveFences.load(), 2 );
+
+  // Once the device finishes, retiring frees them for the next flush,
+  // without waiting.
+  completeSubmissions();
+  staging.retire();
+  BOOST_CHECK( staging.upload(data, sizeof(data), vkBuffer) );
+  staging.flush();
+  BOOST_CHECK_EQUAL( mock::counts().liveFences.load(), 2 );
+  BOOST_CHECK_EQUAL( mock::counts().resetFences.load(), 1 );
+  BOOST_CHECK_EQUAL( mock::counts().fenceWaits.load(), 0 );
+  BOOST_CHECK_EQUAL( mock::counts().submits.load(), 3 );
+}
+
+BOOST_AUTO_TEST_CASE( StagingRingWaitsWhenFull ) {
+  mock::MockDevice mock;
+  MemoryAllocator  allocator(mock.device, 4096);
+  StagingRing      staging(mock.device, allocator, RingSizeCx);
+  const auto       vkBuffer = mock::fakeHandle<VkBuffer>(1);
+
+  // The flushed upload holds the whole ring, so the reserve waits for it.
+  staging.copyToBuffer(staging.reserve(RingSizeCx), vkBuffer, 0);
+  staging.flush();
+  auto range = staging.reserve(64);
+  BOOST_CHECK( range.valid() );
+  BOOST_CHECK_EQUAL( mock::counts().fenceWaits.load(), 1 );
+
+  // When the copies holding the ring haven't been flushed, the reserve
+  // flushes them before it waits.
+  staging.copyToBuffer(range, vkBuffer, 0);
+  staging.copyToBuffer(staging.reserve(RingSizeCx - 64), vkBuffer, 0);
+  BOOST_CHECK( staging.reserve(RingSizeCx).valid() );
+  BOOST_CHECK_EQUAL( mock::counts().submits.load(), 2 );
+  BOOST_CHECK_EQUAL( mock::counts().fenceWaits.load(), 2 );
+
+  // A range which is larger than the ring never fits.
+  BOOST_CHECK( !staging.reserve(RingSizeCx + 1).valid() );
+}
+
+// Fails to allocate command buffers.
+VkResult VKAPI_PTR failAllocateCommandBuffers(VkDevice,
+    const VkCommandBufferAllocateInfo*, VkCommandBuffer*) {
+  return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+}
+
+BOOST_AUTO_TEST_CASE( StagingRingKeepsCopiesWhenFlushFails ) {
+  auto functions = mock::mockDispatch();
+  functions.vkAllocateCommandBuffers = failAllocateCommandBuffers;
+
+  mock::MockDevice mock(1, functions);
+  MemoryAllocator  allocator(mock.device, 4096);
+  StagingRing      staging(mock.device, allocator, RingSizeCx);
+  const char       data[16] = {};
+
+  BOOST_CHECK( staging.upload(data, sizeof(data),
+                              mock::fakeHandle<VkBuffer>(1)) );
+  BOOST_CHECK_EQUAL( staging.flush(), 0u );
+  BOOST_CHECK_EQUAL( mock::counts().submits.load(), 0 );
+  BOOST_CHECK_EQUAL( mock::counts().liveFences.load(), 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,245 @@
+//---- tests/vulkawrap/memory/sub_allocators_tests.cc ------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  sub_allocators_tests.cc
+/// \brief Tests the sub allocation strategies for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapSubAllocatorTests
+#endif
+
+#include "vulkawrap/memory/sub_allocators.h"
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapSubAllocatorSuite )
+
+using namespace vwrap;
+
+BOOST_AUTO_TEST_CASE( TlsfAllocatesTheWholeRange ) {
+  TlsfAllocator allocator(1024);
+  auto allocation = allocator.allocate(1024);
+
+  BOOST_CHECK( allocation.valid() );
+  BOOST_CHECK( allocation.offset == 0 );
+  BOOST_CHECK( !allocator.allocate(1).valid() );
+}
+
+BOOST_AUTO_TEST_CASE( TlsfFailsWhenTheRangeIsTooSmall ) {
+  TlsfAllocator allocator(1024);
+  BOOST_CHECK( !allocator.allocate(1025).valid() );
+}
+
+BOOST_AUTO_TEST_CASE( TlsfFailsWhenTheAlignedSizeOverflows ) {
+  TlsfAllocator allocator(1024);
+  BOOST_CHECK( !allocator.allocate(UINT64_MAX, 2).valid() );
+  BOOST_CHECK( !allocator.allocate(16, UINT64_MAX).valid() );
+  BOOST_CHECK( allocator.allocate(1024).valid() );
+}
+
+BOOST_AUTO_TEST_CASE( TlsfAlignsAllocations ) {
+  TlsfAllocator allocator(4096);
+  allocator.allocate(3);
+  auto allocation = allocator.allocate(100, 256);
+
+  BOOST_CHECK( allocation.valid() );
+  BOOST_CHECK( allocation.offset % 256 == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( TlsfReusesAlignmentPadding ) {
+  TlsfAllocator allocator(4096);
+  allocator.allocate(3);
+  allocator.allocate(100, 256);
+
+  // The padding between the first two allocations is free.
+  auto allocation = allocator.allocate(16);
+  BOOST_CHECK( allocation.valid() );
+  BOOST_CHECK( allocation.offset < 256 );
+}
+
+BOOST_AUTO_TEST_CASE( TlsfMergesFreedNeighbours ) {
+  TlsfAllocator allocator(3000);
+  auto first  = allocator.allocate(1000);
+  auto second = allocator.allocate(1000);
+  auto third  = allocator.allocate(1000);
+
+  allocator.free(first.handle);
+  allocator.free(third.handle);
+  allocator.free(second.handle);
+  BOOST_CHECK( allocator.empty() );
+
+  // Only possible if all the regions were merged back together.
+  BOOST_CHECK( allocator.allocate(3000).valid() );
+}
+
+BOOST_AUTO_TEST_CASE( TlsfAllocationsNeverOverlap ) {
+  const VkDeviceSize size = 1 << 20;
+  TlsfAllocator              allocator(size);
+  std::vector<SubAllocation> allocations;
+  std::mt19937               generator(42);
+
+  for (int iteration = 0; iteration < 5000; ++iteration) {
+    if (!allocations.empty() && generator() % 3 == 0) {
+      const auto index = generator() % allocations.size();
+      allocator.free(allocations[index].handle);
+      allocations.erase(allocations.begin() + index);
+      continue;
+    }
+    const auto allocation = allocator.allocate(1 + generator() % 4096,
+                                               1ull << (generator() % 9));
+    if (allocation.valid()) allocations.push_back(allocation);
+  }
+
+  std::sort(allocations.begin(), allocations.end(),
+    [] (const SubAllocation& a, const SubAllocation& b) {
+      return a.offset < b.offset;
+    });
+  bool overlaps = false;
+  for (size_t i = 1; i < allocations.size(); ++i) {
+    const auto& previous = allocations[i - 1];
+    overlaps |= previous.offset + previous.size > allocations[i].offset;
+  }
+  BOOST_CHECK( !overlaps );
+  BOOST_CHECK( allocations.back().offset + allocations.back().size <= size );
+
+  for (const auto& allocation : allocations)
+    allocator.free(allocation.handle);
+  BOOST_CHECK( allocator.empty() );
+  BOOST_CHECK( allocator.allocate(size).valid() );
+}
+
+BOOST_AUTO_TEST_CASE( LinearAllocatesInOrderAndResets ) {
+  LinearAllocator allocator(1024);
+  auto first  = allocator.allocate(10);
+  auto second = allocator.allocate(10, 64);
+
+  BOOST_CHECK( first.offset  == 0  );
+  BOOST_CHECK( second.offset == 64 );
+  BOOST_CHECK( !allocator.allocate(1024).valid() );
+
+  allocator.reset();
+  BOOST_CHECK( allocator.allocate(1024).valid() );
+}
+
+BOOST_AUTO_TEST_CASE( LinearAllocationsFromThreadsNeverOverlap ) {
+  LinearAllocator            allocator(4 * 1000 * 16);
+  std::vector<VkDeviceSize>  offsets[4];
+  std::vector<std::thread>   threads;
+  for (int threadIdx = 0; threadIdx < 4; ++threadIdx) {
+    threads.emplace_back([&allocator, &offsets, threadIdx] {
+      for (int allocationIdx = 0; allocationIdx < 1000; ++allocationIdx)
+        offsets[threadIdx].push_back(allocator.allocate(16, 16).offset);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::vector<VkDeviceSize> allOffsets;
+  for (const auto& threadOffsets : offsets)
+    allOffsets.insert(allOffsets.end(), threadOffsets.begin(),
+                      threadOffsets.end());
+  std::sort(allOffsets.begin(), allOffsets.end());
+  BOOST_CHECK( std::adjacent_find(allOffsets.begin(), allOffsets.end()) ==
+               allOffsets.end() );
+  BOOST_CHECK( allocator.usedSize() == 4 * 1000 * 16 );
+}
+
+BOOST_AUTO_TEST_CASE( RingWrapsWhenTheEndIsTooSmall ) {
+  RingAllocator allocator(1000);
+  allocator.allocate(600);
+  allocator.retire(allocator.head());
+
+  auto allocation = allocator.allocate(600);
+  BOOST_CHECK( allocation.valid() );
+  BOOST_CHECK( allocation.offset == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( RingFailsUntilRegionsAreRetired ) {
+  RingAllocator allocator(1000);
+  allocator.allocate(400);
+  const auto firstEnd = allocator.head();
+  allocator.allocate(400);
+
+  BOOST_CHECK( !allocator.allocate(400).valid() );
+  allocator.retire(firstEnd);
+
+  auto allocation = allocator.allocate(400);
+  BOOST_CHECK( allocation.valid() );
+  BOOST_CHECK( allocation.offset == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( RingAlignsAllocations ) {
+  RingAllocator allocator(1024);
+  allocator.allocate(3);
+  auto allocation = allocator.allocate(16, 64);
+  BOOST_CHECK( allocation.offset == 64 );
+  BOOST_CHECK( allocator.usedSize() == 80 );
+}
+
+BOOST_AUTO_TEST_CASE( PoolAllocatesEverySlotOnce ) {
+  PoolAllocator allocator(256, 4);
+  std::vector<VkDeviceSize> offsets;
+  for (int slotIdx = 0; slotIdx < 4; ++slotIdx)
+    offsets.push_back(allocator.allocate().offset);
+
+  std::sort(offsets.begin(), offsets.end());
+  BOOST_CHECK( (offsets == std::vector<VkDeviceSize>{ 0, 256, 512, 768 }) );
+  BOOST_CHECK( !allocator.allocate().valid() );
+}
+
+BOOST_AUTO_TEST_CASE( PoolReusesFreedSlots ) {
+  PoolAllocator allocator(64, 1);
+  auto allocation = allocator.allocate();
+  allocator.free(allocation.handle);
+  BOOST_CHECK( allocator.allocate().valid() );
+}
+
+BOOST_AUTO_TEST_CASE( PoolIgnoresFreeOfFailedAllocation ) {
+  PoolAllocator allocator(64, 1);
+  auto allocation = allocator.allocate();
+  auto failed     = allocator.allocate();
+  BOOST_REQUIRE( !failed.valid() );
+
+  // Freeing the failed allocation must not put a slot back on the list.
+  allocator.free(failed.handle);
+  allocator.free(allocation.handle);
+  BOOST_CHECK( allocator.allocate().valid() );
+  BOOST_CHECK( !allocator.allocate().valid() );
+}
+
+BOOST_AUTO_TEST_CASE( PoolSlotsAreNeverSharedAcrossThreads ) {
+  PoolAllocator            allocator(1, 8);
+  std::vector<int>         owners(8, -1);
+  std::atomic<bool>        shared(false);
+  std::vector<std::thread> threads;
+  for (int threadIdx = 0; threadIdx < 4; ++threadIdx) {
+    threads.emplace_back([&, threadIdx] {
+      for (int iteration = 0; iteration < 20000; ++iteration) {
+        auto allocation = allocator.allocate();
+        if (!allocation.valid()) continue;
+        auto& owner = owners[allocation.handle];
+        if (owner != -1) shared = true;
+        owner = threadIdx;
+        owner = -1;
+        allocator.free(allocation.handle);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  BOOST_CHECK( !shared );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+//---- tests/vulkawrap/util/handle_tests.cc ---------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//                          
+//                      Copyright (c) 2016 Rob Clucas        
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  handle_tests.cc
+/// \brief Tests the unique and shared handle functionality for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapHandleTests
+#endif
+
+#include "vulkawrap/device/handles.h"
+#include "vulkawrap/util/handle.hpp"
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapHandleSuite )
+
+// Fake handle type, which is a pointer like dispatchable Vulkan handles.
+struct FakeObject {};
+using FakeHandle = FakeObject*;
+
+// Number of handles which have been destroyed by the deleters.
+static int destroyedCount = 0;
+
+// Deleter without state, which counts the destroyed handles.
+struct CountingDeleter {
+  void operator()(FakeHandle) const { ++destroyedCount; }
+};
+
+// Deleter with state, which counts into its own counter.
+struct StatefulDeleter {
+  int* counter = nullptr;
+  void operator()(FakeHandle) const { ++*counter; }
+};
+
+using UniqueFake           = vwrap::UniqueHandle<FakeHandle, CountingDeleter>;
+using ConcurrentSharedFake = vwrap::SharedHandle<
+  FakeHandle, CountingDeleter, vwrap::ConcurrentReferenceCounter>;
+using NonConcurrentSharedFake = vwrap::SharedHandle<
+  FakeHandle, CountingDeleter, vwrap::NonConcurrentReferenceCounter>;
+
+BOOST_AUTO_TEST_CASE( UniqueHandlesWithEmptyDeletersAreTheSizeOfTheHandle ) {
+  static_assert(sizeof(UniqueFake) == sizeof(FakeHandle), "");
+  static_assert(sizeof(vwrap::UniqueBuffer) == 
+                sizeof(VkBuffer) + sizeof(void*), "");
+  BOOST_CHECK( true );
+}
+
+BOOST_AUTO_TEST_CASE( UniqueHandleDestroysItsHandleOnce ) {
+  FakeObject object;
+  destroyedCount = 0;
+  {
+    UniqueFake handle(&object);
+    UniqueFake movedHandle(std::move(handle));
+    BOOST_CHECK( !handle );
+    BOOST_CHECK( movedHandle.get() == &object );
+  }
+  BOOST_CHECK( destroyedCount == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( UniqueHandleMoveAssignmentDestroysTheOldHandle ) {
+  FakeObject first, second;
+  int        counter = 0;
+  {
+    vwrap::UniqueHandle<FakeHandle, StatefulDeleter> 
+      firstHandle(&first, StatefulDeleter{&counter}),
+      secondHandle(&second, StatefulDeleter{&counter});
+    firstHandle = std::move(secondHandle);
+    BOOST_CHECK( counter == 1 );
+    BOOST_CHECK( firstHandle.get() == &second );
+  }
+  BOOST_CHECK( counter == 2 );
+}
+
+BOOST_AUTO_TEST_CASE( UniqueHandleReleaseDoesNotDestroy ) {
+  FakeObject object;
+  destroyedCount = 0;
+  {
+    UniqueFake handle(&object);
+    BOOST_CHECK( handle.release() == &object );
+  }
+  BOOST_CHECK( destroyedCount == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( SharedHandleIsDestroyedByTheLastReference ) {
+  FakeObject object;
+  destroyedCount = 0;
+  {
+    NonConcurrentSharedFake handle(&object);
+    {
+      NonConcurrentSharedFake copy(handle);
+      BOOST_CHECK( handle.useCount() == 2 );
+    }
+    BOOST_CHECK( destroyedCount == 0 );
+    BOOST_CHECK( handle.useCount() == 1 );
+  }
+  BOOST_CHECK( destroyedCount == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( SharedHandleMovesDoNotChangeTheCount ) {
+  FakeObject object;
+  destroyedCount = 0;
+  {
+    NonConcurrentSharedFake handle(&object);
+    NonConcurrentSharedFake moved(std::move(handle));
+    BOOST_CHECK( !handle );
+    BOOST_CHECK( moved.useCount() == 1 );
+
+    NonConcurrentSharedFake assigned;
+    assigned = std::move(moved);
+    BOOST_CHECK( assigned.useCount() == 1 );
+    BOOST_CHECK( assigned.get() == &object );
+  }
+  BOOST_CHECK( destroyedCount == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( SharedHandleCanBeMadeFromAUniqueHandle ) {
+  FakeObject object;
+  destroyedCount = 0;
+  {
+    UniqueFake           unique(&object);
+    ConcurrentSharedFake shared(std::move(unique));
+    BOOST_CHECK( !unique );
+    BOOST_CHECK( shared.get() == &object );
+  }
+  BOOST_CHECK( destroyedCount == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( ConcurrentSharedHandleIsDestroyedOnceAcrossThreads ) {
+  FakeObject object;
+  destroyedCount = 0;
+  {
+    ConcurrentSharedFake     handle(&object);
+    std::vector<std::thread> threads;
+    for (int threadIdx = 0; threadIdx < 4; ++threadIdx) {
+      threads.emplace_back([handle] {
+        for (int copyIdx = 0; copyIdx < 10000; ++copyIdx)
+          ConcurrentSharedFake copy(handle);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    BOOST_CHECK( handle.useCount() == 1 );
+  }
+  BOOST_CHECK( destroyedCount == 1 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+//---- tests/vulkawrap/util/job_system_tests.cc ------------ -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  job_system_tests.cc
+/// \brief Tests the work stealing deque and the job system for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapJobSystemTests
+#endif
+
+#include "vulkawrap/util/job_system.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapJobSystemSuite )
+
+BOOST_AUTO_TEST_CASE( DequeOwnerPopsInLastInFirstOutOrder ) {
+  vwrap::util::WorkStealingDeque<int> deque(4);
+  int items[3] = { 0, 1, 2 };
+  for (auto& item : items) BOOST_CHECK( deque.push(&item) );
+
+  BOOST_CHECK( deque.pop() == &items[2] );
+  BOOST_CHECK( deque.steal() == &items[0] );
+  BOOST_CHECK( deque.pop() == &items[1] );
+  BOOST_CHECK( deque.pop() == nullptr );
+  BOOST_CHECK( deque.steal() == nullptr );
+}
+
+BOOST_AUTO_TEST_CASE( DequePushFailsWhenFull ) {
+  vwrap::util::WorkStealingDeque<int> deque(2);
+  int items[3] = { 0, 1, 2 };
+  BOOST_CHECK( deque.push(&items[0]) );
+  BOOST_CHECK( deque.push(&items[1]) );
+  BOOST_CHECK( !deque.push(&items[2]) );
+
+  BOOST_CHECK( deque.steal() == &items[0] );
+  BOOST_CHECK( deque.push(&items[2]) );
+}
+
+BOOST_AUTO_TEST_CASE( DequeItemsAreTakenExactlyOnce ) {
+  const int itemCount   = 100000;
+  const int thiefCount  = 3;
+  std::vector<int> items(itemCount);
+  std::vector<std::atomic<int>> taken(itemCount);
+  for (auto& count : taken) count.store(0);
+
+  vwrap::util::WorkStealingDeque<int> deque(256);
+  std::atomic<bool> done(false);
+  std::vector<std::thread> thieves;
+  for (int thiefIdx = 0; thiefIdx < thiefCount; ++thiefIdx) {
+    thieves.emplace_back([&] {
+      while (!done.load()) {
+        if (auto item = deque.steal()) ++taken[item - items.data()];
+      }
+    });
+  }
+
+  // The owner pushes everything, and pops some of it back, while the thieves
+  // steal the rest.
+  for (int itemIdx = 0; itemIdx < itemCount; ++itemIdx) {
+    while (!deque.push(&items[itemIdx])) {
+      if (auto item = deque.pop()) ++taken[item - items.data()];
+    }
+    if (itemIdx % 3 == 0) {
+      if (auto item = deque.pop()) ++taken[item - items.data()];
+    }
+  }
+  while (auto item = deque.pop()) ++taken[item - items.data()];
+  done.store(true);
+  for (auto& thief : thieves) thief.join();
+
+  int wrongCount = 0;
+  for (const auto& count : taken) wrongCount += count.load() != 1;
+  BOOST_CHECK_EQUAL( wrongCount, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( ParallelForVisitsEveryIndexOnce ) {
+  for (uint32_t threadCount : { 1u, 2u, 4u }) {
+    vwrap::util::JobSystem jobs(threadCount);
+    BOOST_CHECK_EQUAL( jobs.getThreadCount(), threadCount );
+
+    // Run several loops, so that the workers are reused between them.
+    for (size_t count : { size_t(0), size_t(1), size_t(7), size_t(10000) }) {
+      std::vector<std::atomic<int>> visits(count);
+      for (auto& visit : visits) visit.store(0);
+
+      jobs.parallelFor(count, [&visits] (size_t index) { ++visits[index]; });
+
+      int wrongCount = 0;
+      for (const auto& visit : visits) wrongCount += visit.load() != 1;
+      BOOST_CHECK_EQUAL( wrongCount, 0 );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( ParallelForUsesTheWorkerThreads ) {
+  vwrap::util::JobSystem jobs(4);
+  std::vector<std::thread::id> threadIds(64);
+
+  // Each index takes long enough that the workers steal some of them.
+  jobs.parallelFor(threadIds.size(), [&threadIds] (size_t index) {
+    threadIds[index] = std::this_thread::get_id();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+
+  bool otherThread = false;
+  for (const auto& threadId : threadIds)
+    otherThread |= threadId != std::this_thread::get_id();
+  BOOST_CHECK( otherThread );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+//---- tests/vulkawrap/util/result_tests.cc ---------------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  result_tests.cc
+/// \brief Tests the result checking for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapResultTests
+#endif
+
+#include "vulkawrap/util/assert.hpp"
+#include "vulkawrap/util/result.hpp"
+#include <boost/test/unit_test.hpp>
+#include <boost/test/output_test_stream.hpp>
+#include <cstring>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapResultSuite )
+
+using namespace vwrap::util;
+
+// Redirects the error buffer while it is alive.
+struct ErrorRedirector {
+  ErrorRedirector(std::streambuf* buffer)
+  : OldBuffer(std::cerr.rdbuf(buffer)) {}
+
+  ~ErrorRedirector() {
+    std::cerr.rdbuf(OldBuffer);
+  }
+
+ private:
+  std::streambuf* OldBuffer;
+};
+
+// The names are known at compile time.
+static_assert(resultName(VK_ERROR_OUT_OF_DATE_KHR)[3] == 'E',
+              "Result names must be constant expressions.");
+
+BOOST_AUTO_TEST_CASE( ResultNamesMatchTheirCodes ) {
+  BOOST_CHECK_EQUAL( std::strcmp(resultName(VK_SUCCESS), "VK_SUCCESS"), 0 );
+  BOOST_CHECK_EQUAL( std::strcmp(resultName(VK_ERROR_DEVICE_LOST),
+                                 "VK_ERROR_DEVICE_LOST"), 0 );
+  BOOST_CHECK_EQUAL( std::strcmp(resultName(static_cast<VkResult>(-999)),
+                                 "UNKNOWN_ERROR"), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( ResultsHoldAValueOrAnError ) {
+  const Result<uint32_t> image = 3u;
+  BOOST_CHECK( image.hasValue() );
+  BOOST_CHECK_EQUAL( image.value(), 3u );
+
+  const Result<uint32_t> suboptimal(4u, VK_SUBOPTIMAL_KHR);
+  BOOST_CHECK( static_cast<bool>(suboptimal) );
+  BOOST_CHECK_EQUAL( suboptimal.result(), VK_SUBOPTIMAL_KHR );
+
+  const Result<uint32_t> outOfDate = VK_ERROR_OUT_OF_DATE_KHR;
+  BOOST_CHECK( !outOfDate );
+  BOOST_CHECK_EQUAL( outOfDate.valueOr(7u), 7u );
+}
+
+BOOST_AUTO_TEST_CASE( RecoverableErrorsAreReturnedWithoutReporting ) {
+  boost::test_tools::output_test_stream errorStream;
+  {
+    ErrorRedirector redirect(errorStream.rdbuf());
+    const auto outOfDate = CheckResult(VK_ERROR_OUT_OF_DATE_KHR,
+                                       "Failed to present");
+    BOOST_CHECK_EQUAL( outOfDate.result(), VK_ERROR_OUT_OF_DATE_KHR );
+    BOOST_CHECK( CheckResult(VK_SUCCESS, "Failed to present") );
+  }
+  BOOST_CHECK( errorStream.is_empty(false) );
+
+  {
+    ErrorRedirector redirect(errorStream.rdbuf());
+    const auto lost = CheckResult(VK_ERROR_DEVICE_LOST, "Failed to submit");
+    BOOST_CHECK( !lost );
+  }
+  BOOST_CHECK( errorStream.str().find("VK_ERROR_DEVICE_LOST") !=
+               std::string::npos );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
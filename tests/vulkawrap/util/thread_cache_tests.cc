@@ -0,0 +1,83 @@
+//---- tests/vulkawrap/util/thread_cache_tests.cc ---------- -*- C++ -*- ----//
+//
+//                                Vulkawrap
+//
+//                      Copyright (c) 2016 Rob Clucas
+//                    Distributed under the MIT License
+//                (See accompanying file LICENSE or copy at
+//                    https://opensource.org/licenses/MIT)
+//
+// ========================================================================= //
+//
+/// \file  thread_cache_tests.cc
+/// \brief Tests the per thread cache for Vulkawrap.
+//
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+    #define BOOST_TEST_MODULE VulkawrapThreadCacheTests
+#endif
+
+#include "vulkawrap/util/thread_cache.h"
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( VulkawrapThreadCacheSuite )
+
+using vwrap::util::ThreadCache;
+
+BOOST_AUTO_TEST_CASE( ThreadCacheInitializesOnceForEachThread ) {
+  ThreadCache<int> cache;
+  int initializations = 0;
+  const auto initialize = [&initializations] (int& value) {
+    value = ++initializations;
+  };
+
+  auto& first = cache.get(initialize);
+  BOOST_CHECK( &cache.get(initialize) == &first );
+  BOOST_CHECK_EQUAL( initializations, 1 );
+
+  std::thread other([&] {
+    BOOST_CHECK( &cache.get(initialize) != &first );
+  });
+  other.join();
+  BOOST_CHECK_EQUAL( initializations, 2 );
+
+  // The value of a thread which has exited is kept until the cache is
+  // destroyed.
+  int valueSum = 0;
+  cache.forEach([&valueSum] (int value) { valueSum += value; });
+  BOOST_CHECK_EQUAL( valueSum, 3 );
+}
+
+BOOST_AUTO_TEST_CASE( ThreadCacheEntriesDieWithTheCache ) {
+  // Caches which are created in the same place must never see the values of
+  // the caches which were destroyed before them.
+  for (int cacheIdx = 0; cacheIdx < 1000; ++cacheIdx) {
+    std::unique_ptr<ThreadCache<int>> cache(new ThreadCache<int>());
+    bool initialized = false;
+    cache->get([&initialized] (int&) { initialized = true; });
+    BOOST_REQUIRE( initialized );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( ThreadCacheOutlivesItsThreads ) {
+  std::unique_ptr<ThreadCache<int>> cache(new ThreadCache<int>());
+  std::vector<std::thread> threads;
+  for (int threadIdx = 0; threadIdx < 4; ++threadIdx) {
+    threads.emplace_back([&cache, threadIdx] {
+      cache->get([threadIdx] (int& value) { value = threadIdx; });
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  int valueCount = 0;
+  cache->forEach([&valueCount] (int) { ++valueCount; });
+  BOOST_CHECK_EQUAL( valueCount, 4 );
+  cache.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()